@@ -54,10 +54,14 @@ bool renderBattery(FieldLayout *layout)
   uint16_t ui16_color;
   uint32_t ui32_i;
 
-  layout->height = BATTERY_SOC_BAR_HEIGHT + BATTERY_SOC_CONTOUR * 2;
+  uint32_t ui32_height = BATTERY_SOC_BAR_HEIGHT + BATTERY_SOC_CONTOUR * 2;
 
   // main portion of battery + pad + extra tip
-  layout->width = ((BATTERY_SOC_BAR_WITH + BATTERY_SOC_CONTOUR + 1) * 9) + (BATTERY_SOC_CONTOUR * 3) + BATTERY_SOC_BAR_WITH + 1;
+  uint32_t ui32_width = ((BATTERY_SOC_BAR_WITH + BATTERY_SOC_CONTOUR + 1) * 9) + (BATTERY_SOC_CONTOUR * 3) + BATTERY_SOC_BAR_WITH + 1;
+
+  // the layout is all we draw, so the next screen knows what to clear
+  layout->width = BATTERY_SOC_START_X + ui32_width + 1;
+  layout->height = BATTERY_SOC_START_Y + ui32_height + 1;
 
   bool drawOutline = true; // For now we do this every time, because we are now called to draw ourselves so rarely
   if(drawOutline)
@@ -66,8 +70,8 @@ bool renderBattery(FieldLayout *layout)
     // first 9 bars
     ui32_x1 = BATTERY_SOC_START_X;
     ui32_y1 = BATTERY_SOC_START_Y;
-    ui32_x2 = ui32_x1 + layout->width;
-    ui32_y2 = ui32_y1 + layout->height;
+    ui32_x2 = ui32_x1 + ui32_width;
+    ui32_y2 = ui32_y1 + ui32_height;
     UG_FillFrame(ui32_x1, ui32_y1, ui32_x2, ui32_y2, C_BLACK);
 
     // now draw the empty battery symbol
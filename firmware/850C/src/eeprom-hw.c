@@ -10,121 +10,81 @@
 #include <string.h>
 #include "stm32f10x_flash.h"
 #include "eeprom_hw.h"
+#include "flash_kv.h"
 
 #define EEPROM_START_ADDRESS            0x0807F000
 #define EEPROM_START_ADDRESS_PAGE_0     0x0807F000
 #define EEPROM_START_ADDRESS_PAGE_1     0x0807F800 // last page of 2kbytes of flash memory
 
+// The format before flash_kv.c, a byte per halfword and a full page written on every save. It is
+// only read, to keep the user settings until the first save after an update.
 #define EEPROM_PAGE_KEY_ADDRESS         (1024 - 1)
 #define EEPROM_PAGE_WRITE_ID_ADDRESS    (EEPROM_PAGE_KEY_ADDRESS - 1)
 
 #define EEPROM_MAGIC_KEY                ((uint8_t) 0x5a)
 
-static uint32_t ui32_m_eeprom_page = 0;
+static int8_t i8_m_legacy_page = -1;
 
-static void eeprom_erase_page(uint32_t ui32_eeprom_page);
-static uint8_t eeprom_read(uint32_t ui32_address);
 static uint8_t eeprom_read_from_page(uint32_t ui32_address, uint32_t ui32_eeprom_page);
-// static uint32_t eeprom_write_to_page(uint32_t ui32_address, uint8_t ui8_data, uint32_t ui32_eeprom_page);
 
-void eeprom_hw_init() {
-	// Nothing needed on 850C
-}
-
-// Set eeprom_page based on which page seems like it might be valid
-void find_valid_page()
+// Page with the newest settings in the old format, -1 if there is none
+static int8_t find_legacy_page(void)
 {
-  // check if both EEPROM pages have invalid values and if so, write default values on page 0
-  if((eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 0) != EEPROM_MAGIC_KEY) &&
-	  (eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 1) != EEPROM_MAGIC_KEY))
-  {
-    // setup page 0
-    ui32_m_eeprom_page = 0;
-    eeprom_erase_page(ui32_m_eeprom_page);
-    // write EEPROM_MAGIC_KEY and EEPROM_PAGE WRITE_ID
-    eeprom_write(EEPROM_PAGE_KEY_ADDRESS, EEPROM_MAGIC_KEY);
-    eeprom_write(EEPROM_PAGE_WRITE_ID_ADDRESS, 1); // start with value 1
-  }
-  // check if both EEPROM pages have valid values...
-  else if((eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 0) == EEPROM_MAGIC_KEY) &&
-	  (eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 1) == EEPROM_MAGIC_KEY))
+  bool page_0_valid = eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 0) == EEPROM_MAGIC_KEY;
+  bool page_1_valid = eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 1) == EEPROM_MAGIC_KEY;
+
+  if (page_0_valid && page_1_valid)
   {
-    // now find the page that has a higher write ID
-    if(eeprom_read_from_page(EEPROM_PAGE_WRITE_ID_ADDRESS, 1) > eeprom_read_from_page(EEPROM_PAGE_WRITE_ID_ADDRESS, 0))
-    {
-      ui32_m_eeprom_page = 1;
-    }
+    // the page that has a higher write ID
+    if (eeprom_read_from_page(EEPROM_PAGE_WRITE_ID_ADDRESS, 1) > eeprom_read_from_page(EEPROM_PAGE_WRITE_ID_ADDRESS, 0))
+      return 1;
     else
-    {
-      ui32_m_eeprom_page = 0;
-    }
-  }
-  else if(eeprom_read_from_page(EEPROM_PAGE_KEY_ADDRESS, 0) == EEPROM_MAGIC_KEY)
-  {
-      ui32_m_eeprom_page = 0;
-  }
-  else
-  {
-      ui32_m_eeprom_page = 1;
+      return 0;
   }
+  else if (page_0_valid)
+    return 0;
+  else if (page_1_valid)
+    return 1;
+
+  return -1;
+}
+
+void eeprom_hw_init() {
+  i8_m_legacy_page = find_legacy_page();
+
+  // start the store on the other page, so the old settings are still there if the first save is cut
+  flash_kv_init(i8_m_legacy_page == 0 ? 1 : 0);
 }
 
 // Read raw EEPROM data, return false if it is blank or malformatted
 bool flash_read_words(void *dest, uint16_t length_words)
 {
-  uint8_t ui8_data;
-
-  find_valid_page();
+  if (flash_kv_read(dest, length_words))
+    return true;
 
-  // start by reading address 0 and see if value is different from our key,
-  // if so mean that eeprom memory is clean (or data strucutre is invalid) and we need to populate
-  ui8_data = eeprom_read(ADDRESS_KEY);
-  if(ui8_data != KEY) // verify if our key exist
-	  return false;
+  // nothing saved since the update, use the old format settings if there are
+  if (i8_m_legacy_page < 0 || eeprom_read_from_page(ADDRESS_KEY, i8_m_legacy_page) != KEY)
+    return false;
 
   // read the values from EEPROM to array
   for(int i = 0; i < sizeof(uint32_t) * length_words; i++)
   {
      // we start at EEPROM address 1 as 0 is already in use by the KEY
-     ((uint8_t *) dest)[i] = eeprom_read(1 + i);
+     ((uint8_t *) dest)[i] = eeprom_read_from_page(1 + i, i8_m_legacy_page);
   }
 
   return true;
 }
 
-static void eeprom_write_array(const uint8_t *p_array, uint32_t ui32_len)
-{
-  // write the full array
-  for(uint32_t ui32_i = 0; ui32_i < ui32_len; ui32_i++)
-  {
-    // start at 1 since 0 address is for KEY
-    eeprom_write(1 + ui32_i, *p_array++);
-  }
-}
-
 bool flash_write_words(const void *value, uint16_t length_words)
 {
-  // cycle/increment ui32_eeprom_page, to next page
-  ui32_m_eeprom_page = (ui32_m_eeprom_page + 1) % 2;
-
-  // erase the new page
-  eeprom_erase_page(ui32_m_eeprom_page);
-  // write on the new page
-  eeprom_write_array(value, sizeof(uint32_t) * length_words);
-  // write key
-  eeprom_write(ADDRESS_KEY, KEY);
-  // write EEPROM_MAGIC_KEY and EEPROM_PAGE WRITE_ID
-  eeprom_write(EEPROM_PAGE_KEY_ADDRESS, EEPROM_MAGIC_KEY);
-  uint8_t ui32_eeprom_write_id = eeprom_read_from_page(EEPROM_PAGE_WRITE_ID_ADDRESS, (ui32_m_eeprom_page == 0) ? 1 : 0) + 1;
-  eeprom_write(EEPROM_PAGE_WRITE_ID_ADDRESS, ui32_eeprom_write_id); // write new ID
-
-  return true;
+  return flash_kv_write(value, length_words);
 }
 
-uint8_t eeprom_read(uint32_t ui32_address)
+bool flash_flush(void)
 {
-  uint16_t *ui16_p_address = (uint16_t *) (((uint32_t) EEPROM_START_ADDRESS) + (ui32_m_eeprom_page * 2048) + (ui32_address * 2));
-  return (uint8_t) (*ui16_p_address);
+  // flash_write_words() returns when the data is in flash
+  return true;
 }
 
 uint8_t eeprom_read_from_page(uint32_t ui32_address, uint32_t ui32_eeprom_page)
@@ -133,26 +93,35 @@ uint8_t eeprom_read_from_page(uint32_t ui32_address, uint32_t ui32_eeprom_page)
   return (uint8_t) (*ui16_p_address);
 }
 
-uint32_t eeprom_write(uint32_t ui32_address, uint8_t ui8_data)
+const uint8_t* flash_kv_hw_page(uint8_t ui8_page)
 {
-  ui32_address = ((uint32_t) EEPROM_START_ADDRESS) + (ui32_m_eeprom_page * 2048) + (ui32_address * 2);
+  return (const uint8_t *) (EEPROM_START_ADDRESS + ui8_page * FLASH_KV_PAGE_SIZE);
+}
 
+// once per save, not per halfword
+void flash_kv_hw_unlock(void)
+{
   FLASH_Unlock();
-  if(FLASH_ProgramHalfWord(ui32_address, (uint16_t) ui8_data) != FLASH_COMPLETE)
-  {
-    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
-    FLASH_Lock();
-    return 1;
-  }
-  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+}
+
+void flash_kv_hw_lock(void)
+{
   FLASH_Lock();
+}
+
+bool flash_kv_hw_program_word(uint8_t ui8_page, uint16_t ui16_offset, uint32_t ui32_data)
+{
+  // FLASH_ProgramWord() programs the low halfword first
+  FLASH_Status status = FLASH_ProgramWord(EEPROM_START_ADDRESS + ui8_page * FLASH_KV_PAGE_SIZE + ui16_offset, ui32_data);
 
-  return 0;
+  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+  return status == FLASH_COMPLETE;
 }
 
-void eeprom_erase_page(uint32_t ui32_eeprom_page)
+bool flash_kv_hw_erase(uint8_t ui8_page)
 {
-  FLASH_Unlock();
-  FLASH_ErasePage(((uint32_t) EEPROM_START_ADDRESS) + (ui32_eeprom_page * 2048));
-  FLASH_Lock();
+  FLASH_Status status = FLASH_ErasePage(EEPROM_START_ADDRESS + ui8_page * FLASH_KV_PAGE_SIZE);
+
+  FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+  return status == FLASH_COMPLETE;
 }
@@ -0,0 +1,245 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include <string.h>
+#include "flash_kv.h"
+#include "crc16.h"
+
+#define FLASH_KV_MAGIC      0x314b5642 // "BVK1", value of the header record in slot 0
+#define FLASH_KV_COMMIT     0xfffe     // key of a commit record, its value is the first slot of the save
+#define FLASH_KV_NO_PAGE    0xff
+
+/*
+ * Slot layout, programmed as 2 words with the low halfword first. The check is a CRC of the
+ * value and the key and is never 0xffff, so it is the halfword that makes a record valid and
+ * the last one programmed.
+ */
+typedef struct flash_kv_record_struct
+{
+  uint32_t ui32_value;
+  uint16_t ui16_key; // the generation in the header record
+  uint16_t ui16_check;
+} flash_kv_record_t;
+
+static uint32_t ui32_m_values[FLASH_KV_KEYS];
+static uint8_t ui8_m_present[FLASH_KV_KEYS];
+static uint8_t ui8_m_page = FLASH_KV_NO_PAGE;
+static uint8_t ui8_m_fresh_page;
+static uint16_t ui16_m_generation;
+static uint16_t ui16_m_next_slot;
+
+static uint16_t record_check(uint32_t ui32_value, uint16_t ui16_key)
+{
+  uint8_t ui8_bytes[6] = { ui32_value, ui32_value >> 8, ui32_value >> 16, ui32_value >> 24, ui16_key, ui16_key >> 8 };
+
+  return crc16_buffer(CRC16_INIT, ui8_bytes, sizeof(ui8_bytes)) & 0x7fff;
+}
+
+static void read_record(uint8_t ui8_page, uint16_t ui16_slot, flash_kv_record_t *p_record)
+{
+  memcpy(p_record, flash_kv_hw_page(ui8_page) + ui16_slot * FLASH_KV_RECORD_SIZE, sizeof(*p_record));
+}
+
+static bool record_erased(const flash_kv_record_t *p_record)
+{
+  return p_record->ui32_value == 0xffffffff && p_record->ui16_key == 0xffff && p_record->ui16_check == 0xffff;
+}
+
+static bool record_valid(const flash_kv_record_t *p_record)
+{
+  return p_record->ui16_check == record_check(p_record->ui32_value, p_record->ui16_key);
+}
+
+static bool program_record(uint8_t ui8_page, uint16_t ui16_slot, uint32_t ui32_value, uint16_t ui16_key)
+{
+  uint16_t ui16_offset = ui16_slot * FLASH_KV_RECORD_SIZE;
+  uint32_t ui32_key_check = ui16_key | ((uint32_t) record_check(ui32_value, ui16_key) << 16);
+
+  return flash_kv_hw_program_word(ui8_page, ui16_offset, ui32_value) &&
+      flash_kv_hw_program_word(ui8_page, ui16_offset + 4, ui32_key_check);
+}
+
+static bool page_generation(uint8_t ui8_page, uint16_t *p_ui16_generation)
+{
+  flash_kv_record_t record;
+
+  read_record(ui8_page, 0, &record);
+  if (record.ui32_value != FLASH_KV_MAGIC || !record_valid(&record))
+    return false;
+
+  *p_ui16_generation = record.ui16_key;
+  return true;
+}
+
+// Build the RAM copy from the committed records and find the first free slot
+static void scan_page(uint8_t ui8_page)
+{
+  flash_kv_record_t record;
+  uint16_t ui16_last_used = 0;
+
+  memset(ui8_m_present, 0, sizeof(ui8_m_present));
+
+  for (uint16_t ui16_slot = 1; ui16_slot < FLASH_KV_SLOTS; ui16_slot++)
+  {
+    read_record(ui8_page, ui16_slot, &record);
+
+    // a slot that a power loss cut is not erased either, it is skipped
+    if (record_erased(&record))
+      continue;
+
+    ui16_last_used = ui16_slot;
+
+    if (record.ui16_key != FLASH_KV_COMMIT || !record_valid(&record) ||
+        record.ui32_value == 0 || record.ui32_value >= ui16_slot)
+      continue;
+
+    for (uint16_t ui16_i = record.ui32_value; ui16_i < ui16_slot; ui16_i++)
+    {
+      flash_kv_record_t value;
+
+      read_record(ui8_page, ui16_i, &value);
+      if (value.ui16_key < FLASH_KV_KEYS && record_valid(&value))
+      {
+        ui32_m_values[value.ui16_key] = value.ui32_value;
+        ui8_m_present[value.ui16_key] = 1;
+      }
+    }
+  }
+
+  ui16_m_next_slot = ui16_last_used + 1;
+}
+
+void flash_kv_init(uint8_t ui8_fresh_page)
+{
+  uint16_t ui16_generation[FLASH_KV_PAGES];
+  bool valid_0 = page_generation(0, &ui16_generation[0]);
+  bool valid_1 = page_generation(1, &ui16_generation[1]);
+
+  ui8_m_fresh_page = ui8_fresh_page;
+  memset(ui8_m_present, 0, sizeof(ui8_m_present));
+
+  // after a compaction both pages are valid until the next one, the newer generation wins
+  if (valid_0 && valid_1)
+    ui8_m_page = (int16_t) (ui16_generation[1] - ui16_generation[0]) > 0 ? 1 : 0;
+  else if (valid_0)
+    ui8_m_page = 0;
+  else if (valid_1)
+    ui8_m_page = 1;
+  else
+  {
+    ui8_m_page = FLASH_KV_NO_PAGE;
+    ui16_m_generation = 0;
+    return;
+  }
+
+  ui16_m_generation = ui16_generation[ui8_m_page];
+  scan_page(ui8_m_page);
+}
+
+bool flash_kv_read(uint32_t *p_words, uint16_t ui16_words)
+{
+  if (ui8_m_page == FLASH_KV_NO_PAGE)
+    return false;
+
+  for (uint16_t ui16_i = 0; ui16_i < ui16_words; ui16_i++)
+    p_words[ui16_i] = (ui16_i < FLASH_KV_KEYS && ui8_m_present[ui16_i]) ? ui32_m_values[ui16_i] : 0xffffffff;
+
+  return true;
+}
+
+static bool changed(const uint32_t *p_words, uint16_t ui16_key)
+{
+  return !ui8_m_present[ui16_key] || ui32_m_values[ui16_key] != p_words[ui16_key];
+}
+
+static void update_values(const uint32_t *p_words, uint16_t ui16_words)
+{
+  memcpy(ui32_m_values, p_words, ui16_words * sizeof(uint32_t));
+  memset(ui8_m_present, 1, ui16_words);
+}
+
+// Append the changed words and their commit to the active page
+static bool append(const uint32_t *p_words, uint16_t ui16_words)
+{
+  uint16_t ui16_start = ui16_m_next_slot;
+
+  for (uint16_t ui16_key = 0; ui16_key < ui16_words; ui16_key++)
+  {
+    // a failed save still used the slot
+    if (changed(p_words, ui16_key) && !program_record(ui8_m_page, ui16_m_next_slot++, p_words[ui16_key], ui16_key))
+      return false;
+  }
+
+  if (!program_record(ui8_m_page, ui16_m_next_slot++, ui16_start, FLASH_KV_COMMIT))
+    return false;
+
+  update_values(p_words, ui16_words);
+  return true;
+}
+
+// Write every value to the other page, which becomes the active one when its header is written
+static bool compact(const uint32_t *p_words, uint16_t ui16_words)
+{
+  uint8_t ui8_page = ui8_m_page == FLASH_KV_NO_PAGE ? ui8_m_fresh_page : ui8_m_page ^ 1;
+  uint16_t ui16_slot = 1;
+
+  if (!flash_kv_hw_erase(ui8_page))
+    return false;
+
+  for (uint16_t ui16_key = 0; ui16_key < FLASH_KV_KEYS; ui16_key++)
+  {
+    uint32_t ui32_value;
+
+    if (ui16_key < ui16_words)
+      ui32_value = p_words[ui16_key];
+    else if (ui8_m_present[ui16_key])
+      ui32_value = ui32_m_values[ui16_key];
+    else
+      continue;
+
+    if (!program_record(ui8_page, ui16_slot++, ui32_value, ui16_key))
+      return false;
+  }
+
+  if (!program_record(ui8_page, ui16_slot++, 1, FLASH_KV_COMMIT) ||
+      !program_record(ui8_page, 0, FLASH_KV_MAGIC, ui16_m_generation + 1))
+    return false;
+
+  ui8_m_page = ui8_page;
+  ui16_m_generation++;
+  ui16_m_next_slot = ui16_slot;
+  update_values(p_words, ui16_words);
+  return true;
+}
+
+bool flash_kv_write(const uint32_t *p_words, uint16_t ui16_words)
+{
+  uint16_t ui16_changed = 0;
+  bool ok;
+
+  if (ui16_words > FLASH_KV_KEYS)
+    return false;
+
+  for (uint16_t ui16_key = 0; ui16_key < ui16_words; ui16_key++)
+  {
+    if (changed(p_words, ui16_key))
+      ui16_changed++;
+  }
+
+  if (ui16_changed == 0 && ui8_m_page != FLASH_KV_NO_PAGE)
+    return true;
+
+  flash_kv_hw_unlock();
+  if (ui8_m_page != FLASH_KV_NO_PAGE && ui16_m_next_slot + ui16_changed + 1 <= FLASH_KV_SLOTS)
+    ok = append(p_words, ui16_words);
+  else
+    ok = compact(p_words, ui16_words);
+  flash_kv_hw_lock();
+
+  return ok;
+}
@@ -0,0 +1,49 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _FLASH_KV_H_
+#define _FLASH_KV_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Append only key/value store over the two EEPROM emulation flash pages.
+ *
+ * A key is the index of a 32 bit word of the saved data. Every record is 2 flash words: the
+ * value, then the key with a CRC of both. A save appends records only for the words that
+ * changed, then a commit record that points back to the first of them. Records that have no
+ * commit after them were cut by a power loss and are ignored. The page is erased only when it
+ * is full: the current values are then written to the other page, whose header is written last.
+ *
+ * At boot the active page is scanned once to build the RAM copy of the values.
+ */
+
+#define FLASH_KV_PAGES        2
+#define FLASH_KV_PAGE_SIZE    2048
+#define FLASH_KV_RECORD_SIZE  8
+#define FLASH_KV_SLOTS        (FLASH_KV_PAGE_SIZE / FLASH_KV_RECORD_SIZE) // slot 0 is the page header
+#define FLASH_KV_KEYS         64
+
+/// ui8_fresh_page is the page to use if neither page has a store yet
+void flash_kv_init(uint8_t ui8_fresh_page);
+
+/// Copy the stored words, the ones never saved are 0xffffffff. False if nothing was ever saved.
+bool flash_kv_read(uint32_t *p_words, uint16_t ui16_words);
+
+/// Save the words that are different from the stored ones
+bool flash_kv_write(const uint32_t *p_words, uint16_t ui16_words);
+
+// Flash access, from eeprom-hw.c
+const uint8_t* flash_kv_hw_page(uint8_t ui8_page);
+void flash_kv_hw_unlock(void);
+void flash_kv_hw_lock(void);
+bool flash_kv_hw_program_word(uint8_t ui8_page, uint16_t ui16_offset, uint32_t ui32_data);
+bool flash_kv_hw_erase(uint8_t ui8_page);
+
+#endif /* _FLASH_KV_H_ */
@@ -23,6 +23,7 @@
 #include "eeprom.h"
 #include "ugui.h"
 #include "ugui_driver/ugui_bafang_850c.h"
+#include "ugui_driver/lcd_burst.h"
 #include "utils.h"
 #include "rtc.h"
 #include "stm32f10x_usart.h"
@@ -69,6 +70,12 @@ int main(void)
 
       // next 2 lines takes about 11ms to execute (main menu). Measured on 2019.03.04.
       main_idle();
+      lcd_bus_stats_frame_end();
+
+      // the ticks that went by while main_idle() ran, as the SW102 main loop counts them
+      uint32_t ui32_idle_ms = get_time_base_counter_1ms() - ui32_timer_base_counter_1ms;
+      if(ui32_idle_ms > 20)
+        ui32_g_ticks_missed += ui32_idle_ms / 20;
       continue;
     }
   }
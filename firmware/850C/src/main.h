@@ -13,9 +13,10 @@
 // Define for the NVIC IRQChannel Preemption Priority
 // lower number has higher priority
 #define USART1_INTERRUPT_PRIORITY       3
-#define USART1_DMA_INTERRUPT_PRIORITY   4
+#define USART1_DMA_INTERRUPT_PRIORITY   3 // the same as USART1, both run the RX framer
 #define TIM4_INTERRUPT_PRIORITY         5
 #define RTC_INTERRUT_PRIORITY           6
+#define PENDSV_INTERRUPT_PRIORITY       15 // the lowest, layer_2() runs there
 
 
 
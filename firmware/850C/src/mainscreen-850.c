@@ -28,19 +28,46 @@
 
 Field batteryField = FIELD_CUSTOM(renderBattery);
 
-// We currently don't have any graphs in the SW102, so leave them here until then
-Field humanPowerGraph = FIELD_GRAPH(&humanPowerField);
-Field speedGraph = FIELD_GRAPH(&wheelSpeedIntegerField);
-Field motorTempGraph = FIELD_GRAPH(&motorTempField);
-Field motorPowerGraph = FIELD_GRAPH(&maxPowerField);
-Field pwmDutyGraph = FIELD_GRAPH(&pwmDutyField);
-Field motorErpsGraph = FIELD_GRAPH(&motorErpsField);
-Field motorFOCGraph = FIELD_GRAPH(&motorFOCField);
-Field cadenceGraph = FIELD_GRAPH(&cadenceField);
-Field batteryVoltageGraph = FIELD_GRAPH(&batteryVoltageField, .min_threshold = -1, .warn_threshold = -1, .error_threshold = -1);
+// The bucket rings of the levels the long graphs below show
+static history_bucket_t batteryVoltageBuckets[2][HISTORY_POINTS];
+static history_bucket_t motorTempBuckets[1][HISTORY_POINTS];
+
+// Recorded every second, whether their graph is shown or not
+static history_series_t batteryVoltageHistory = HISTORY_SERIES_BUCKETS(&l3_vars.ui16_battery_voltage_filtered_x10, batteryVoltageBuckets);
+static history_series_t humanPowerHistory = HISTORY_SERIES(&l3_vars.ui16_pedal_power_filtered);
+static history_series_t speedHistory = HISTORY_SERIES(&l3_vars.ui16_wheel_speed_x10);
+static history_series_t motorTempHistory = HISTORY_SERIES_BUCKETS(&l3_vars.ui8_motor_temperature, motorTempBuckets);
+static history_series_t pwmDutyHistory = HISTORY_SERIES(&l3_vars.ui8_duty_cycle);
+static history_series_t motorErpsHistory = HISTORY_SERIES(&l3_vars.ui16_motor_speed_erps);
+static history_series_t motorFOCHistory = HISTORY_SERIES(&l3_vars.ui8_foc_angle);
+static history_series_t cadenceHistory = HISTORY_SERIES(&l3_vars.ui8_pedal_cadence);
+
+static history_series_t *histories[] = { &batteryVoltageHistory, &humanPowerHistory, &speedHistory,
+		&motorTempHistory, &pwmDutyHistory, &motorErpsHistory, &motorFOCHistory, &cadenceHistory };
 
+// We currently don't have any graphs in the SW102, so leave them here until then
+Field humanPowerGraph = FIELD_GRAPH(&humanPowerField, &humanPowerHistory);
+Field speedGraph = FIELD_GRAPH(&wheelSpeedIntegerField, &speedHistory);
+Field motorTempGraph = FIELD_GRAPH(&motorTempField, &motorTempHistory);
+Field pwmDutyGraph = FIELD_GRAPH(&pwmDutyField, &pwmDutyHistory);
+Field motorErpsGraph = FIELD_GRAPH(&motorErpsField, &motorErpsHistory);
+Field motorFOCGraph = FIELD_GRAPH(&motorFOCField, &motorFOCHistory);
+Field cadenceGraph = FIELD_GRAPH(&cadenceField, &cadenceHistory);
+Field batteryVoltageGraph = FIELD_GRAPH(&batteryVoltageField, &batteryVoltageHistory, .min_threshold = -1, .warn_threshold = -1, .error_threshold = -1);
+
+// The same values over the longer spans of the history
+Field motorTempLongGraph = FIELD_GRAPH(&motorTempField, &motorTempHistory, .level = 1);
+Field batteryVoltageLongGraph = FIELD_GRAPH(&batteryVoltageField, &batteryVoltageHistory, .level = 2, .min_threshold = -1, .warn_threshold = -1, .error_threshold = -1);
+
+// new choices go at the end, the selection is saved as an index
 Field graphs = FIELD_CUSTOMIZABLE(&l3_vars.field_selectors[0], &batteryVoltageGraph, &humanPowerGraph, &speedGraph,
-		&motorTempGraph, &pwmDutyGraph, &motorErpsGraph, &motorFOCGraph, &cadenceGraph);
+		&motorTempGraph, &pwmDutyGraph, &motorErpsGraph, &motorFOCGraph, &cadenceGraph,
+		&motorTempLongGraph, &batteryVoltageLongGraph);
+
+void graphs_record(void) {
+	for (uint8_t i = 0; i < sizeof(histories) / sizeof(histories[0]); i++)
+		history_record(histories[i]);
+}
 
 uint8_t ui8_g_configuration_clock_hours;
 uint8_t ui8_g_configuration_clock_minutes;
@@ -56,6 +83,8 @@ static void mainScreenOnEnter() {
 			l2_vars.ui8_motor_temperature_min_value_to_limit;
 	motorTempGraph.graph.error_threshold =
 			l2_vars.ui8_motor_temperature_max_value_to_limit;
+	motorTempLongGraph.graph.warn_threshold = motorTempGraph.graph.warn_threshold;
+	motorTempLongGraph.graph.error_threshold = motorTempGraph.graph.error_threshold;
 }
 
 static void mainScreenOnDirtyClean() {
@@ -92,6 +121,15 @@ void mainScreenOnPostUpdate(void) {
   UG_FillFrame(244, 129, 250, 135, C_WHITE);
 }
 
+// What mainScreenOnDirtyClean() and mainScreenOnPostUpdate() draw, cleared when another screen is shown
+static const UG_AREA mainScreenOutsideAreas[] = {
+  { 0, 33, 319, 33 }, { 0, 155, 319, 155 }, { 0, 235, 319, 235 }, { 0, 315, 319, 315 }, // horizontal lines
+  { 159, 156, 159, 314 }, // vertical line
+  { 12, 46, 76, 61 }, // ASSIST
+  { 260, 46, 302, 61 }, // KM/H or MPH
+  { 244, 129, 250, 135 } // wheel speed dot
+};
+
 /**
  * Appears at the bottom of all screens, includes status msgs or critical fault alerts
  * FIXME - get rid of this nasty define - instead add the concept of Subscreens, so that the battery bar
@@ -136,6 +174,8 @@ Screen mainScreen = {
   .onDirtyClean = mainScreenOnDirtyClean,
   .onPostUpdate = mainScreenOnPostUpdate,
   .onCustomized = eeprom_write_variables,
+  .outsideAreas = mainScreenOutsideAreas,
+  .numOutsideAreas = sizeof(mainScreenOutsideAreas) / sizeof(mainScreenOutsideAreas[0]),
 
   .fields = {
     BATTERY_BAR,
@@ -143,6 +183,7 @@ Screen mainScreen = {
       .x = 20, .y = 77,
       .width = 45, .height = -1,
       .field = &assistLevelField,
+      .critical = true,
       .font = &BIG_NUMBERS_TEXT_FONT,
       .label_align_x = AlignHidden,
       .align_x = AlignCenter,
@@ -155,6 +196,7 @@ Screen mainScreen = {
       .width = 123, // 2 digits
       .height = 99,
       .field = &wheelSpeedIntegerField,
+      .critical = true,
       .font = &HUGE_NUMBERS_TEXT_FONT,
       .label_align_x = AlignHidden,
       .align_x = AlignRight,
@@ -167,6 +209,7 @@ Screen mainScreen = {
       .width = 45, // 1 digit
       .height = 72,
       .field = &wheelSpeedDecimalField,
+      .critical = true,
       .font = &BIG_NUMBERS_TEXT_FONT,
       .label_align_x = AlignHidden,
       .align_x = AlignCenter,
@@ -13,6 +13,11 @@
 #include "pins.h"
 #include "state.h"
 
+// the DWT cycle counter, this CMSIS doesn't define the DWT registers
+#define DWT_CTRL   (*(volatile uint32_t *) 0xE0001000)
+#define DWT_CYCCNT (*(volatile uint32_t *) 0xE0001004)
+#define DWT_CTRL_CYCCNTENA 1
+
 static volatile uint32_t _ms;
 volatile uint32_t time_base_counter_1ms = 0;
 
@@ -75,7 +80,7 @@ void timer3_init(void)
   TIM_Cmd(TIM3, ENABLE);
 }
 
-// every 100ms
+// every 100ms, layer_2() runs from PendSV once the higher priority interrupts are done
 void TIM4_IRQHandler(void)
 {
   if (TIM_GetITStatus(TIM4, TIM_IT_Update) != RESET)
@@ -83,11 +88,33 @@ void TIM4_IRQHandler(void)
     /* Clear TIMx TIM_IT_Update pending interrupt bit */
     TIM_ClearITPendingBit(TIM4, TIM_IT_Update);
 
-	  layer_2();
-	  // FIXME - make graphs work again graphs_measurements_update();
+    if (layer_2_trigger())
+      SCB->ICSR = SCB_ICSR_PENDSVSET;
   }
 }
 
+void PendSV_Handler(void)
+{
+  tx_urgent_task();
+  layer_2_task();
+}
+
+// a button press changed what the motor must know now, send it from PendSV as layer_2() does
+void tx_urgent_pend(void)
+{
+  SCB->ICSR = SCB_ICSR_PENDSVSET;
+}
+
+uint32_t layer_2_clock(void)
+{
+  return DWT_CYCCNT;
+}
+
+uint32_t layer_2_clock_us_since(uint32_t ui32_stamp)
+{
+  return (DWT_CYCCNT - ui32_stamp) >> 7; // 128MHz
+}
+
 void timer4_init(void)
 {
   // enable TIMx clock
@@ -104,6 +131,12 @@ void timer4_init(void)
   TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
   TIM_TimeBaseInit (TIM4, &TIM_TimeBaseStructure);
 
+  // layer_2() runs from PendSV, below every other interrupt, and times itself with the cycle counter
+  NVIC_SetPriority(PendSV_IRQn, PENDSV_INTERRUPT_PRIORITY);
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT_CYCCNT = 0;
+  DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+
   /* Enable the TIMx global Interrupt */
   NVIC_InitTypeDef NVIC_InitStructure;
   NVIC_InitStructure.NVIC_IRQChannel = TIM4_IRQn;
@@ -2,7 +2,8 @@
 #include "uart.h"
 #include "usart1.h"
 
-uint8_t ui8_usart1_tx_buffer[UART_NUMBER_DATA_BYTES_TO_SEND + 3];
+uint8_t ui8_usart1_tx_buffer[UART_NUMBER_DATA_BYTES_TO_SEND_V20 + 3];
+static uint8_t ui8_stream_version = 19;
 
 /**
  * @brief Init UART peripheral
@@ -13,17 +14,41 @@ void uart_init(void)
 }
 
 /**
- * @brief Returns pointer to RX buffer ready for parsing or NULL
+ * @brief Returns current stream version set
  */
-const uint8_t* uart_get_rx_buffer_rdy(void)
+uint8_t uart_get_stream_version(void)
 {
-	if(!usart1_received_package()) {
-		return NULL;
-	}
+  return ui8_stream_version;
+}
+
+/**
+ * @brief Sets stream version, the packet lengths of the RX framer and the TX DMA follow it
+ */
+void uart_set_stream_version(uint8_t version)
+{
+  switch (version)
+  {
+  case 19:
+    usart1_set_packet_lengths(UART_NUMBER_DATA_BYTES_TO_RECEIVE_V19 + 3, UART_NUMBER_DATA_BYTES_TO_SEND_V19 + 3);
+    break;
+
+  case 20:
+    usart1_set_packet_lengths(UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 + 3, UART_NUMBER_DATA_BYTES_TO_SEND_V20 + 3);
+    break;
 
-	uint8_t *r = usart1_get_rx_buffer();
-	usart1_reset_received_package();
-	return r;
+  default:
+    return;
+  }
+
+  ui8_stream_version = version;
+}
+
+/**
+ * @brief Returns pointer to RX buffer ready for parsing or NULL, and the bytes received for it
+ */
+const uint8_t* uart_get_rx_buffer_rdy(uint8_t *p_length)
+{
+  return usart1_get_rx_packet(p_length);
 }
 
 /**
@@ -34,6 +59,22 @@ uint8_t* uart_get_tx_buffer(void)
   return ui8_usart1_tx_buffer;
 }
 
+/**
+ * @brief Change the baud rate, for the motor link handshake
+ */
+void uart_set_baud(uint32_t ui32_baud)
+{
+  usart1_set_baud(ui32_baud);
+}
+
+/**
+ * @brief True while the TX buffer is still going out, until its last byte left the shift register
+ */
+bool uart_tx_busy(void)
+{
+  return usart1_tx_busy();
+}
+
 /**
  * @brief Send TX buffer over UART.
  */
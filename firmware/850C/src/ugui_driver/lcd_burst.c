@@ -0,0 +1,341 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include "lcd_burst.h"
+#include "ugui_bafang_850c.h"
+#ifdef LCD_BUS_MODEL
+#include <assert.h>
+#endif
+
+#ifndef LCD_BUS_MODEL
+#include "stm32f10x.h"
+#include "../pins.h"
+#endif
+
+// the hot loops are worth optimizing even when the rest of the firmware is built with -O0
+#define LCD_BURST_FAST __attribute__((optimize("O2")))
+
+#define LCD_BURST_STR(x)  #x
+#define LCD_BURST_XSTR(x) LCD_BURST_STR(x)
+#define LCD_BURST_NOPS(n) __asm volatile(".rept " LCD_BURST_XSTR(n) "\n\tnop\n\t.endr")
+
+#ifndef LCD_BUS_MODEL
+#define LCD_BUS_WRITE(v)      (LCD_BUS__PORT->ODR = (v))
+#define LCD_BUS_DATA_MODE()   (LCD_COMMAND_DATA__PORT->BSRR = LCD_COMMAND_DATA__PIN)
+#define LCD_BUS_COMMAND_MODE() (LCD_COMMAND_DATA__PORT->BRR = LCD_COMMAND_DATA__PIN)
+#define LCD_BUS_STROBE() \
+  do { \
+    LCD_WRITE__PORT->BRR = LCD_WRITE__PIN; \
+    LCD_BURST_NOPS(LCD_BURST_PULSE_LOW_NOPS); \
+    LCD_WRITE__PORT->BSRR = LCD_WRITE__PIN; \
+    LCD_BURST_NOPS(LCD_BURST_PULSE_HIGH_NOPS); \
+  } while (0)
+#else
+static uint16_t ui16_model_bus;
+static bool model_is_data = true;
+#define LCD_BUS_WRITE(v)      (ui16_model_bus = (v))
+#define LCD_BUS_DATA_MODE()   (model_is_data = true)
+#define LCD_BUS_COMMAND_MODE() (model_is_data = false)
+#define LCD_BUS_STROBE()      lcd_bus_model_strobe(ui16_model_bus, model_is_data)
+#endif
+
+#define LCD_BUS_STROBE_4() \
+  do { LCD_BUS_STROBE(); LCD_BUS_STROBE(); LCD_BUS_STROBE(); LCD_BUS_STROBE(); } while (0)
+
+lcd_bus_stats_t lcd_bus_stats;
+static lcd_bus_stats_t last_frame_stats;
+
+// what the controller currently has for address window and write cursor
+typedef struct lcd_shadow
+{
+  bool columns_valid;
+  bool pages_valid;
+  bool cursor_valid;
+  bool writing; // last command was 0x2c/0x3c, data goes to the frame memory
+  UG_S16 x1, x2;
+  UG_S16 y1, y2;
+  uint32_t ui32_size;
+  uint32_t ui32_offset; // cursor, in pixels from x1,y1
+} lcd_shadow_t;
+
+static lcd_shadow_t shadow;
+
+static void burst_command(uint16_t ui16_command)
+{
+  LCD_BUS_COMMAND_MODE();
+  LCD_BUS_WRITE(ui16_command);
+  LCD_BUS_STROBE();
+  LCD_BUS_DATA_MODE();
+  lcd_bus_stats.ui32_command_strobes++;
+}
+
+static void burst_data(uint16_t ui16_data)
+{
+  LCD_BUS_WRITE(ui16_data);
+  LCD_BUS_STROBE();
+  lcd_bus_stats.ui32_data_strobes++;
+}
+
+static void set_columns(UG_S16 x1, UG_S16 x2)
+{
+  if (shadow.columns_valid && shadow.x1 == x1 && shadow.x2 == x2)
+  {
+    lcd_bus_stats.ui32_window_skips++;
+    return;
+  }
+
+  burst_command(0x2a); // column address
+  burst_data(x1 >> 8);
+  burst_data(x1);
+  burst_data(x2 >> 8);
+  burst_data(x2);
+
+  shadow.x1 = x1;
+  shadow.x2 = x2;
+  shadow.columns_valid = true;
+  shadow.writing = false;
+}
+
+static void set_pages(UG_S16 y1, UG_S16 y2)
+{
+  if (shadow.pages_valid && shadow.y1 == y1 && shadow.y2 == y2)
+  {
+    lcd_bus_stats.ui32_window_skips++;
+    return;
+  }
+
+  burst_command(0x2b); // page address
+  burst_data(y1 >> 8);
+  burst_data(y1);
+  burst_data(y2 >> 8);
+  burst_data(y2);
+
+  shadow.y1 = y1;
+  shadow.y2 = y2;
+  shadow.pages_valid = true;
+  shadow.writing = false;
+}
+
+static void memory_write_start(void)
+{
+  burst_command(0x2c); // memory write, cursor goes to x1,y1
+
+  shadow.ui32_size = (uint32_t) (shadow.x2 - shadow.x1 + 1) * (uint32_t) (shadow.y2 - shadow.y1 + 1);
+  shadow.ui32_offset = 0;
+  shadow.cursor_valid = true;
+  shadow.writing = true;
+}
+
+// pixels were written, move the cursor. Past the end of the window the controller behaviour
+// differs between ILI9481 and ST7796 so we simply forget where it is.
+static inline void shadow_advance(uint32_t ui32_count)
+{
+  shadow.ui32_offset += ui32_count;
+  if (shadow.ui32_offset >= shadow.ui32_size)
+    shadow.cursor_valid = false;
+}
+
+/**
+ * Set the address window and start a memory write, pixels are then streamed by rows from x1,y1
+ * to x2,y2. Coordinates must already be ordered. Column and page commands are only sent when
+ * they differ from what the controller already has.
+ */
+void lcd_burst_window(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2)
+{
+  set_columns(x1, x2);
+  set_pages(y1, y2);
+  memory_write_start();
+
+  lcd_bus_stats.ui32_bursts++;
+}
+
+/**
+ * Write a single pixel. No command is sent when the pixel is the one the write cursor is on,
+ * which is the next pixel of the open window in row order (0x3c first if a command ended the
+ * write). Anywhere else the window is reopened from x,y to the bottom right corner of the screen:
+ * 0x2a and 0x2b only go out when the column or page range changed, 0x2c always does. So the
+ * following pixels of a row are free, while each pixel of a vertical run with the same x costs
+ * a 0x2b and a 0x2c.
+ */
+void lcd_burst_pixel_at(UG_S16 x, UG_S16 y, UG_COLOR color)
+{
+  if (x < 0 || x >= DISPLAY_WIDTH || y < 0 || y >= DISPLAY_HEIGHT)
+    return;
+
+  if (shadow.cursor_valid &&
+      x >= shadow.x1 && x <= shadow.x2 &&
+      y >= shadow.y1 && y <= shadow.y2 &&
+      (uint32_t) (y - shadow.y1) * (uint32_t) (shadow.x2 - shadow.x1 + 1) + (uint32_t) (x - shadow.x1) == shadow.ui32_offset)
+  {
+    // the cursor is already there
+    if (!shadow.writing)
+    {
+      burst_command(0x3c); // memory write continue
+      shadow.writing = true;
+    }
+    lcd_bus_stats.ui32_window_skips += 2;
+  }
+  else
+  {
+    set_columns(x, DISPLAY_WIDTH - 1);
+    set_pages(y, DISPLAY_HEIGHT - 1);
+    memory_write_start();
+  }
+
+#ifdef LCD_BUS_MODEL
+  UG_S16 model_x, model_y;
+  lcd_bus_model_cursor(&model_x, &model_y);
+  assert(model_x == x && model_y == y);
+#endif
+
+  lcd_burst_pixel(color);
+}
+
+/**
+ * Must be called for every command sent outside of this engine. Commands that don't touch the
+ * frame memory address only end the memory write, the next contiguous pixel then uses 0x3c.
+ */
+void lcd_burst_command_sent(uint16_t ui16_command)
+{
+  switch (ui16_command)
+  {
+    case 0x00: // nop
+    case 0x28: // display off
+    case 0x29: // display on
+    case 0x51: // brightness
+    case 0x53: // CTRL display
+      shadow.writing = false;
+      break;
+
+    default:
+      shadow.columns_valid = false;
+      shadow.pages_valid = false;
+      shadow.cursor_valid = false;
+      shadow.writing = false;
+      break;
+  }
+}
+
+LCD_BURST_FAST void lcd_burst_solid(UG_COLOR color, uint32_t ui32_count)
+{
+  // the bus can't skip pixels inside a window
+  if (color == C_TRANSPARENT)
+    color = C_BLACK;
+
+  lcd_bus_stats.ui32_data_strobes += ui32_count;
+  lcd_bus_stats.ui32_pixels += ui32_count;
+  shadow_advance(ui32_count);
+
+  // set the color only once since is equal to all pixels
+  LCD_BUS_WRITE(color);
+
+  while (ui32_count >= 16)
+  {
+    LCD_BUS_STROBE_4();
+    LCD_BUS_STROBE_4();
+    LCD_BUS_STROBE_4();
+    LCD_BUS_STROBE_4();
+    ui32_count -= 16;
+  }
+
+  while (ui32_count--)
+    LCD_BUS_STROBE();
+}
+
+void lcd_burst_spans(const lcd_span_t *p_spans, uint16_t ui16_num_spans)
+{
+  while (ui16_num_spans--)
+  {
+    lcd_burst_solid(p_spans->color, p_spans->ui16_count);
+    p_spans++;
+  }
+}
+
+LCD_BURST_FAST void lcd_burst_buffer(const UG_COLOR *p_buffer, uint32_t ui32_count)
+{
+  lcd_bus_stats.ui32_data_strobes += ui32_count;
+  lcd_bus_stats.ui32_pixels += ui32_count;
+  shadow_advance(ui32_count);
+
+  while (ui32_count >= 4)
+  {
+    LCD_BUS_WRITE(p_buffer[0]);
+    LCD_BUS_STROBE();
+    LCD_BUS_WRITE(p_buffer[1]);
+    LCD_BUS_STROBE();
+    LCD_BUS_WRITE(p_buffer[2]);
+    LCD_BUS_STROBE();
+    LCD_BUS_WRITE(p_buffer[3]);
+    LCD_BUS_STROBE();
+    p_buffer += 4;
+    ui32_count -= 4;
+  }
+
+  while (ui32_count--)
+  {
+    LCD_BUS_WRITE(*p_buffer++);
+    LCD_BUS_STROBE();
+  }
+}
+
+void lcd_burst_pixel(UG_COLOR color)
+{
+  if (color == C_TRANSPARENT)
+    color = C_BLACK;
+
+  LCD_BUS_WRITE(color);
+  LCD_BUS_STROBE();
+  lcd_bus_stats.ui32_data_strobes++;
+  lcd_bus_stats.ui32_pixels++;
+  shadow_advance(1);
+}
+
+void lcd_burst(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, const lcd_pixel_source_t *p_source)
+{
+  uint32_t ui32_pixels = (uint32_t) (x2 - x1 + 1) * (uint32_t) (y2 - y1 + 1);
+
+  lcd_burst_window(x1, y1, x2, y2);
+
+  switch (p_source->type)
+  {
+    case LCD_SOURCE_SOLID:
+      lcd_burst_solid(p_source->color, ui32_pixels);
+      break;
+
+    case LCD_SOURCE_SPANS:
+      lcd_burst_spans(p_source->p_spans, p_source->ui16_num_spans);
+      break;
+
+    case LCD_SOURCE_BUFFER:
+      // a line buffer shorter than the window is repeated, e.g. one row for a gradient
+      while (ui32_pixels)
+      {
+        uint32_t ui32_len = p_source->ui32_buffer_len < ui32_pixels ? p_source->ui32_buffer_len : ui32_pixels;
+        if (ui32_len == 0)
+          break;
+        lcd_burst_buffer(p_source->p_buffer, ui32_len);
+        ui32_pixels -= ui32_len;
+      }
+      break;
+  }
+}
+
+void lcd_bus_stats_frame_end(void)
+{
+  last_frame_stats = lcd_bus_stats;
+  lcd_bus_stats.ui32_command_strobes = 0;
+  lcd_bus_stats.ui32_data_strobes = 0;
+  lcd_bus_stats.ui32_pixels = 0;
+  lcd_bus_stats.ui32_bursts = 0;
+  lcd_bus_stats.ui32_window_skips = 0;
+}
+
+const lcd_bus_stats_t *lcd_bus_stats_last_frame(void)
+{
+  return &last_frame_stats;
+}
@@ -0,0 +1,89 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef LCD_BURST_H_
+#define LCD_BURST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ugui.h"
+
+/*
+ * Burst write engine for the 16 bits parallel LCD bus.
+ *
+ * A burst is a window (0x2a/0x2b/0x2c) followed by a stream of pixels coming from one of
+ * the pixel sources below. Pixels are strobed with an unrolled WR loop.
+ *
+ * Define LCD_BUS_MODEL to build this file without the STM32 headers: every WR strobe is then
+ * handed to lcd_bus_model_strobe() so a host side model can decode and count the bus traffic.
+ */
+
+// Minimum WR low / high time, in nops, for the fast path (128MHz CPU, 7.8ns per cycle).
+// ILI9481 needs tWRL/tWRH >= 30ns and tWC >= 100ns, ST7796 is faster.
+#ifndef LCD_BURST_PULSE_LOW_NOPS
+#define LCD_BURST_PULSE_LOW_NOPS    3
+#endif
+#ifndef LCD_BURST_PULSE_HIGH_NOPS
+#define LCD_BURST_PULSE_HIGH_NOPS   5
+#endif
+
+typedef struct lcd_span
+{
+  uint16_t ui16_count; // number of consecutive pixels
+  UG_COLOR color;
+} lcd_span_t;
+
+typedef enum
+{
+  LCD_SOURCE_SOLID = 0,
+  LCD_SOURCE_SPANS,
+  LCD_SOURCE_BUFFER
+} lcd_source_type_t;
+
+typedef struct lcd_pixel_source
+{
+  lcd_source_type_t type;
+  UG_COLOR color;             // LCD_SOURCE_SOLID
+  const lcd_span_t *p_spans;  // LCD_SOURCE_SPANS
+  uint16_t ui16_num_spans;
+  const UG_COLOR *p_buffer;   // LCD_SOURCE_BUFFER
+  uint32_t ui32_buffer_len;   // pixels in p_buffer, the buffer is repeated until the window is full
+} lcd_pixel_source_t;
+
+typedef struct lcd_bus_stats
+{
+  uint32_t ui32_command_strobes; // WR strobes with C/D low
+  uint32_t ui32_data_strobes;    // WR strobes with C/D high, window parameters included
+  uint32_t ui32_pixels;          // of the data strobes, how many were pixels
+  uint32_t ui32_bursts;
+  uint32_t ui32_window_skips;    // 0x2a/0x2b sequences not sent because the controller already had them
+} lcd_bus_stats_t;
+
+extern lcd_bus_stats_t lcd_bus_stats;
+
+void lcd_burst_window(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2);
+void lcd_burst_solid(UG_COLOR color, uint32_t ui32_count);
+void lcd_burst_spans(const lcd_span_t *p_spans, uint16_t ui16_num_spans);
+void lcd_burst_buffer(const UG_COLOR *p_buffer, uint32_t ui32_count);
+void lcd_burst_pixel(UG_COLOR color);
+void lcd_burst_pixel_at(UG_S16 x, UG_S16 y, UG_COLOR color);
+void lcd_burst_command_sent(uint16_t ui16_command);
+void lcd_burst(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, const lcd_pixel_source_t *p_source);
+
+// latch the counters of the frame just drawn and start counting a new one
+void lcd_bus_stats_frame_end(void);
+const lcd_bus_stats_t *lcd_bus_stats_last_frame(void);
+
+#ifdef LCD_BUS_MODEL
+// implemented by the host model, called once for every WR rising edge
+void lcd_bus_model_strobe(uint16_t ui16_bus, bool is_data);
+// where the modelled controller will write the next pixel
+void lcd_bus_model_cursor(UG_S16 *p_x, UG_S16 *p_y);
+#endif
+
+#endif /* LCD_BURST_H_ */
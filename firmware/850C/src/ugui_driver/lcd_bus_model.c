@@ -0,0 +1,135 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Host side model of the ILI9481/ST7796 controller, only built with LCD_BUS_MODEL.
+ *
+ * It decodes the WR strobes coming from lcd_burst.c the same way the controller does (column and
+ * page address, memory write, memory write continue) into its own frame memory, so what the
+ * driver wanted to draw and what actually landed on the glass can be compared pixel by pixel.
+ */
+
+#ifdef LCD_BUS_MODEL
+
+#include <string.h>
+#include "lcd_bus_model.h"
+
+typedef struct lcd_model
+{
+  uint16_t ui16_command;
+  uint8_t ui8_param_index;
+  uint16_t ui16_params[4];
+  bool writing;
+  UG_S16 sc, ec, sp, ep; // column and page window
+  UG_S16 x, y;           // write cursor
+} lcd_model_t;
+
+static lcd_model_t model;
+static uint16_t frame_memory[DISPLAY_HEIGHT][DISPLAY_WIDTH];
+static lcd_bus_model_counters_t counters;
+
+void lcd_bus_model_reset(void)
+{
+  memset(&model, 0, sizeof(model));
+  model.ec = DISPLAY_WIDTH - 1;
+  model.ep = DISPLAY_HEIGHT - 1;
+  memset(frame_memory, 0, sizeof(frame_memory));
+  memset(&counters, 0, sizeof(counters));
+}
+
+static void model_command(uint16_t ui16_command)
+{
+  counters.ui32_commands++;
+  model.ui16_command = ui16_command;
+  model.ui8_param_index = 0;
+  model.writing = false;
+
+  switch (ui16_command)
+  {
+    case 0x2a: // column address
+    case 0x2b: // page address
+      counters.ui32_windows++;
+      break;
+
+    case 0x2c: // memory write
+      model.x = model.sc;
+      model.y = model.sp;
+      model.writing = true;
+      break;
+
+    case 0x3c: // memory write continue
+      model.writing = true;
+      break;
+  }
+}
+
+static void model_param(uint16_t ui16_data)
+{
+  if (model.ui8_param_index < 4)
+    model.ui16_params[model.ui8_param_index] = ui16_data & 0xff;
+  model.ui8_param_index++;
+
+  if (model.ui8_param_index != 4)
+    return;
+
+  if (model.ui16_command == 0x2a)
+  {
+    model.sc = (model.ui16_params[0] << 8) | model.ui16_params[1];
+    model.ec = (model.ui16_params[2] << 8) | model.ui16_params[3];
+  }
+  else if (model.ui16_command == 0x2b)
+  {
+    model.sp = (model.ui16_params[0] << 8) | model.ui16_params[1];
+    model.ep = (model.ui16_params[2] << 8) | model.ui16_params[3];
+  }
+}
+
+static void model_pixel(uint16_t ui16_color)
+{
+  counters.ui32_pixels++;
+
+  if (model.x >= 0 && model.x < DISPLAY_WIDTH && model.y >= 0 && model.y < DISPLAY_HEIGHT)
+    frame_memory[model.y][model.x] = ui16_color;
+
+  if (++model.x > model.ec)
+  {
+    model.x = model.sc;
+    if (++model.y > model.ep)
+      model.y = model.sp;
+  }
+}
+
+void lcd_bus_model_strobe(uint16_t ui16_bus, bool is_data)
+{
+  counters.ui32_strobes++;
+
+  if (!is_data)
+    model_command(ui16_bus);
+  else if (model.writing)
+    model_pixel(ui16_bus);
+  else
+    model_param(ui16_bus);
+}
+
+void lcd_bus_model_cursor(UG_S16 *p_x, UG_S16 *p_y)
+{
+  *p_x = model.x;
+  *p_y = model.y;
+}
+
+uint16_t lcd_bus_model_get_pixel(UG_S16 x, UG_S16 y)
+{
+  return frame_memory[y][x];
+}
+
+const lcd_bus_model_counters_t *lcd_bus_model_counters(void)
+{
+  return &counters;
+}
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef LCD_BUS_MODEL_H_
+#define LCD_BUS_MODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ugui.h"
+#include "ugui_bafang_850c.h"
+#include "lcd_burst.h"
+
+typedef struct lcd_bus_model_counters
+{
+  uint32_t ui32_strobes;
+  uint32_t ui32_commands;
+  uint32_t ui32_windows; // column (0x2a) and page (0x2b) address commands
+  uint32_t ui32_pixels;
+} lcd_bus_model_counters_t;
+
+void lcd_bus_model_reset(void);
+uint16_t lcd_bus_model_get_pixel(UG_S16 x, UG_S16 y);
+const lcd_bus_model_counters_t *lcd_bus_model_counters(void);
+
+#endif /* LCD_BUS_MODEL_H_ */
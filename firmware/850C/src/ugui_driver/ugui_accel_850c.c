@@ -0,0 +1,94 @@
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * uGUI pixel set and acceleration callbacks for the 850C. They only talk to the LCD through the
+ * burst engine, so the same code runs on the real bus and on the host bus model.
+ */
+
+#include "ugui.h"
+#include "ugui_bafang_850c.h"
+#include "lcd_burst.h"
+
+static void push_pixel_850(UG_COLOR c) {
+    // FIXME, transparent is drawn as black - not quite correct - we really should skip that pixel
+    lcd_burst_pixel(c);
+}
+
+/**
+ * A ugui acceleration function.  Given a rectangle, return a callback to set pixels in that rect.
+ * The draw order will be by rows, starting from x1,y1 down to x2,y2.
+ */
+PushPixelFn HW_FillArea(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2) {
+    lcd_burst_window(x1, y1, x2, y2);
+    
+    return push_pixel_850;
+}
+
+void lcd_pixel_set(UG_S16 i16_x, UG_S16 i16_y, UG_COLOR ui32_color) {
+    if (ui32_color == C_TRANSPARENT)
+        return;
+    
+    // the burst engine tracks the controller address window and cursor, so consecutive pixels
+    // don't need the full 0x2a/0x2b/0x2c sequence every time
+    lcd_burst_pixel_at(i16_x, i16_y, ui32_color);
+}
+
+UG_RESULT HW_FillFrame(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2,
+                       UG_COLOR ui32_color) {
+    if (ui32_color == C_TRANSPARENT)
+        return UG_RESULT_OK;
+    
+    uint32_t ui32_pixels;
+    int32_t i32_dx, i32_dy;
+    UG_S16 temp;
+    
+    // calc total of pixels
+    if (x2 >= x1) {
+        i32_dx = (uint32_t) (x2 - x1 + 1);
+    } else {
+        i32_dx = (uint32_t) (x1 - x2 + 1);
+        temp = x2;
+        x2 = x1;
+        x1 = temp;
+    }
+    
+    if (y2 >= y1) {
+        i32_dy = (uint32_t) (y2 - y1 + 1);
+    } else {
+        i32_dy = (uint32_t) (y1 - y2 + 1);
+        temp = y2;
+        y2 = y1;
+        y1 = temp;
+    }
+    
+    ui32_pixels = i32_dx * i32_dy;
+    
+    lcd_burst_window(x1, y1, x2, y2);
+    lcd_burst_solid(ui32_color, ui32_pixels);
+    
+    return UG_RESULT_OK;
+}
+
+UG_RESULT HW_DrawLine(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c) {
+    if (c == C_TRANSPARENT)
+        return UG_RESULT_OK;
+    
+    if ((x1 < 0) || (x1 >= DISPLAY_WIDTH) || (y1 < 0) || (y1 >= DISPLAY_HEIGHT))
+        return UG_RESULT_FAIL;
+    if ((x2 < 0) || (x2 >= DISPLAY_WIDTH) || (y2 < 0) || (y2 >= DISPLAY_HEIGHT))
+        return UG_RESULT_FAIL;
+    
+    // If it is a vertical or a horizontal line, draw it.
+    // If not, then use original drawline routine.
+    if ((x1 == x2) || (y1 == y2)) {
+        return HW_FillFrame(x1, y1, x2, y2, c);
+    }
+    
+    return UG_RESULT_FAIL;
+}
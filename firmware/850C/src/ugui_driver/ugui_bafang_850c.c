@@ -29,6 +29,7 @@
 
 #include "ugui.h"
 #include "../ugui_driver/ugui_bafang_850c.h"
+#include "../ugui_driver/lcd_burst.h"
 #include "../pins.h"
 #include "../timers.h"
 
@@ -48,41 +49,6 @@ inline void Display_Reset() {
     
 }
 
-typedef void (*PushPixelFn)(UG_COLOR);
-
-static void push_pixel_850(UG_COLOR c) {
-    if (c == C_TRANSPARENT)
-        c = C_BLACK; // FIXME, not quite correct - we really should skip that pixel
-    
-    lcd_write_data_8bits(c);
-}
-
-/**
- * A ugui acceleration function.  Given a rectangle, return a callback to set pixels in that rect.
- * The draw order will be by rows, starting from x1,y1 down to x2,y2.
- */
-PushPixelFn HW_FillArea(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2) {
-    
-    /**************************************************/
-    // Set XY
-    //
-    lcd_write_command(0x2a); // write coladdr
-    lcd_write_data_8bits(x1 >> 8);   // write data to BUS - start addr
-    lcd_write_data_8bits(x1);   // write data to BUS
-    lcd_write_data_8bits(x2 >> 8);   // write data to BUS - end addr
-    lcd_write_data_8bits(x2);   // write data to BUS
-    
-    lcd_write_command(0x2b); // write pageaddr
-    lcd_write_data_8bits(y1 >> 8);   // write data to BUS
-    lcd_write_data_8bits(y1);   // write data to BUS
-    lcd_write_data_8bits(y2 >> 8);   // write data to BUS
-    lcd_write_data_8bits(y2);   // write data to BUS
-    
-    lcd_write_command(0x2c); // start writing pixels
-    
-    return push_pixel_850;
-}
-
 lcd_IC_t detect_lcd_type()
 {
     lcd_read_data_16bits(0xbf, lcd_devcode, 6); // ILI9481 doesn't support Read ID4 command (0xD3)
@@ -338,53 +304,6 @@ void lcd_window_set(unsigned int s_x, unsigned int e_x, unsigned int s_y,
     lcd_write_command(0x2c);
 }
 
-void lcd_pixel_set(UG_S16 i16_x, UG_S16 i16_y, UG_COLOR ui32_color) {
-    if (ui32_color == C_TRANSPARENT)
-        return;
-    
-    // first 8 bits are the only ones that count for the LCD driver
-    uint32_t ui32_x_high = i16_x >> 8;
-    uint32_t ui32_x_low = i16_x;
-    uint32_t ui32_y_high = i16_y >> 8;
-    uint32_t ui32_y_low = i16_y;
-    
-    /**************************************************/
-    // Set XY
-    //
-    lcd_write_command(0x2a); // write coladdr
-    lcd_write_data_8bits(ui32_x_high);   // write data to BUS - start addr
-    lcd_write_data_8bits(ui32_x_low);   // write data to BUS
-    lcd_write_data_8bits(ui32_x_high);   // write data to BUS - end addr
-    lcd_write_data_8bits(ui32_x_low);   // write data to BUS
-    
-    lcd_write_command(0x2b); // write pageaddr
-    lcd_write_data_8bits(ui32_y_high);   // write data to BUS
-    lcd_write_data_8bits(ui32_y_low);   // write data to BUS
-    lcd_write_data_8bits(ui32_y_high);   // write data to BUS
-    lcd_write_data_8bits(ui32_y_low);   // write data to BUS
-    
-    lcd_write_command(0x2c); // write data to BUS
-    
-    /**************************************************/
-    // Set data on bus
-    //
-    lcd_write_data_8bits(ui32_color);
-    
-#if 0
-    // I @geeksville don't think this is required and it cost cycles
-    
-    // NOP
-    lcd_write_command(0); // write data to BUS
-    
-    // NOP
-    lcd_write_command(0); // write data to BUS
-    
-    // NOP
-    lcd_write_command(0); // write data to BUS
-#endif
-}
-
-
 // pulse low WR pin tPWLW min time 30ns (shortest possible CPU cycle on our CPU is 9ns)
 void wait_pulse() {
     // WOW @r0mko says his screen needs this delay to be 80 which is really slow.  Hopefully we only have to
@@ -404,86 +323,6 @@ void lcd_write_cycle() {
 }
 
 
-UG_RESULT HW_FillFrame(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2,
-                       UG_COLOR ui32_color) {
-    if (ui32_color == C_TRANSPARENT)
-        return UG_RESULT_OK;
-    
-    uint32_t ui32_pixels;
-    int32_t i32_dx, i32_dy;
-    UG_S16 temp;
-    
-    // calc total of pixels
-    if (x2 >= x1) {
-        i32_dx = (uint32_t) (x2 - x1 + 1);
-    } else {
-        i32_dx = (uint32_t) (x1 - x2 + 1);
-        temp = x2;
-        x2 = x1;
-        x1 = temp;
-    }
-    
-    if (y2 >= y1) {
-        i32_dy = (uint32_t) (y2 - y1 + 1);
-    } else {
-        i32_dy = (uint32_t) (y1 - y2 + 1);
-        temp = y2;
-        y2 = y1;
-        y1 = temp;
-    }
-    
-    ui32_pixels = i32_dx * i32_dy;
-    
-    /**************************************************/
-    // Set XY
-    //
-    lcd_write_command(0x2a); // write data to BUS - set col addr
-    lcd_write_data_8bits(x1 >> 8);   // write data to BUS
-    lcd_write_data_8bits(x1);   // write data to BUS
-    lcd_write_data_8bits(x2 >> 8);   // write data to BUS
-    lcd_write_data_8bits(x2);   // write data to BUS
-    
-    lcd_write_command(0x2b); // write data to BUS
-    lcd_write_data_8bits(y1 >> 8);   // write data to BUS
-    lcd_write_data_8bits(y1);   // write data to BUS
-    lcd_write_data_8bits(y2 >> 8);   // write data to BUS
-    lcd_write_data_8bits(y2);   // write data to BUS
-    
-    lcd_write_command(0x2c); // write data to BUS
-    
-    LCD_COMMAND_DATA__PORT->BSRR = LCD_COMMAND_DATA__PIN; // data
-    
-    // set the color only once since is equal to all pixels
-    LCD_BUS__PORT->ODR = ui32_color;
-    
-    while (ui32_pixels-- > 0) {
-        lcd_write_cycle();
-    }
-    
-    return UG_RESULT_OK;
-}
-
-UG_RESULT HW_DrawLine(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c) {
-    if (c == C_TRANSPARENT)
-        return UG_RESULT_OK;
-    
-    if ((x1 < 0) || (x1 >= DISPLAY_WIDTH) || (y1 < 0) || (y1 >= DISPLAY_HEIGHT))
-        return UG_RESULT_FAIL;
-    if ((x2 < 0) || (x2 >= DISPLAY_WIDTH) || (y2 < 0) || (y2 >= DISPLAY_HEIGHT))
-        return UG_RESULT_FAIL;
-    
-    // If it is a vertical or a horizontal line, draw it.
-    // If not, then use original drawline routine.
-    if ((x1 == x2) || (y1 == y2)) {
-        return HW_FillFrame(x1, y1, x2, y2, c);
-    }
-    
-    return UG_RESULT_FAIL;
-}
-
-
-
-
 /**
  * For timing information see 13.2.2 in the datasheet
  */
@@ -496,6 +335,9 @@ void lcd_write_command(uint16_t ui32_command) {
     LCD_CHIP_SELECT__PORT->BRR = LCD_CHIP_SELECT__PIN; // reassert chip select
 #endif
     
+    lcd_burst_command_sent(ui32_command);
+    lcd_bus_stats.ui32_command_strobes++;
+    
     // command
     LCD_COMMAND_DATA__PORT->BRR = LCD_COMMAND_DATA__PIN;
     
@@ -512,6 +354,8 @@ void lcd_write_data_8bits(uint16_t ui32_data) {
     // data
     // LCD_COMMAND_DATA__PORT->BSRR = LCD_COMMAND_DATA__PIN;
     
+    lcd_bus_stats.ui32_data_strobes++;
+    
     // write data to BUS
     LCD_BUS__PORT->ODR = ui32_data;
     
@@ -39,6 +39,8 @@ void lcd_write_data_8bits(uint16_t ui32_data);
 uint16_t* getLcdDevcode(void); // per 8.2.39 of datasheet, six words, first will be filled with garbage
 
     // Accelerators.
+typedef void (*PushPixelFn)(UG_COLOR);
+PushPixelFn HW_FillArea(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2);
 UG_RESULT HW_FillFrame(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c);
 UG_RESULT HW_DrawLine(UG_S16 x1 , UG_S16 y1 , UG_S16 x2 , UG_S16 y2 , UG_COLOR c );
 UG_RESULT HW_DrawImage(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, uint8_t *image, uint16_t pSize);
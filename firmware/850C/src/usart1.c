@@ -1,192 +1,184 @@
-/*
- * Bafang LCD 850C firmware
- *
- * Copyright (C) Casainho, 2018.
- *
- * Released under the GPL License, Version 3
- */
-
-#include <string.h>
-#include "usart1.h"
-#include "stm32f10x.h"
-#include "pins.h"
-#include "stm32f10x_usart.h"
-#include "stm32f10x_dma.h"
-#include "lcd.h"
-#include "utils.h"
-#include "usart1.h"
-#include "main.h"
-#include "uart.h"
-
-uint8_t ui8_rx_buffer[UART_NUMBER_DATA_BYTES_TO_RECEIVE + 3];
-volatile uint8_t ui8_received_package_flag = 0;
-
-void usart1_init(void)
-{
-  NVIC_InitTypeDef NVIC_InitStructure;
-  GPIO_InitTypeDef GPIO_InitStructure;
-  USART_InitTypeDef USART_InitStructure;
-  DMA_InitTypeDef DMA_InitStructure;
-
-  // enable GPIO clock
-  RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1 | RCC_APB2Periph_AFIO, ENABLE);
-  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
-
-  DMA_DeInit(DMA1_Channel4);
-  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) &(USART1->DR);
-  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t) uart_get_tx_buffer();
-  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
-  DMA_InitStructure.DMA_BufferSize = UART_NUMBER_DATA_BYTES_TO_SEND + 3;
-  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
-  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
-  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
-  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
-  DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
-  DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
-  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
-  DMA_Init(DMA1_Channel4, &DMA_InitStructure);
-
-  // USART pins
-  GPIO_InitStructure.GPIO_Pin = USART1_RX__PIN;
-  GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
-  GPIO_Init(USART1__PORT, &GPIO_InitStructure);
-
-  GPIO_InitStructure.GPIO_Pin = USART1_TX__PIN;
-  GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
-  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
-  GPIO_Init(USART1__PORT, &GPIO_InitStructure);
-
-  USART_DeInit(USART1);
-  USART_InitStructure.USART_BaudRate = 9600;
-  USART_InitStructure.USART_WordLength = USART_WordLength_8b;
-  USART_InitStructure.USART_StopBits = USART_StopBits_1;
-  USART_InitStructure.USART_Parity = USART_Parity_No;
-  USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
-  USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
-  USART_Init(USART1, &USART_InitStructure);
-
-  // enable the USART Interrupt
-  NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn;
-  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART1_INTERRUPT_PRIORITY;
-  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
-  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-  NVIC_Init(&NVIC_InitStructure);
-
-  USART_ClearITPendingBit(USART1, USART_IT_RXNE);
-  USART_ClearITPendingBit(USART1, USART_IT_TC);
-
-  // enable the USART
-  USART_Cmd(USART1, ENABLE);
-
-  DMA_Cmd(DMA1_Channel4, ENABLE);
-  USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
-  USART_Cmd(USART1, ENABLE);
-
-  // enable USART Receive and Transmit interrupts
-  USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);
-}
-
-// USART1 Tx and Rx interrupt handler.
-void USART1_IRQHandler()
-{
-  uint8_t ui8_byte_received;
-  static uint8_t ui8_state_machine = 0;
-  static uint8_t ui8_rx[UART_NUMBER_DATA_BYTES_TO_RECEIVE + 3];
-  static uint8_t ui8_rx_counter = 0;
-  uint8_t ui8_i;
-  uint16_t ui16_crc_rx;
-
-  // The interrupt may be from Tx, Rx, or both.
-  if(USART_GetITStatus(USART1, USART_IT_ORE) == SET)
-  {
-    USART_ReceiveData(USART1); // get ride of this interrupt flag
-    return;
-  }
-  else if(USART_GetITStatus(USART1, USART_IT_TXE) == SET)
-  {
-    USART_ITConfig(USART1, USART_IT_TXE, DISABLE);
-    return;
-  }
-  else if(USART_GetITStatus(USART1, USART_IT_RXNE) == SET)
-  {
-    // receive byte
-    ui8_byte_received = (uint8_t) USART1->DR;
-
-    switch(ui8_state_machine)
-    {
-      case 0:
-      if(ui8_byte_received == 67) // see if we get start package byte
-      {
-        ui8_rx[ui8_rx_counter] = ui8_byte_received;
-        ui8_rx_counter++;
-        ui8_state_machine = 1;
-      }
-      else
-      {
-        ui8_rx_counter = 0;
-        ui8_state_machine = 0;
-      }
-      break;
-
-      case 1:
-      ui8_rx[ui8_rx_counter] = ui8_byte_received;
-      ui8_rx_counter++;
-
-      // see if is the last byte of the package
-      if(ui8_rx_counter >= (UART_NUMBER_DATA_BYTES_TO_RECEIVE + 3))
-      {
-        ui8_rx_counter = 0;
-        ui8_state_machine = 0;
-
-        // validation of the package data
-        // last byte is the checksum
-        ui16_crc_rx = 0xffff;
-        for(ui8_i = 0; ui8_i <= UART_NUMBER_DATA_BYTES_TO_RECEIVE; ui8_i++)
-        {
-          crc16(ui8_rx[ui8_i], &ui16_crc_rx);
-        }
-
-        if(((((uint16_t) ui8_rx[UART_NUMBER_DATA_BYTES_TO_RECEIVE + 2]) << 8) +
-            ((uint16_t) ui8_rx[UART_NUMBER_DATA_BYTES_TO_RECEIVE + 1])) ==
-                ui16_crc_rx)
-        {
-          // copy to the other buffer only if we processed already the last package
-          if(!ui8_received_package_flag)
-          {
-            ui8_received_package_flag = 1;
-
-            // store the received data to rx_buffer
-            memcpy(ui8_rx_buffer, ui8_rx, UART_NUMBER_DATA_BYTES_TO_RECEIVE + 1);
-          }
-        }
-      }
-      break;
-
-      default:
-      break;
-    }
-  }
-}
-
-void usart1_start_dma_transfer(void)
-{
-  DMA_Cmd(DMA1_Channel4, DISABLE);
-  DMA_SetCurrDataCounter(DMA1_Channel4, UART_NUMBER_DATA_BYTES_TO_SEND + 3);
-  DMA_Cmd(DMA1_Channel4, ENABLE);
-}
-
-uint8_t* usart1_get_rx_buffer(void)
-{
-  return ui8_rx_buffer;
-}
-
-uint8_t usart1_received_package(void)
-{
-  return ui8_received_package_flag;
-}
-
-void usart1_reset_received_package(void)
-{
-  ui8_received_package_flag = 0;
-}
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include "usart1.h"
+#include "stm32f10x.h"
+#include "pins.h"
+#include "stm32f10x_usart.h"
+#include "stm32f10x_dma.h"
+#include "lcd.h"
+#include "usart1.h"
+#include "main.h"
+#include "uart.h"
+#include "packet_framer.h"
+#include "motor_packet.h"
+
+// DMA1 channel 5 writes the received bytes round this, the framer takes the packets out. The DMA
+// half and full transfer interrupts come every 32 bytes, so it never laps the framer.
+#define RX_RING_SIZE 64
+
+static volatile uint8_t ui8_rx_ring[RX_RING_SIZE];
+static packet_framer_t rx_framer;
+static uint8_t ui8_m_tx_length = UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V19 + UART_NUMBER_CRC_BYTES;
+uart_rx_stats_t uart_rx_stats;
+
+void usart1_init(void)
+{
+  NVIC_InitTypeDef NVIC_InitStructure;
+  GPIO_InitTypeDef GPIO_InitStructure;
+  USART_InitTypeDef USART_InitStructure;
+  DMA_InitTypeDef DMA_InitStructure;
+
+  // enable GPIO clock
+  RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1 | RCC_APB2Periph_AFIO, ENABLE);
+  RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+  DMA_DeInit(DMA1_Channel4);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) &(USART1->DR);
+  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t) uart_get_tx_buffer();
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+  DMA_InitStructure.DMA_BufferSize = ui8_m_tx_length;
+  DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+  DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+  DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+  DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+  DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+  DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+
+  // RX, round the ring for good
+  packet_framer_init(&rx_framer, ui8_rx_ring, RX_RING_SIZE, MOTOR_PACKET_RX_START_BYTE,
+      UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V19 + UART_NUMBER_CRC_BYTES, &uart_rx_stats);
+
+  DMA_DeInit(DMA1_Channel5);
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t) &(USART1->DR);
+  DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t) ui8_rx_ring;
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+  DMA_InitStructure.DMA_BufferSize = RX_RING_SIZE;
+  DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+  DMA_Init(DMA1_Channel5, &DMA_InitStructure);
+  DMA_ITConfig(DMA1_Channel5, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+  // USART pins
+  GPIO_InitStructure.GPIO_Pin = USART1_RX__PIN;
+  GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN_FLOATING;
+  GPIO_Init(USART1__PORT, &GPIO_InitStructure);
+
+  GPIO_InitStructure.GPIO_Pin = USART1_TX__PIN;
+  GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+  GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_PP;
+  GPIO_Init(USART1__PORT, &GPIO_InitStructure);
+
+  USART_DeInit(USART1);
+  USART_InitStructure.USART_BaudRate = 9600;
+  USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+  USART_InitStructure.USART_StopBits = USART_StopBits_1;
+  USART_InitStructure.USART_Parity = USART_Parity_No;
+  USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+  USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+  USART_Init(USART1, &USART_InitStructure);
+
+  // enable the USART Interrupt
+  NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART1_INTERRUPT_PRIORITY;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
+
+  // at the same priority as the USART, so the two never run the framer at the same time
+  NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel5_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART1_DMA_INTERRUPT_PRIORITY;
+  NVIC_Init(&NVIC_InitStructure);
+
+  USART_ClearITPendingBit(USART1, USART_IT_RXNE);
+  USART_ClearITPendingBit(USART1, USART_IT_TC);
+
+  // enable the USART
+  USART_Cmd(USART1, ENABLE);
+
+  DMA_Cmd(DMA1_Channel4, ENABLE);
+  DMA_Cmd(DMA1_Channel5, ENABLE);
+  USART_DMACmd(USART1, USART_DMAReq_Tx | USART_DMAReq_Rx, ENABLE);
+  USART_Cmd(USART1, ENABLE);
+
+  // the end of every packet, the line goes idle after it
+  USART_ITConfig(USART1, USART_IT_IDLE, ENABLE);
+}
+
+static void rx_process(bool idle)
+{
+  packet_framer_process(&rx_framer, RX_RING_SIZE - DMA_GetCurrDataCounter(DMA1_Channel5), idle);
+}
+
+// USART1 interrupt handler, RX goes by DMA and the interrupt is only for the idle line
+void USART1_IRQHandler()
+{
+  uint16_t ui16_status = USART1->SR;
+
+  // reading SR then DR clears IDLE and ORE, the DMA already took the byte in DR
+  if(ui16_status & (USART_FLAG_IDLE | USART_FLAG_ORE))
+    (void) USART1->DR;
+
+  if(ui16_status & USART_FLAG_ORE)
+    uart_rx_stats.ui32_framing_errors++;
+
+  if(ui16_status & USART_FLAG_IDLE)
+    rx_process(true);
+}
+
+// half and full transfer of the RX ring
+void DMA1_Channel5_IRQHandler()
+{
+  DMA_ClearITPendingBit(DMA1_IT_GL5);
+  rx_process(false);
+}
+
+void usart1_set_baud(uint32_t ui32_baud)
+{
+  USART_InitTypeDef USART_InitStructure;
+
+  // only the settings bits of CR1 change, the DMA and the idle interrupt stay on
+  USART_InitStructure.USART_BaudRate = ui32_baud;
+  USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+  USART_InitStructure.USART_StopBits = USART_StopBits_1;
+  USART_InitStructure.USART_Parity = USART_Parity_No;
+  USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+  USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+
+  USART_Cmd(USART1, DISABLE);
+  USART_Init(USART1, &USART_InitStructure);
+  USART_Cmd(USART1, ENABLE);
+}
+
+void usart1_set_packet_lengths(uint8_t ui8_rx_length, uint8_t ui8_tx_length)
+{
+  packet_framer_set_length(&rx_framer, ui8_rx_length);
+  ui8_m_tx_length = ui8_tx_length;
+}
+
+void usart1_start_dma_transfer(void)
+{
+  DMA_Cmd(DMA1_Channel4, DISABLE);
+  DMA_SetCurrDataCounter(DMA1_Channel4, ui8_m_tx_length);
+  USART_ClearFlag(USART1, USART_FLAG_TC);
+  DMA_Cmd(DMA1_Channel4, ENABLE);
+}
+
+// TC is cleared when a transfer starts, set out of reset, and set again once the last byte the
+// DMA put in DR left the shift register
+bool usart1_tx_busy(void)
+{
+  return !(USART1->SR & USART_FLAG_TC);
+}
+
+const uint8_t* usart1_get_rx_packet(uint8_t *p_length)
+{
+  return packet_framer_get(&rx_framer, p_length);
+}
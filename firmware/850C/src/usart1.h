@@ -1,21 +1,27 @@
-/*
- * Bafang LCD 850C firmware
- *
- * Copyright (C) Casainho, 2018.
- *
- * Released under the GPL License, Version 3
- */
-
-#ifndef _USART1_H_
-#define _USART1_H_
-
-#include "stdio.h"
-
-void usart1_init(void);
-uint8_t* usart1_get_rx_buffer(void);
-uint8_t usart1_received_package(void);
-void usart1_reset_received_package(void);
-void usart1_send_byte_and_block(uint8_t ui8_byte);
-void usart1_start_dma_transfer(void);
-
-#endif
+/*
+ * Bafang LCD 850C firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _USART1_H_
+#define _USART1_H_
+
+#include "stdio.h"
+#include <stdbool.h>
+
+void usart1_init(void);
+/// The newest packet received, NULL if none came since the last call, its length goes to *p_length
+const uint8_t* usart1_get_rx_packet(uint8_t *p_length);
+void usart1_send_byte_and_block(uint8_t ui8_byte);
+void usart1_start_dma_transfer(void);
+/// True until the last byte of the TX DMA transfer left the shift register
+bool usart1_tx_busy(void);
+/// Doesn't wait for the TX, a byte going out would be garbled: call it once usart1_tx_busy() is false
+void usart1_set_baud(uint32_t ui32_baud);
+/// Packet lengths with the start byte and the CRC, V19 at start. TX takes it at the next usart1_start_dma_transfer().
+void usart1_set_packet_lengths(uint8_t ui8_rx_length, uint8_t ui8_tx_length);
+
+#endif
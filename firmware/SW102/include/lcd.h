@@ -10,8 +10,16 @@
 
 #include "stdint.h"
 
+typedef struct {
+  uint32_t flushes; // lcd_refresh() calls that sent something
+  uint32_t skipped; // lcd_refresh() calls with nothing to send
+  uint32_t pages;   // page windows sent
+  uint32_t bytes;   // frameBuffer bytes sent, a full refresh is 1024
+} lcd_flush_stats_t;
+
 void lcd_init(void);
-void lcd_refresh(void); // Call to flush framebuffer to SPI device
+void lcd_refresh(void); // Call to flush the changed parts of framebuffer to SPI device
+const lcd_flush_stats_t *lcd_get_flush_stats(void);
 void lcd_set_backlight_intensity(uint8_t level);
 
 
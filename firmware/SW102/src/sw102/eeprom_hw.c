@@ -7,19 +7,43 @@
  */
 
 #include <string.h>
-#include "section_vars.h"
 #include "eeprom_hw.h"
 #include "common.h"
 #include "fds.h"
 #include "nrf_delay.h"
 #include "nrf_soc.h"
+#include "app_util_platform.h"
 #include "assert.h"
 
-// volatile fs_ret_t last_fs_ret;
+#define FILE_ID     0x1001
+#define REC_KEY     0x2002
 
-/* Event handler */
+#define FDS_HEADER_WORDS  3  // sizeof(fds_header_t)
+#define MAX_WORDS         64 // the largest eeprom_data_t the save queue takes
 
-volatile static bool gc_done, init_done, write_done;
+/*
+ * Saves don't wait for the flash. flash_write_words() copies the data and returns, the FDS write
+ * is started from there or from the event handler when the previous one is done, and a save
+ * queued behind a write in flight is replaced by a newer one. GC runs only when the free space
+ * gets short, after a write, so that a save rarely has to wait for one.
+ */
+typedef enum {
+  FDS_IDLE,
+  FDS_WRITING,
+  FDS_COLLECTING
+} fds_state_t;
+
+static uint32_t ui32_m_buffers[2][MAX_WORDS]; // FDS reads the data until its write is done
+static uint8_t ui8_m_queued_buffer;           // the buffer FDS doesn't own
+static uint16_t ui16_m_queued_words;          // 0 if no save is queued
+static uint16_t ui16_m_record_words;
+static fds_record_desc_t m_record_desc;
+static bool has_record;
+static bool gc_wanted;
+static volatile fds_state_t m_state = FDS_IDLE;
+static volatile bool init_done, write_failed;
+
+static void start_next(void);
 
 /* Register fs_sys_event_handler with softdevice_sys_evt_handler_set in ble_stack_init or this doesn't fire! */
 static void fds_evt_handler(fds_evt_t const *const evt)
@@ -31,11 +55,17 @@ static void fds_evt_handler(fds_evt_t const *const evt)
     init_done = true;
     break;
   case FDS_EVT_GC:
-    gc_done = true;
+    if (m_state == FDS_COLLECTING)
+      m_state = FDS_IDLE;
     break;
   case FDS_EVT_UPDATE:
   case FDS_EVT_WRITE:
-    write_done = true;
+    if (m_state == FDS_WRITING && evt->write.file_id == FILE_ID && evt->write.record_key == REC_KEY) {
+      if (evt->result != FDS_SUCCESS)
+        write_failed = true;
+      m_state = FDS_IDLE;
+      gc_wanted = true;
+    }
     break;
   case FDS_EVT_DEL_RECORD:
     break;
@@ -43,10 +73,11 @@ static void fds_evt_handler(fds_evt_t const *const evt)
   default:
     break;
   }
-}
 
-#define FILE_ID     0x1001
-#define REC_KEY     0x2002
+  // other FDS users (the peer manager) share the op queue, so any event can let a save start
+  if (init_done)
+    start_next();
+}
 
 // returns true if our preferences were found
 bool flash_read_words(void *dest, uint16_t length_words)
@@ -73,6 +104,10 @@ bool flash_read_words(void *dest, uint16_t length_words)
 
       // Close the record when done.
       APP_ERROR_CHECK(fds_record_close(&record_desc));
+
+      // the saves update this record
+      m_record_desc = record_desc;
+      has_record = true;
     }
     else {
       // Found a second record with the same key, delete it to prevent confusion when we go to write
@@ -83,68 +118,98 @@ bool flash_read_words(void *dest, uint16_t length_words)
   return did_read;
 }
 
-static bool wait_gc()
+// Start the queued save, or a GC if it is due. Called with the FDS event handler masked.
+static void start_next(void)
 {
-  if(!useSoftDevice)
-    return true; // assume success
+  fds_stat_t stat;
+  fds_record_t record;
+  fds_record_chunk_t record_chunk;
 
-  gc_done = false;
-  fds_gc();
-  for (volatile int count = 0; count < 1000 && !gc_done; count++) {
-    sd_app_evt_wait();
-    nrf_delay_ms(1);
+  if (m_state != FDS_IDLE || fds_stat(&stat) != FDS_SUCCESS)
+    return;
+
+  if (ui16_m_queued_words) {
+    if (stat.largest_contig < ui16_m_queued_words + FDS_HEADER_WORDS) {
+      // no room for the record, it has to wait for the GC
+      if (stat.freeable_words) {
+        m_state = FDS_COLLECTING;
+        if (fds_gc() != FDS_SUCCESS)
+          m_state = FDS_IDLE; // FDS queue full, retried on the next event
+      }
+      return;
+    }
+
+    // Set up data.
+    record_chunk.p_data = ui32_m_buffers[ui8_m_queued_buffer];
+    record_chunk.length_words = ui16_m_queued_words;
+
+    // Set up record.
+    record.file_id = FILE_ID;
+    record.key = REC_KEY;
+    record.data.p_chunks = &record_chunk;
+    record.data.num_chunks = 1;
+
+    // the state first, the event can come before fds_record_update() returns
+    m_state = FDS_WRITING;
+    ui16_m_record_words = ui16_m_queued_words;
+    ui16_m_queued_words = 0;
+    ui8_m_queued_buffer ^= 1;
+
+    // either make a new record or update an old one (if we lose power during update the old record is preserved)
+    ret_code_t retcode = has_record ?
+      fds_record_update(&m_record_desc, &record)
+    :
+      fds_record_write(&m_record_desc, &record);
+
+    if (retcode == FDS_SUCCESS) {
+      has_record = true;
+    } else if (m_state == FDS_WRITING) {
+      // not queued, keep the save for the next event unless a newer one came
+      m_state = FDS_IDLE;
+      ui8_m_queued_buffer ^= 1;
+      ui16_m_queued_words = ui16_m_record_words;
+    }
+    return;
   }
-  // Note: this can fail if the soft device is not enabled (normally performed in ble init)
-  // assert(gc_done);
-  return gc_done;
-}
 
+  // idle, make room for the next save now (a GC copies the records and erases pages)
+  if (gc_wanted && stat.largest_contig < 2 * (ui16_m_record_words + FDS_HEADER_WORDS) && stat.freeable_words) {
+    gc_wanted = false;
+    m_state = FDS_COLLECTING;
+    if (fds_gc() != FDS_SUCCESS)
+      m_state = FDS_IDLE;
+  }
+}
 
 bool flash_write_words(const void *value, uint16_t length_words)
 {
-  fds_record_t record;
-  fds_record_desc_t record_desc;
-  fds_record_chunk_t record_chunk;
-  fds_find_token_t ftok;
-
   if(!useSoftDevice)
     return true; // FIXME: for this test of working without soft device, we let writes to flash silently fail
 
-  wait_gc(); // Before writing we always GC (to ensure there is at least one free record we can use)
+  if (length_words > MAX_WORDS)
+    return false;
 
-  // Do we already have one of these records?
-  memset(&record_desc, 0x00, sizeof(record_desc));
-  memset(&ftok, 0x00, sizeof(ftok));
-  bool has_old = fds_record_find(FILE_ID, REC_KEY, &record_desc, &ftok)
-      == FDS_SUCCESS;
-
-// Set up data.
-  record_chunk.p_data = value;
-  record_chunk.length_words = length_words;
-
-// Set up record.
-  record.file_id = FILE_ID;
-  record.key = REC_KEY;
-  record.data.p_chunks = &record_chunk;
-  record.data.num_chunks = 1;
-
-  write_done = false;
-
-  // either make a new record or update an old one (if we lose power during update the old record is preserved)
-  ret_code_t retcode = (has_old) ?
-    fds_record_update(&record_desc, &record)
-  :
-    fds_record_write(&record_desc, &record);
-  // Note - we intentionally don't check error codes here, because the developer might have turned off softdevice for debugging
-  // APP_ERROR_CHECK(retcode);
-  (void) retcode;
-
-  for (volatile int count = 0; count < 1000 && !write_done; count++) {
+  CRITICAL_REGION_ENTER();
+  memcpy(ui32_m_buffers[ui8_m_queued_buffer], value, length_words * sizeof(uint32_t));
+  ui16_m_queued_words = length_words;
+  write_failed = false;
+  start_next();
+  CRITICAL_REGION_EXIT();
+
+  return true;
+}
+
+bool flash_flush(void)
+{
+  if(!useSoftDevice)
+    return true;
+
+  for (volatile int count = 0; count < 1000 && (m_state == FDS_WRITING || ui16_m_queued_words); count++) {
     sd_app_evt_wait();
     nrf_delay_ms(1);
   }
 
-  return write_done;
+  return !ui16_m_queued_words && m_state != FDS_WRITING && !write_failed;
 }
 
 
@@ -166,7 +231,5 @@ void eeprom_hw_init(void)
   }
   // Note: this can fail if the soft device is not enabled (normally performed in ble init)
   // assert(init_done);
-
-  wait_gc();
 }
 
@@ -36,6 +36,21 @@ extern UG_GUI gui;
 /* Frame buffer in RAM with same structure as LCD memory --> 16 pages a 64 columns (1 kB) */
 uint8_t frameBuffer[16][64];
 
+/* Per page range of columns changed since the last flush, empty when dirtyStart > dirtyEnd.
+ * Everything starts dirty so the first refresh clears the LCD internal RAM. */
+static uint8_t dirtyStart[16] = { 0 };
+static uint8_t dirtyEnd[16] = { 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63 };
+
+static lcd_flush_stats_t flushStats;
+
+static inline void markDirty(uint8_t page, uint8_t x1, uint8_t x2)
+{
+  if (x1 < dirtyStart[page])
+    dirtyStart[page] = x1;
+  if (x2 > dirtyEnd[page] || dirtyStart[page] > dirtyEnd[page])
+    dirtyEnd[page] = x2;
+}
+
 /* Init sequence sampled by casainho from original SW102 display */
 static const uint8_t init_array[] = {
     0xAE, // 11. display on
@@ -95,14 +110,20 @@ void drawFastHLineInternal(int16_t x, int16_t y, int16_t w, UG_COLOR color) {
     }
     if(w > 0) { // Proceed only if width is positive
       uint8_t *pBuf = &frameBuffer[(y / 8)][x],
-               mask = 1 << (y & 7);
-      if(color)
-        while(w--) { *pBuf++ |= mask; } // white
-      else { // black
-        mask = ~mask;
-        while(w--) { *pBuf++ &= mask; };
+               mask = 1 << (y & 7),
+               set = color ? mask : 0; // white or black
+      int16_t first = -1, last = -1; // the columns whose byte changed, only they are dirty as in pset()
+      for(int16_t i = x; i < x + w; i++, pBuf++) {
+        uint8_t old = *pBuf;
+        *pBuf = (old & ~mask) | set;
+        if(*pBuf != old) {
+          if(first < 0)
+            first = i;
+          last = i;
+        }
       }
-      // case INVERSE:             while(w--) { *pBuf++ ^= mask; }; break;
+      if(first >= 0)
+        markDirty(y / 8, first, last);
     }
   }
 }
@@ -166,11 +187,15 @@ static void pset(UG_S16 x, UG_S16 y, UG_COLOR col)
 
   uint8_t page = y / 8;
   uint8_t pixel = y % 8;
+  uint8_t old = frameBuffer[page][x];
 
   if (col > 0)
     SET_BIT(frameBuffer[page][x], pixel);
   else
     CLR_BIT(frameBuffer[page][x], pixel);
+
+  if (frameBuffer[page][x] != old)
+    markDirty(page, x, x);
 }
 
 /**
@@ -213,7 +238,7 @@ static int lcdBacklight = -1; // -1 means unset
 static int oldBacklight = -1;
 
 /**
- * @brief Start transfer of frameBuffer to LCD
+ * @brief Start transfer of frameBuffer to LCD, only the changed columns of the changed pages are sent
  */
 void lcd_refresh(void)
 {
@@ -226,19 +251,44 @@ void lcd_refresh(void)
     send_cmd(cmd, sizeof(cmd));
   }
 
-  uint8_t addr = 0xB0;
   static uint8_t pagecmd[] = { 0, 0x00, 0x10 };
+  bool sent = false;
 
   for (uint8_t i = 0; i < 16; i++)
   {
-    // New page address
-    pagecmd[0] = addr++;
+    if (dirtyStart[i] > dirtyEnd[i])
+      continue;
+
+    uint8_t start = dirtyStart[i];
+    uint8_t len = dirtyEnd[i] - start + 1;
+
+    // New page and column address
+    pagecmd[0] = 0xB0 + i;
+    pagecmd[1] = start & 0x0F;
+    pagecmd[2] = 0x10 | (start >> 4);
     send_cmd(pagecmd, sizeof(pagecmd));
 
-    // send page data
+    // send the changed part of the page
     set_data();
-    APP_ERROR_CHECK(nrf_drv_spi_transfer(&spi, &frameBuffer[i][0], 64, NULL, 0));
+    APP_ERROR_CHECK(nrf_drv_spi_transfer(&spi, &frameBuffer[i][start], len, NULL, 0));
+
+    dirtyStart[i] = 0xFF;
+    dirtyEnd[i] = 0;
+    sent = true;
+
+    flushStats.pages++;
+    flushStats.bytes += len;
   }
+
+  if (sent)
+    flushStats.flushes++;
+  else
+    flushStats.skipped++;
+}
+
+const lcd_flush_stats_t *lcd_get_flush_stats(void)
+{
+  return &flushStats;
 }
 
 /**
@@ -6,6 +6,7 @@
 #include <ble_services.h>
 #include <eeprom_hw.h>
 #include "app_timer.h"
+#include "app_scheduler.h"
 #include "main.h"
 #include "button.h"
 #include "buttons.h"
@@ -48,6 +49,11 @@ APP_TIMER_DEF(gui_timer_id); /* GUI updates counting timer. */
 #define GUI_INTERVAL APP_TIMER_TICKS(MSEC_PER_TICK, APP_TIMER_PRESCALER)
 volatile uint32_t gui_ticks;
 
+// layer_2() goes through the scheduler. Its event stays queued while layer_2_task() runs, and that
+// clears layer_2_pending first, so the next trigger can put a second one.
+#define SCHED_MAX_EVENT_DATA_SIZE 0
+#define SCHED_QUEUE_SIZE 2
+
 // assume we should until we init_softdevice()
 bool useSoftDevice = true;
 
@@ -68,7 +74,9 @@ void lcd_power_off(uint8_t updateDistanceOdo)
   lcd_refresh();
   // lcd_set_backlight_intensity(0);
 
-  // FIXME: wait for flash write to complete before powering down
+  // wait for the flash write to complete before powering down
+  flash_flush();
+
   // now disable the power to all the system
   system_power(0);
 
@@ -171,6 +179,7 @@ int main(void)
   uart_init();
   battery_voltage_init();
 
+  APP_SCHED_INIT(SCHED_MAX_EVENT_DATA_SIZE, SCHED_QUEUE_SIZE);
   init_app_timers(); // Must be before ble_init! because it sets app timer prescaler
 
   if(useSoftDevice)
@@ -193,13 +202,14 @@ int main(void)
 
   uint32_t lasttick = gui_ticks;
   uint32_t tickshandled = 0; // we might miss ticks if running behind, so we use our own local count to figure out if we need to run our 100ms services
-  uint32_t ticksmissed = 0;
   while (1)
   {
     if (l3_vars.ui16_wheel_speed_x10 == 0) {  //Stef
          l3_vars.ui8_offroad_mode = 0;
       }
 
+    app_sched_execute(); // layer_2()
+
     uint32_t tick = gui_ticks;
     if (tick != lasttick)
     {
@@ -207,9 +217,9 @@ int main(void)
       watchdog_service(); // we only service the watchdog if we see our ticks are still increasing
 
       if(tick != lasttick + 1) {
-        ticksmissed += (tick - lasttick - 1); // Error!  We fell behind and missed some ticks (probably due to screen draw taking more than 20 msec)
+        ui32_g_ticks_missed += (tick - lasttick - 1); // Error!  We fell behind and missed some ticks (probably due to screen draw taking more than 20 msec)
 
-        // if(is_sim_motor) app_error_fault_handler(FAULT_MISSEDTICK, 0, ticksmissed);
+        // if(is_sim_motor) app_error_fault_handler(FAULT_MISSEDTICK, 0, ui32_g_ticks_missed);
       }
 
       lasttick = tick;
@@ -276,14 +286,28 @@ static void button_poll_timer_timeout(void *p_context)
 #endif
 
 
+static void layer_2_event(void *p_event_data, uint16_t event_size)
+{
+  UNUSED_PARAMETER(p_event_data);
+  UNUSED_PARAMETER(event_size);
+
+  layer_2_task();
+}
+
+// layer_2() runs from the main loop too, so the urgent packet can go right away
+void tx_urgent_pend(void)
+{
+  tx_urgent_task();
+}
+
 static void gui_timer_timeout(void *p_context)
 {
   UNUSED_PARAMETER(p_context);
 
   gui_ticks++;
 
-  if(gui_ticks % (100 / MSEC_PER_TICK) == 0) // every 100ms
-    layer_2();
+  if(gui_ticks % (100 / MSEC_PER_TICK) == 0 && layer_2_trigger()) // every 100ms, run by the main loop
+    APP_ERROR_CHECK(app_sched_event_put(NULL, 0, layer_2_event));
 
   if(gui_ticks % (1000 / MSEC_PER_TICK) == 0){
     ui32_seconds_since_startup++;
@@ -297,6 +321,17 @@ uint32_t get_msecs() {
   return gui_ticks * MSEC_PER_TICK;
 }
 
+uint32_t layer_2_clock(void) {
+  return NRF_RTC1->COUNTER; // the app timer RTC, 24 bits at 32768Hz
+}
+
+uint32_t layer_2_clock_us_since(uint32_t ui32_stamp) {
+  uint32_t ui32_ticks = ((NRF_RTC1->COUNTER - ui32_stamp) & 0xffffff) * (APP_TIMER_PRESCALER + 1);
+
+  // * 1000000 / 32768 is * 15625 / 512, in two parts so it doesn't overflow, the M0 has no divide
+  return (ui32_ticks >> 9) * 15625 + (((ui32_ticks & 511) * 15625) >> 9);
+}
+
 uint32_t get_seconds() {
 //  return ui32_seconds_since_startup;
   return l3_vars.ui32_trip_timeSec;
@@ -11,6 +11,7 @@
 #include "main.h"
 #include "utils.h"
 #include "screen.h"
+#include "format.h"
 #include "rtc.h"
 #include "fonts.h"
 #include "uart.h"
@@ -123,6 +124,7 @@ Screen mainScreen = {
         .x = 0, .y = 48,//35
         .width = -1, .height = -1,
         .field = &assistLevelField,
+        .critical = true,
         .font = &MEDIUM_NUMBERS_TEXT_FONT,
         .label_align_x = AlignHidden,
         .border = BorderBottom//BorderNone
@@ -131,6 +133,7 @@ Screen mainScreen = {
         .x = 12, .y = 24,
         .width = -2, .height = -1,
         .field = &wheelSpeedIntegerField,
+        .critical = true,
         .font = &BIG_NUMBERS_TEXT_FONT,
         .label_align_x = AlignHidden,
         .border = BorderBottom
@@ -205,8 +208,19 @@ Screen infoScreen = {
 // Show our battery graphic
 void battery_display() {
   // on this board we use a special battery font
+  static uint8_t ui8_old_bars = 0xff; // used to prevent unneeded updates
   uint8_t ui32_battery_bar_number = l3_vars.volt_based_soc / (90 / 5); // scale SOC so anything greater than 90% is 5 bars, and zero is zero.
-  fieldPrintf(&batteryField, "%d", ui32_battery_bar_number);
+
+  if (ui32_battery_bar_number != ui8_old_bars) {
+    ui8_old_bars = ui32_battery_bar_number;
+    char str[4];
+    format_uint(str, ui32_battery_bar_number, 0, ' ');
+    fieldSetText(&batteryField, str);
+  }
+}
+
+// There are no graphs on this board, so no history to record
+void graphs_record(void) {
 }
 
 // Screens in a loop, shown when the user short presses the power button
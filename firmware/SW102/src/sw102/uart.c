@@ -8,7 +8,7 @@
 #include "common.h"
 #include "nrf_drv_uart.h"
 #include "uart.h"
-#include "utils.h"
+#include "crc16.h"
 #include "assert.h"
 #include "app_util_platform.h"
 
@@ -17,12 +17,14 @@ typedef struct uart_rx_buff_typedef uart_rx_buff_typedef;
 struct uart_rx_buff_typedef
 {
   uint8_t uart_rx_data[UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 + UART_NUMBER_CRC_BYTES];
+  uint8_t uart_rx_length; // bytes received, the start byte included
   uart_rx_buff_typedef* next_uart_rx_buff;
 };
 uart_rx_buff_typedef* uart_rx_buffer;
-volatile uint8_t* uart_rx_data_rdy;
+uart_rx_buff_typedef* volatile uart_rx_buff_rdy;
 uint8_t stream_version;
 uint8_t uart_number_bytes_rx, uart_number_bytes_tx;
+uart_rx_stats_t uart_rx_stats;
 
 uint8_t uart_buffer0_tx[UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V20 + UART_NUMBER_CRC_BYTES];
 
@@ -89,32 +91,50 @@ void uart_set_stream_version(uint8_t version)
 }
 
 /**
- * @brief Returns pointer to RX buffer ready for parsing or NULL
+ * @brief Returns pointer to RX buffer ready for parsing or NULL, and the bytes received for it
  */
-const uint8_t* uart_get_rx_buffer_rdy(void)
+const uint8_t* uart_get_rx_buffer_rdy(uint8_t *p_length)
 {
-  uint8_t* rx_rdy;
+  uart_rx_buff_typedef* rx_buff;
+  uint8_t* rx_rdy = NULL;
+  uint8_t rx_length = 0;
 
-  // VERY paranoid but it is possible that uart_rx_data_rdy
+  // VERY paranoid but it is possible that uart_rx_buff_rdy
   // is set from IRQ during hand-over and gets NULLed right away.
   CRITICAL_REGION_ENTER();
   {
-    rx_rdy = (uint8_t*) uart_rx_data_rdy;
-    uart_rx_data_rdy = NULL;
+    rx_buff = uart_rx_buff_rdy;
+    uart_rx_buff_rdy = NULL;
   }
   CRITICAL_REGION_EXIT();
 
-  if (rx_rdy != NULL)
+  if (rx_buff != NULL)
   {
-    uint16_t crc_rx = 0xffff;
-    for (uint8_t ui8_i = 0; ui8_i <= uart_number_bytes_rx; ui8_i++)
-      crc16(rx_rdy[ui8_i], &crc_rx);
+    rx_rdy = rx_buff->uart_rx_data;
+    rx_length = rx_buff->uart_rx_length;
+  }
 
-    if (((((uint16_t) rx_rdy[uart_number_bytes_rx + 2]) << 8)
-        + ((uint16_t) rx_rdy[uart_number_bytes_rx + 1])) != crc_rx)
+  // the CRC is in the last 2 of the bytes received, a packet that was cut short fails it
+  if (rx_rdy != NULL && rx_length < UART_NUMBER_START_BYTES + UART_NUMBER_CRC_BYTES)
+  {
+    rx_rdy = NULL;
+    uart_rx_stats.ui32_framing_errors++;
+  }
+  else if (rx_rdy != NULL)
+  {
+    uint16_t crc_rx = crc16_buffer(CRC16_INIT, rx_rdy, rx_length - UART_NUMBER_CRC_BYTES);
+
+    if (((((uint16_t) rx_rdy[rx_length - 1]) << 8)
+        + ((uint16_t) rx_rdy[rx_length - 2])) != crc_rx)
+    {
       rx_rdy = NULL;  // Invalidate buffer if CRC not OK
+      uart_rx_stats.ui32_crc_errors++;
+    }
+    else
+      uart_rx_stats.ui32_packets++;
   }
 
+  *p_length = rx_length;
   return rx_rdy;
 }
 
@@ -137,6 +157,39 @@ void uart_send_tx_buffer(uint8_t *tx_buffer)
   APP_ERROR_CHECK(err_code);
 }
 
+/**
+ * @brief True while the last TX buffer is still going out
+ */
+bool uart_tx_busy(void)
+{
+  return nrf_drv_uart_tx_in_progress(&uart0);
+}
+
+/**
+ * @brief Change the baud rate, for the motor link handshake
+ */
+void uart_set_baud(uint32_t ui32_baud)
+{
+  nrf_uart_baudrate_t baudrate;
+
+  switch (ui32_baud)
+  {
+  case 57600:
+    baudrate = NRF_UART_BAUDRATE_57600;
+    break;
+
+  case 115200:
+    baudrate = NRF_UART_BAUDRATE_115200;
+    break;
+
+  default:
+    baudrate = NRF_UART_BAUDRATE_9600;
+    break;
+  }
+
+  nrf_uart_baudrate_set(NRF_UART0, baudrate);
+}
+
 /* Event handler */
 
 static void uart_event_handler(nrf_drv_uart_event_t *p_event, void *p_context)
@@ -153,6 +206,7 @@ static void uart_event_handler(nrf_drv_uart_event_t *p_event, void *p_context)
     // The only error we expect is overrun or framing
     // assert(p_event->data.error.error_mask & (UART_ERRORSRC_OVERRUN_Msk | UART_ERRORSRC_FRAMING_Msk | UART_ERRORSRC_BREAK_Msk));
 
+    uart_rx_stats.ui32_framing_errors++;
     uart_rx_state_machine = 0;
     APP_ERROR_CHECK(nrf_drv_uart_rx(&uart0, &uart_rx_buffer->uart_rx_data[0], 1));
     break;
@@ -174,8 +228,11 @@ static void uart_event_handler(nrf_drv_uart_event_t *p_event, void *p_context)
 
     /* End of stream RX */
     case 1:
+      uart_rx_buffer->uart_rx_length = UART_NUMBER_START_BYTES + p_event->data.rxtx.bytes;
       /* Signal that we have a full package to be processed */
-      uart_rx_data_rdy = uart_rx_buffer->uart_rx_data;
+      if (uart_rx_buff_rdy != NULL)
+        uart_rx_stats.ui32_replaced++;
+      uart_rx_buff_rdy = uart_rx_buffer;
       /* Switch buffer */
       uart_rx_buffer = uart_rx_buffer->next_uart_rx_buff;
       /* Start bytewise RX again */
@@ -0,0 +1,43 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _CRC16_H_
+#define _CRC16_H_
+
+#include <stdint.h>
+
+/*
+ * CRC16/Modbus (reflected 0x8005, seeded with 0xffff) as used by the motor packets.
+ *
+ * Three implementations giving the same result, CRC16_IMPLEMENTATION picks the one behind
+ * crc16_update() and crc16_buffer():
+ *   CRC16_BYTE_TABLE    one lookup per byte, 512 bytes of flash
+ *   CRC16_NIBBLE_TABLE  two lookups per byte, 32 bytes of flash
+ *   CRC16_BITWISE       eight shift/xor steps per byte, no table
+ */
+#define CRC16_BITWISE       0
+#define CRC16_NIBBLE_TABLE  1
+#define CRC16_BYTE_TABLE    2
+
+#ifndef CRC16_IMPLEMENTATION
+#define CRC16_IMPLEMENTATION CRC16_BYTE_TABLE
+#endif
+
+#define CRC16_INIT 0xffff
+
+uint16_t crc16_update_bitwise(uint16_t ui16_crc, uint8_t ui8_data);
+uint16_t crc16_update_nibble_table(uint16_t ui16_crc, uint8_t ui8_data);
+uint16_t crc16_update_byte_table(uint16_t ui16_crc, uint8_t ui8_data);
+
+/// Add one byte to a running CRC, start with CRC16_INIT
+uint16_t crc16_update(uint16_t ui16_crc, uint8_t ui8_data);
+
+/// Add ui16_length bytes to a running CRC
+uint16_t crc16_buffer(uint16_t ui16_crc, const uint8_t *p_data, uint16_t ui16_length);
+
+#endif /* _CRC16_H_ */
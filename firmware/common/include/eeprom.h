@@ -75,6 +75,7 @@ typedef struct eeprom_data {
 	 
 	uint8_t ui8_battery_soc_increment_decrement;
 	uint8_t ui8_buttons_up_down_invert;
+	uint8_t ui8_motor_firmware; // 0xff in an older image, read as v0.19
 
 
 
@@ -103,6 +104,7 @@ void eeprom_init_defaults(void);
 #define DEFAULT_VALUE_BATTERY_CELLS_NUMBER                          10 // 13 --> 48V
 #define DEFAULT_VALUE_BATTERY_LOW_VOLTAGE_CUT_OFF_X10               300 // 48v battery, LVC = 39.0 (3.0 * 13)
 #define DEFAULT_VALUE_MOTOR_TYPE                                    1 // ui8_motor_type = 0 = 48V
+#define DEFAULT_VALUE_MOTOR_FIRMWARE                                0 // v0.19, stream version 19
 #define DEFAULT_VALUE_MOTOR_ASSISTANCE_WITHOUT_PEDAL_ROTATION       0 // 0 to keep this feature disable
 #define DEFAULT_VALUE_ASSIST_LEVEL_FACTOR_1                         2 // 0.2
 #define DEFAULT_VALUE_ASSIST_LEVEL_FACTOR_2                         3
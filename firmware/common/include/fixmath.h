@@ -0,0 +1,57 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _FIXMATH_H_
+#define _FIXMATH_H_
+
+#include <stdint.h>
+
+/**
+ * Division without a divide instruction, for layer_2() and the digits of format.c. The Cortex-M0
+ * of the SW102 has none, so every / is a call to __aeabi_uidiv, a loop of shifts and subtracts.
+ * Here a division is a multiply by the reciprocal, keeping the high 32 bits of the 64 bit product,
+ * and a shift: the constants are the ones gcc uses when it has a divide by a constant to do on a
+ * CPU with a long multiply. The results are the same as with / for every 32 bit value.
+ *
+ * The M0 has no long multiply either, fixmath_mulhi() does it with four 16 x 16 bit ones there.
+ */
+
+/// The high 32 bits of ui32_a * ui32_b
+uint32_t fixmath_mulhi(uint32_t ui32_a, uint32_t ui32_b);
+
+/// The same from four 16 x 16 bit multiplies, what fixmath_mulhi() does on the Cortex-M0
+uint32_t fixmath_mulhi_parts(uint32_t ui32_a, uint32_t ui32_b);
+
+/// ui32_value / N, for every value
+uint32_t fixmath_div10(uint32_t ui32_value);
+uint32_t fixmath_div20(uint32_t ui32_value);
+uint32_t fixmath_div25(uint32_t ui32_value);
+uint32_t fixmath_div36(uint32_t ui32_value);
+uint32_t fixmath_div50(uint32_t ui32_value);
+uint32_t fixmath_div500(uint32_t ui32_value);
+uint32_t fixmath_div1000(uint32_t ui32_value);
+uint32_t fixmath_div100000(uint32_t ui32_value);
+
+/**
+ * The reciprocal of a divisor that changes seldom, a setting for example. fixmath_recip_set()
+ * does one 64 bit division, and only when the divisor changed, then fixmath_recip_div() divides
+ * by it with a multiply and shifts. Starts zeroed.
+ */
+typedef struct {
+	uint32_t ui32_divisor; // 0 until the first fixmath_recip_set()
+	uint32_t ui32_m;
+	uint8_t ui8_shift;     // bits of ui32_divisor - 1
+} fixmath_recip_t;
+
+/// ui32_divisor must not be 0
+void fixmath_recip_set(fixmath_recip_t *p_recip, uint32_t ui32_divisor);
+
+/// ui32_value / p_recip->ui32_divisor, for every value
+uint32_t fixmath_recip_div(const fixmath_recip_t *p_recip, uint32_t ui32_value);
+
+#endif /* _FIXMATH_H_ */
@@ -0,0 +1,46 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _FORMAT_H_
+#define _FORMAT_H_
+
+#include <stdint.h>
+
+/**
+ * Number formatting for the screens, without printf. newlib nano's vsnprintf is big and slow on
+ * both displays. The digits come from fixmath_div10(), without a divide, see fixmath.h.
+ *
+ * Every function writes at p_out, ends the string with a 0 and returns where that 0 is, so the
+ * calls chain:
+ *
+ *   p = format_uint(p, hours, 0, ' ');
+ *   p = format_str(p, ":");
+ *   p = format_uint(p, minutes, 2, '0');
+ *
+ * The caller makes sure the buffer is big enough, FORMAT_INT32_LEN for a number.
+ */
+
+#define FORMAT_INT32_LEN  13 // "-2147483648" or "4294967295", a decimal point and the 0
+
+/// Unsigned decimal, padded on the left with c_pad (' ' or '0') to ui8_width characters, as %*u and %0*u
+char* format_uint(char *p_out, uint32_t ui32_value, uint8_t ui8_width, char c_pad);
+
+/// Signed decimal, padded the same way, the zeros go after the '-' as with %0*d
+char* format_int(char *p_out, int32_t i32_value, uint8_t ui8_width, char c_pad);
+
+/// A fixed point value with ui8_decimals decimal digits, showing ui8_shown of them. The others are
+/// truncated as an integer division does: 1234 with 2 decimals is "12.34", "12.3" or "12".
+char* format_fixed(char *p_out, int32_t i32_value, uint8_t ui8_decimals, uint8_t ui8_shown);
+
+/// Hexadecimal in lower case, padded with zeros to ui8_width digits, as %0*lx
+char* format_hex(char *p_out, uint32_t ui32_value, uint8_t ui8_width);
+
+/// Copy a string, for units and separators
+char* format_str(char *p_out, const char *p_str);
+
+#endif /* _FORMAT_H_ */
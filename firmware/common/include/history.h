@@ -0,0 +1,112 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <stdint.h>
+
+/**
+ * Telemetry history for the graphs. A series records an l3_vars value every second, whether its
+ * graph is shown or not, in a pyramid of rings of HISTORY_POINTS:
+ *
+ *   level 0: the 1 s samples            (4 min 15 s)
+ *   level 1: 10 s buckets of 10 samples (42 min 30 s)
+ *   level 2: 60 s buckets of 6 level 1 buckets (4 h 15 min)
+ *
+ * A bucket keeps the min, max and average of its samples. Values are raw, in the units of l3_vars,
+ * and saturated to 16 bits.
+ *
+ * Every series has level 0. The bucket rings of the levels above are 1530 bytes each, so a series
+ * only has those its graphs show, from an array declared with it: see HISTORY_SERIES_BUCKETS().
+ */
+
+#define HISTORY_POINTS  255 // one per graph column
+#define HISTORY_LEVELS  3
+
+typedef struct history_bucket_struct {
+	uint16_t ui16_min;
+	uint16_t ui16_max;
+	uint16_t ui16_avg;
+} history_bucket_t;
+
+typedef struct history_series_struct {
+	const void *p_source; // the l3_vars value
+	history_bucket_t (*p_buckets)[HISTORY_POINTS]; // levels 1 and up, ui8_levels - 1 rings
+	uint8_t ui8_source_size; // of the value, 1, 2 or 4 bytes
+	uint8_t ui8_levels; // recorded, 1 to HISTORY_LEVELS
+
+	uint16_t ui16_samples[HISTORY_POINTS]; // level 0
+	uint8_t ui8_next[HISTORY_LEVELS]; // where the next point of a level goes
+	uint8_t ui8_count[HISTORY_LEVELS]; // points in a level
+	uint32_t ui32_added[HISTORY_LEVELS]; // points ever added to a level, changes when it scrolls
+
+	// the buckets being filled
+	history_bucket_t partial[HISTORY_LEVELS - 1];
+	uint32_t ui32_partial_sum[HISTORY_LEVELS - 1];
+	uint8_t ui8_partial_count[HISTORY_LEVELS - 1];
+} history_series_t;
+
+/// A series of level 0 only
+#define HISTORY_SERIES(source) { .p_source = source, .ui8_source_size = sizeof(*(source)), .ui8_levels = 1 }
+
+/// A series with the levels up to the number of rings of buckets, a history_bucket_t [levels - 1][HISTORY_POINTS]
+#define HISTORY_SERIES_BUCKETS(source, buckets) { .p_source = source, .ui8_source_size = sizeof(*(source)), \
+	.ui8_levels = 1 + sizeof(buckets) / sizeof((buckets)[0]), .p_buckets = buckets }
+
+/// Take a sample of the value of the series, every second
+void history_record(history_series_t *p_series);
+
+/// Seconds per point of a level
+uint16_t history_level_seconds(uint8_t ui8_level);
+
+/// Points in a level, at most HISTORY_POINTS. 0 for the levels the series doesn't have.
+uint8_t history_count(const history_series_t *p_series, uint8_t ui8_level);
+
+/// Points ever added to a level, it changes when the level scrolls
+uint32_t history_added(const history_series_t *p_series, uint8_t ui8_level);
+
+/// Point ui8_index of a level, 0 is the oldest. A level 0 sample is a bucket with the same min, max and average.
+history_bucket_t history_point(const history_series_t *p_series, uint8_t ui8_level, uint8_t ui8_index);
+
+/**
+ * The max and min of the points of a level, for the scale of a graph. Two monotonic queues of ring
+ * positions follow the level as it scrolls: the max queue has the points no later point is over,
+ * the oldest first, so its front is the max, and the min queue the same the other way. A new point
+ * costs amortized O(1), the queues only take the points added since the last update.
+ *
+ * The max is that of the bucket maxes. For the min, a bucket whose min is under
+ * i32_min_threshold counts with its average, and not at all if that is under too.
+ */
+typedef struct history_queue_struct {
+	uint8_t ui8_positions[HISTORY_POINTS]; // in the ring of the level, the oldest point first
+	uint8_t ui8_front;
+	uint8_t ui8_count;
+} history_queue_t;
+
+typedef struct history_window_struct {
+	uint8_t ui8_level;
+	int32_t i32_min_threshold;
+	uint32_t ui32_added; // the points of the level the queues have taken
+	uint8_t ui8_next; // where the next of them is in the ring
+	history_queue_t max;
+	history_queue_t min;
+} history_window_t;
+
+void history_window_init(history_window_t *p_window, uint8_t ui8_level, int32_t i32_min_threshold);
+
+/// Take the points added to the level since the last update
+void history_window_update(history_window_t *p_window, const history_series_t *p_series);
+
+/// The max of the points in the level at the last update, INT32_MIN if there are none
+int32_t history_window_max(const history_window_t *p_window, const history_series_t *p_series);
+
+/// The min of the points in the level that count for it, INT32_MAX if there are none
+int32_t history_window_min(const history_window_t *p_window, const history_series_t *p_series);
+
+#endif /* _HISTORY_H_ */
@@ -4,6 +4,8 @@
 
 void mainscreen_show();
 void main_idle(); // call every 20ms
+extern uint32_t ui32_g_ticks_missed; // 20ms ticks the main loop missed because main_idle() took too long, counted by the main loop
+void screen_clock(void); // the screen part of main_idle(), copies layer 2 vars and updates the screen
 bool mainscreen_onpress(buttons_events_t events);
 
 extern Screen mainScreen, infoScreen, bootScreen;
@@ -37,6 +39,7 @@ extern Field socField,
 
 extern Field batteryField; // These fields are custom for board type
 void battery_display(); // 850C and sw102 provide alternative versions due to different implementations
+void graphs_record(void); // take a sample for the history of each graph, every second
 void set_conversions();
 bool anyscreen_onpress(buttons_events_t events);
 
@@ -0,0 +1,88 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _MOTOR_LINK_H_
+#define _MOTOR_LINK_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "state.h"
+
+/**
+ * Negotiates a faster motor link in the spare byte V20 packets have each way: TX data byte 7
+ * (l2_vars.ui8_link_request) and RX data byte 26 (l2_vars.ui8_link). The display speaks V20 when
+ * the "Motor firmware" setting is v0.20. A controller that doesn't know about the handshake sends
+ * 0 there and the link stays at 9600 baud, one status packet per 100ms.
+ *
+ *   display                              motor
+ *   MOTOR_LINK_OFFER | our caps    ->
+ *                                  <-    MOTOR_LINK_OFFER | its caps
+ *   MOTOR_LINK_SWITCH | choice     ->
+ *                                  <-    MOTOR_LINK_SWITCH | choice, then it switches
+ *   switches, goes on sending MOTOR_LINK_SWITCH | choice at the new speed
+ *
+ * The choice is the fastest baud rate both have and MOTOR_LINK_RATE_50MS if both have it: the motor
+ * then sends its status every 50ms, and layer_2() takes the newest so it is at most 50ms old.
+ *
+ * After MOTOR_LINK_FALLBACK_WINDOWS 100ms windows in a row without a good packet (bad CRCs at the
+ * wrong speed or nothing at all) the display goes back to 9600 and waits MOTOR_LINK_RETRY_WINDOWS
+ * before it offers again. The motor must do the same when it stops getting good packets.
+ */
+
+// caps and choice bits, in the low 6 bits of the link byte
+#define MOTOR_LINK_BAUD_MASK     0x03
+#define MOTOR_LINK_BAUD_9600     0x00 // choice only, every link has it
+#define MOTOR_LINK_BAUD_57600    0x01 // a cap or a choice
+#define MOTOR_LINK_BAUD_115200   0x02 // a cap or a choice, in caps 0x03 means both
+#define MOTOR_LINK_RATE_50MS     0x04
+
+#define MOTOR_LINK_OFFER         0x40
+#define MOTOR_LINK_SWITCH        0x80
+#define MOTOR_LINK_DATA_MASK     0x3f
+
+#define MOTOR_LINK_CAPS          (MOTOR_LINK_BAUD_57600 | MOTOR_LINK_BAUD_115200 | MOTOR_LINK_RATE_50MS)
+
+#define MOTOR_LINK_WAIT_WINDOWS      10  // for an answer to an offer or a switch
+#define MOTOR_LINK_FALLBACK_WINDOWS  5
+#define MOTOR_LINK_RETRY_WINDOWS     300 // 30s, so a motor that doesn't answer costs nothing
+
+typedef enum {
+	MOTOR_LINK_SLOW = 0, // 9600, waiting to offer
+	MOTOR_LINK_OFFERED,
+	MOTOR_LINK_SWITCHING,
+	MOTOR_LINK_FAST,
+} motor_link_state_t;
+
+typedef struct {
+	motor_link_state_t state;
+	uint8_t ui8_choice;
+	uint16_t ui16_windows; // in this state, or without a good packet when fast
+	bool motor_switched; // MOTOR_LINK_SWITCHING, the motor answered but the TX was busy
+	uint32_t ui32_baud;
+	uint32_t ui32_switches;
+	uint32_t ui32_fallbacks;
+	uint32_t ui32_baud_retries; // baud rate changes put off to the next window by a busy TX
+} motor_link_t;
+
+extern motor_link_t motor_link;
+
+/// Baud rate of a MOTOR_LINK_BAUD_ code
+uint32_t motor_link_baud(uint8_t ui8_code);
+
+/// The choice for the caps both sides have, 0 if there is nothing better than 9600 and 100ms
+uint8_t motor_link_choose(uint8_t ui8_caps);
+
+/**
+ * Every 100ms, after the received packet went into p_vars (packet_ok) or didn't come. Sets
+ * p_vars->ui8_link_request for the next packet and changes the UART baud rate with
+ * uart_set_baud(). It never waits for the TX: while uart_tx_busy() the change is tried again in
+ * the next window. Only for stream version 20, the other versions have no byte for it.
+ */
+void motor_link_update(l2_vars_t *p_vars, bool packet_ok);
+
+#endif /* _MOTOR_LINK_H_ */
@@ -0,0 +1,117 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _MOTOR_PACKET_H_
+#define _MOTOR_PACKET_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "state.h"
+#include "uart.h"
+
+#define MOTOR_PACKET_RX_START_BYTE  0x43
+#define MOTOR_PACKET_TX_START_BYTE  0x59
+
+// motor_packet_field_t flags
+#define MOTOR_PACKET_OR             1 // or into the destination instead of replacing it
+#define MOTOR_PACKET_BOOL           2 // TX: 1 if the variable is not 0
+#define MOTOR_PACKET_IF_TEMPERATURE 4 // RX: only when the temperature limit feature is enabled
+#define MOTOR_PACKET_IF_THROTTLE    8 // RX: only when it is not
+
+/**
+ * One field of a motor packet and the l2_vars field it goes to (RX) or comes from (TX).
+ * Multi byte fields are little endian. The mask (0 for the whole value) and the shift are applied
+ * to the packet bytes on RX and to the variable on TX, so a field can also be a few bits of a byte.
+ */
+typedef struct motor_packet_field_struct {
+	uint8_t ui8_offset;   // in the packet, the start byte is 0
+	uint8_t ui8_bytes;    // 1 to 3
+	uint8_t ui8_var_size; // 1, 2 or 4
+	uint8_t ui8_mask;
+	uint8_t ui8_shift;
+	uint8_t ui8_flags;
+	uint16_t ui16_var;    // offsetof() in l2_vars_t
+} motor_packet_field_t;
+
+#define MOTOR_PACKET_FIELD(offset, bytes, var, mask, shift, flags) \
+	{ offset, bytes, sizeof(((l2_vars_t*) 0)->var), mask, shift, flags, offsetof(l2_vars_t, var) }
+
+typedef struct motor_packet_fields_struct {
+	const motor_packet_field_t *p_fields;
+	uint8_t ui8_fields;
+} motor_packet_fields_t;
+
+#define MOTOR_PACKET_FIELDS(fields) { fields, sizeof(fields) / sizeof(fields[0]) }
+
+/**
+ * The packet layout of one motor controller firmware version. Every TX packet has the tx_every
+ * fields plus the fields of its message id, from 0 to ui8_max_message_id.
+ */
+typedef struct motor_packet_version_struct {
+	uint8_t ui8_version;
+	uint8_t ui8_rx_data_bytes;
+	uint8_t ui8_tx_data_bytes;
+	uint8_t ui8_max_message_id;
+	motor_packet_fields_t rx;
+	motor_packet_fields_t tx_every;
+	const motor_packet_fields_t *p_tx_messages;
+} motor_packet_version_t;
+
+#define MOTOR_PACKET_RX_LENGTH(p_version) \
+	(UART_NUMBER_START_BYTES + (p_version)->ui8_rx_data_bytes + UART_NUMBER_CRC_BYTES)
+#define MOTOR_PACKET_TX_LENGTH(p_version) \
+	(UART_NUMBER_START_BYTES + (p_version)->ui8_tx_data_bytes + UART_NUMBER_CRC_BYTES)
+
+#define MOTOR_PACKET_MAX_TX_LENGTH  (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V20 + UART_NUMBER_CRC_BYTES)
+#define MOTOR_PACKET_MAX_MESSAGES   (UART_MAX_NUMBER_MESSAGE_ID_V19 + 1)
+#define MOTOR_PACKET_DIRTY_BURST    3 // changed messages in a row before one of the background refresh
+
+/**
+ * Which message id goes next, for motor_packet_schedule(). A message whose fields changed since it
+ * was last sent goes first, so a new setting reaches the motor in the next packet. The packets
+ * without one, and at least one in MOTOR_PACKET_DIRTY_BURST + 1, go on cycling through all the
+ * message ids, so the motor still gets every setting again after it restarts. There is no
+ * acknowledge in the protocol: a message counts as delivered once it was sent.
+ */
+typedef struct motor_packet_schedule_struct {
+	uint8_t ui8_version;     // the stream version of the signatures, 0 at start
+	uint8_t ui8_refresh_id;  // next message id of the background refresh
+	uint8_t ui8_last_id;
+	uint8_t ui8_dirty_run;   // changed messages sent since the last refresh one
+	uint16_t ui16_sent;      // bit per message id sent since the version changed
+	uint16_t ui16_signature[MOTOR_PACKET_MAX_MESSAGES]; // of the message fields when last sent
+	uint32_t ui32_dirty;     // packets sent for a change
+	uint32_t ui32_refresh;   // packets of the background refresh
+} motor_packet_schedule_t;
+
+/// Layout for a stream version (see uart_get_stream_version()), NULL if it is not supported
+const motor_packet_version_t* motor_packet_version(uint8_t ui8_version);
+
+/**
+ * Decode a received packet into p_vars. The CRC is checked by the UART driver, this checks the
+ * start byte and that ui8_length matches the version. Returns false, with p_vars untouched, if not.
+ */
+bool motor_packet_decode(const motor_packet_version_t *p_version,
+		const uint8_t *p_packet, uint8_t ui8_length, l2_vars_t *p_vars);
+
+/**
+ * Build message ui8_message_id, CRC included, in p_packet (MOTOR_PACKET_TX_LENGTH() bytes).
+ * Also updates the ui8_tx_ fields of p_vars. Returns the packet length.
+ */
+uint8_t motor_packet_encode(const motor_packet_version_t *p_version,
+		uint8_t ui8_message_id, l2_vars_t *p_vars, uint8_t *p_packet);
+
+/**
+ * The message id of the next packet, see motor_packet_schedule_t. Counts it as sent, so call it once
+ * per packet and encode that message with motor_packet_encode(). Starts zeroed.
+ */
+uint8_t motor_packet_schedule(motor_packet_schedule_t *p_schedule,
+		const motor_packet_version_t *p_version, l2_vars_t *p_vars);
+
+#endif /* _MOTOR_PACKET_H_ */
@@ -0,0 +1,67 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _PACKET_FRAMER_H_
+#define _PACKET_FRAMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "uart.h"
+
+#define PACKET_FRAMER_MAX_LENGTH (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 + UART_NUMBER_CRC_BYTES)
+
+// in ui8_ready, the frame there wasn't taken yet
+#define PACKET_FRAMER_FRESH 0x80
+
+/**
+ * Finds the motor packets in the bytes a DMA channel writes round a ring buffer: a start byte,
+ * then ui8_length - 1 more bytes, the last 2 the CRC16 of the others. A start byte that doesn't
+ * check out is skipped and the search goes on from the next byte, so a packet right after
+ * garbage or a cut off packet is still found.
+ *
+ * The packets go to the reader through three buffers: the framer fills one, the last packet is
+ * in another and the reader has the third, so neither waits for the other and the reader always
+ * gets the newest packet. The buffers are swapped with an atomic exchange, which is inline
+ * LDREXB/STREXB on the Cortex-M3 of the 850C.
+ */
+typedef struct {
+	const volatile uint8_t *p_ring;
+	uint16_t ui16_ring_size;
+	uint16_t ui16_tail; // the next byte to look at
+	uint8_t ui8_start_byte;
+	volatile uint8_t ui8_length; // packet_framer_set_length() changes it from the reader's side
+	bool in_sync; // the last bytes were a good packet, so skipping now is a framing error
+	uint8_t ui8_write; // the buffer the framer fills
+	uint8_t ui8_read; // the buffer the reader has
+	volatile uint8_t ui8_ready; // the buffer with the last packet, | PACKET_FRAMER_FRESH
+	uint8_t frames[3][PACKET_FRAMER_MAX_LENGTH];
+	uint8_t ui8_frame_length[3]; // of the packet in each buffer
+	uart_rx_stats_t *p_stats;
+} packet_framer_t;
+
+void packet_framer_init(packet_framer_t *p_framer, const volatile uint8_t *p_ring, uint16_t ui16_ring_size,
+		uint8_t ui8_start_byte, uint8_t ui8_length, uart_rx_stats_t *p_stats);
+
+/**
+ * Change the packet length, for another stream version. The framer takes it at its next
+ * packet_framer_process(), a packet cut by the change fails the CRC. ui8_length must not be over
+ * PACKET_FRAMER_MAX_LENGTH.
+ */
+void packet_framer_set_length(packet_framer_t *p_framer, uint8_t ui8_length);
+
+/**
+ * Take the bytes up to ui16_head, the ring index the DMA writes next. It must be called before the
+ * DMA went round the whole ring, from the DMA half and full transfer interrupts, and with idle set
+ * from the UART IDLE line interrupt: a packet that isn't complete then never will be.
+ */
+void packet_framer_process(packet_framer_t *p_framer, uint16_t ui16_head, bool idle);
+
+/// The newest packet, NULL if there wasn't a new one, valid until the next call. Its length goes to *p_length.
+const uint8_t* packet_framer_get(packet_framer_t *p_framer, uint8_t *p_length);
+
+#endif /* _PACKET_FRAMER_H_ */
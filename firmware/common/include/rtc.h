@@ -16,6 +16,8 @@ typedef struct _rtc_time {
 	uint8_t ui8_minutes;
 } rtc_time_t;
 
+typedef rtc_time_t struct_rtc_time_t; // name used by the SW102 port
+
 void rtc_init(void);
 void rtc_set_time(rtc_time_t *rtc_time);
 rtc_time_t* rtc_get_time(void);
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "ugui.h"
 #include "buttons.h"
+#include "history.h"
 
 /**
  * Main screen notes
@@ -47,6 +48,7 @@
  *
  * helper functions:
  * fieldPrintf(fieldptr, "str %d", 5) - sets the string for the specified fields, marks the field as dirty if the string changed
+ * fieldSetText(fieldptr, str) - the same with a string built with format.h, without printf
  * fieldSetSOC(fieldptr, 32) - sets state of charge and marks field as dirty if the soc changed
  * fieldAddPlot(fieldptr, value) - add a new data point to a plot field
  *
@@ -130,8 +132,8 @@ typedef enum {
 } EditableType;
 
 
-#define GRAPH_MAX_POINTS	(256) // Note: we waste one record, to make our ring buffer code easier
-#define GRAPH_INTERVAL_MS 	3500 // graph updates are expensive - do rarely
+#define GRAPH_MAX_POINTS	HISTORY_POINTS
+#define GRAPH_INTERVAL_MS 	1000 // how often to look for new history points, an update only draws the pixels that changed
 #define GRAPH_COLOR_ACCENT  C_WHITE // Drawn as a top line on the graph
 #define GRAPH_COLOR_NORMAL  C_BLUE
 #define GRAPH_COLOR_WARN    C_YELLOW
@@ -147,13 +149,26 @@ typedef enum {
 // How often to toggle blink animations
 #define BLINK_INTERVAL_MS  300
 
-// Each _active_ graph needs a graphcache to store past points and invariants.  Currently we use use one,
-// but as soon as we have multiple active graphs we should assign dynamically.
+// Pixels an update draws before it leaves the other dirty fields to the next updates, about half the 20ms slot. A pixel
+// is some 0.1us on the bus of the 850C, the SW102 sets its pixels in RAM with the CPU and sends the changes afterwards.
+#ifdef SW102
+#define SCREEN_RENDER_BUDGET 4096
+#else
+#define SCREEN_RENDER_BUDGET 96000
+#endif
+
+// A graph shows the points of a history series, see history.h. The graphcache is what the graph has on the screen,
+// so an update only draws the pixels that change. The screens show one graph at a time, so there is one cache and
+// the graph shown takes it. The points themselves are only kept by the history.
 typedef struct {
-	int32_t points[GRAPH_MAX_POINTS];
-	int32_t max_val, min_val; // the max/min value we've seen (ever)
-	uint32_t start_valid; // the oldest point in our ring buffer
-	uint32_t end_valid; // the newest point in our ring buffer
+	struct Field *owner; // the graph using this cache, NULL if none was shown yet
+	uint32_t drawn_added; // the history points added to the level when it was drawn
+
+	history_window_t window; // the max/min of the level shown
+	int32_t max_val, min_val; // the max/min value of the points shown, INT32_MIN/INT32_MAX if none
+	uint8_t column_top[GRAPH_MAX_POINTS]; // top row of each bar - graphYmax + 1, 0 if not drawn
+	int16_t drawn_warn_row, drawn_error_row; // the threshold rows the bars were drawn with
+	int32_t drawn_max_val, drawn_min_val; // the axis labels
 } GraphCache;
 
 struct FieldLayout;
@@ -182,7 +197,9 @@ typedef struct Field {
 		} drawTextPtr;
 
 		struct {
-			struct Field *source; // the data field we are graphing
+			struct Field *source; // the data field we are graphing, for its label and units
+			history_series_t *history; // the recorded values of source
+			uint8_t level; // of the history: 0 for a point per second, 1 for 10 s, 2 for 60 s
 			GraphCache *cache;
 			int32_t warn_threshold, error_threshold; // if != -1 and a value exceeds this it will be drawn in the warn/error colors
 			int32_t min_threshold; // if value is less than this, it is ignored for purposes of calculating min/average - useful for ignoring speed/cadence when stopped
@@ -217,7 +234,7 @@ typedef struct Field {
 					const char *units;
 					const uint8_t div_digits :4; // how many digits to divide by for fractions (i.e. 0 for integers, 1 for /10x, 2 for /100x, 3 /1000x
 					const bool hide_fraction :1; // if set, don't ever show the fractional part
-					const uint32_t max_value, min_value; // min/max
+					uint32_t max_value, min_value; // min/max, not const because the 850C changes the clock hours limit at runtime
 					const uint32_t inc_step; // if zero, then 1 is assumed
 				} number;
 
@@ -256,7 +273,7 @@ typedef struct Field {
 #define FIELD_DRAWTEXT(...) { .variant = FieldDrawText, .drawText = { __VA_ARGS__  } }
 #define FIELD_DRAWTEXTPTR(str, ...) { .variant = FieldDrawTextPtr, .drawTextPtr = { .msg = str, ##__VA_ARGS__  } }
 #define FIELD_CUSTOM(cb) { .variant = FieldCustom, .custom = { .render = &cb  } }
-#define FIELD_GRAPH(s, ...) { .variant = FieldGraph, .blink = true, .graph = { .source = s, ##__VA_ARGS__  } }
+#define FIELD_GRAPH(s, h, ...) { .variant = FieldGraph, .blink = true, .graph = { .source = s, .history = h, ##__VA_ARGS__  } }
 #define FIELD_CUSTOMIZABLE_PTR(s, c) { .variant = FieldCustomizable, .customizable = { .selector = s, .choices = c  } }
 #define FIELD_CUSTOMIZABLE(s, ...) { .variant = FieldCustomizable, .customizable = { .selector = s, .choices = (Field *[]){ __VA_ARGS__, NULL }}}
 
@@ -324,6 +341,10 @@ typedef struct FieldLayout {
 	AlignmentY label_align_y : 2; // Align the label using this rule
 	AlignmentX unit_align_x : 2; // Align units using this rule
 	AlignmentY unit_align_y : 2; // Align units using this rule
+	bool value_drawn :1; // for editables, the string of old_editable is on the screen, so only the chars that change need drawing
+	bool kept :1; // the screen shown before had this same layout, so its pixels are left as they are instead of being redrawn
+	bool critical :1; // drawn before the other layouts on every update, the render budget never leaves it for later
+	bool carried :1; // it needed drawing but the render budget of this update was spent
 	uint8_t inset_x, inset_y; 		// inset primary content in from sides by this amount
 
 	Field *field; // The field to render in this location
@@ -332,6 +353,8 @@ typedef struct FieldLayout {
 
 	uint32_t old_editable; // a cache value only used for editable fields, used to compare against previous values and redraw if needed.
 
+	uint16_t cost; // pixels the last whole draw of this layout took, to plan what fits in the render budget
+
 } FieldLayout;
 
 /** Called when a press has occured, return true if this function has handled the event (and therefore it should be cleared)
@@ -354,6 +377,12 @@ typedef struct {
 	void (*onDirtyClean)(); // If !NULL, Called after screen is cleared because it is dirty, good to draw any mask
 	void (*onCustomized)(); // If !NULL, called when the user has just customized fields with FieldCustomize (used to save to EEPROM)
 	ButtonEventHandler onPress; // or NULL for no handler
+
+	// What onDirtyClean and onPostUpdate draw outside of the fields. Showing another screen only clears the areas this
+	// screen drew, so a screen that has either handler but no outsideAreas is cleared completely when it is left.
+	const UG_AREA *outsideAreas;
+	uint8_t numOutsideAreas;
+
 	FieldLayout fields[];
 } Screen;
 
@@ -376,6 +405,28 @@ extern bool screenConvertMiles;
 // Set to true if we should automatically convert C -> F
 extern bool screenConvertFarenheit;
 
+// Set to false to redraw every graph column on each update (for comparing costs)
+extern bool graphIncremental;
+
+// Pixels an update may draw, SCREEN_RENDER_BUDGET. The critical layouts are drawn first, then the others in order until
+// the next one would go over, those are drawn by the next updates. 0 draws everything that needs it on each update.
+extern uint32_t screenRenderBudget;
+
+// Updates that went over the render budget and left layouts for the next one, since boot
+extern uint32_t screenCarriedUpdates;
+
+#ifdef USE_DRAW_STATS
+// Values formatted to strings since boot (editables and fieldSetText()), for the render cost benchmarks
+extern uint32_t screenFormattedStrings;
+
+// Pixels cleared by screen transitions since boot
+extern uint32_t screenClearedPixels;
+#endif
+
+// Set the string of a drawtext field, it is marked dirty if the string changed
+void fieldSetText(Field *field, const char *str);
+
+// Pulls in newlib's vsnprintf, the firmware builds its strings with format.h and fieldSetText()
 void fieldPrintf(Field *field, const char *fmt, ...);
 
 // Update this readonly editable with a string value, str must point to a static buffer
@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "telemetry.h"
 
 // error codes from common.h in the controller code, used for ui8_error_states
 #define NO_ERROR                                0
@@ -15,35 +16,16 @@
 
 
 typedef struct l2_vars_struct {
-	uint16_t ui16_adc_battery_voltage;
-	uint8_t ui8_battery_current_x5;
+	// what layer_2() publishes, see telemetry.h
+	union {
+		l2_telemetry_t telemetry;
+		struct {
+			L2_TELEMETRY_FIELDS
+		};
+	};
 	uint8_t ui8_adc_throttle;
-	uint8_t ui8_throttle;
-	uint8_t ui8_adc_pedal_torque_sensor;
-	uint8_t ui8_pedal_torque_sensor;
-	uint8_t ui8_pedal_human_power;
-	uint8_t ui8_duty_cycle;
-	uint8_t ui8_error_states;
-	uint16_t ui16_wheel_speed_x10;
-	uint8_t ui8_pedal_cadence;
-	uint16_t ui16_motor_speed_erps;
-	uint8_t ui8_foc_angle;
-	uint8_t ui8_temperature_current_limiting_value;
-	uint8_t ui8_motor_temperature;
-	uint32_t ui32_wheel_speed_sensor_tick_counter;
+	uint8_t ui8_link; // V20 RX data byte 26, the motor side of the link handshake, see motor_link.h
 	uint16_t ui16_pedal_torque_x10;
-	uint16_t ui16_pedal_power_x10;
-	uint16_t ui16_battery_voltage_filtered_x10;
-	uint16_t ui16_battery_current_filtered_x5;
-	uint16_t ui16_battery_power_filtered_x50;
-	uint16_t ui16_battery_power_filtered;
-	uint16_t ui16_pedal_torque_filtered;
-	uint16_t ui16_pedal_power_filtered;
-	uint8_t ui8_pedal_cadence_filtered;
-	uint16_t ui16_battery_voltage_soc_x10;
-	uint32_t ui32_wh_sum_x5;
-	uint32_t ui32_wh_sum_counter;
-	uint32_t ui32_wh_x10;
 
 	uint8_t ui8_assist_level;
 	uint8_t ui8_number_of_assist_levels;
@@ -62,6 +44,7 @@ typedef struct l2_vars_struct {
 	uint16_t ui16_battery_voltage_reset_wh_counter_x10;
 	uint16_t ui16_battery_pack_resistance_x1000;
 	uint8_t ui8_motor_type;
+	uint8_t ui8_motor_firmware; // 0 v0.19, stream version 19, 1 v0.20, stream version 20
 	uint8_t ui8_motor_assistance_startup_without_pedal_rotation;
 	uint8_t ui8_assist_level_factor[10];
 	uint8_t ui8_walk_assist_feature_enabled;
@@ -87,9 +70,14 @@ typedef struct l2_vars_struct {
 	uint32_t ui32_odometer_x10;
 
 	uint8_t ui8_lights;
-	uint8_t ui8_braking;
 	uint8_t ui8_walk_assist;
 	uint8_t ui8_offroad_mode;
+	uint8_t ui8_link_request; // V20 TX data byte 7, set by motor_link_update()
+
+	// worked out by motor_packet_encode() from the fields above
+	uint8_t ui8_tx_assist_level_factor;
+	uint8_t ui8_tx_startup_motor_power_boost_factor;
+	uint8_t ui8_tx_wheel_max_speed;
 	//Stef  energy data variables
 /*	uint32_t ui32_ee_gesamt_km;
  	uint32_t ui32_ee_gesamt_km_mit_motor;
@@ -111,36 +99,16 @@ typedef struct l2_vars_struct {
 #define NUM_CUSTOMIZABLE_FIELDS 5 // We currently only allow customizing the graph field
 
 typedef struct l3_vars_struct {
-	uint16_t ui16_adc_battery_voltage;
-	uint8_t ui8_battery_current_x5;
+	// what layer_2() publishes, see telemetry.h
+	union {
+		l2_telemetry_t telemetry;
+		struct {
+			L2_TELEMETRY_FIELDS
+		};
+	};
 	uint8_t ui8_adc_throttle;
-	uint8_t ui8_throttle;
-	uint8_t ui8_adc_pedal_torque_sensor;
-	uint8_t ui8_pedal_torque_sensor;
-	uint8_t ui8_pedal_human_power;
-	uint8_t ui8_duty_cycle;
-	uint8_t ui8_error_states;
-	uint16_t ui16_wheel_speed_x10;
-	uint8_t ui8_pedal_cadence;
-	uint16_t ui16_motor_speed_erps;
-	uint8_t ui8_foc_angle;
-	uint8_t ui8_temperature_current_limiting_value;
-	uint8_t ui8_motor_temperature;
-	uint32_t ui32_wheel_speed_sensor_tick_counter;
 	uint32_t ui32_wheel_speed_sensor_tick_counter_offset;
 	uint16_t ui16_pedal_torque_x10;
-	uint16_t ui16_pedal_power_x10;
-	uint16_t ui16_battery_voltage_filtered_x10;
-	uint16_t ui16_battery_current_filtered_x5;
-	uint16_t ui16_battery_power_filtered_x50;
-	uint16_t ui16_battery_power_filtered;
-	uint16_t ui16_pedal_torque_filtered;
-	uint16_t ui16_pedal_power_filtered;
-	uint8_t ui8_pedal_cadence_filtered;
-	uint16_t ui16_battery_voltage_soc_x10;
-	uint32_t ui32_wh_sum_x5;
-	uint32_t ui32_wh_sum_counter;
-	uint32_t ui32_wh_x10;
 
 	uint8_t ui8_assist_level;
 	uint8_t ui8_number_of_assist_levels;
@@ -159,6 +127,7 @@ typedef struct l3_vars_struct {
 	uint16_t ui16_battery_voltage_reset_wh_counter_x10;
 	uint16_t ui16_battery_pack_resistance_x1000;
 	uint8_t ui8_motor_type;
+	uint8_t ui8_motor_firmware; // 0 v0.19, stream version 19, 1 v0.20, stream version 20
 	uint8_t ui8_motor_assistance_startup_without_pedal_rotation;
 	uint8_t ui8_assist_level_factor[9];
 	uint8_t ui8_walk_assist_feature_enabled;
@@ -185,7 +154,6 @@ typedef struct l3_vars_struct {
 	uint32_t ui32_trip_timeSec;
 
 	uint8_t ui8_lights;
-	uint8_t ui8_braking;
 	uint8_t ui8_walk_assist;
 	uint8_t ui8_offroad_mode;
 	uint8_t ui8_buttons_up_down_invert;
@@ -215,6 +183,68 @@ extern l3_vars_t l3_vars;
 
 void layer_2(void);
 
+/**
+ * layer_2() doesn't run in the 100ms timer interrupt any more. The interrupt calls layer_2_trigger()
+ * and, if it returns true, has the target run layer_2_task() later at the lowest priority: PendSV
+ * on the 850C, the app_scheduler queue (so from the main loop) on the SW102. The USART and
+ * button interrupts are not held up by the packet parsing and the filters any more.
+ */
+typedef struct {
+	uint32_t ui32_runs;
+	uint32_t ui32_missed; // triggers that came before the last one was run, they are dropped
+	uint32_t ui32_latency_us; // trigger to the start of layer_2(), of the last run
+	uint32_t ui32_latency_min_us;
+	uint32_t ui32_latency_max_us;
+	uint32_t ui32_jitter_us; // ui32_latency_max_us - ui32_latency_min_us, how much the 100ms period wobbles
+	uint32_t ui32_run_max_us; // the longest layer_2()
+} layer_2_stats_t;
+
+extern layer_2_stats_t layer_2_stats;
+
+/// From the 100ms timer interrupt, timestamps the trigger, returns false if the last one is still pending
+bool layer_2_trigger(void);
+
+/// Runs layer_2() for the last trigger and keeps layer_2_stats
+void layer_2_task(void);
+
+/// A free running clock for layer_2_stats, in the target's own ticks, provided by the target
+uint32_t layer_2_clock(void);
+
+/// Microseconds since a layer_2_clock() reading, provided by the target
+uint32_t layer_2_clock_us_since(uint32_t ui32_stamp);
+
+/**
+ * The assist level, the lights and walk assist go to the motor in a packet of their own right after
+ * they change, not with the next 100ms one. screen_clock() calls tx_urgent_check() once a tick,
+ * which copies them to l2_vars and has the target run tx_urgent_task() in the layer_2() context:
+ * PendSV on the 850C, right away on the SW102 where layer_2() runs from the main loop too. The
+ * packet waits for a TX still going out and for TX_URGENT_SPACING_US after the last packet: the
+ * next tick tries again, unless the 100ms packet took the change first.
+ */
+#define TX_URGENT_SPACING_US 20000
+
+typedef struct {
+	uint32_t ui32_changes;        // changes seen by tx_urgent_check()
+	uint32_t ui32_sent;           // packets sent right away for them
+	uint32_t ui32_deferred;       // tries held back by a busy TX or the spacing
+	uint32_t ui32_latency_us;     // change to the packet starting in the UART, of the last change
+	uint32_t ui32_latency_max_us;
+} tx_urgent_stats_t;
+
+extern tx_urgent_stats_t tx_urgent_stats;
+
+/// From main_idle(), right after the button handlers
+void tx_urgent_check(void);
+
+/// Sends the packet for the last change, in the layer_2() context
+void tx_urgent_task(void);
+
+/// Run tx_urgent_task() in the layer_2() context, provided by the target
+void tx_urgent_pend(void);
+
+/// Publish the l2_vars telemetry for copy_layer_2_layer_3_vars(), layer_2() does it at the end of every run
+void l2_publish_telemetry(void);
+
 /**
  * Called from the main thread every 100ms
  *
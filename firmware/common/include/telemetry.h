@@ -0,0 +1,74 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <stdint.h>
+
+/**
+ * The part of the layer 2 state that goes up to layer 3: motor telemetry and the values layer_2()
+ * filters from it. layer_2() runs at interrupt priority on the 850C (PendSV, see layer_2_trigger()),
+ * so the UI never reads these from l2_vars directly, it takes a snapshot of the last frame layer_2()
+ * published.
+ *
+ * l2_vars_t and l3_vars_t hold the same fields in a union with an l2_telemetry_t, so a frame goes
+ * from l2_vars to the back buffer and from the front buffer to l3_vars as one struct. A new field
+ * only needs adding here.
+ */
+#define L2_TELEMETRY_FIELDS \
+	uint32_t ui32_wheel_speed_sensor_tick_counter; \
+	uint32_t ui32_wh_sum_x5; \
+	uint32_t ui32_wh_sum_counter; \
+	uint32_t ui32_wh_x10; \
+	uint16_t ui16_adc_battery_voltage; \
+	uint16_t ui16_wheel_speed_x10; \
+	uint16_t ui16_motor_speed_erps; \
+	uint16_t ui16_pedal_power_x10; \
+	uint16_t ui16_battery_voltage_filtered_x10; \
+	uint16_t ui16_battery_current_filtered_x5; \
+	uint16_t ui16_battery_power_filtered_x50; \
+	uint16_t ui16_battery_power_filtered; \
+	uint16_t ui16_pedal_torque_filtered; \
+	uint16_t ui16_pedal_power_filtered; \
+	uint16_t ui16_battery_voltage_soc_x10; \
+	uint8_t ui8_battery_current_x5; \
+	uint8_t ui8_throttle; \
+	uint8_t ui8_adc_pedal_torque_sensor; \
+	uint8_t ui8_pedal_torque_sensor; \
+	uint8_t ui8_pedal_human_power; \
+	uint8_t ui8_duty_cycle; \
+	uint8_t ui8_error_states; \
+	uint8_t ui8_pedal_cadence; \
+	uint8_t ui8_pedal_cadence_filtered; \
+	uint8_t ui8_temperature_current_limiting_value; \
+	uint8_t ui8_motor_temperature; \
+	uint8_t ui8_braking; \
+	uint8_t ui8_foc_angle;
+
+typedef struct l2_telemetry_struct {
+	L2_TELEMETRY_FIELDS
+} l2_telemetry_t;
+
+/**
+ * Double buffered with a sequence counter. The writer (layer_2(), PendSV on the 850C) fills the
+ * back buffer and publishes it, which flips the buffers. The reader (main loop) copies the front
+ * buffer and tries again if a frame was published while it was copying; it never blocks the writer
+ * and doesn't need interrupts disabled.
+ */
+
+/// Back buffer, only valid for the writer until the next telemetry_publish()
+l2_telemetry_t* telemetry_back_buffer(void);
+
+/// Make the back buffer the published frame
+void telemetry_publish(void);
+
+/// Copy the last published frame, returns how many times the copy had to be restarted
+uint32_t telemetry_snapshot(l2_telemetry_t *p_telemetry);
+
+#endif /* _TELEMETRY_H_ */
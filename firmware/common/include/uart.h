@@ -1,13 +1,29 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 void uart_init(void);
 uint8_t uart_get_stream_version(void);
 void uart_set_stream_version(uint8_t version);
-const uint8_t* uart_get_rx_buffer_rdy(void);
+/// The last packet received or NULL, *p_length is then the number of bytes the UART received for it
+const uint8_t* uart_get_rx_buffer_rdy(uint8_t *p_length);
 uint8_t* uart_get_tx_buffer(void);
 void uart_send_tx_buffer(uint8_t *tx_buffer);
+/// Change the motor UART baud rate, for motor_link.c. The TX must be done, see uart_tx_busy().
+void uart_set_baud(uint32_t ui32_baud);
+/// True while the last uart_send_tx_buffer() is still going out, the TX buffer must not change then
+bool uart_tx_busy(void);
+
+/// What the motor UART received, kept by the UART driver of each target
+typedef struct {
+	uint32_t ui32_packets;        // with a good CRC
+	uint32_t ui32_crc_errors;     // start bytes that didn't begin a good packet
+	uint32_t ui32_framing_errors; // bytes skipped to find a start byte, cut off packets, UART errors
+	uint32_t ui32_replaced;       // good packets a newer one replaced before layer_2() read them
+} uart_rx_stats_t;
+
+extern uart_rx_stats_t uart_rx_stats;
 
 #define UART_NUMBER_DATA_BYTES_TO_RECEIVE_V19   25  // change this value depending on how many data bytes there is to receive ( Package = one start byte + data bytes + two bytes 16 bit CRC )
 #define UART_NUMBER_DATA_BYTES_TO_SEND_V19      6   // change this value depending on how many data bytes there is to send ( Package = one start byte + data bytes + two bytes 16 bit CRC )
@@ -587,6 +587,22 @@ typedef struct
 
 #define UG_SATUS_WAIT_FOR_UPDATE                      (1<<0)
 
+#ifdef USE_DRAW_STATS
+/* Drawing operations since UG_Init(), for the render cost benchmarks */
+typedef struct
+{
+   UG_U32 glyphs;
+   UG_U32 fills;
+   UG_U32 lines;
+} UG_DRAW_STATS;
+
+extern UG_DRAW_STATS ug_draw_stats;
+#endif
+
+/* Pixels drawn since boot, the whole box of a glyph or a fill and the length of a line,
+ * for the screens to learn what a field costs to draw */
+extern UG_U32 ug_pixels_drawn;
+
 /* -------------------------------------------------------------------------------- */
 /* -- µGUI COLORS                                                                -- */
 /* -- Source: http://www.rapidtables.com/web/color/RGB_Color.htm                 -- */
@@ -132,4 +132,5 @@ typedef int32_t UG_S32;
 /* Feature enablers */
 #define USE_PRERENDER_EVENT
 #define USE_POSTRENDER_EVENT
+//#define USE_DRAW_STATS // count glyphs, fills and lines in ug_draw_stats, enabled by the host build
 
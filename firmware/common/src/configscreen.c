@@ -2,6 +2,10 @@
 #include "mainscreen.h"
 #include "configscreen.h"
 #include "eeprom.h"
+#include "uart.h"
+#include "motor_link.h"
+
+uint8_t ui8_g_display_reset_to_defaults;
 
 static Field wheelMenus[] =
 		{
@@ -102,6 +106,7 @@ static Field offroadMenus[] = {
 static Field variousMenus[] =
 		{
 						FIELD_EDITABLE_ENUM("Motor voltage", &l3_vars.ui8_motor_type, "48V", "36V", "expert"),
+						FIELD_EDITABLE_ENUM("Motor firmware", &l3_vars.ui8_motor_firmware, "v0.19", "v0.20"),
 						FIELD_EDITABLE_ENUM("Motor assist", &l3_vars.ui8_motor_assistance_startup_without_pedal_rotation, "disable", "enable"), // FIXME, share one array of disable/enable strings
 				FIELD_END };
 
@@ -116,6 +121,19 @@ static Field technicalMenus[] =
 						FIELD_READONLY_UINT("PWM duty cycle", &l3_vars.ui8_duty_cycle, ""),
 						FIELD_READONLY_UINT("Motor speed", &l3_vars.ui16_motor_speed_erps, ""),
 				FIELD_READONLY_UINT("Motor FOC", &l3_vars.ui8_foc_angle, ""),
+				FIELD_READONLY_UINT("Missed ticks", &ui32_g_ticks_missed, ""),
+				FIELD_READONLY_UINT("Split draws", &screenCarriedUpdates, ""),
+				FIELD_READONLY_UINT("L2 latency", &layer_2_stats.ui32_latency_max_us, "us"),
+				FIELD_READONLY_UINT("L2 jitter", &layer_2_stats.ui32_jitter_us, "us"),
+				FIELD_READONLY_UINT("L2 run", &layer_2_stats.ui32_run_max_us, "us"),
+				FIELD_READONLY_UINT("L2 missed", &layer_2_stats.ui32_missed, ""),
+				FIELD_READONLY_UINT("RX packets", &uart_rx_stats.ui32_packets, ""),
+				FIELD_READONLY_UINT("RX CRC errors", &uart_rx_stats.ui32_crc_errors, ""),
+				FIELD_READONLY_UINT("RX framing", &uart_rx_stats.ui32_framing_errors, ""),
+				FIELD_READONLY_UINT("RX replaced", &uart_rx_stats.ui32_replaced, ""),
+				FIELD_READONLY_UINT("Link baud", &motor_link.ui32_baud, ""),
+				FIELD_READONLY_UINT("Link fallbacks", &motor_link.ui32_fallbacks, ""),
+				FIELD_READONLY_UINT("Button to TX", &tx_urgent_stats.ui32_latency_max_us, "us"),
 				FIELD_END };
 
 static Field topMenus[] = {
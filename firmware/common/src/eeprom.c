@@ -99,7 +99,8 @@ const eeprom_data_t m_eeprom_data_defaults = { .eeprom_version = EEPROM_VERSION,
 		DEFAULT_VALUE_WALK_ASSIST_LEVEL_FACTOR_7,
 		DEFAULT_VALUE_WALK_ASSIST_LEVEL_FACTOR_8,
 		DEFAULT_VALUE_WALK_ASSIST_LEVEL_FACTOR_9 }, .field_selectors = { // we somewhat yuckily pick defaults to match the layout on the previous release
-				0, 10, 0, 2, 1 } };
+				0, 10, 0, 2, 1 }, .ui8_motor_firmware =
+		DEFAULT_VALUE_MOTOR_FIRMWARE };
 
 void eeprom_init() {
 	eeprom_hw_init();
@@ -136,6 +137,17 @@ void eeprom_init() {
 	set_conversions();
 }
 
+/// Throw away the user settings, load the defaults and write them back to flash
+void eeprom_init_defaults(void) {
+	memcpy(&m_eeprom_data, &m_eeprom_data_defaults,
+			sizeof(m_eeprom_data_defaults));
+	flash_write_words(&m_eeprom_data, sizeof(m_eeprom_data) / sizeof(uint32_t));
+
+	eeprom_init_variables();
+
+	set_conversions();
+}
+
 void eeprom_init_variables(void) {
 	l3_vars_t *p_l3_output_vars = get_l3_vars();
 	// copy data final variables
@@ -224,6 +236,8 @@ void eeprom_init_variables(void) {
 	p_l3_output_vars->ui32_odometer_x10 = m_eeprom_data.ui32_odometer_x10;
 	p_l3_output_vars->ui32_trip_x10 = m_eeprom_data.ui32_trip_x10;
 	p_l3_output_vars->ui32_trip_timeSec = m_eeprom_data.ui32_trip_timeSec;
+	p_l3_output_vars->ui8_motor_firmware =
+			m_eeprom_data.ui8_motor_firmware == 1 ? 1 : 0;
 }
 
 void eeprom_write_variables(void) {
@@ -313,6 +327,7 @@ void eeprom_write_variables(void) {
 	m_eeprom_data.ui32_odometer_x10 = p_l3_output_vars->ui32_odometer_x10;
 	m_eeprom_data.ui32_trip_x10 = p_l3_output_vars->ui32_trip_x10;
 	m_eeprom_data.ui32_trip_timeSec = p_l3_output_vars->ui32_trip_timeSec;
+	m_eeprom_data.ui8_motor_firmware = p_l3_output_vars->ui8_motor_firmware;
 
 	flash_write_words(&m_eeprom_data, sizeof(m_eeprom_data) / sizeof(uint32_t));
 }
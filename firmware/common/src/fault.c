@@ -2,6 +2,8 @@
 #include "ugui_config.h"
 #include "fonts.h"
 #include "stdlib.h"
+#include "string.h"
+#include "format.h"
 #include "fault.h"
 #include "state.h"
 
@@ -63,8 +65,13 @@ static inline void debugger_break(void) {
  *
  */
 void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info) {
-	fieldPrintf(&faultCode, "0x%lx", id);
-	fieldPrintf(&addrCode, "0x%06lx", pc);
+	char str[MAX_FIELD_LEN + 2 * FORMAT_INT32_LEN + 4]; // built without printf, which needs a lot of stack for a fault handler
+	char *p;
+
+	format_hex(format_str(str, "0x"), id, 0);
+	fieldSetText(&faultCode, str);
+	format_hex(format_str(str, "0x"), pc, 6);
+	fieldSetText(&addrCode, str);
 
 	switch (id) {
 	case FAULT_GCC_ASSERT:
@@ -75,37 +82,44 @@ void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info) {
 	{
 		// app errors include filename and line
 		error_info_t *einfo = (error_info_t*) info;
-		fieldPrintf(&infoCode, "%s:%d (%d)",
-				einfo->p_file_name ?
-						(const char*) einfo->p_file_name : "nofile",
-				einfo->line_num, einfo->err_code);
+		strncpy(str, einfo->p_file_name ?
+						(const char*) einfo->p_file_name : "nofile", MAX_FIELD_LEN);
+		str[MAX_FIELD_LEN] = 0;
+		p = format_str(str + strlen(str), ":");
+		p = format_int(p, einfo->line_num, 0, ' ');
+		p = format_str(p, " (");
+		p = format_int(p, einfo->err_code, 0, ' ');
+		format_str(p, ")");
+		fieldSetText(&infoCode, str);
 		break;
 	}
 
 	case FAULT_HARDFAULT:
 #ifdef SW102
     if(!info)
-      fieldPrintf(&infoCode, "hf overflow");
+      fieldSetText(&infoCode, "hf overflow");
     else {
       HardFault_stack_t *hs = (HardFault_stack_t *) info;
 
-      fieldPrintf(&infoCode, "%x:%x",
-        hs->r12, hs->lr);
+      p = format_str(format_hex(str, hs->r12, 0), ":");
+      format_hex(p, hs->lr, 0);
+      fieldSetText(&infoCode, str);
     }
 #endif
 		break;
 
 	case FAULT_MISSEDTICK:
-		fieldPrintf(&infoCode, "missed tick");
+		fieldSetText(&infoCode, "missed tick");
 		break;
 	case FAULT_STACKOVERFLOW:
-		fieldPrintf(&infoCode, "stack overflow");
+		fieldSetText(&infoCode, "stack overflow");
 		break;
 	case FAULT_LOSTRX:
-		fieldPrintf(&infoCode, "lost rx");
+		fieldSetText(&infoCode, "lost rx");
 		break;
 	default:
-		fieldPrintf(&infoCode, "%08lx", info);
+		format_hex(str, info, 8);
+		fieldSetText(&infoCode, str);
 		break;
 	}
 
@@ -0,0 +1,91 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include "fixmath.h"
+
+uint32_t fixmath_mulhi_parts(uint32_t ui32_a, uint32_t ui32_b) {
+	uint32_t ui32_a_lo = ui32_a & 0xffff, ui32_a_hi = ui32_a >> 16;
+	uint32_t ui32_b_lo = ui32_b & 0xffff, ui32_b_hi = ui32_b >> 16;
+
+	uint32_t ui32_lo = ui32_a_lo * ui32_b_lo;
+	uint32_t ui32_mid_a = ui32_a_hi * ui32_b_lo;
+	uint32_t ui32_mid_b = ui32_a_lo * ui32_b_hi;
+
+	// what the middle products carry into the high word, 18 bits at most
+	uint32_t ui32_carry = ((ui32_lo >> 16) + (ui32_mid_a & 0xffff) + (ui32_mid_b & 0xffff)) >> 16;
+
+	return ui32_a_hi * ui32_b_hi + (ui32_mid_a >> 16) + (ui32_mid_b >> 16) + ui32_carry;
+}
+
+static uint32_t mulhi(uint32_t ui32_a, uint32_t ui32_b) {
+#ifdef __ARM_ARCH_6M__
+	return fixmath_mulhi_parts(ui32_a, ui32_b);
+#else
+	return (uint32_t) (((uint64_t) ui32_a * ui32_b) >> 32); // umull on the 850C
+#endif
+}
+
+uint32_t fixmath_mulhi(uint32_t ui32_a, uint32_t ui32_b) {
+	return mulhi(ui32_a, ui32_b);
+}
+
+uint32_t fixmath_div10(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0xcccccccd) >> 3;
+}
+
+uint32_t fixmath_div20(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0xcccccccd) >> 4;
+}
+
+uint32_t fixmath_div25(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0x51eb851f) >> 3;
+}
+
+uint32_t fixmath_div36(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0x38e38e39) >> 3;
+}
+
+uint32_t fixmath_div50(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0x51eb851f) >> 4;
+}
+
+uint32_t fixmath_div500(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0x10624dd3) >> 5;
+}
+
+uint32_t fixmath_div1000(uint32_t ui32_value) {
+	return mulhi(ui32_value, 0x10624dd3) >> 6;
+}
+
+uint32_t fixmath_div100000(uint32_t ui32_value) {
+	// 100000 is 32 * 3125, the 32 goes first so the reciprocal of 3125 fits
+	return mulhi(ui32_value >> 5, 0x0a7c5ac5) >> 7;
+}
+
+void fixmath_recip_set(fixmath_recip_t *p_recip, uint32_t ui32_divisor) {
+	if (ui32_divisor == p_recip->ui32_divisor)
+		return;
+
+	uint8_t ui8_shift = 0;
+	while (ui8_shift < 32 && ((uint64_t) 1 << ui8_shift) < ui32_divisor)
+		ui8_shift++;
+
+	// 2^32 * (2^shift - divisor) / divisor + 1, the bits of 2^(32 + shift) / divisor under the top one
+	p_recip->ui32_m = (uint32_t) (((((uint64_t) 1 << ui8_shift) - ui32_divisor) << 32) / ui32_divisor) + 1;
+	p_recip->ui8_shift = ui8_shift;
+	p_recip->ui32_divisor = ui32_divisor;
+}
+
+uint32_t fixmath_recip_div(const fixmath_recip_t *p_recip, uint32_t ui32_value) {
+	if (!p_recip->ui8_shift)
+		return ui32_value; // / 1
+
+	// adds the top bit of the reciprocal back without overflowing
+	uint32_t ui32_t = mulhi(p_recip->ui32_m, ui32_value);
+	return (ui32_t + ((ui32_value - ui32_t) >> 1)) >> (p_recip->ui8_shift - 1);
+}
@@ -0,0 +1,129 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include <stdbool.h>
+#include "format.h"
+#include "fixmath.h"
+
+// The digits of ui32_value as characters, the last one first, returns how many
+static uint8_t digits(char *p_digits, uint32_t ui32_value) {
+	uint8_t ui8_count = 0;
+
+	do {
+		uint32_t ui32_q = fixmath_div10(ui32_value);
+		p_digits[ui8_count++] = '0' + (ui32_value - ((ui32_q << 3) + (ui32_q << 1)));
+		ui32_value = ui32_q;
+	} while (ui32_value);
+
+	return ui8_count;
+}
+
+static char* pad(char *p_out, uint8_t ui8_count, char c_pad) {
+	while (ui8_count--)
+		*p_out++ = c_pad;
+
+	return p_out;
+}
+
+// Copy ui8_count digits from p_digits[ui8_first] down, the digits being last one first
+static char* copy_digits(char *p_out, const char *p_digits, uint8_t ui8_first, uint8_t ui8_count) {
+	while (ui8_count--)
+		*p_out++ = p_digits[ui8_first--];
+
+	return p_out;
+}
+
+static char* format_number(char *p_out, uint32_t ui32_value, bool negative, uint8_t ui8_width, char c_pad) {
+	char digits_buf[10];
+	uint8_t ui8_count = digits(digits_buf, ui32_value);
+	uint8_t ui8_len = ui8_count + negative;
+	uint8_t ui8_padding = ui8_width > ui8_len ? ui8_width - ui8_len : 0;
+
+	if (c_pad != '0')
+		p_out = pad(p_out, ui8_padding, c_pad);
+	if (negative)
+		*p_out++ = '-';
+	if (c_pad == '0')
+		p_out = pad(p_out, ui8_padding, c_pad);
+
+	p_out = copy_digits(p_out, digits_buf, ui8_count - 1, ui8_count);
+	*p_out = 0;
+	return p_out;
+}
+
+char* format_uint(char *p_out, uint32_t ui32_value, uint8_t ui8_width, char c_pad) {
+	return format_number(p_out, ui32_value, false, ui8_width, c_pad);
+}
+
+char* format_int(char *p_out, int32_t i32_value, uint8_t ui8_width, char c_pad) {
+	bool negative = i32_value < 0;
+	uint32_t ui32_magnitude = negative ? 0u - (uint32_t) i32_value : (uint32_t) i32_value;
+
+	return format_number(p_out, ui32_magnitude, negative, ui8_width, c_pad);
+}
+
+char* format_fixed(char *p_out, int32_t i32_value, uint8_t ui8_decimals, uint8_t ui8_shown) {
+	char digits_buf[10 + 9]; // the zeros before the point of a value smaller than one
+	bool negative = i32_value < 0;
+	uint32_t ui32_magnitude = negative ? 0u - (uint32_t) i32_value : (uint32_t) i32_value;
+	uint8_t ui8_count = digits(digits_buf, ui32_magnitude);
+
+	if (ui8_decimals > 9)
+		ui8_decimals = 9;
+	if (ui8_shown > ui8_decimals)
+		ui8_shown = ui8_decimals;
+
+	// at least one digit before the point
+	while (ui8_count <= ui8_decimals)
+		digits_buf[ui8_count++] = '0';
+
+	// the digits that are truncated are left out, a '-' only goes before a value that isn't shown as 0
+	uint8_t ui8_truncated = ui8_decimals - ui8_shown;
+	if (negative) {
+		bool zero = true;
+		for (uint8_t i = ui8_truncated; i < ui8_count; i++)
+			if (digits_buf[i] != '0')
+				zero = false;
+
+		if (!zero)
+			*p_out++ = '-';
+	}
+
+	p_out = copy_digits(p_out, digits_buf, ui8_count - 1, ui8_count - ui8_decimals);
+	if (ui8_shown) {
+		*p_out++ = '.';
+		p_out = copy_digits(p_out, digits_buf, ui8_decimals - 1, ui8_shown);
+	}
+
+	*p_out = 0;
+	return p_out;
+}
+
+char* format_hex(char *p_out, uint32_t ui32_value, uint8_t ui8_width) {
+	char digits_buf[8];
+	uint8_t ui8_count = 0;
+
+	do {
+		uint8_t ui8_digit = ui32_value & 0xf;
+		digits_buf[ui8_count++] = ui8_digit < 10 ? '0' + ui8_digit : 'a' - 10 + ui8_digit;
+		ui32_value >>= 4;
+	} while (ui32_value);
+
+	p_out = pad(p_out, ui8_width > ui8_count ? ui8_width - ui8_count : 0, '0');
+	p_out = copy_digits(p_out, digits_buf, ui8_count - 1, ui8_count);
+	*p_out = 0;
+	return p_out;
+}
+
+char* format_str(char *p_out, const char *p_str) {
+	while (*p_str)
+		*p_out++ = *p_str++;
+
+	*p_out = 0;
+	return p_out;
+}
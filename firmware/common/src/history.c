@@ -0,0 +1,244 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include "history.h"
+
+// samples or buckets of the level below in a bucket of a level
+static const uint8_t ui8_bucket_size[HISTORY_LEVELS] = { 1, 10, 6 };
+
+static uint16_t read_source(const history_series_t *p_series) {
+	uint32_t ui32_value;
+
+	switch (p_series->ui8_source_size) {
+	case 1:
+		ui32_value = *(const uint8_t*) p_series->p_source;
+		break;
+	case 2:
+		ui32_value = *(const uint16_t*) p_series->p_source;
+		break;
+	default:
+		ui32_value = *(const uint32_t*) p_series->p_source;
+		break;
+	}
+
+	return ui32_value > UINT16_MAX ? UINT16_MAX : ui32_value;
+}
+
+static uint8_t next_index(uint8_t ui8_index) {
+	return ui8_index + 1 < HISTORY_POINTS ? ui8_index + 1 : 0;
+}
+
+static void level_added(history_series_t *p_series, uint8_t ui8_level) {
+	p_series->ui8_next[ui8_level] = next_index(p_series->ui8_next[ui8_level]);
+	if (p_series->ui8_count[ui8_level] < HISTORY_POINTS)
+		p_series->ui8_count[ui8_level]++;
+	p_series->ui32_added[ui8_level]++;
+}
+
+// Add a sample or a bucket of the level below to the partial bucket of ui8_level, which is added
+// to its ring when it is complete and then goes up the same way
+static void add_to_level(history_series_t *p_series, uint8_t ui8_level, const history_bucket_t *p_point) {
+	uint8_t ui8_partial = ui8_level - 1;
+	history_bucket_t *p_bucket = &p_series->partial[ui8_partial];
+
+	if (p_series->ui8_partial_count[ui8_partial] == 0) {
+		*p_bucket = *p_point;
+		p_series->ui32_partial_sum[ui8_partial] = 0;
+	} else {
+		if (p_point->ui16_min < p_bucket->ui16_min)
+			p_bucket->ui16_min = p_point->ui16_min;
+		if (p_point->ui16_max > p_bucket->ui16_max)
+			p_bucket->ui16_max = p_point->ui16_max;
+	}
+
+	// the points of a level all cover the same time, so the average of their averages is exact
+	p_series->ui32_partial_sum[ui8_partial] += p_point->ui16_avg;
+	if (++p_series->ui8_partial_count[ui8_partial] < ui8_bucket_size[ui8_level])
+		return;
+
+	p_bucket->ui16_avg = p_series->ui32_partial_sum[ui8_partial] / ui8_bucket_size[ui8_level];
+	p_series->ui8_partial_count[ui8_partial] = 0;
+
+	p_series->p_buckets[ui8_partial][p_series->ui8_next[ui8_level]] = *p_bucket;
+	level_added(p_series, ui8_level);
+
+	if (ui8_level + 1 < p_series->ui8_levels)
+		add_to_level(p_series, ui8_level + 1, p_bucket);
+}
+
+void history_record(history_series_t *p_series) {
+	uint16_t ui16_value = read_source(p_series);
+	history_bucket_t sample = { ui16_value, ui16_value, ui16_value };
+
+	p_series->ui16_samples[p_series->ui8_next[0]] = ui16_value;
+	level_added(p_series, 0);
+
+	if (p_series->ui8_levels > 1)
+		add_to_level(p_series, 1, &sample);
+}
+
+uint16_t history_level_seconds(uint8_t ui8_level) {
+	uint16_t ui16_seconds = 1;
+
+	for (uint8_t ui8_i = 1; ui8_i <= ui8_level; ui8_i++)
+		ui16_seconds *= ui8_bucket_size[ui8_i];
+
+	return ui16_seconds;
+}
+
+uint8_t history_count(const history_series_t *p_series, uint8_t ui8_level) {
+	return ui8_level < p_series->ui8_levels ? p_series->ui8_count[ui8_level] : 0;
+}
+
+uint32_t history_added(const history_series_t *p_series, uint8_t ui8_level) {
+	return ui8_level < p_series->ui8_levels ? p_series->ui32_added[ui8_level] : 0;
+}
+
+// The point at a position of the ring of a level
+static history_bucket_t point_at(const history_series_t *p_series, uint8_t ui8_level, uint8_t ui8_position) {
+	if (ui8_level == 0) {
+		uint16_t ui16_value = p_series->ui16_samples[ui8_position];
+		history_bucket_t sample = { ui16_value, ui16_value, ui16_value };
+		return sample;
+	}
+
+	return p_series->p_buckets[ui8_level - 1][ui8_position];
+}
+
+history_bucket_t history_point(const history_series_t *p_series, uint8_t ui8_level, uint8_t ui8_index) {
+	// the oldest point is at ui8_next once the ring is full, at 0 before
+	uint16_t ui16_i = ui8_index;
+	if (p_series->ui8_count[ui8_level] == HISTORY_POINTS)
+		ui16_i += p_series->ui8_next[ui8_level];
+	if (ui16_i >= HISTORY_POINTS)
+		ui16_i -= HISTORY_POINTS;
+
+	return point_at(p_series, ui8_level, ui16_i);
+}
+
+static uint8_t queue_at(const history_queue_t *p_queue, uint8_t ui8_index) {
+	uint16_t ui16_i = p_queue->ui8_front + ui8_index;
+	if (ui16_i >= HISTORY_POINTS)
+		ui16_i -= HISTORY_POINTS;
+
+	return p_queue->ui8_positions[ui16_i];
+}
+
+static uint8_t queue_back(const history_queue_t *p_queue) {
+	return queue_at(p_queue, p_queue->ui8_count - 1);
+}
+
+static void queue_push(history_queue_t *p_queue, uint8_t ui8_position) {
+	uint16_t ui16_i = p_queue->ui8_front + p_queue->ui8_count;
+	if (ui16_i >= HISTORY_POINTS)
+		ui16_i -= HISTORY_POINTS;
+
+	p_queue->ui8_positions[ui16_i] = ui8_position;
+	p_queue->ui8_count++;
+}
+
+static void queue_pop_front(history_queue_t *p_queue) {
+	p_queue->ui8_front = next_index(p_queue->ui8_front);
+	p_queue->ui8_count--;
+}
+
+// What a point counts with for the min, -1 if it doesn't
+static int32_t window_min_value(const history_window_t *p_window, const history_bucket_t *p_point) {
+	// a bucket can have samples under the threshold and over it, its average is the best we have then
+	int32_t i32_min = p_point->ui16_min;
+	if (i32_min < p_window->i32_min_threshold)
+		i32_min = p_point->ui16_avg;
+
+	return i32_min < p_window->i32_min_threshold ? -1 : i32_min;
+}
+
+// Points taken after the one at a position of the ring, 0 for the last one taken
+static uint8_t window_age(const history_window_t *p_window, uint8_t ui8_position) {
+	return p_window->ui8_next > ui8_position ? p_window->ui8_next - 1 - ui8_position :
+			p_window->ui8_next + HISTORY_POINTS - 1 - ui8_position;
+}
+
+// Drop the points that the new ones push out of the ring, they are at the front
+static void window_expire(const history_window_t *p_window, history_queue_t *p_queue, uint8_t ui8_new) {
+	while (p_queue->ui8_count && window_age(p_window, queue_at(p_queue, 0)) >= HISTORY_POINTS - ui8_new)
+		queue_pop_front(p_queue);
+}
+
+static void window_push(history_window_t *p_window, const history_series_t *p_series) {
+	uint8_t ui8_position = p_window->ui8_next;
+	history_bucket_t point = point_at(p_series, p_window->ui8_level, ui8_position);
+
+	// the points that are not over the new one can never be the max again
+	while (p_window->max.ui8_count
+			&& point_at(p_series, p_window->ui8_level, queue_back(&p_window->max)).ui16_max <= point.ui16_max)
+		p_window->max.ui8_count--;
+	queue_push(&p_window->max, ui8_position);
+
+	int32_t i32_min = window_min_value(p_window, &point);
+	if (i32_min >= 0) {
+		while (p_window->min.ui8_count) {
+			history_bucket_t back = point_at(p_series, p_window->ui8_level, queue_back(&p_window->min));
+			if (window_min_value(p_window, &back) < i32_min)
+				break;
+			p_window->min.ui8_count--;
+		}
+		queue_push(&p_window->min, ui8_position);
+	}
+
+	p_window->ui8_next = next_index(ui8_position);
+	p_window->ui32_added++;
+}
+
+void history_window_init(history_window_t *p_window, uint8_t ui8_level, int32_t i32_min_threshold) {
+	p_window->ui8_level = ui8_level;
+	p_window->i32_min_threshold = i32_min_threshold;
+	p_window->ui32_added = 0;
+	p_window->ui8_next = 0;
+	p_window->max.ui8_front = p_window->max.ui8_count = 0;
+	p_window->min.ui8_front = p_window->min.ui8_count = 0;
+}
+
+void history_window_update(history_window_t *p_window, const history_series_t *p_series) {
+	uint32_t ui32_added = history_added(p_series, p_window->ui8_level);
+	uint32_t ui32_new = ui32_added - p_window->ui32_added;
+
+	if (!ui32_new)
+		return;
+
+	if (ui32_new >= HISTORY_POINTS) {
+		// the whole ring is new, start again from its oldest point
+		uint8_t ui8_count = history_count(p_series, p_window->ui8_level);
+
+		p_window->ui32_added = ui32_added - ui8_count;
+		p_window->ui8_next = ui8_count == HISTORY_POINTS ? p_series->ui8_next[p_window->ui8_level] : 0;
+		p_window->max.ui8_front = p_window->max.ui8_count = 0;
+		p_window->min.ui8_front = p_window->min.ui8_count = 0;
+	} else {
+		// the queues only point at positions the new points didn't write over
+		window_expire(p_window, &p_window->max, ui32_new);
+		window_expire(p_window, &p_window->min, ui32_new);
+	}
+
+	while (p_window->ui32_added != ui32_added)
+		window_push(p_window, p_series);
+}
+
+int32_t history_window_max(const history_window_t *p_window, const history_series_t *p_series) {
+	if (!p_window->max.ui8_count)
+		return INT32_MIN;
+
+	return point_at(p_series, p_window->ui8_level, queue_at(&p_window->max, 0)).ui16_max;
+}
+
+int32_t history_window_min(const history_window_t *p_window, const history_series_t *p_series) {
+	if (!p_window->min.ui8_count)
+		return INT32_MAX;
+
+	history_bucket_t point = point_at(p_series, p_window->ui8_level, queue_at(&p_window->min, 0));
+	return window_min_value(p_window, &point);
+}
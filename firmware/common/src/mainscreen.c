@@ -12,6 +12,7 @@
 #include "main.h"
 #include "utils.h"
 #include "screen.h"
+#include "format.h"
 #include "rtc.h"
 #include "fonts.h"
 #include "uart.h"
@@ -41,6 +42,8 @@ static bool renderWarning(FieldLayout *layout);
 /// set to true if this boot was caused because we had a watchdog failure, used to show user the problem in the fault line
 bool wd_failure_detected;
 
+uint32_t ui32_g_ticks_missed;
+
 //
 // Fields - these might be shared my multiple screens
 //p
@@ -126,11 +129,15 @@ static void bootScreenOnPreUpdate() {
 	is_sim_motor = (bvolt < MIN_VOLTAGE_10X);
 
   if(is_sim_motor)
-    fieldPrintf(&bootStatus, "SIMULATING TSDZ2!");
+    fieldSetText(&bootStatus, "SIMULATING TSDZ2!");
   else if(has_seen_motor)
-    fieldPrintf(&bootStatus, "Found TSDZ2");
-  else
-    fieldPrintf(&bootStatus, "Waiting TSDZ2 - (%u.%uV)", bvolt / 10, bvolt % 10);
+    fieldSetText(&bootStatus, "Found TSDZ2");
+  else {
+    char str[MAX_FIELD_LEN];
+    char *p = format_str(str, "Waiting TSDZ2 - (");
+    format_str(format_fixed(p, bvolt, 1, 1), "V)");
+    fieldSetText(&bootStatus, str);
+  }
 
   // Stop showing only after we release on/off button and we are commutication with motor
   if(buttons_get_onoff_state() == 0 && (has_seen_motor || is_sim_motor))
@@ -401,6 +408,7 @@ void mainscreen_show(void) {
 
 void screen_clock(void) {
 	static uint8_t ui8_counter_100ms = 0;
+	static uint8_t ui8_counter_1s = 0;
 
 	// every 100ms
 	if (ui8_counter_100ms++ >= 4) {
@@ -411,9 +419,19 @@ void screen_clock(void) {
 		ui32_g_layer_2_can_execute = 0;
 		copy_layer_2_layer_3_vars();
 		ui32_g_layer_2_can_execute = 1;
+
+		// every 1s, the rate layer 2 works out its slow values at
+		if (++ui8_counter_1s >= 10) {
+			ui8_counter_1s = 0;
+			graphs_record();
+		}
 	}
 
 	lcd_main_screen();
+
+	// once a tick, after the buttons and walk_assist_state() and before the screen is drawn
+	tx_urgent_check();
+
 	screenUpdate();
 }
 
@@ -424,7 +442,9 @@ void trip_time(void) {
 
 	if(p_time->ui8_minutes != oldmin) {
 		oldmin = p_time->ui8_minutes;
-		sprintf(timestr, "%d:%02d", p_time->ui8_hours, p_time->ui8_minutes);
+		char *p = format_uint(timestr, p_time->ui8_hours, 0, ' ');
+		p = format_str(p, ":");
+		format_uint(p, p_time->ui8_minutes, 2, '0');
 		updateReadOnlyStr(&tripTimeField, timestr);
 	}
 }
@@ -441,9 +461,10 @@ static bool renderWarning(FieldLayout *layout) {
 static void setWarning(ColorOp color, const char *str) {
 	warnColor = color;
 	warnField.blink = (color == ColorError);
-	warnField.dirty = (strcmp(str, warningStr) != 0);
-	if(warnField.dirty)
+	if(strcmp(str, warningStr) != 0) { // only ever set dirty, the screen might not have drawn it yet
+		warnField.dirty = true;
 		strncpy(warningStr, str, sizeof(warningStr));
+	}
 }
 
 
@@ -500,24 +521,37 @@ void warnings(void) {
 		return;
 	}
 
-	setWarning(ColorNormal, "");
+	// set once, going through "" each time made the warning dirty on every update
+	const char *str = "";
 	if (l3_vars.ui32_trip_timeSec == 0)
-			setWarning(ColorNormal, "CLEAR TRP");
+			str = "CLEAR TRP";
 
 	if (l3_vars.ui32_ee_gesamt_km == 0)
-			setWarning(ColorNormal, "CLEAR RNG");
+			str = "CLEAR RNG";
 
+	setWarning(ColorNormal, str);
 }
 
 
 
 void battery_soc(void) {
+	static uint8_t ui8_old_soc_enable = 0xff; // used to prevent unneeded updates
+	static uint16_t ui16_old_value;
+	uint16_t ui16_value = l3_vars.ui8_battery_soc_enable ?
+			ui16_m_battery_soc_watts_hour : l3_vars.ui16_battery_voltage_soc_x10;
+
+	if (l3_vars.ui8_battery_soc_enable == ui8_old_soc_enable && ui16_value == ui16_old_value)
+		return;
+	ui8_old_soc_enable = l3_vars.ui8_battery_soc_enable;
+	ui16_old_value = ui16_value;
+
+	char str[FORMAT_INT32_LEN + 1];
 	if (l3_vars.ui8_battery_soc_enable)
-		fieldPrintf(&socField, "%3d%%", ui16_m_battery_soc_watts_hour);
+		format_str(format_uint(str, ui16_m_battery_soc_watts_hour, 3, ' '), "%");
 	else
-		fieldPrintf(&socField, "%u.%1uV",
-				l3_vars.ui16_battery_voltage_soc_x10 / 10,
-				l3_vars.ui16_battery_voltage_soc_x10 % 10);
+		format_str(format_fixed(str, l3_vars.ui16_battery_voltage_soc_x10, 1, 1), "V");
+
+	fieldSetText(&socField, str);
 }
 
 
@@ -531,8 +565,17 @@ void time(void) {
 		}
 	}
 
-	fieldPrintf(&timeField, "%d:%02d", p_rtc_time->ui8_hours,
-			p_rtc_time->ui8_minutes);
+	static int oldtime = -1; // used to prevent unneeded updates
+	int newtime = p_rtc_time->ui8_hours * 60 + p_rtc_time->ui8_minutes;
+
+	if (newtime != oldtime) {
+		char str[8]; // 12:13
+		oldtime = newtime;
+		char *p = format_uint(str, p_rtc_time->ui8_hours, 0, ' ');
+		p = format_str(p, ":");
+		format_uint(p, p_rtc_time->ui8_minutes, 2, '0');
+		fieldSetText(&timeField, str);
+	}
 }
 
 void walk_assist_state(void) {
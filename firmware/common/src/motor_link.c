@@ -0,0 +1,127 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include "motor_link.h"
+#include "uart.h"
+
+motor_link_t motor_link = { .ui32_baud = 9600 };
+
+// ui16_windows of MOTOR_LINK_SLOW counts down to the next offer
+static void enter(motor_link_t *p_link, motor_link_state_t state, uint16_t ui16_windows) {
+	p_link->state = state;
+	p_link->ui16_windows = ui16_windows;
+	p_link->motor_switched = false;
+}
+
+// false if a packet is still going out: it would be garbled, and waiting for it here could take
+// 11.5ms at 9600, so the caller tries again in the next window
+static bool set_baud(motor_link_t *p_link, uint32_t ui32_baud) {
+	if (p_link->ui32_baud != ui32_baud) {
+		if (uart_tx_busy()) {
+			p_link->ui32_baud_retries++;
+			return false;
+		}
+
+		uart_set_baud(ui32_baud);
+		p_link->ui32_baud = ui32_baud;
+	}
+
+	return true;
+}
+
+// back to 9600, offer again in ui16_windows. MOTOR_LINK_SLOW retries the baud rate if the TX was busy.
+static void slow(motor_link_t *p_link, l2_vars_t *p_vars, uint16_t ui16_windows) {
+	set_baud(p_link, 9600);
+	p_vars->ui8_link_request = 0;
+	enter(p_link, MOTOR_LINK_SLOW, ui16_windows);
+}
+
+uint32_t motor_link_baud(uint8_t ui8_code) {
+	switch (ui8_code & MOTOR_LINK_BAUD_MASK) {
+	case MOTOR_LINK_BAUD_57600:
+		return 57600;
+	case MOTOR_LINK_BAUD_115200:
+		return 115200;
+	default:
+		return 9600;
+	}
+}
+
+uint8_t motor_link_choose(uint8_t ui8_caps) {
+	ui8_caps &= MOTOR_LINK_CAPS;
+
+	uint8_t ui8_choice = ui8_caps & MOTOR_LINK_RATE_50MS;
+	if (ui8_caps & MOTOR_LINK_BAUD_115200)
+		ui8_choice |= MOTOR_LINK_BAUD_115200;
+	else if (ui8_caps & MOTOR_LINK_BAUD_57600)
+		ui8_choice |= MOTOR_LINK_BAUD_57600;
+
+	return ui8_choice;
+}
+
+void motor_link_update(l2_vars_t *p_vars, bool packet_ok) {
+	motor_link_t *p_link = &motor_link;
+	uint8_t ui8_link = packet_ok ? p_vars->ui8_link : 0;
+
+	if (uart_get_stream_version() != 20) {
+		if (p_link->state != MOTOR_LINK_SLOW)
+			slow(p_link, p_vars, 0);
+		else
+			set_baud(p_link, 9600);
+		return;
+	}
+
+	switch (p_link->state) {
+	case MOTOR_LINK_SLOW:
+		if (!set_baud(p_link, 9600))
+			break;
+
+		if (p_link->ui16_windows)
+			p_link->ui16_windows--;
+		else if (packet_ok) {
+			// the motor is there and talks at 9600
+			p_vars->ui8_link_request = MOTOR_LINK_OFFER | MOTOR_LINK_CAPS;
+			enter(p_link, MOTOR_LINK_OFFERED, 0);
+		}
+		break;
+
+	case MOTOR_LINK_OFFERED:
+		if ((ui8_link & (MOTOR_LINK_OFFER | MOTOR_LINK_SWITCH)) == MOTOR_LINK_OFFER) {
+			p_link->ui8_choice = motor_link_choose(ui8_link & MOTOR_LINK_DATA_MASK);
+
+			if (p_link->ui8_choice) {
+				p_vars->ui8_link_request = MOTOR_LINK_SWITCH | p_link->ui8_choice;
+				enter(p_link, MOTOR_LINK_SWITCHING, 0);
+			} else
+				slow(p_link, p_vars, MOTOR_LINK_RETRY_WINDOWS); // nothing better than what we have
+		} else if (++p_link->ui16_windows >= MOTOR_LINK_WAIT_WINDOWS)
+			slow(p_link, p_vars, MOTOR_LINK_RETRY_WINDOWS); // a motor without the handshake
+		break;
+
+	case MOTOR_LINK_SWITCHING:
+		// the motor answered at the old speed and switched, the next packet goes at the new one
+		if (ui8_link == (MOTOR_LINK_SWITCH | p_link->ui8_choice))
+			p_link->motor_switched = true;
+
+		if (p_link->motor_switched && set_baud(p_link, motor_link_baud(p_link->ui8_choice))) {
+			p_link->ui32_switches++;
+			enter(p_link, MOTOR_LINK_FAST, 0);
+		} else if (++p_link->ui16_windows >= MOTOR_LINK_WAIT_WINDOWS)
+			slow(p_link, p_vars, MOTOR_LINK_RETRY_WINDOWS);
+		break;
+
+	case MOTOR_LINK_FAST:
+		if (packet_ok)
+			p_link->ui16_windows = 0;
+		else if (++p_link->ui16_windows >= MOTOR_LINK_FALLBACK_WINDOWS) {
+			p_link->ui32_fallbacks++;
+			slow(p_link, p_vars, MOTOR_LINK_RETRY_WINDOWS);
+		}
+		break;
+	}
+}
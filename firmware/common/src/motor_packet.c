@@ -0,0 +1,329 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include <string.h>
+#include "motor_packet.h"
+#include "crc16.h"
+
+#define F MOTOR_PACKET_FIELD
+
+// Received from the motor controller, V19 and the first 25 data bytes of V20
+#define RX_FIELDS \
+	F(1, 1, ui16_adc_battery_voltage, 0, 0, 0), \
+	F(2, 1, ui16_adc_battery_voltage, 0x30, 4, MOTOR_PACKET_OR), /* ADC bits 8 and 9 */ \
+	F(3, 1, ui8_battery_current_x5, 0, 0, 0), \
+	F(4, 2, ui16_wheel_speed_x10, 0, 0, 0), \
+	F(6, 1, ui8_braking, 1, 0, 0), \
+	F(7, 1, ui8_adc_throttle, 0, 0, 0), \
+	F(8, 1, ui8_motor_temperature, 0, 0, MOTOR_PACKET_IF_TEMPERATURE), \
+	F(8, 1, ui8_throttle, 0, 0, MOTOR_PACKET_IF_THROTTLE), \
+	F(9, 1, ui8_adc_pedal_torque_sensor, 0, 0, 0), \
+	F(10, 1, ui8_pedal_torque_sensor, 0, 0, 0), \
+	F(11, 1, ui8_pedal_cadence, 0, 0, 0), \
+	F(12, 1, ui8_pedal_human_power, 0, 0, 0), \
+	F(13, 1, ui8_duty_cycle, 0, 0, 0), \
+	F(14, 2, ui16_motor_speed_erps, 0, 0, 0), \
+	F(16, 1, ui8_foc_angle, 0, 0, 0), \
+	F(17, 1, ui8_error_states, 0, 0, 0), \
+	F(18, 1, ui8_temperature_current_limiting_value, 0, 0, 0), \
+	F(19, 3, ui32_wheel_speed_sensor_tick_counter, 0, 0, 0), \
+	F(22, 2, ui16_pedal_torque_x10, 0, 0, 0), \
+	F(24, 2, ui16_pedal_power_x10, 0, 0, 0)
+
+static const motor_packet_field_t rx_fields[] = { RX_FIELDS };
+
+// V20 byte 26 is the link handshake
+static const motor_packet_field_t rx_fields_v20[] = {
+	RX_FIELDS,
+	F(26, 1, ui8_link, 0, 0, 0),
+};
+
+// Sent to the motor controller in every packet
+#define TX_EVERY_FIELDS \
+	F(2, 1, ui8_tx_assist_level_factor, 0, 0, 0), \
+	F(3, 1, ui8_lights, 1, 0, 0), \
+	F(3, 1, ui8_walk_assist, 1, 1, MOTOR_PACKET_OR), \
+	F(4, 1, ui8_target_max_battery_power, 0, 0, 0)
+
+static const motor_packet_field_t tx_every_fields[] = { TX_EVERY_FIELDS };
+
+// V20 byte 7 is the link handshake
+static const motor_packet_field_t tx_every_fields_v20[] = {
+	TX_EVERY_FIELDS,
+	F(7, 1, ui8_link_request, 0, 0, 0),
+};
+
+// and in bytes 5 and 6, depending on the message id
+static const motor_packet_field_t tx_message_0[] = {
+	F(5, 2, ui16_battery_low_voltage_cut_off_x10, 0, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_1[] = {
+	F(5, 2, ui16_wheel_perimeter, 0, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_2[] = {
+	F(5, 1, ui8_tx_wheel_max_speed, 0, 0, 0),
+	F(6, 1, ui8_battery_max_current, 0, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_3[] = {
+	F(5, 1, ui8_motor_type, 0, 0, 0),
+	F(6, 1, ui8_startup_motor_power_boost_always, 0, 0, MOTOR_PACKET_BOOL),
+	F(6, 1, ui8_startup_motor_power_boost_limit_power, 0, 1, MOTOR_PACKET_BOOL | MOTOR_PACKET_OR),
+};
+
+static const motor_packet_field_t tx_message_4[] = {
+	F(5, 1, ui8_tx_startup_motor_power_boost_factor, 0, 0, 0),
+	F(6, 1, ui8_startup_motor_power_boost_time, 0, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_5[] = {
+	F(5, 1, ui8_startup_motor_power_boost_fade_time, 0, 0, 0),
+	F(6, 1, ui8_startup_motor_power_boost_feature_enabled, 1, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_6[] = {
+	F(5, 1, ui8_motor_temperature_min_value_to_limit, 0, 0, 0),
+	F(6, 1, ui8_motor_temperature_max_value_to_limit, 0, 0, 0),
+};
+
+static const motor_packet_field_t tx_message_7[] = {
+	F(5, 1, ui8_ramp_up_amps_per_second_x10, 0, 0, 0),
+	// byte 6 is the cruise target speed, TODO
+};
+
+static const motor_packet_field_t tx_message_8[] = {
+	F(5, 1, ui8_temperature_limit_feature_enabled, 1, 0, 0),
+	F(6, 1, ui8_motor_assistance_startup_without_pedal_rotation, 0, 0, 0),
+};
+
+static const motor_packet_fields_t tx_messages[] = {
+	MOTOR_PACKET_FIELDS(tx_message_0),
+	MOTOR_PACKET_FIELDS(tx_message_1),
+	MOTOR_PACKET_FIELDS(tx_message_2),
+	MOTOR_PACKET_FIELDS(tx_message_3),
+	MOTOR_PACKET_FIELDS(tx_message_4),
+	MOTOR_PACKET_FIELDS(tx_message_5),
+	MOTOR_PACKET_FIELDS(tx_message_6),
+	MOTOR_PACKET_FIELDS(tx_message_7),
+	MOTOR_PACKET_FIELDS(tx_message_8),
+};
+
+// V20 packets are one byte longer each way and cycle through fewer message ids, the extra bytes
+// carry the link handshake (0 until both sides take part in it)
+static const motor_packet_version_t versions[] = {
+	{ 19, UART_NUMBER_DATA_BYTES_TO_RECEIVE_V19, UART_NUMBER_DATA_BYTES_TO_SEND_V19, UART_MAX_NUMBER_MESSAGE_ID_V19,
+	  MOTOR_PACKET_FIELDS(rx_fields), MOTOR_PACKET_FIELDS(tx_every_fields), tx_messages },
+	{ 20, UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20, UART_NUMBER_DATA_BYTES_TO_SEND_V20, UART_MAX_NUMBER_MESSAGE_ID_V20,
+	  MOTOR_PACKET_FIELDS(rx_fields_v20), MOTOR_PACKET_FIELDS(tx_every_fields_v20), tx_messages },
+};
+
+const motor_packet_version_t* motor_packet_version(uint8_t ui8_version) {
+	for (uint8_t ui8_i = 0; ui8_i < sizeof(versions) / sizeof(versions[0]); ui8_i++) {
+		if (versions[ui8_i].ui8_version == ui8_version)
+			return &versions[ui8_i];
+	}
+
+	return NULL;
+}
+
+static uint32_t load_var(const uint8_t *p_var, uint8_t ui8_size) {
+	switch (ui8_size) {
+	case 1:
+		return *p_var;
+	case 2:
+		return *(const uint16_t*) p_var;
+	default:
+		return *(const uint32_t*) p_var;
+	}
+}
+
+static void store_var(uint8_t *p_var, uint8_t ui8_size, uint32_t ui32_value) {
+	switch (ui8_size) {
+	case 1:
+		*p_var = (uint8_t) ui32_value;
+		break;
+	case 2:
+		*(uint16_t*) p_var = (uint16_t) ui32_value;
+		break;
+	default:
+		*(uint32_t*) p_var = ui32_value;
+		break;
+	}
+}
+
+bool motor_packet_decode(const motor_packet_version_t *p_version,
+		const uint8_t *p_packet, uint8_t ui8_length, l2_vars_t *p_vars) {
+	if (!p_version || ui8_length != MOTOR_PACKET_RX_LENGTH(p_version)
+			|| p_packet[0] != MOTOR_PACKET_RX_START_BYTE)
+		return false;
+
+	// byte 8 is the motor temperature or the throttle, depending on the configuration
+	uint8_t ui8_skip =
+			p_vars->ui8_temperature_limit_feature_enabled ?
+					MOTOR_PACKET_IF_THROTTLE : MOTOR_PACKET_IF_TEMPERATURE;
+
+	const motor_packet_field_t *p_field = p_version->rx.p_fields;
+	const motor_packet_field_t *p_end = p_field + p_version->rx.ui8_fields;
+	uint8_t *p_base = (uint8_t*) p_vars;
+
+	for (; p_field < p_end; p_field++) {
+		if (p_field->ui8_flags & ui8_skip)
+			continue;
+
+		const uint8_t *p_bytes = &p_packet[p_field->ui8_offset];
+		uint32_t ui32_value = p_bytes[0];
+
+		if (p_field->ui8_bytes > 1)
+			ui32_value |= ((uint32_t) p_bytes[1]) << 8;
+		if (p_field->ui8_bytes > 2)
+			ui32_value |= ((uint32_t) p_bytes[2]) << 16;
+
+		if (p_field->ui8_mask)
+			ui32_value &= p_field->ui8_mask;
+		ui32_value <<= p_field->ui8_shift;
+
+		uint8_t *p_var = p_base + p_field->ui16_var;
+		if (p_field->ui8_flags & MOTOR_PACKET_OR)
+			ui32_value |= load_var(p_var, p_field->ui8_var_size);
+
+		store_var(p_var, p_field->ui8_var_size, ui32_value);
+	}
+
+	return true;
+}
+
+static void encode_fields(const motor_packet_fields_t *p_fields,
+		const l2_vars_t *p_vars, uint8_t *p_packet) {
+	const motor_packet_field_t *p_field = p_fields->p_fields;
+	const motor_packet_field_t *p_end = p_field + p_fields->ui8_fields;
+	const uint8_t *p_base = (const uint8_t*) p_vars;
+
+	for (; p_field < p_end; p_field++) {
+		uint32_t ui32_value = load_var(p_base + p_field->ui16_var,
+				p_field->ui8_var_size);
+
+		if (p_field->ui8_mask)
+			ui32_value &= p_field->ui8_mask;
+		if (p_field->ui8_flags & MOTOR_PACKET_BOOL)
+			ui32_value = ui32_value ? 1 : 0;
+		ui32_value <<= p_field->ui8_shift;
+
+		// the packet starts zeroed, so OR and replace only differ for bytes shared by two fields
+		uint8_t *p_bytes = &p_packet[p_field->ui8_offset];
+		for (uint8_t ui8_i = 0; ui8_i < p_field->ui8_bytes; ui8_i++) {
+			p_bytes[ui8_i] |= (uint8_t) ui32_value;
+			ui32_value >>= 8;
+		}
+	}
+}
+
+// the values that are not a plain copy of a variable
+static void update_tx_vars(l2_vars_t *p_vars) {
+	uint8_t ui8_level = p_vars->ui8_assist_level;
+	if (ui8_level) {
+		p_vars->ui8_tx_assist_level_factor =
+				p_vars->ui8_walk_assist ?
+						p_vars->ui8_walk_assist_level_factor[ui8_level - 1] :
+						p_vars->ui8_assist_level_factor[ui8_level - 1];
+		p_vars->ui8_tx_startup_motor_power_boost_factor =
+				p_vars->ui8_startup_motor_power_boost_factor[ui8_level - 1];
+	} else {
+		p_vars->ui8_tx_assist_level_factor = 0;
+		p_vars->ui8_tx_startup_motor_power_boost_factor = 0;
+	}
+
+	// Stef: no wheel speed limit when offroad
+	p_vars->ui8_tx_wheel_max_speed =
+			p_vars->ui8_offroad_mode == 1 ? 49 : p_vars->ui8_wheel_max_speed;
+}
+
+uint8_t motor_packet_encode(const motor_packet_version_t *p_version,
+		uint8_t ui8_message_id, l2_vars_t *p_vars, uint8_t *p_packet) {
+	uint8_t ui8_length = MOTOR_PACKET_TX_LENGTH(p_version);
+	uint8_t ui8_crc_offset = ui8_length - UART_NUMBER_CRC_BYTES;
+
+	update_tx_vars(p_vars);
+
+	memset(p_packet, 0, ui8_crc_offset);
+	p_packet[0] = MOTOR_PACKET_TX_START_BYTE;
+	p_packet[1] = ui8_message_id;
+
+	encode_fields(&p_version->tx_every, p_vars, p_packet);
+	if (ui8_message_id <= p_version->ui8_max_message_id)
+		encode_fields(&p_version->p_tx_messages[ui8_message_id], p_vars, p_packet);
+
+	uint16_t ui16_crc_tx = crc16_buffer(CRC16_INIT, p_packet, ui8_crc_offset);
+	p_packet[ui8_crc_offset] = (uint8_t) (ui16_crc_tx & 0xff);
+	p_packet[ui8_crc_offset + 1] = (uint8_t) (ui16_crc_tx >> 8);
+
+	return ui8_length;
+}
+
+// CRC of the message fields alone, so a change in any of them changes it
+static uint16_t message_signature(const motor_packet_version_t *p_version,
+		uint8_t ui8_message_id, const l2_vars_t *p_vars) {
+	uint8_t packet[MOTOR_PACKET_MAX_TX_LENGTH];
+	uint8_t ui8_crc_offset = MOTOR_PACKET_TX_LENGTH(p_version) - UART_NUMBER_CRC_BYTES;
+
+	memset(packet, 0, ui8_crc_offset);
+	encode_fields(&p_version->p_tx_messages[ui8_message_id], p_vars, packet);
+
+	return crc16_buffer(CRC16_INIT, packet, ui8_crc_offset);
+}
+
+uint8_t motor_packet_schedule(motor_packet_schedule_t *p_schedule,
+		const motor_packet_version_t *p_version, l2_vars_t *p_vars) {
+	uint8_t ui8_messages = p_version->ui8_max_message_id + 1;
+	uint16_t signatures[MOTOR_PACKET_MAX_MESSAGES];
+
+	// a new stream version: nothing of it was sent yet
+	if (p_schedule->ui8_version != p_version->ui8_version) {
+		p_schedule->ui8_version = p_version->ui8_version;
+		p_schedule->ui16_sent = 0;
+		p_schedule->ui8_refresh_id = 0;
+		p_schedule->ui8_last_id = p_version->ui8_max_message_id;
+		p_schedule->ui8_dirty_run = 0;
+	}
+
+	update_tx_vars(p_vars);
+
+	// the changed message after the last one sent, so two that keep changing take turns
+	uint8_t ui8_id = p_schedule->ui8_last_id;
+	uint8_t ui8_dirty_id = ui8_messages;
+	for (uint8_t ui8_i = 0; ui8_i < ui8_messages; ui8_i++) {
+		if (++ui8_id == ui8_messages)
+			ui8_id = 0;
+
+		signatures[ui8_id] = message_signature(p_version, ui8_id, p_vars);
+		if (ui8_dirty_id == ui8_messages
+				&& (!(p_schedule->ui16_sent & (1 << ui8_id))
+						|| signatures[ui8_id] != p_schedule->ui16_signature[ui8_id]))
+			ui8_dirty_id = ui8_id;
+	}
+
+	// and every MOTOR_PACKET_DIRTY_BURST + 1 packets the next one of the refresh, even with changes
+	if (ui8_dirty_id < ui8_messages && p_schedule->ui8_dirty_run < MOTOR_PACKET_DIRTY_BURST) {
+		ui8_id = ui8_dirty_id;
+		p_schedule->ui8_dirty_run++;
+		p_schedule->ui32_dirty++;
+	} else {
+		ui8_id = p_schedule->ui8_refresh_id;
+		if (++p_schedule->ui8_refresh_id == ui8_messages)
+			p_schedule->ui8_refresh_id = 0;
+		p_schedule->ui8_dirty_run = 0;
+		p_schedule->ui32_refresh++;
+	}
+
+	p_schedule->ui16_signature[ui8_id] = signatures[ui8_id];
+	p_schedule->ui16_sent |= 1 << ui8_id;
+	p_schedule->ui8_last_id = ui8_id;
+
+	return ui8_id;
+}
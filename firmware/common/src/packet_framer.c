@@ -0,0 +1,113 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include <stddef.h>
+#include "packet_framer.h"
+#include "crc16.h"
+
+void packet_framer_init(packet_framer_t *p_framer, const volatile uint8_t *p_ring, uint16_t ui16_ring_size,
+		uint8_t ui8_start_byte, uint8_t ui8_length, uart_rx_stats_t *p_stats) {
+	p_framer->p_ring = p_ring;
+	p_framer->ui16_ring_size = ui16_ring_size;
+	p_framer->ui16_tail = 0;
+	p_framer->ui8_start_byte = ui8_start_byte;
+	p_framer->ui8_length = ui8_length;
+	p_framer->in_sync = true;
+	p_framer->ui8_write = 0;
+	p_framer->ui8_ready = 1;
+	p_framer->ui8_read = 2;
+	p_framer->p_stats = p_stats;
+}
+
+void packet_framer_set_length(packet_framer_t *p_framer, uint8_t ui8_length) {
+	p_framer->ui8_length = ui8_length;
+}
+
+static void skip(packet_framer_t *p_framer, uint16_t ui16_bytes) {
+	p_framer->ui16_tail += ui16_bytes;
+	if (p_framer->ui16_tail >= p_framer->ui16_ring_size)
+		p_framer->ui16_tail -= p_framer->ui16_ring_size;
+}
+
+static void lost_sync(packet_framer_t *p_framer) {
+	if (p_framer->in_sync)
+		p_framer->p_stats->ui32_framing_errors++;
+
+	p_framer->in_sync = false;
+}
+
+static void publish(packet_framer_t *p_framer) {
+	uint8_t ui8_last = __atomic_exchange_n(&p_framer->ui8_ready, p_framer->ui8_write | PACKET_FRAMER_FRESH,
+			__ATOMIC_SEQ_CST);
+
+	if (ui8_last & PACKET_FRAMER_FRESH)
+		p_framer->p_stats->ui32_replaced++;
+
+	p_framer->ui8_write = ui8_last & ~PACKET_FRAMER_FRESH;
+}
+
+void packet_framer_process(packet_framer_t *p_framer, uint16_t ui16_head, bool idle) {
+	uint16_t ui16_size = p_framer->ui16_ring_size;
+	uint8_t ui8_length = p_framer->ui8_length;
+	uint16_t ui16_available = ui16_head >= p_framer->ui16_tail ?
+			ui16_head - p_framer->ui16_tail : ui16_head + ui16_size - p_framer->ui16_tail;
+
+	while (ui16_available) {
+		if (p_framer->p_ring[p_framer->ui16_tail] != p_framer->ui8_start_byte) {
+			lost_sync(p_framer);
+			skip(p_framer, 1);
+			ui16_available--;
+			continue;
+		}
+
+		if (ui16_available < ui8_length)
+			break; // the rest is still coming
+
+		// copied out first, the DMA goes on writing the ring
+		uint8_t *p_frame = p_framer->frames[p_framer->ui8_write];
+		uint16_t ui16_index = p_framer->ui16_tail;
+		for (uint8_t i = 0; i < ui8_length; i++) {
+			p_frame[i] = p_framer->p_ring[ui16_index];
+			if (++ui16_index == ui16_size)
+				ui16_index = 0;
+		}
+
+		uint16_t ui16_crc = crc16_buffer(CRC16_INIT, p_frame, ui8_length - UART_NUMBER_CRC_BYTES);
+		if (ui16_crc == (p_frame[ui8_length - 2] | ((uint16_t) p_frame[ui8_length - 1] << 8))) {
+			p_framer->ui8_frame_length[p_framer->ui8_write] = ui8_length;
+			publish(p_framer);
+			p_framer->p_stats->ui32_packets++;
+			p_framer->in_sync = true;
+			skip(p_framer, ui8_length);
+			ui16_available -= ui8_length;
+		} else {
+			// look for the next start byte from the byte after this one
+			p_framer->p_stats->ui32_crc_errors++;
+			p_framer->in_sync = false;
+			skip(p_framer, 1);
+			ui16_available--;
+		}
+	}
+
+	// the line went idle in the middle of a packet, the start of the next one comes after
+	if (idle && ui16_available) {
+		lost_sync(p_framer);
+		skip(p_framer, ui16_available);
+	}
+}
+
+const uint8_t* packet_framer_get(packet_framer_t *p_framer, uint8_t *p_length) {
+	if (!(p_framer->ui8_ready & PACKET_FRAMER_FRESH))
+		return NULL;
+
+	p_framer->ui8_read = __atomic_exchange_n(&p_framer->ui8_ready, p_framer->ui8_read, __ATOMIC_SEQ_CST)
+			& ~PACKET_FRAMER_FRESH;
+
+	*p_length = p_framer->ui8_frame_length[p_framer->ui8_read];
+	return p_framer->frames[p_framer->ui8_read];
+}
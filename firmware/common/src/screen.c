@@ -22,11 +22,13 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <limits.h>
 #include <string.h>
 #include <strings.h>
 #include <stdio.h>
 #include <assert.h>
 #include "screen.h"
+#include "format.h"
 #include "lcd.h"
 #include "ugui.h"
 #include "fonts.h"
@@ -51,9 +53,12 @@ typedef bool (*FieldRenderFn)(FieldLayout *layout);
 
 static const FieldRenderFn renderers[];
 
+static int32_t getEditableNumber(Field *field, bool withConversion);
+
 /// If true blink changed to be true or false this tick and we should redraw anything that is animated
 static bool blinkChanged;
 static bool blinkOn;
+static bool graphChanged; // time for the graphs to look for new points
 
 static uint32_t screenUpdateCounter;
 
@@ -63,6 +68,8 @@ static uint32_t screenUpdateCounter;
 
 static Screen *curScreen;
 static bool screenDirty;
+static Screen *leftScreen; // the screen shown before curScreen, until curScreen is drawn. NULL to clear the whole screen
+static uint32_t shownPixels; // what the draw of showScreen() took, the update of the same tick has that less to spend
 
 #ifdef SW102
 #define HEADING_FONT FONT_5X12
@@ -99,7 +106,7 @@ const UG_FONT *editable_units_font = &SMALL_TEXT_FONT;
 
 static void putAligned(FieldLayout *layout, AlignmentX alignx,
 		AlignmentY aligny, int insetx, int insety, const UG_FONT *font,
-		const char *str);
+		const char *str, const char *shown);
 
 static UG_COLOR getBackColor(const FieldLayout *layout) {
 	switch (layout->color) {
@@ -154,7 +161,7 @@ bool renderDrawTextCommon(FieldLayout *layout, const char *msg) {
 	UG_SetBackcolor(C_TRANSPARENT);
 	if (!layout->field->blink || blinkOn) // if we are supposed to blink do that
 		putAligned(layout, layout->align_x, AlignTop, layout->inset_x,
-				layout->inset_y, layout->font, msg);
+				layout->inset_y, layout->font, msg, NULL);
 	return true;
 }
 
@@ -197,7 +204,7 @@ static void drawSelectionMarker(FieldLayout *layout) {
 		UG_FontSelect(&FONT_CURSORS);
 		UG_PutChar('0', layout->x + layout->width - FONT_CURSORS.char_width, // draw on ride side of line
 		layout->y + (layout->height - FONT_CURSORS.char_height) / 2, // draw centered vertially within the box
-		blinkOn ? EDITABLE_CURSOR_COLOR : getBackColor(ColorNormal),
+		blinkOn ? EDITABLE_CURSOR_COLOR : getBackColor(layout),
 		C_TRANSPARENT);
 	}
 
@@ -258,8 +265,21 @@ static Field* getField(const FieldLayout *layout) {
 	return field;
 }
 
+/// Does this editable show something else than it did? Only a change of the bound value, the forced labels or the
+/// editing state can change it, so a steady value isn't formatted or drawn again
+static bool editableNeedsRender(FieldLayout *layout, Field *field) {
+	if (field == curActiveEditable
+			|| (curCustomizingField && curCustomizingField == parentCustomizable))
+		return true; // renderEditable() polls the buttons and blinks
+
+	if (forceLabels != oldForceLabels)
+		return true;
+
+	return getEditableNumber(field, true) != (int32_t) layout->old_editable;
+}
+
 /// Should we redraw this field this tick? We always render dirty items, or items that might need to show blink animations
-static bool needsRender(Field *field) {
+static bool needsRender(FieldLayout *layout, Field *field) {
 	if (field->dirty)
 		return true;
 
@@ -271,7 +291,10 @@ static bool needsRender(Field *field) {
 			return true; // we also do a blink animation for our selection cursor
 	}
 	if (field->variant == FieldEditable)
-		return true; // Editables are smart enough to do their own rendering shortcuts based on cached values
+		return editableNeedsRender(layout, field);
+
+	if (field->variant == FieldGraph && graphChanged)
+		return true; // not only on a blink, or the graph interval would have to be a multiple of the blink one
 
 	return false;
 }
@@ -285,7 +308,107 @@ static bool renderField(FieldLayout *layout, Field *field) {
 	return renderers[field->variant](layout);
 }
 
-const bool renderLayouts(FieldLayout *layouts, bool forceRender) {
+static bool layoutIsPlaced(const FieldLayout *layout) {
+	return layout->y >= 0 && layout->width > 0 && layout->height > 0;
+}
+
+static UG_AREA layoutArea(const FieldLayout *layout) {
+	UG_AREA area = { layout->x, layout->y, layout->x + layout->width - 1,
+			layout->y + layout->height - 1 };
+	return area;
+}
+
+uint32_t screenRenderBudget = SCREEN_RENDER_BUDGET;
+uint32_t screenCarriedUpdates;
+
+/**
+ * Draw a layout that needs it, placing it on its first draw, and remember what it cost
+ */
+static bool renderLayout(FieldLayout *layout, Field *field, Coord *maxy) {
+	if (layout->width == 0)
+		layout->width = screenWidth - layout->x;
+
+	if (layout->height == 0)
+		layout->height = screenHeight - layout->y;
+
+	// if user specified width in terms of characters, change it to pixels
+	if (layout->width < 0) {
+		assert(layout->font); // you must specify a font to use this feature
+		layout->width = -layout->width
+				* (layout->font->char_width + gui.char_h_space);
+	}
+
+	// a y <0 means, start just below the previous lowest point on the screen, -1 is immediately below, -2 has one blank line, -3 etc...
+	if (layout->y < 0)
+		layout->y = *maxy + -layout->y - 1;
+
+	UG_U32 pixels = ug_pixels_drawn;
+	bool whole = field->dirty; // not only what changed, a blink or a graph column
+	bool didDraw = renderField(layout, field);
+
+	assert(layout->height != -1); // by the time we reach here this must be set
+
+	// After the renderer has run, cache the highest Y we have seen (for entries that have y = -1 for auto assignment)
+// Zwischenspeichern Sie nach dem Ausführen des Renderers das höchste Y, das wir gesehen haben (für Einträge mit y = -1 für die automatische Zuweisung)
+	if (layout->y + layout->height > *maxy)
+		*maxy = layout->y + layout->height;
+
+	drawSelectionMarker(layout);
+	drawBorder(layout);
+
+	// the plan takes the cost of drawing it all, a change is usually less
+	pixels = ug_pixels_drawn - pixels;
+	if (whole)
+		layout->cost = pixels > UINT16_MAX ? UINT16_MAX : pixels;
+	return didDraw;
+}
+
+// Layouts are placed in order, below the ones before, on their first draw. Until then they can't be put off.
+static bool layoutsArePlaced(const FieldLayout *layouts) {
+	for (; layouts->field; layouts++)
+		if (!layoutIsPlaced(layouts))
+			return false;
+
+	return true;
+}
+
+/**
+ * Plan the draw of a whole screen, which renderLayouts() then follows: the layouts that won't fit in the budget are
+ * marked carried. This is done before the screen shown before is cleared, so it clears what they would paint over.
+ */
+static void planScreenRender(FieldLayout *layouts, uint32_t budget) {
+	FieldLayout *layout;
+	uint32_t spent = 0;
+	bool drewOther = false;
+
+	if (!layoutsArePlaced(layouts))
+		budget = 0;
+
+	for (layout = layouts; layout->field; layout++) {
+		layout->carried = false;
+		if (layout->critical && !layout->kept)
+			spent += layout->cost;
+	}
+
+	for (layout = layouts; budget && layout->field; layout++) {
+		if (layout->critical || layout->kept)
+			continue;
+
+		if (drewOther && spent + layout->cost > budget)
+			layout->carried = true;
+		else {
+			spent += layout->cost;
+			drewOther = true;
+		}
+	}
+}
+
+/**
+ * Draw the layouts that need it. With a budget (in pixels) the critical layouts go first, then the others in order
+ * while the cost of their last whole draw still fits, at least one of them. The rest stay dirty for the next call.
+ * forceRender draws the screen as planScreenRender() planned it.
+ */
+const bool renderLayouts(FieldLayout *layouts, bool forceRender, uint32_t budget) {
 	bool didDraw = false; // we only render to hardware if something changed
 
 	Coord maxy = 0;
@@ -293,55 +416,60 @@ const bool renderLayouts(FieldLayout *layouts, bool forceRender) {
 	bool didChangeForceLabels = false; // if we did label force/unforce we need to remember for the next render
 	bool mpressed = SCREENFN_FORCE_LABELS;
 
-	// For each field if that field is dirty (or the screen is) redraw it
-	for (FieldLayout *layout = layouts; layout->field; layout++) {
-		Field *field = getField(layout); // we might be redirecting
+	FieldLayout *layout;
+	if (!layoutsArePlaced(layouts))
+		budget = 0;
 
-		if (forceRender) // tell the field it must redraw itself
-			field->dirty = true;
+	for (layout = layouts; !forceRender && layout->field; layout++)
+		layout->carried = false;
 
-		if (field->variant == FieldEditable) {
-			// If this field normally doesn't show the label, but M is pressed now, show it
-			forceLabels = mpressed && layout->label_align_x == AlignHidden;
-			didChangeForceLabels = true;
-		}
-
-		// We always render dirty items, or items that might need to show blink animations
-		if (needsRender(field)) {
-			if (layout->width == 0)
-				layout->width = screenWidth - layout->x;
+	uint32_t spent = 0;
+	bool drewOther = false; // of the layouts that aren't critical
 
-			if (layout->height == 0)
-				layout->height = screenHeight - layout->y;
+	// For each field if that field is dirty (or the screen is) redraw it, the critical ones first
+	for (uint8_t pass = budget ? 0 : 1; pass < 2; pass++) {
+		for (layout = layouts; layout->field; layout++) {
+			if (budget && layout->critical != (pass == 0))
+				continue;
 
-			// if user specified width in terms of characters, change it to pixels
-			if (layout->width < 0) {
-				assert(layout->font); // you must specify a font to use this feature
-				layout->width = -layout->width
-						* (layout->font->char_width + gui.char_h_space);
-			}
+			Field *field = getField(layout); // we might be redirecting
 
-			// a y <0 means, start just below the previous lowest point on the screen, -1 is immediately below, -2 has one blank line, -3 etc...
-			if (layout->y < 0)
-				layout->y = maxy + -layout->y - 1;
+			if (forceRender && !layout->kept) // tell the field it must redraw itself
+				field->dirty = true;
 
-			didDraw |= renderField(layout, field);
+			if (field->variant == FieldEditable) {
+				// If this field normally doesn't show the label, but M is pressed now, show it
+				forceLabels = mpressed && layout->label_align_x == AlignHidden;
+				didChangeForceLabels = true;
+			}
 
-			assert(layout->height != -1); // by the time we reach here this must be set
+			// We always render dirty items, or items that might need to show blink animations
+			if (!needsRender(layout, field))
+				continue;
 
-			// After the renderer has run, cache the highest Y we have seen (for entries that have y = -1 for auto assignment)
-// Zwischenspeichern Sie nach dem Ausführen des Renderers das höchste Y, das wir gesehen haben (für Einträge mit y = -1 für die automatische Zuweisung)
-			if (layout->y + layout->height > maxy)
-				maxy = layout->y + layout->height;
+			if (forceRender ? layout->carried : (pass == 1 && budget && drewOther && spent + layout->cost > budget)) {
+				layout->carried = true;
+				continue;
+			}
 
-			drawSelectionMarker(layout);
-			drawBorder(layout);
+			didDraw |= renderLayout(layout, field, &maxy);
+			spent += layout->cost;
+			drewOther |= pass == 1;
 		}
 	}
 
 	// We clear the dirty bits in a separate pass because multiple layouts on the screen might share the same field
-	for (const FieldLayout *layout = layouts; layout->field; layout++) {
+	bool carried = false;
+	for (layout = layouts; layout->field; layout++) {
 		getField(layout)->dirty = false; // we call getField because we might be redirecting
+		carried |= layout->carried;
+	}
+
+	if (carried) {
+		for (layout = layouts; layout->field; layout++)
+			if (layout->carried)
+				getField(layout)->dirty = true;
+		screenCarriedUpdates++;
 	}
 
 	if (didChangeForceLabels)
@@ -402,9 +530,17 @@ static bool exitScrollable() {
 
 static int maxRowsPerScreen;
 
+static Coord scrollableRowHeight() {
+	return EDITABLE_NUM_ROWS * (SCROLLABLE_FONT.char_height + gui.char_v_space)
+			+ SCROLLABLE_VPAD;
+}
+
+static Coord scrollableHeadingHeight() {
+	return HEADING_FONT.char_height + gui.char_v_space + SCROLLABLE_VPAD;
+}
+
 static bool renderActiveScrollable(FieldLayout *layout, Field *field) {
-	const Coord rowHeight = EDITABLE_NUM_ROWS
-			* (SCROLLABLE_FONT.char_height + gui.char_v_space) + SCROLLABLE_VPAD;
+	const Coord rowHeight = scrollableRowHeight();
 	maxRowsPerScreen = SCREEN_HEIGHT / rowHeight; // might be less than MAX_SCROLLABLE_ROWS
 
 	Field *scrollable = getActiveScrollable();
@@ -433,15 +569,14 @@ static bool renderActiveScrollable(FieldLayout *layout, Field *field) {
 
 				if (i == 0) { // heading
 					heading.dirty = true; // Force the heading to be redrawn even if we aren't chaning the string
-					fieldPrintf(&heading, "%s", field->scrollable.label);
+					fieldSetText(&heading, field->scrollable.label);
 					r->field = &heading;
 					r->color = ColorHeading;
 					r->border = HEADING_BORDER;
 					r->font = &HEADING_FONT;
 
 					r->y = layout->y;
-					r->height = r->font->char_height + gui.char_v_space
-							+ SCROLLABLE_VPAD;
+					r->height = scrollableHeadingHeight();
 				} else {
 					r->y = rows[i - 1].y + rows[i - 1].height;
 					r->height = rowHeight; // all data rows are the same height
@@ -481,7 +616,7 @@ static bool renderActiveScrollable(FieldLayout *layout, Field *field) {
 		}
 
 		// draw (or redraw if necessary) our current set of visible rows
-		return renderLayouts(rows, false);
+		return renderLayouts(rows, false, 0);
 	} else {
 		static FieldLayout rows[1 + 1]; // Used to layout each our single row + end of rows marker
 
@@ -495,7 +630,7 @@ static bool renderActiveScrollable(FieldLayout *layout, Field *field) {
 		r->border = BorderNone;
 
 		static Field label = FIELD_DRAWTEXT();
-		fieldPrintf(&label, "%s", field->scrollable.label);
+		fieldSetText(&label, field->scrollable.label);
 		r->field = &label;
 		r->color = ColorNormal;
 		r->font = &SCROLLABLE_FONT;
@@ -512,7 +647,7 @@ static bool renderActiveScrollable(FieldLayout *layout, Field *field) {
 		rows[1].field = NULL; // mark end of array (for rendering)
 
 		// draw (or redraw if necessary) our current set of visible rows
-		return renderLayouts(rows, false);
+		return renderLayouts(rows, false, 0);
 	}
 }
 
@@ -535,6 +670,20 @@ bool screenConvertMiles = false;
 // Set to true if we should automatically convert C -> F
 bool screenConvertFarenheit = false;
 
+// Convert a value of an editable number to the units the user wants to see
+static int32_t convertEditableNumber(Field *field, int32_t num) {
+	const char *units = field->editable.number.units;
+	if (screenConvertMiles
+			&& (strcasecmp(units, "kph") == 0
+					|| strcasecmp(units, "km") == 0))
+		num = (num * 100) / 161; // div by 1.609 for km->mi
+
+	if (screenConvertFarenheit && strcmp(units, "C") == 0)
+		num = 32 + (num * 9) / 5;
+
+	return num;
+}
+
 // Get the numeric value of an editable number, properly handling different possible byte encodings
 // if withConversion, convert from SI units if necessary
 static int32_t getEditableNumber(Field *field, bool withConversion) {
@@ -556,16 +705,8 @@ static int32_t getEditableNumber(Field *field, bool withConversion) {
 		return 0;
 	}
 
-	if (withConversion) {
-		const char *units = field->editable.number.units;
-		if (screenConvertMiles
-				&& (strcasecmp(units, "kph") == 0
-						|| strcasecmp(units, "km") == 0))
-			num = (num * 100) / 161; // div by 1.609 for km->mi
-
-		if (screenConvertFarenheit && strcmp(units, "C") == 0)
-			num = 32 + (num * 9) / 5;
-	}
+	if (withConversion)
+		num = convertEditableNumber(field, num);
 
 	return num;
 }
@@ -674,8 +815,16 @@ static const char* getUnits(Field *field) {
 	return units;
 }
 
+#ifdef USE_DRAW_STATS
+uint32_t screenFormattedStrings;
+#endif
+
 /// Given an editible extract its value as a string (max len MAX_FIELD_LEN)
 static void getEditableString(Field *field, int32_t num, char *outbuf) {
+#ifdef USE_DRAW_STATS
+	screenFormattedStrings++;
+#endif
+
 	switch (field->editable.typ) {
 	case ReadOnlyStr:
 		// NOTE: We ignore the passed in number (it will be garbage anyways) and instead just return the string
@@ -686,18 +835,10 @@ static void getEditableString(Field *field, int32_t num, char *outbuf) {
 		// properly handle div_digits
 		int divd = field->editable.number.div_digits;
 		if (divd == 0)
-			snprintf(outbuf, MAX_FIELD_LEN, "%lu", num);
-		else {
-			int div = 1;
-			while (divd--)
-				div *= 10; // pwrs of 10
-
-			if (field->editable.number.hide_fraction)
-				snprintf(outbuf, MAX_FIELD_LEN, "%ld", num / div);
-			else
-				snprintf(outbuf, MAX_FIELD_LEN, "%ld.%0*lu", num / div,
-						field->editable.number.div_digits, num % div);
-		}
+			format_uint(outbuf, num, 0, ' ');
+		else
+			format_fixed(outbuf, num, divd,
+					field->editable.number.hide_fraction ? 0 : divd);
 		break;
 	}
 	case EditEnum:
@@ -712,9 +853,59 @@ static void getEditableString(Field *field, int32_t num, char *outbuf) {
 // Sometimes we want to know where we just draw a string, so I have this FIXME ugly hack here
 static int renderedStrX, renderedStrY;
 
+// True if every char of str and shown sits in a cell of the font's char_width, so one can be
+// drawn over the other without touching its neighbours
+static bool hasFixedCells(const UG_FONT *font, const char *str,
+		const char *shown) {
+	for (int i = 0; str[i]; i++) {
+		char chrs[2] = { str[i], shown[i] };
+
+		for (int j = 0; j < 2; j++) {
+			if (chrs[j] < font->start_char || chrs[j] > font->end_char)
+				return false;
+			if (font->widths
+					&& font->widths[chrs[j] - font->start_char]
+							!= font->char_width)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Draw up to maxchars of str at x, y.
+ *
+ * If shown is not NULL it is the string of the same length that was drawn there last time, and
+ * with a fixed width font and an opaque back color only the chars that differ are drawn. A big
+ * speed of "25" going to "26" draws one 61x99 glyph instead of two.
+ */
+static void putString(int x, int y, const UG_FONT *font, const char *str,
+		int maxchars, const char *shown) {
+	UG_FontSelect(font);
+
+	int len = strlen(str);
+	if (maxchars > len)
+		maxchars = len;
+
+	UG_S16 cell = font->char_width + gui.char_h_space;
+	if (shown && maxchars && gui.back_color != C_TRANSPARENT
+			&& x + cell * (maxchars - 1) + font->char_width < gui.x_dim // no wrapping
+			&& hasFixedCells(font, str, shown)) {
+		for (int i = 0; i < maxchars; i++)
+			if (str[i] != shown[i])
+				UG_PutChar(str[i], x + i * cell, y, gui.fore_color,
+						gui.back_color);
+	} else
+		UG_PutString_with_length(x, y, (char*) str, maxchars);
+
+	renderedStrX = x;
+	renderedStrY = y;
+}
+
 // Center justify a string on a line of specified width
 static void putStringCentered(int x, int y, int width, const UG_FONT *font,
-		const char *str) {
+		const char *str, const char *shown) {
     int maxchars = strlen(str);
 
     // Note: we don't need char_h_space for the last char in the string, because the printing won't be adding that pad space
@@ -729,39 +920,33 @@ static void putStringCentered(int x, int y, int width, const UG_FONT *font,
 	if (strwidth < width)
 		x += (width - strwidth) / 2; // if we have extra space put half of it before the string
 
-	UG_FontSelect(font);
-	UG_PutString_with_length(x, y, (char*) str, maxchars);
-	renderedStrX = x;
-	renderedStrY = y;
+	putString(x, y, font, str, maxchars, shown);
 }
 
 // right justify a string (printing it to the left of X and Y)
-static void putStringRight(int x, int y, const UG_FONT *font, const char *str) {
+static void putStringRight(int x, int y, const UG_FONT *font, const char *str,
+		const char *shown) {
 	UG_S16 strwidth = (font->char_width + gui.char_h_space) * strlen(str);
 
 	x -= strwidth;
 
-	UG_FontSelect(font);
-	UG_PutString(x, y, (char*) str);
-	renderedStrX = x;
-	renderedStrY = y;
+	putString(x, y, font, str, INT_MAX, shown);
 }
 
-static void putStringLeft(int x, int y, const UG_FONT *font, const char *str) {
-	UG_FontSelect(font);
-	UG_PutString(x, y, (char*) str);
-	renderedStrX = x;
-	renderedStrY = y;
+static void putStringLeft(int x, int y, const UG_FONT *font, const char *str,
+		const char *shown) {
+	putString(x, y, font, str, INT_MAX, shown);
 }
 
 /**
  * Draw a string in a field, respecting font, alignment and optional insets.
  *
  * Insets will be from the left/top if using align left/top/center, otherwise they will be from the right.
+ * shown is NULL or the string of the same length already in the field, see putString().
  */
 static void putAligned(FieldLayout *layout, AlignmentX alignx,
 		AlignmentY aligny, int insetx, int insety, const UG_FONT *font,
-		const char *str) {
+		const char *str, const char *shown) {
 	assert(font); // dynamic font selection not yet supported
 
 	// First find the y position
@@ -785,13 +970,13 @@ static void putAligned(FieldLayout *layout, AlignmentX alignx,
 	case AlignHidden:
 		return; // Don't draw at all
 	case AlignLeft:
-		putStringLeft(layout->x + insetx, y, font, str);
+		putStringLeft(layout->x + insetx, y, font, str, shown);
 		break;
 	case AlignRight:
-		putStringRight(layout->x + layout->width - insetx, y, font, str);
+		putStringRight(layout->x + layout->width - insetx, y, font, str, shown);
 		break;
 	case AlignCenter:
-		putStringCentered(layout->x + insetx, y, layout->width, font, str);
+		putStringCentered(layout->x + insetx, y, layout->width, font, str, shown);
 		break;
 	default:
 		assert(0);
@@ -864,10 +1049,13 @@ static bool renderEditable(FieldLayout *layout) {
 	bool needBlink = blinkChanged
 			&& (isActive || field->is_selected || isCustomizing);
 
+	bool forceLabelsChanged = forceLabels != oldForceLabels;
+
 	// If the value numerically changed, see if it also changed as a string (much more expensive)
-	bool showValue = !forceLabels && (valueChanged || dirty || needBlink); // default to not drawing the value
+	// When the labels stop being forced the value has to come back, it was blanked
+	bool showValue = !forceLabels && (valueChanged || dirty || needBlink || forceLabelsChanged); // default to not drawing the value
+	char oldvaluestr[MAX_FIELD_LEN];
 	if (showValue) {
-		char oldvaluestr[MAX_FIELD_LEN];
 		getEditableString(field, layout->old_editable, oldvaluestr);
 
 		layout->old_editable = num;
@@ -875,20 +1063,27 @@ static bool renderEditable(FieldLayout *layout) {
 		getEditableString(field, num, valuestr);
 		if (strlen(valuestr) != strlen(oldvaluestr))
 			dirty = true; // Force a complete redraw (because alignment of str in field might have changed and we don't want to leave turds on the screen
+		else if (!dirty && !needBlink && strcmp(valuestr, oldvaluestr) == 0)
+			valueChanged = false; // the number changed but not its string (a hidden fraction, for instance), nothing to draw
+	} else if (forceLabels) {
+		// Only the label is on the screen, but keep up with the value so editableNeedsRender() doesn't see it change
+		// every tick. The value is drawn whole again when the labels stop being forced.
+		layout->old_editable = num;
+		valueChanged = false;
 	}
 
 	// If not dirty, labels didn't change and we aren't animating then exit
-	bool forceLabelsChanged = forceLabels != oldForceLabels;
-
 	if (!dirty && !valueChanged && !forceLabelsChanged && !needBlink)
 		return false; // We didn't actually change so don't try to draw anything
 
 	// fill our entire box with blankspace (if we must)
 	bool blankAll = EDITABLE_BLANKALL || forceLabelsChanged || dirty
 			|| (isCustomizing && needBlink);
-	if (blankAll)
+	if (blankAll) {
 		UG_FillFrame(layout->x, layout->y, layout->x + width - 1,
 				layout->y + height - 1, back);
+		layout->value_drawn = false;
+	}
 
 	UG_SetBackcolor(blankAll ? C_TRANSPARENT : C_BLACK); // we just cleared the background ourself, from now on allow fonts to overlap
 	UG_SetForecolor(fore);
@@ -913,7 +1108,7 @@ static bool renderEditable(FieldLayout *layout) {
 	if (showOnlyLabel) {
 		putStringCentered(layout->x,
 				layout->y + (height - editable_label_font->char_height) / 2,
-				width, editable_label_font, field->editable.label);
+				width, editable_label_font, field->editable.label, NULL);
 
 		return true;
 	}
@@ -927,7 +1122,7 @@ static bool renderEditable(FieldLayout *layout) {
 
 		putAligned(layout, layout->label_align_x, layout->label_align_y,
 				label_inset_x, label_inset_y, editable_label_font,
-				field->editable.label);
+				field->editable.label, NULL);
 	}
 
 	UG_SetBackcolor(blankAll ? C_TRANSPARENT : C_BLACK); // we just cleared the background ourself, from now on allow fonts to overlap
@@ -954,7 +1149,11 @@ static bool renderEditable(FieldLayout *layout) {
 			}
 		}
 
-		putAligned(layout, layout->align_x, align_y, x, y, font, valuestr);
+		// Over the same length string with opaque glyphs, only the digits that changed are drawn
+		bool overShown = layout->value_drawn && !blankAll && !isActive;
+		putAligned(layout, layout->align_x, align_y, x, y, font, valuestr,
+				overShown ? oldvaluestr : NULL);
+		layout->value_drawn = true;
 
 		// Blinking underline cursor when editing, just below value and drawing to the right edge of the box
 		if (isActive) {
@@ -977,7 +1176,7 @@ static bool renderEditable(FieldLayout *layout) {
 				layout->unit_align_y = AlignBottom;
 			}
 			putAligned(layout, layout->unit_align_x, layout->unit_align_y,
-					unit_inset_x, unit_inset_y, editable_units_font, units);
+					unit_inset_x, unit_inset_y, editable_units_font, units, NULL);
 		}
 	}
 
@@ -989,27 +1188,42 @@ static bool renderCustom(FieldLayout *layout) {
 	return (*layout->field->custom.render)(layout);
 }
 
-// FIXME - support multiple active graphs by assigning cache dynamically
-static GraphCache caches[1];
+static GraphCache graphCache;
 
-// Add to our ring buffer and maintain invariants
-static void graphAddPoint(Field *field, int32_t val) {
-	GraphCache *cache = field->graph.cache;
+// The cache of a graph about to be shown, taken from the graph shown before it
+static GraphCache* graphGetCache(Field *field) {
+	if (field->graph.cache)
+		return field->graph.cache;
+
+	GraphCache *cache = &graphCache;
+	if (cache->owner)
+		cache->owner->graph.cache = NULL;
 
-	// add the point
-	cache->points[cache->end_valid] = val;
-	cache->end_valid = (cache->end_valid + 1) % GRAPH_MAX_POINTS; // inc ptr with wrap
+	// Reinit cache to empty
+	memset(cache, 0, sizeof(*cache));
+	cache->owner = field;
+	cache->drawn_warn_row = -1;
+	cache->drawn_error_row = -1;
+	history_window_init(&cache->window, field->graph.level, field->graph.min_threshold);
+	field->graph.cache = cache;
+	field->dirty = true; // nothing of it is on the screen
 
-	// discard old point if needed
-	bool overfull = cache->start_valid == cache->end_valid;
-	if (overfull)
-		cache->start_valid = (cache->start_valid + 1) % GRAPH_MAX_POINTS;
+	return cache;
+}
 
-	// update invariants
-	if (val > cache->max_val)
-		cache->max_val = val;
-	if (val < cache->min_val && val >= field->graph.min_threshold)
-		cache->min_val = val;
+// The value drawn for a point: a second's sample, or the average of a bucket
+static inline int32_t graphPointValue(const history_bucket_t *point) {
+	return point->ui16_avg;
+}
+
+// The max/min of the points shown, values under min_threshold don't count for the min
+static void graphFindExtremes(Field *field) {
+	GraphCache *cache = field->graph.cache;
+	history_series_t *history = field->graph.history;
+
+	history_window_update(&cache->window, history);
+	cache->max_val = history_window_max(&cache->window, history);
+	cache->min_val = history_window_min(&cache->window, history);
 }
 
 static int graphX, // upper left of graph
@@ -1020,7 +1234,11 @@ static int graphX, // upper left of graph
 		graphXmax, // x loc of rightmost data point
 		graphYmin, // y loc of 0,0 position (for min value)
 		graphYmax, // y loc of max value
-		graphLabelY; // y loc of the label for field name
+		graphLabelY, // y loc of the label for field name
+		graphWarnRow, // the bars are yellow from this row up, -1 if none
+		graphErrorRow; // and red from this one up, -1 if none
+
+bool graphIncremental = true;
 
 // Clear our box completely if needed
 static void graphClear(Field *field) {
@@ -1031,6 +1249,9 @@ static void graphClear(Field *field) {
 		// clear all
 		UG_FillFrame(graphX, graphY, graphX + graphWidth - 1,
 				graphY + graphHeight - 1, GRAPH_COLOR_BACKGROUND);
+
+		memset(field->graph.cache->column_top, 0,
+				sizeof(field->graph.cache->column_top));
 	}
 }
 
@@ -1041,8 +1262,22 @@ static void graphLabelAxis(Field *field) {
 	Field *source = field->graph.source;
 	if (field->dirty) {
 		UG_SetForecolor(LABEL_COLOR);
-		putStringCentered(graphX, graphLabelY, graphWidth, &GRAPH_LABEL_FONT,
-				source->editable.label);
+		if (field->graph.level) {
+			// how long the graph covers when it is full
+			char label[MAX_FIELD_LEN + 12];
+			uint32_t span = (uint32_t) HISTORY_POINTS
+					* history_level_seconds(field->graph.level) / 60;
+			char *p = format_str(label, source->editable.label);
+			p = format_str(p, ", ");
+			if (span >= 120)
+				format_str(format_uint(p, span / 60, 0, ' '), "h");
+			else
+				format_str(format_uint(p, span, 0, ' '), "min");
+			putStringCentered(graphX, graphLabelY, graphWidth, &GRAPH_LABEL_FONT,
+					label, NULL);
+		} else
+			putStringCentered(graphX, graphLabelY, graphWidth, &GRAPH_LABEL_FONT,
+					source->editable.label, NULL);
 		UG_SetForecolor(GRAPH_COLOR_ACCENT);
 
 		// vertical axis line
@@ -1054,19 +1289,32 @@ static void graphLabelAxis(Field *field) {
 		GRAPH_COLOR_AXIS);
 	}
 
-	// draw max value
+	// draw max value, when it changed (a shorter string doesn't cover the old one)
 	GraphCache *cache = field->graph.cache;
 	char valstr[MAX_FIELD_LEN];
-	if (cache->max_val != INT32_MIN) {
-		getEditableString(source, cache->max_val, valstr);
-		putStringRight(graphXmin, graphYmax, &GRAPH_MAXVAL_FONT, valstr);
+	if (cache->max_val != INT32_MIN
+			&& (field->dirty || cache->max_val != cache->drawn_max_val)) {
+		if (!field->dirty)
+			UG_FillFrame(graphX, graphYmax, graphXmin - 1,
+					graphYmax + GRAPH_MAXVAL_FONT.char_height - 1,
+					GRAPH_COLOR_BACKGROUND);
+		getEditableString(source, convertEditableNumber(source, cache->max_val),
+				valstr);
+		putStringRight(graphXmin, graphYmax, &GRAPH_MAXVAL_FONT, valstr, NULL);
+		cache->drawn_max_val = cache->max_val;
 	}
 
 	// draw min value
-	if (cache->min_val != INT32_MAX) {
-		getEditableString(source, cache->min_val, valstr);
+	if (cache->min_val != INT32_MAX
+			&& (field->dirty || cache->min_val != cache->drawn_min_val)) {
+		if (!field->dirty)
+			UG_FillFrame(graphX, graphYmin - GRAPH_MAXVAL_FONT.char_height,
+					graphXmin - 1, graphYmin - 1, GRAPH_COLOR_BACKGROUND);
+		getEditableString(source, convertEditableNumber(source, cache->min_val),
+				valstr);
 		putStringRight(graphXmin, graphYmin - GRAPH_MAXVAL_FONT.char_height,
-				&GRAPH_MAXVAL_FONT, valstr);
+				&GRAPH_MAXVAL_FONT, valstr, NULL);
+		cache->drawn_min_val = cache->min_val;
 	}
 }
 
@@ -1081,73 +1329,100 @@ static inline int32_t graphScaleY(GraphCache *cache, int32_t x) {
 			/ (cache->max_val - cache->min_val);
 }
 
-static void graphDrawPoints(Field *field) {
-	GraphCache *cache = field->graph.cache;
+// Row of a threshold, -1 if it is not set
+static int graphThresholdRow(GraphCache *cache, int32_t threshold) {
+	if (threshold == -1)
+		return -1;
 
-	int ptr = cache->start_valid;
-	if (ptr == cache->end_valid)
-		return; // ring buffer is empty
+	int row = graphScaleY(cache, threshold);
 
-	int x = graphXmin; // the vertical axis line
+	// Make sure our threshold never goes below the areas we are going to draw
+	if (row > graphYmin - 1)
+		row = graphYmin - 1;
 
-	int warn_threshold = field->graph.warn_threshold;
-	if (warn_threshold != -1) {
-		warn_threshold = graphScaleY(cache, field->graph.warn_threshold);
+	return row;
+}
 
-		// Make sure our threshold never goes below the areas we are going to draw
-		if (warn_threshold > graphYmin - 1)
-			warn_threshold = graphYmin - 1;
+// Draw rows from..to of column x as they are with the top of the bar at row top
+static void graphDrawColumnRows(int x, int from, int to, int top) {
+	// Draw black space above the bar (so we scroll/scale properly)
+	if (from < top) {
+		int end = (to < top - 1) ? to : top - 1;
+		UG_DrawLine(x, from, x, end, GRAPH_COLOR_BACKGROUND);
+		from = end + 1;
 	}
 
-	int error_threshold = field->graph.error_threshold;
-	if (error_threshold != -1) {
-		error_threshold = graphScaleY(cache, field->graph.error_threshold);
-
-		// Make sure our threshold never goes below the areas we are going to draw
-		if (error_threshold > graphYmin - 1)
-			error_threshold = graphYmin - 1;
+	if (graphErrorRow != -1 && from <= to && from <= graphErrorRow) {
+		int end = (to < graphErrorRow) ? to : graphErrorRow;
+		UG_DrawLine(x, from, x, end, GRAPH_COLOR_ERROR);
+		from = end + 1;
 	}
 
-	do {
-		x++; // drawing a new vertical line now
-		int val = cache->points[ptr];
-		int y = graphScaleY(cache, val);
-
-		// Draw black space above the line (so we scroll/scale properly)
-		UG_DrawLine(x, graphYmax, x, y - 1, GRAPH_COLOR_BACKGROUND);
+	if (graphWarnRow != -1 && from <= to && from <= graphWarnRow) {
+		int end = (to < graphWarnRow) ? to : graphWarnRow;
+		UG_DrawLine(x, from, x, end, GRAPH_COLOR_WARN);
+		from = end + 1;
+	}
 
-#if 0 // FIXME accent line is pretty ugly
-		 // Draw the accent line
-		 int accent_bottom = y + 2; // we draw the accent line three pixels high
-		 if(accent_bottom >= graphYmin) // don't draw past end of graph
-			 accent_bottom = graphYmin - 1;
+	if (from <= to)
+		UG_DrawLine(x, from, x, to, GRAPH_COLOR_NORMAL);
+}
 
-		 UG_DrawLine(x, y, x, accent_bottom, GRAPH_COLOR_ACCENT);
-		 y = accent_bottom + 1; // New segment is just below the accent
-#endif
+/**
+ * Draw a bar per point, oldest at the left. A column that is already on the screen only gets the
+ * rows between its old and its new top redrawn, so a point that didn't change, or scrolled into a
+ * column that had the same height, costs nothing.
+ */
+static void graphDrawPoints(Field *field) {
+	GraphCache *cache = field->graph.cache;
+	history_series_t *history = field->graph.history;
+	uint8_t level = field->graph.level;
+	int count = history_count(history, level);
 
-		if (error_threshold != -1 && y <= error_threshold) {
-			UG_DrawLine(x, y, x, error_threshold, GRAPH_COLOR_ERROR);
-			y = error_threshold + 1;
-		}
+	int x = graphXmin; // the vertical axis line
 
-		if (warn_threshold != -1 && y <= warn_threshold) {
-			UG_DrawLine(x, y, x, warn_threshold, GRAPH_COLOR_WARN);
-			y = warn_threshold + 1;
-		}
+	graphWarnRow = graphThresholdRow(cache, field->graph.warn_threshold);
+	graphErrorRow = graphThresholdRow(cache, field->graph.error_threshold);
 
-		UG_DrawLine(x, y, x, graphYmin, GRAPH_COLOR_NORMAL);
+	// the colors of the bars moved, every row has to be drawn again
+	bool redrawAll = !graphIncremental || graphWarnRow != cache->drawn_warn_row
+			|| graphErrorRow != cache->drawn_error_row;
+	cache->drawn_warn_row = graphWarnRow;
+	cache->drawn_error_row = graphErrorRow;
 
-		ptr = (ptr + 1) % GRAPH_MAX_POINTS; // increment and wrap
-	} while (ptr != cache->end_valid); // we just did the last entry?
+	for (int column = 0; column < count; column++) {
+		x++; // drawing a new vertical line now
+		history_bucket_t point = history_point(history, level, column);
+		int y = graphScaleY(cache, graphPointValue(&point));
+
+		// values under min_threshold are under the scale
+		if (y > graphYmin)
+			y = graphYmin;
+		if (y < graphYmax)
+			y = graphYmax;
+
+		uint8_t *top = &cache->column_top[column];
+		int oldY = *top + graphYmax - 1;
+
+		if (redrawAll)
+			graphDrawColumnRows(x, graphYmax, graphYmin, y);
+		else if (!*top) // the column is blank
+			graphDrawColumnRows(x, y, graphYmin, y);
+		else if (y < oldY)
+			graphDrawColumnRows(x, y, oldY - 1, y);
+		else if (y > oldY)
+			graphDrawColumnRows(x, oldY, y - 1, y);
+
+		*top = y - graphYmax + 1;
+	}
 }
 
 /**
- * Our graphs are invoked for rendering once each blink interval, but most of the time we opt to do nothing.
+ * Our graphs are invoked for rendering once each blink interval and each graph interval, but most of the time we opt to do nothing.
  */
 static bool renderGraph(FieldLayout *layout) {
-	bool needUpdate = (screenUpdateCounter
-			% (GRAPH_INTERVAL_MS / UPDATE_INTERVAL_MS) == 0);
+	// the history takes the points, see graphs_record()
+	bool needUpdate = graphChanged;
 
 	Field *field = getField(layout);
 
@@ -1162,22 +1437,13 @@ static bool renderGraph(FieldLayout *layout) {
 	if (!needUpdate && !field->dirty)
 		return false;
 
-	if (!field->graph.cache) {
-		GraphCache *cache = field->graph.cache = &caches[0];
-
-		// Reinit cache to empty
-		cache->max_val = INT32_MIN;
-		cache->min_val = INT32_MAX;
-		cache->start_valid = 0;
-		cache->end_valid = 0;
-	}
-
-	Field *source = field->graph.source;
-	assert(source);
+	GraphCache *cache = graphGetCache(field);
 
-	// Pull in the latest point (if we are our periodic update)
-	if (needUpdate)
-		graphAddPoint(field, getEditableNumber(source, true));
+	// levels over 0 only get a point every 10 s or more
+	uint32_t added = history_added(field->graph.history, field->graph.level);
+	if (!field->dirty && added == cache->drawn_added)
+		return false;
+	cache->drawn_added = added;
 
 	// Set axis coordinates
 	int axisdigits = 5;
@@ -1202,6 +1468,7 @@ static bool renderGraph(FieldLayout *layout) {
 	if(needBlink && !blinkOn)
 		return true; // If we are supposed to be blinking return before we actually draw the graph contents
 
+	graphFindExtremes(field);
 	graphLabelAxis(field);
 	graphDrawPoints(field);
 
@@ -1422,16 +1689,11 @@ static void changeCurrentCustomizableField() {
 
 	uint8_t i = *s->customizable.selector;
 
-	Field *oldSelected = s->customizable.choices[i];
-
-	// If we are leaving a graph, discard that graphs cache (so it will start fresh next time)
-	if(oldSelected->variant == FieldGraph)
-		oldSelected->graph.cache = NULL;
-
 	if (!s->customizable.choices[++i]) // we fell off the end, loop around
 		i = 0;
 
 	*s->customizable.selector = i;
+	s->customizable.choices[i]->dirty = true; // what is on the screen is from the old choice
 }
 
 // Returns true if we've handled the event (and therefore it should be cleared)
@@ -1494,8 +1756,8 @@ bool screenOnPress(buttons_events_t events) {
 	return handled;
 }
 
-// A low level screen render that doesn't use soft device or call exit handlers (useful for the critical fault handler ONLY)
-void panicScreenShow(Screen *screen) {
+static void showScreen(Screen *screen, Screen *left) {
+	leftScreen = left;
 	setActiveEditable(NULL);
 	curCustomizingField = NULL;
 	scrollableStackPtr = 0; // new screen might not have one, we will find out when we render
@@ -1505,20 +1767,181 @@ void panicScreenShow(Screen *screen) {
 	if (curScreen->onEnter)
 		(*curScreen->onEnter)();
 
+	UG_U32 pixels = ug_pixels_drawn;
 	screenUpdate(); // Force a draw immediately
+	shownPixels = ug_pixels_drawn - pixels;
+}
+
+// A low level screen render that doesn't use soft device or call exit handlers (useful for the critical fault handler ONLY)
+void panicScreenShow(Screen *screen) {
+	showScreen(screen, NULL);
 }
 
 void screenShow(Screen *screen) {
 	if (curScreen && curScreen->onExit)
 		curScreen->onExit();
 
-	panicScreenShow(screen);
+	// While editing or customizing a field might be blinked off, then the old screen is not to be trusted
+	bool keepOld = curScreen != screen && !curActiveEditable && !curCustomizingField;
+	showScreen(screen, keepOld ? curScreen : NULL);
 }
 
 Screen* getCurrentScreen() {
 	return curScreen;
 }
 
+#ifdef USE_DRAW_STATS
+uint32_t screenClearedPixels;
+#endif
+
+/// Would layout show its field the same way as other does?
+static bool sameLayout(const FieldLayout *layout, const FieldLayout *other) {
+	return layout->field == other->field && layout->x == other->x
+			&& layout->y == other->y && layout->width == other->width
+			&& layout->height == other->height && layout->font == other->font
+			&& layout->border == other->border && layout->color == other->color
+			&& layout->modifier == other->modifier
+			&& layout->align_x == other->align_x
+			&& layout->align_y == other->align_y
+			&& layout->label_align_x == other->label_align_x
+			&& layout->label_align_y == other->label_align_y
+			&& layout->unit_align_x == other->unit_align_x
+			&& layout->unit_align_y == other->unit_align_y
+			&& layout->inset_x == other->inset_x
+			&& layout->inset_y == other->inset_y;
+}
+
+static FieldLayout* findSameLayout(FieldLayout *layouts,
+		const FieldLayout *layout) {
+	for (; layouts->field; layouts++)
+		if (sameLayout(layouts, layout))
+			return layouts;
+
+	return NULL;
+}
+
+/**
+ * The area a layout of the screen being shown is sure to paint over when the screen is first drawn, the whole box for
+ * the fields that fill their background, the rows for a scrollable. Returns false if there is none.
+ */
+static bool layoutCovers(const FieldLayout *layout, UG_AREA *area) {
+	if (!layoutIsPlaced(layout))
+		return false; // the first time a screen is shown its auto sized layouts are only placed as they are drawn
+
+	*area = layoutArea(layout);
+	if (layout->kept)
+		return true;
+	if (layout->carried)
+		return false; // it is drawn by a later update, on what is cleared now
+
+	const Field *field = layout->field;
+	if (field->variant == FieldCustomizable)
+		field = field->customizable.choices[*field->customizable.selector];
+
+	switch (field->variant) {
+	case FieldDrawText:
+	case FieldDrawTextPtr:
+	case FieldFill:
+	case FieldEditable:
+	case FieldGraph:
+		return true;
+	case FieldScrollable: {
+		// the heading and a row, or a blank one, for as many as fit on the screen
+		Coord rowsHeight = scrollableHeadingHeight()
+				+ (SCREEN_HEIGHT / scrollableRowHeight() - 1)
+						* scrollableRowHeight();
+		if (area->ye > area->ys + rowsHeight - 1)
+			area->ye = area->ys + rowsHeight - 1;
+		return true;
+	}
+	default:
+		return false; // custom renderers draw what they like
+	}
+}
+
+// Clear the parts of area the layouts from covering on do not paint over
+static void clearUncovered(UG_AREA area, const FieldLayout *covering) {
+	for (; covering->field; covering++) {
+		UG_AREA cover;
+		if (!layoutCovers(covering, &cover) || cover.xs > area.xe
+				|| cover.xe < area.xs || cover.ys > area.ye
+				|| cover.ye < area.ys)
+			continue;
+
+		// what is left of area above and below cover, then beside it
+		if (area.ys < cover.ys)
+			clearUncovered((UG_AREA ) { area.xs, area.ys, area.xe, cover.ys - 1 },
+					covering + 1);
+		if (area.ye > cover.ye)
+			clearUncovered((UG_AREA ) { area.xs, cover.ye + 1, area.xe, area.ye },
+					covering + 1);
+
+		UG_S16 ys = area.ys > cover.ys ? area.ys : cover.ys;
+		UG_S16 ye = area.ye < cover.ye ? area.ye : cover.ye;
+		if (area.xs < cover.xs)
+			clearUncovered((UG_AREA ) { area.xs, ys, cover.xs - 1, ye },
+					covering + 1);
+		if (area.xe > cover.xe)
+			clearUncovered((UG_AREA ) { cover.xe + 1, ys, area.xe, ye },
+					covering + 1);
+		return;
+	}
+
+	UG_FillFrame(area.xs, area.ys, area.xe, area.ye, C_BLACK);
+#ifdef USE_DRAW_STATS
+	screenClearedPixels += (uint32_t) (area.xe - area.xs + 1)
+			* (area.ye - area.ys + 1);
+#endif
+}
+
+/**
+ * Clear what the screen we left drew, instead of the whole screen: only the parts the fields of the new one will not
+ * paint over, and nothing where both screens show the same field the same way (the status bar, the battery). Those
+ * layouts are marked kept and are not redrawn. The layouts the render budget leaves for later paint over nothing now.
+ */
+static void clearScreenTransition(Screen *left, Screen *screen) {
+	FieldLayout *layout;
+	bool placed = true;
+
+	for (layout = screen->fields; layout->field; layout++) {
+		layout->kept = false;
+		placed &= layoutIsPlaced(layout);
+	}
+
+	// a screen that draws where it doesn't say is cleared completely, as is one where a layout was never drawn
+	bool whole = !left || ((left->onDirtyClean || left->onPostUpdate) && !left->outsideAreas);
+	for (layout = whole ? NULL : left->fields; layout && layout->field; layout++)
+		whole |= !layoutIsPlaced(layout);
+
+	if (whole) {
+		planScreenRender(screen->fields, screenRenderBudget);
+		UG_FillScreen(C_BLACK);
+#ifdef USE_DRAW_STATS
+		screenClearedPixels += (uint32_t) SCREEN_WIDTH * SCREEN_HEIGHT;
+#endif
+		return;
+	}
+
+	// Keeping a layout needs the ones after it placed, they are placed below the lowest one drawn
+	for (layout = screen->fields; placed && layout->field; layout++) {
+		FieldLayout *old = findSameLayout(left->fields, layout);
+		if (old && !old->carried) { // a carried layout isn't up to date there
+			layout->kept = true;
+			layout->old_editable = old->old_editable;
+			layout->value_drawn = old->value_drawn;
+		}
+	}
+
+	planScreenRender(screen->fields, screenRenderBudget);
+
+	for (layout = left->fields; layout->field; layout++)
+		if (!(placed && findSameLayout(screen->fields, layout)))
+			clearUncovered(layoutArea(layout), screen->fields);
+
+	for (uint8_t i = 0; i < left->numOutsideAreas; i++)
+		clearUncovered(left->outsideAreas[i], screen->fields);
+}
+
 void screenUpdate() {
 	if (!curScreen )
 		return;
@@ -1535,10 +1958,13 @@ void screenUpdate() {
 	if (blinkChanged) {
 		blinkOn = !blinkOn;
 	}
+	graphChanged = (screenUpdateCounter
+			% (GRAPH_INTERVAL_MS / UPDATE_INTERVAL_MS) == 0);
 
 	if (screenDirty) {
-		// clear screen (to prevent turds from old screen staying around)
-		UG_FillScreen(C_BLACK);
+		// clear what the old screen left (to prevent turds from it staying around)
+		clearScreenTransition(leftScreen, curScreen);
+		leftScreen = NULL;
 		didDraw = true;
 
 		if (curScreen->onDirtyClean)
@@ -1546,7 +1972,12 @@ void screenUpdate() {
 	}
 
 // For each field if that field is dirty (or the screen is) redraw it
-	didDraw |= renderLayouts(curScreen->fields, screenDirty);
+	uint32_t budget = screenRenderBudget;
+	if (budget)
+		budget = budget > shownPixels ? budget - shownPixels : 1;
+	shownPixels = 0;
+
+	didDraw |= renderLayouts(curScreen->fields, screenDirty, budget);
 
 	if (didDraw) {
 		if (curScreen->onPostUpdate)
@@ -1564,17 +1995,25 @@ void screenUpdate() {
 	screenDirty = false;
 }
 
+void fieldSetText(Field *field, const char *str) {
+	assert(field->variant == FieldDrawText);
+#ifdef USE_DRAW_STATS
+	screenFormattedStrings++;
+#endif
+	if (strncmp(str, field->drawText.msg, sizeof(field->drawText.msg)) != 0) {
+		strncpy(field->drawText.msg, str, sizeof(field->drawText.msg) - 1);
+		field->drawText.msg[sizeof(field->drawText.msg) - 1] = 0;
+		field->dirty = true;
+	}
+}
+
 void fieldPrintf(Field *field, const char *fmt, ...) {
 	va_list argp;
 	va_start(argp, fmt);
 	char buf[sizeof(field->drawText.msg)] = "";
 
-	assert(field->variant == FieldDrawText);
 	vsnprintf(buf, sizeof(buf), fmt, argp);
-	if (strcmp(buf, field->drawText.msg) != 0) {
-		strcpy(field->drawText.msg, buf);
-		field->dirty = true;
-	}
+	fieldSetText(field, buf);
 
 	va_end(argp);
 }
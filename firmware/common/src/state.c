@@ -19,6 +19,10 @@
 #include "buttons.h"
 // #include "adc.h"
 #include "fault.h"
+#include "telemetry.h"
+#include "motor_packet.h"
+#include "motor_link.h"
+#include "fixmath.h"
 #include <stdlib.h>
 
 static uint8_t ui8_m_usart1_received_first_package = 0;
@@ -143,107 +147,25 @@ void parse_simmotor() {
 void process_rx(void) {
 	static uint32_t num_missed_packets = 0;
 
-	const uint8_t *p_rx_buffer = uart_get_rx_buffer_rdy();
+	uint8_t ui8_rx_length;
+	const uint8_t *p_rx_buffer = uart_get_rx_buffer_rdy(&ui8_rx_length);
+	bool packet_ok = false;
 
 	// process rx package if we are simulating or the UART had a packet
 	if (is_sim_motor || p_rx_buffer) {
 		if (is_sim_motor)
 			parse_simmotor();
 		else if (p_rx_buffer) {
-			// now process rx data
-			// only if first byte is equal to package start byte
-			if (*p_rx_buffer == 67) {
+			const motor_packet_version_t *p_version = motor_packet_version(
+					uart_get_stream_version());
+
+			// only if it has the start byte and the UART received the length of this stream version
+			if (p_version
+					&& motor_packet_decode(p_version, p_rx_buffer, ui8_rx_length,
+							(l2_vars_t*) &l2_vars)) {
+				packet_ok = true;
 				has_seen_motor = true;
 				num_missed_packets = 0; // reset missed packet count
-
-				p_rx_buffer++;
-
-				l2_vars.ui16_adc_battery_voltage = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui16_adc_battery_voltage |= ((uint16_t) (*p_rx_buffer
-						& 0x30)) << 4;
-				p_rx_buffer++;
-
-				l2_vars.ui8_battery_current_x5 = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui16_wheel_speed_x10 = (uint16_t) *p_rx_buffer;
-				p_rx_buffer++;
-				l2_vars.ui16_wheel_speed_x10 += ((uint16_t) *p_rx_buffer << 8);
-				p_rx_buffer++;
-
-				uint8_t ui8_temp = *p_rx_buffer;
-				l2_vars.ui8_braking = ui8_temp & 1;
-				p_rx_buffer++;
-
-				l2_vars.ui8_adc_throttle = *p_rx_buffer;
-				p_rx_buffer++;
-
-				if (l2_vars.ui8_temperature_limit_feature_enabled) {
-					l2_vars.ui8_motor_temperature = *p_rx_buffer;
-				} else {
-					l2_vars.ui8_throttle = *p_rx_buffer;
-				}
-				p_rx_buffer++;
-
-				l2_vars.ui8_adc_pedal_torque_sensor = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui8_pedal_torque_sensor = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui8_pedal_cadence = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui8_pedal_human_power = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui8_duty_cycle = *p_rx_buffer;
-				p_rx_buffer++;
-
-				l2_vars.ui16_motor_speed_erps = (uint16_t) *p_rx_buffer;
-				p_rx_buffer++;
-				l2_vars.ui16_motor_speed_erps += ((uint16_t) *p_rx_buffer << 8);
-				p_rx_buffer++;
-
-				l2_vars.ui8_foc_angle = *p_rx_buffer;
-				p_rx_buffer++;
-
-				// error states
-				l2_vars.ui8_error_states = *p_rx_buffer;
-				p_rx_buffer++;
-
-				// temperature actual limiting value
-				l2_vars.ui8_temperature_current_limiting_value = *p_rx_buffer;
-				p_rx_buffer++;
-
-				// wheel_speed_sensor_tick_counter
-				uint32_t ui32_wheel_speed_sensor_tick_temp;
-				ui32_wheel_speed_sensor_tick_temp = ((uint32_t) *p_rx_buffer);
-				p_rx_buffer++;
-				ui32_wheel_speed_sensor_tick_temp |= (((uint32_t) *p_rx_buffer)
-						<< 8);
-				p_rx_buffer++;
-				ui32_wheel_speed_sensor_tick_temp |= (((uint32_t) *p_rx_buffer)
-						<< 16);
-				l2_vars.ui32_wheel_speed_sensor_tick_counter =
-						ui32_wheel_speed_sensor_tick_temp;
-				p_rx_buffer++;
-
-				// ui16_pedal_torque_x10
-				l2_vars.ui16_pedal_torque_x10 = (uint16_t) *p_rx_buffer;
-				p_rx_buffer++;
-				l2_vars.ui16_pedal_torque_x10 += ((uint16_t) *p_rx_buffer << 8);
-				p_rx_buffer++;
-
-				// ui16_pedal_power_x10
-				l2_vars.ui16_pedal_power_x10 = (uint16_t) *p_rx_buffer;
-				p_rx_buffer++;
-				l2_vars.ui16_pedal_power_x10 += ((uint16_t) *p_rx_buffer << 8);
-
-				// not needed with this implementation (and with ptr flipflop not needed eitehr)
-				// usart1_reset_received_package();
 			}
 		}
 
@@ -259,149 +181,99 @@ void process_rx(void) {
 			APP_ERROR_HANDLER(FAULT_LOSTRX);
 	}
 
+	// the speed of the link for the packet send_tx_package() sends next
+	if (!is_sim_motor)
+		motor_link_update((l2_vars_t*) &l2_vars, packet_ok);
 }
 
-void send_tx_package(void) {
-	static uint8_t ui8_message_id = 0;
+static motor_packet_schedule_t tx_schedule;
+
+tx_urgent_stats_t tx_urgent_stats;
+static volatile bool tx_urgent_pending;
+static volatile uint32_t ui32_tx_urgent_stamp;
+static uint32_t ui32_tx_stamp; // of the last packet
 
+// false if the last packet is still going out, an urgent one sent just before the 100ms tick
+static bool send_tx_package(void) {
+	const motor_packet_version_t *p_version = motor_packet_version(
+			uart_get_stream_version());
 	uint8_t *ui8_g_usart1_tx_buffer = uart_get_tx_buffer();
 
-	/************************************************************************************************/
-	// send tx package
-	// start up byte
-	ui8_g_usart1_tx_buffer[0] = 0x59;
-	ui8_g_usart1_tx_buffer[1] = ui8_message_id;
-
-	if (l2_vars.ui8_walk_assist) {
-		ui8_g_usart1_tx_buffer[2] =
-				l2_vars.ui8_walk_assist_level_factor[((l2_vars.ui8_assist_level)
-						- 1)];
-	} else if (l2_vars.ui8_assist_level) {
-		ui8_g_usart1_tx_buffer[2] =
-				l2_vars.ui8_assist_level_factor[((l2_vars.ui8_assist_level) - 1)];
-	} else {
-		ui8_g_usart1_tx_buffer[2] = 0;
+	if (!p_version || uart_tx_busy())
+		return false;
+
+	// the message id selects which configuration values go in bytes 5 and 6, changed ones first
+	uint8_t ui8_message_id = motor_packet_schedule(&tx_schedule, p_version,
+			(l2_vars_t*) &l2_vars);
+	motor_packet_encode(p_version, ui8_message_id, (l2_vars_t*) &l2_vars,
+			ui8_g_usart1_tx_buffer);
+
+	// send the full package to UART
+	// start DMA UART transfer
+	if (!is_sim_motor) // If we are simulating received packets never send real packets
+		uart_send_tx_buffer(ui8_g_usart1_tx_buffer);
+
+	ui32_tx_stamp = layer_2_clock();
+
+	// this packet has the last urgent change, whichever way it went
+	if (tx_urgent_pending) {
+		uint32_t ui32_latency_us = layer_2_clock_us_since(ui32_tx_urgent_stamp);
+		tx_urgent_pending = false;
+
+		tx_urgent_stats.ui32_latency_us = ui32_latency_us;
+		if (ui32_latency_us > tx_urgent_stats.ui32_latency_max_us)
+			tx_urgent_stats.ui32_latency_max_us = ui32_latency_us;
 	}
 
-	// set lights state
-	// walk assist level state
-	// set offroad state
-//  ui8_g_usart1_tx_buffer[3] = (l2_vars.ui8_lights & 1) |
-//      ((l2_vars.ui8_walk_assist & 1) << 1) |
-//      ((l2_vars.ui8_offroad_mode & 1) << 2);
+	return true;
+}
 
-	ui8_g_usart1_tx_buffer[3] = (l2_vars.ui8_lights & 1)
-			| ((l2_vars.ui8_walk_assist & 1) << 1);
+void tx_urgent_check(void) {
+	static uint8_t ui8_assist_level, ui8_lights, ui8_walk_assist;
+	static bool started;
 
-	// battery power
-	ui8_g_usart1_tx_buffer[4] = l2_vars.ui8_target_max_battery_power;
-
-	switch (ui8_message_id) {
-	case 0:
-		// battery low voltage cut-off
-		ui8_g_usart1_tx_buffer[5] =
-				(uint8_t) (l2_vars.ui16_battery_low_voltage_cut_off_x10 & 0xff);
-		ui8_g_usart1_tx_buffer[6] =
-				(uint8_t) (l2_vars.ui16_battery_low_voltage_cut_off_x10 >> 8);
-		break;
-
-	case 1:
-		// wheel perimeter
-		ui8_g_usart1_tx_buffer[5] = (uint8_t) (l2_vars.ui16_wheel_perimeter
-				& 0xff);
-		ui8_g_usart1_tx_buffer[6] =
-				(uint8_t) (l2_vars.ui16_wheel_perimeter >> 8);
-		break;
-
-	case 2:
-		// wheel max speed Stef
-		if(l3_vars.ui8_offroad_mode == 1)
-				ui8_g_usart1_tx_buffer[5] = 49;
-		else
-				ui8_g_usart1_tx_buffer[5] = l2_vars.ui8_wheel_max_speed;
-
-
-		// battery max current
-		ui8_g_usart1_tx_buffer[6] = l2_vars.ui8_battery_max_current;
-		break;
-
-	case 3:
-		ui8_g_usart1_tx_buffer[5] = l2_vars.ui8_motor_type;
-
-		ui8_g_usart1_tx_buffer[6] = (
-				l2_vars.ui8_startup_motor_power_boost_always ? 1 : 0)
-				| (l2_vars.ui8_startup_motor_power_boost_limit_power ? 2 : 0);
-		break;
-
-	case 4:
-		// startup motor power boost
-		ui8_g_usart1_tx_buffer[5] =
-				l2_vars.ui8_startup_motor_power_boost_factor[((l2_vars.ui8_assist_level)
-						- 1)];
-		// startup motor power boost time
-		ui8_g_usart1_tx_buffer[6] = l2_vars.ui8_startup_motor_power_boost_time;
-		break;
-
-	case 5:
-		// startup motor power boost fade time
-		ui8_g_usart1_tx_buffer[5] =
-				l2_vars.ui8_startup_motor_power_boost_fade_time;
-		// boost feature enabled
-		ui8_g_usart1_tx_buffer[6] =
-				(l2_vars.ui8_startup_motor_power_boost_feature_enabled & 1) ?
-						1 : 0;
-		break;
-
-	case 6:
-		// motor over temperature min and max values to limit
-		ui8_g_usart1_tx_buffer[5] =
-				l2_vars.ui8_motor_temperature_min_value_to_limit;
-		ui8_g_usart1_tx_buffer[6] =
-				l2_vars.ui8_motor_temperature_max_value_to_limit;
-		break;
-
-	case 7:
-		ui8_g_usart1_tx_buffer[5] = l2_vars.ui8_ramp_up_amps_per_second_x10;
-
-		// TODO
-		// target speed for cruise
-		ui8_g_usart1_tx_buffer[6] = 0;
-		break;
-
-	case 8:
-		// motor temperature limit function or throttle
-		ui8_g_usart1_tx_buffer[5] =
-				l2_vars.ui8_temperature_limit_feature_enabled & 1;
-
-		// motor assistance without pedal rotation enable/disable when startup
-		ui8_g_usart1_tx_buffer[6] =
-				l2_vars.ui8_motor_assistance_startup_without_pedal_rotation;
-		break;
-
-	default:
-		ui8_message_id = 0;
-		break;
+	if (started && l3_vars.ui8_assist_level == ui8_assist_level && l3_vars.ui8_lights == ui8_lights
+			&& l3_vars.ui8_walk_assist == ui8_walk_assist) {
+		// held back by a busy TX or the spacing, try again
+		if (tx_urgent_pending)
+			tx_urgent_pend();
+		return;
 	}
 
-	// prepare crc of the package
-	uint16_t ui16_crc_tx = 0xffff;
-	for (uint8_t ui8_i = 0; ui8_i <= UART_NUMBER_DATA_BYTES_TO_SEND; ui8_i++) {
-		crc16(ui8_g_usart1_tx_buffer[ui8_i], &ui16_crc_tx);
+	ui8_assist_level = l3_vars.ui8_assist_level;
+	ui8_lights = l3_vars.ui8_lights;
+	ui8_walk_assist = l3_vars.ui8_walk_assist;
+
+	// the values from the eeprom go with the first 100ms packets
+	if (!started) {
+		started = true;
+		return;
 	}
-	ui8_g_usart1_tx_buffer[UART_NUMBER_DATA_BYTES_TO_SEND + 1] =
-			(uint8_t) (ui16_crc_tx & 0xff);
-	ui8_g_usart1_tx_buffer[UART_NUMBER_DATA_BYTES_TO_SEND + 2] =
-			(uint8_t) (ui16_crc_tx >> 8) & 0xff;
 
-	// send the full package to UART
-	// start DMA UART transfer
-	if (!is_sim_motor) // If we are simulating received packets never send real packets
-		uart_send_tx_buffer(ui8_g_usart1_tx_buffer);
+	// as copy_layer_2_layer_3_vars() would do on its next run
+	l2_vars.ui8_assist_level = ui8_assist_level;
+	l2_vars.ui8_lights = ui8_lights;
+	l2_vars.ui8_walk_assist = ui8_walk_assist;
+
+	// a change the last one didn't get out for is measured from the first
+	if (!tx_urgent_pending)
+		ui32_tx_urgent_stamp = layer_2_clock();
+	tx_urgent_pending = true;
+	tx_urgent_stats.ui32_changes++;
+
+	tx_urgent_pend();
+}
+
+void tx_urgent_task(void) {
+	if (!tx_urgent_pending)
+		return;
 
-	// increment message_id for next package
-	if (++ui8_message_id > UART_MAX_NUMBER_MESSAGE_ID) {
-		ui8_message_id = 0;
+	if (layer_2_clock_us_since(ui32_tx_stamp) < TX_URGENT_SPACING_US || !send_tx_package()) {
+		tx_urgent_stats.ui32_deferred++;
+		return;
 	}
+
+	tx_urgent_stats.ui32_sent++;
 }
 
 void l2_low_pass_filter_battery_voltage_current_power(void) {
@@ -416,8 +288,8 @@ void l2_low_pass_filter_battery_voltage_current_power(void) {
 			(uint32_t) l2_vars.ui16_adc_battery_voltage
 					* ADC_BATTERY_VOLTAGE_PER_ADC_STEP_X10000;
 	l2_vars.ui16_battery_voltage_filtered_x10 =
-			((uint32_t) (ui32_battery_voltage_accumulated_x10000
-					>> BATTERY_VOLTAGE_FILTER_COEFFICIENT)) / 1000;
+			fixmath_div1000(ui32_battery_voltage_accumulated_x10000
+					>> BATTERY_VOLTAGE_FILTER_COEFFICIENT);
 
 	// low pass filter batery current
 	ui16_battery_current_accumulated_x5 -= ui16_battery_current_accumulated_x5
@@ -433,22 +305,22 @@ void l2_low_pass_filter_battery_voltage_current_power(void) {
 			l2_vars.ui16_battery_current_filtered_x5
 					* l2_vars.ui16_battery_voltage_filtered_x10;
 	l2_vars.ui16_battery_power_filtered =
-			l2_vars.ui16_battery_power_filtered_x50 / 50;
+			fixmath_div50(l2_vars.ui16_battery_power_filtered_x50);
 
 	// loose resolution under 200W
 	if (l2_vars.ui16_battery_power_filtered < 200) {
-		l2_vars.ui16_battery_power_filtered /= 10;
-		l2_vars.ui16_battery_power_filtered *= 10;
+		l2_vars.ui16_battery_power_filtered =
+				fixmath_div10(l2_vars.ui16_battery_power_filtered) * 10;
 	}
 	// loose resolution under 400W
 	else if (l2_vars.ui16_battery_power_filtered < 400) {
-		l2_vars.ui16_battery_power_filtered /= 20;
-		l2_vars.ui16_battery_power_filtered *= 20;
+		l2_vars.ui16_battery_power_filtered =
+				fixmath_div20(l2_vars.ui16_battery_power_filtered) * 20;
 	}
 	// loose resolution all other values
 	else {
-		l2_vars.ui16_battery_power_filtered /= 25;
-		l2_vars.ui16_battery_power_filtered *= 25;
+		l2_vars.ui16_battery_power_filtered =
+				fixmath_div25(l2_vars.ui16_battery_power_filtered) * 25;
 	}
 }
 
@@ -459,8 +331,7 @@ void l2_low_pass_filter_pedal_torque_and_power(void) {
 	// low pass filter
 	ui32_pedal_torque_accumulated -= ui32_pedal_torque_accumulated
 			>> PEDAL_TORQUE_FILTER_COEFFICIENT;
-	ui32_pedal_torque_accumulated += (uint32_t) l2_vars.ui16_pedal_torque_x10
-			/ 10;
+	ui32_pedal_torque_accumulated += fixmath_div10(l2_vars.ui16_pedal_torque_x10);
 	l2_vars.ui16_pedal_torque_filtered =
 			((uint32_t) (ui32_pedal_torque_accumulated
 					>> PEDAL_TORQUE_FILTER_COEFFICIENT));
@@ -468,31 +339,30 @@ void l2_low_pass_filter_pedal_torque_and_power(void) {
 	// low pass filter
 	ui32_pedal_power_accumulated -= ui32_pedal_power_accumulated
 			>> PEDAL_POWER_FILTER_COEFFICIENT;
-	ui32_pedal_power_accumulated += (uint32_t) l2_vars.ui16_pedal_power_x10
-			/ 10;
+	ui32_pedal_power_accumulated += fixmath_div10(l2_vars.ui16_pedal_power_x10);
 	l2_vars.ui16_pedal_power_filtered =
 			((uint32_t) (ui32_pedal_power_accumulated
 					>> PEDAL_POWER_FILTER_COEFFICIENT));
 
 	if (l2_vars.ui16_pedal_torque_filtered > 200) {
-		l2_vars.ui16_pedal_torque_filtered /= 20;
-		l2_vars.ui16_pedal_torque_filtered *= 20;
+		l2_vars.ui16_pedal_torque_filtered =
+				fixmath_div20(l2_vars.ui16_pedal_torque_filtered) * 20;
 	} else if (l2_vars.ui16_pedal_torque_filtered > 100) {
-		l2_vars.ui16_pedal_torque_filtered /= 10;
-		l2_vars.ui16_pedal_torque_filtered *= 10;
+		l2_vars.ui16_pedal_torque_filtered =
+				fixmath_div10(l2_vars.ui16_pedal_torque_filtered) * 10;
 	} else {
 		// do nothing to original values
 	}
 
 	if (l2_vars.ui16_pedal_power_filtered > 500) {
-		l2_vars.ui16_pedal_power_filtered /= 25;
-		l2_vars.ui16_pedal_power_filtered *= 25;
+		l2_vars.ui16_pedal_power_filtered =
+				fixmath_div25(l2_vars.ui16_pedal_power_filtered) * 25;
 	} else if (l2_vars.ui16_pedal_power_filtered > 200) {
-		l2_vars.ui16_pedal_power_filtered /= 20;
-		l2_vars.ui16_pedal_power_filtered *= 20;
+		l2_vars.ui16_pedal_power_filtered =
+				fixmath_div20(l2_vars.ui16_pedal_power_filtered) * 20;
 	} else if (l2_vars.ui16_pedal_power_filtered > 10) {
-		l2_vars.ui16_pedal_power_filtered /= 10;
-		l2_vars.ui16_pedal_power_filtered *= 10;
+		l2_vars.ui16_pedal_power_filtered =
+				fixmath_div10(l2_vars.ui16_pedal_power_filtered) * 10;
 	}
 }
 
@@ -501,9 +371,9 @@ void l2_calc_battery_voltage_soc(void) {
 
 	// calculate flutuate voltage, that depends on the current and battery pack resistance
 	ui16_fluctuate_battery_voltage_x10 =
-			(uint16_t) ((((uint32_t) l2_vars.ui16_battery_pack_resistance_x1000)
-					* ((uint32_t) l2_vars.ui16_battery_current_filtered_x5))
-					/ ((uint32_t) 500));
+			(uint16_t) fixmath_div500(
+					((uint32_t) l2_vars.ui16_battery_pack_resistance_x1000)
+							* ((uint32_t) l2_vars.ui16_battery_current_filtered_x5));
 	// now add fluctuate voltage value
 	l2_vars.ui16_battery_voltage_soc_x10 =
 			l2_vars.ui16_battery_voltage_filtered_x10
@@ -515,7 +385,7 @@ void l2_calc_wh(void) {
 	uint32_t ui32_temp = 0;
 
 	if (l2_vars.ui16_battery_power_filtered_x50 > 0) {
-		l2_vars.ui32_wh_sum_x5 += l2_vars.ui16_battery_power_filtered_x50 / 10;
+		l2_vars.ui32_wh_sum_x5 += fixmath_div10(l2_vars.ui16_battery_power_filtered_x50);
 		l2_vars.ui32_wh_sum_counter++;
 	}
 
@@ -525,10 +395,9 @@ void l2_calc_wh(void) {
 
 		// avoid zero divisison
 		if (l2_vars.ui32_wh_sum_counter != 0) {
-			ui32_temp = l2_vars.ui32_wh_sum_counter / 36;// Stef war 36
-			ui32_temp = (ui32_temp
-					* (l2_vars.ui32_wh_sum_x5 / l2_vars.ui32_wh_sum_counter))
-					/ 500;
+			ui32_temp = fixmath_div36(l2_vars.ui32_wh_sum_counter);// Stef war 36
+			ui32_temp = fixmath_div500(ui32_temp
+					* (l2_vars.ui32_wh_sum_x5 / l2_vars.ui32_wh_sum_counter));
 		}
 
 		l2_vars.ui32_wh_x10 = l2_vars.ui32_wh_x10_offset + ui32_temp;
@@ -565,7 +434,7 @@ static void l2_calc_odometer(void) {
 				* ((uint32_t) l2_vars.ui16_wheel_perimeter);
 		// avoid division by 0
 		if (uint32_temp > 100000) {
-			uint32_temp /= 100000;
+			uint32_temp = fixmath_div100000(uint32_temp);
 		}  // milimmeters to 0.1kms
 		else {
 			uint32_temp = 0;
@@ -663,10 +532,12 @@ uint8_t first_time_management(void) {
 }
 
 void calc_battery_soc_watts_hour(void) {
+	static fixmath_recip_t wh_x10_100_percent; // a setting, the division runs every 100ms
 	uint32_t ui32_temp;
 	ui32_temp = l3_vars.ui32_wh_x10 * 100;
 	if (l3_vars.ui32_wh_x10_100_percent > 0) {
-		ui32_temp /= l3_vars.ui32_wh_x10_100_percent;
+		fixmath_recip_set(&wh_x10_100_percent, l3_vars.ui32_wh_x10_100_percent);
+		ui32_temp = fixmath_recip_div(&wh_x10_100_percent, ui32_temp);
 	} else {
 		ui32_temp = 0;
 	}
@@ -685,15 +556,27 @@ void calc_battery_soc_watts_hour(void) {
 	ui16_m_battery_soc_watts_hour_fixed = 100 - ui32_temp;
 }
 
-// Note: this called from ISR context every 100ms
+void l2_publish_telemetry(void) {
+	*telemetry_back_buffer() = l2_vars.telemetry;
+
+	telemetry_publish();
+}
+
+// Note: this called every 100ms from layer_2_task(), at the lowest interrupt priority on the 850C and
+// from the main loop on the SW102
 void layer_2(void) {
 	// this was not ideal because it mean't if unlucky we might miss a 100ms tick sometimes, better to just block the timer from running while doing the brief copy
 	// operation
 	//if(!ui32_g_layer_2_can_execute)
 	//  return;
 
+	// the stream version of the "Motor firmware" setting, the UART drivers size the packets by it
+	uint8_t ui8_stream_version = l2_vars.ui8_motor_firmware ? 20 : 19;
+	if (uart_get_stream_version() != ui8_stream_version)
+		uart_set_stream_version(ui8_stream_version);
+
 	process_rx();
-	send_tx_package();
+	send_tx_package(); // skipped if the urgent packet of a button press is still going out
 
 	/************************************************************************************************/
 	// now do all the calculations that must be done every 100ms
@@ -709,6 +592,48 @@ void layer_2(void) {
 
 	first_time_management();
 	calc_battery_soc_watts_hour();
+
+	l2_publish_telemetry();
+}
+
+layer_2_stats_t layer_2_stats;
+static volatile uint32_t ui32_layer_2_trigger_stamp;
+static volatile bool layer_2_pending;
+
+bool layer_2_trigger(void) {
+	if (layer_2_pending) {
+		layer_2_stats.ui32_missed++;
+		return false;
+	}
+
+	ui32_layer_2_trigger_stamp = layer_2_clock();
+	layer_2_pending = true;
+	return true;
+}
+
+void layer_2_task(void) {
+	if (!layer_2_pending)
+		return;
+
+	// a trigger that comes while layer_2() runs is for the next run
+	uint32_t ui32_latency_us = layer_2_clock_us_since(ui32_layer_2_trigger_stamp);
+	layer_2_pending = false;
+
+	uint32_t ui32_start = layer_2_clock();
+	layer_2();
+	uint32_t ui32_run_us = layer_2_clock_us_since(ui32_start);
+
+	layer_2_stats_t *p_stats = &layer_2_stats;
+	if (p_stats->ui32_runs == 0 || ui32_latency_us < p_stats->ui32_latency_min_us)
+		p_stats->ui32_latency_min_us = ui32_latency_us;
+	if (ui32_latency_us > p_stats->ui32_latency_max_us)
+		p_stats->ui32_latency_max_us = ui32_latency_us;
+	if (ui32_run_us > p_stats->ui32_run_max_us)
+		p_stats->ui32_run_max_us = ui32_run_us;
+
+	p_stats->ui32_latency_us = ui32_latency_us;
+	p_stats->ui32_jitter_us = p_stats->ui32_latency_max_us - p_stats->ui32_latency_min_us;
+	p_stats->ui32_runs++;
 }
 
 /**
@@ -716,41 +641,8 @@ void layer_2(void) {
  *
  */
 void copy_layer_2_layer_3_vars(void) {
-	l3_vars.ui16_adc_battery_voltage = l2_vars.ui16_adc_battery_voltage;
-	l3_vars.ui8_battery_current_x5 = l2_vars.ui8_battery_current_x5;
-	l3_vars.ui8_throttle = l2_vars.ui8_throttle;
-	l3_vars.ui8_adc_pedal_torque_sensor = l2_vars.ui8_adc_pedal_torque_sensor;
-	l3_vars.ui8_pedal_torque_sensor = l2_vars.ui8_pedal_torque_sensor;
-	l3_vars.ui8_pedal_human_power = l2_vars.ui8_pedal_human_power;
-	l3_vars.ui8_duty_cycle = l2_vars.ui8_duty_cycle;
-	l3_vars.ui8_error_states = l2_vars.ui8_error_states;
-	l3_vars.ui16_wheel_speed_x10 = l2_vars.ui16_wheel_speed_x10;
-	;
-	l3_vars.ui8_pedal_cadence = l2_vars.ui8_pedal_cadence;
-	l3_vars.ui16_motor_speed_erps = l2_vars.ui16_motor_speed_erps;
-	l3_vars.ui8_temperature_current_limiting_value =
-			l2_vars.ui8_temperature_current_limiting_value;
-	l3_vars.ui8_motor_temperature = l2_vars.ui8_motor_temperature;
-	l3_vars.ui32_wheel_speed_sensor_tick_counter =
-			l2_vars.ui32_wheel_speed_sensor_tick_counter;
-	l3_vars.ui16_pedal_power_x10 = l2_vars.ui16_pedal_power_x10;
-	l3_vars.ui16_battery_voltage_filtered_x10 =
-			l2_vars.ui16_battery_voltage_filtered_x10;
-	l3_vars.ui16_battery_current_filtered_x5 =
-			l2_vars.ui16_battery_current_filtered_x5;
-	l3_vars.ui16_battery_power_filtered_x50 =
-			l2_vars.ui16_battery_power_filtered_x50;
-	l3_vars.ui16_battery_power_filtered = l2_vars.ui16_battery_power_filtered;
-	l3_vars.ui16_pedal_torque_filtered = l2_vars.ui16_pedal_torque_filtered;
-	l3_vars.ui16_pedal_power_filtered = l2_vars.ui16_pedal_power_filtered;
-	l3_vars.ui8_pedal_cadence_filtered = l2_vars.ui8_pedal_cadence_filtered;
-	l3_vars.ui16_battery_voltage_soc_x10 = l2_vars.ui16_battery_voltage_soc_x10;
-	l3_vars.ui32_wh_sum_x5 = l2_vars.ui32_wh_sum_x5;
-	l3_vars.ui32_wh_sum_counter = l2_vars.ui32_wh_sum_counter;
-	l3_vars.ui32_wh_x10 = l2_vars.ui32_wh_x10;
-	l3_vars.ui8_braking = l2_vars.ui8_braking;
-	l3_vars.ui8_foc_angle = l2_vars.ui8_foc_angle;
-
+	// one consistent frame, layer_2() may run in the middle of this
+	telemetry_snapshot(&l3_vars.telemetry);
 
 	l2_vars.ui32_wh_x10_offset = l3_vars.ui32_wh_x10_offset;
 	l2_vars.ui16_battery_pack_resistance_x1000 =
@@ -797,6 +689,7 @@ void copy_layer_2_layer_3_vars(void) {
 	l2_vars.ui16_wheel_perimeter = l3_vars.ui16_wheel_perimeter;
 	l2_vars.ui8_wheel_max_speed = l3_vars.wheel_max_speed_x10 / 10;
 	l2_vars.ui8_motor_type = l3_vars.ui8_motor_type;
+	l2_vars.ui8_motor_firmware = l3_vars.ui8_motor_firmware;
 	l2_vars.ui8_motor_assistance_startup_without_pedal_rotation =
 			l3_vars.ui8_motor_assistance_startup_without_pedal_rotation;
 	l2_vars.ui8_temperature_limit_feature_enabled =
@@ -0,0 +1,50 @@
+/*
+ * Bafang LCD firmware
+ *
+ * Copyright (C) Casainho, 2018.
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#include <string.h>
+#include "telemetry.h"
+
+// DMB on the Cortex-M targets, also keeps the compiler from moving the buffer accesses around
+#define TELEMETRY_BARRIER() __sync_synchronize()
+
+static l2_telemetry_t telemetry[2];
+
+// Number of frames published so far, the published frame is telemetry[ui32_sequence & 1].
+// Only telemetry_publish() writes it.
+static volatile uint32_t ui32_sequence;
+
+l2_telemetry_t* telemetry_back_buffer(void) {
+	return &telemetry[(ui32_sequence + 1) & 1];
+}
+
+void telemetry_publish(void) {
+	// the frame must be complete before it becomes visible
+	TELEMETRY_BARRIER();
+	ui32_sequence++;
+	TELEMETRY_BARRIER();
+}
+
+uint32_t telemetry_snapshot(l2_telemetry_t *p_telemetry) {
+	uint32_t ui32_retries = 0;
+	uint32_t ui32_start;
+
+	// The writer only touches the buffer being copied after it published the other one, which
+	// changes the sequence. So if the sequence is the same after the copy, the copy is one frame.
+	while (1) {
+		ui32_start = ui32_sequence;
+		TELEMETRY_BARRIER();
+
+		memcpy(p_telemetry, &telemetry[ui32_start & 1], sizeof(l2_telemetry_t));
+
+		TELEMETRY_BARRIER();
+		if (ui32_sequence == ui32_start)
+			return ui32_retries;
+
+		ui32_retries++;
+	}
+}
@@ -73,6 +73,12 @@ void _UG_Refresh( void );
  /* Pointer to the gui */
 static UG_GUI* gui;
 
+#ifdef USE_DRAW_STATS
+UG_DRAW_STATS ug_draw_stats;
+#endif
+
+UG_U32 ug_pixels_drawn;
+
 #ifdef USE_FONT_4X6
 __UG_FONT_DATA unsigned char font_4x6[256][6]={
 {0x00,0x00,0x00,0x00,0x00,0x00}, // 0x00
@@ -4636,6 +4642,10 @@ void UG_FillFrame( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c )
 {
    UG_S16 n,m;
 
+#ifdef USE_DRAW_STATS
+   ug_draw_stats.fills++;
+#endif
+
    if ( x2 < x1 )
    {
       n = x2;
@@ -4649,6 +4659,8 @@ void UG_FillFrame( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c )
       y1 = n;
    }
 
+   ug_pixels_drawn += (UG_U32) (x2 - x1 + 1) * (y2 - y1 + 1);
+
    /* Is hardware acceleration available? */
    if ( gui->driver[DRIVER_FILL_FRAME].state & DRIVER_ENABLED )
    {
@@ -4737,6 +4749,8 @@ void UG_DrawMesh( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c )
       y1 = n;
    }
 
+   ug_pixels_drawn += (UG_U32) ((x2 - x1) / 2 + 1) * ((y2 - y1) / 2 + 1);
+
    for( m=y1; m<=y2; m+=2 )
    {
       for( n=x1; n<=x2; n+=2 )
@@ -4794,6 +4808,7 @@ void UG_DrawRoundFrame( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_S16 r, UG
 
 void UG_DrawPixel( UG_S16 x0, UG_S16 y0, UG_COLOR c )
 {
+   ug_pixels_drawn++;
    gui->pset(x0,y0,c);
 }
 
@@ -4929,6 +4944,14 @@ void UG_DrawLine( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c )
 {
    UG_S16 n, dx, dy, sgndx, sgndy, dxabs, dyabs, x, y, drawx, drawy;
 
+#ifdef USE_DRAW_STATS
+   ug_draw_stats.lines++;
+#endif
+
+   dxabs = (x2>x1)?x2-x1:x1-x2;
+   dyabs = (y2>y1)?y2-y1:y1-y2;
+   ug_pixels_drawn += ((dxabs>dyabs)?dxabs:dyabs) + 1;
+
    /* Is hardware acceleration available? */
    if ( gui->driver[DRIVER_DRAW_LINE].state & DRIVER_ENABLED )
    {
@@ -5313,6 +5336,79 @@ const UG_COLOR pal_checkbox_released[] =
 /* -------------------------------------------------------------------------------- */
 /* -- INTERNAL FUNCTIONS                                                         -- */
 /* -------------------------------------------------------------------------------- */
+/* Fill a rectangle without triggering a refresh, used while drawing glyphs */
+static void _UG_FillRun( UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c )
+{
+   UG_S16 n,m;
+
+#ifdef USE_DRAW_STATS
+   ug_draw_stats.fills++;
+#endif
+
+   if( ((UG_RESULT(*)(UG_S16 x1, UG_S16 y1, UG_S16 x2, UG_S16 y2, UG_COLOR c))gui->driver[DRIVER_FILL_FRAME].driver)(x1,y1,x2,y2,c) == UG_RESULT_OK ) return;
+
+   for( m=y1; m<=y2; m++ )
+   {
+      for( n=x1; n<=x2; n++ )
+      {
+         gui->pset(n,m,c);
+      }
+   }
+}
+
+/* Run-length output of a 1BPP glyph: every horizontal run of foreground pixels is sent as a
+ * single accelerated fill, and consecutive rows with the same bitmap (the straight strokes of
+ * the big number fonts) are merged into one rectangle. Background pixels are never touched
+ * when bc is C_TRANSPARENT. */
+static void _UG_PutCharSpans( UG_U8 bt, UG_S16 x, UG_S16 y, UG_COLOR fc, UG_COLOR bc, const UG_FONT* font, UG_U16 bn, UG_U16 actual_char_width )
+{
+   UG_U16 i,j,k,h,start;
+   const unsigned char *row, *next;
+
+   if ( bc != C_TRANSPARENT )
+      _UG_FillRun(x, y, x+actual_char_width-1, y+font->char_height-1, bc);
+
+   if ( fc == C_TRANSPARENT ) return;
+
+   row = &font->p[(UG_U32)(bt - font->start_char) * font->char_height * bn];
+   j = 0;
+   while ( j < font->char_height )
+   {
+      /* How many of the following rows are identical to this one? */
+      h = 1;
+      next = row + bn;
+      while ( j+h < font->char_height )
+      {
+         for( i=0; (i<bn) && (row[i] == next[i]); i++ );
+         if ( i < bn ) break;
+         h++;
+         next += bn;
+      }
+
+      k = 0;
+      while ( k < actual_char_width )
+      {
+         if ( !(k & 7) && !row[k >> 3] )
+         {
+            k += 8; // empty byte
+            continue;
+         }
+         if ( !(row[k >> 3] & (1 << (k & 7))) )
+         {
+            k++;
+            continue;
+         }
+
+         start = k;
+         while ( (k < actual_char_width) && (row[k >> 3] & (1 << (k & 7))) ) k++;
+         _UG_FillRun(x+start, y+j, x+k-1, y+j+h-1, fc);
+      }
+
+      j += h;
+      row = next;
+   }
+}
+
 void _UG_PutChar( char chr, UG_S16 x, UG_S16 y, UG_COLOR fc, UG_COLOR bc, const UG_FONT* font)
 {
    UG_U16 i,j,k,xo,yo,c,bn,actual_char_width;
@@ -5340,9 +5436,22 @@ void _UG_PutChar( char chr, UG_S16 x, UG_S16 y, UG_COLOR fc, UG_COLOR bc, const
    yo = y;
    bn = font->char_width;
    if ( !bn ) return;
+#ifdef USE_DRAW_STATS
+   ug_draw_stats.glyphs++;
+#endif
    bn >>= 3;
    if ( font->char_width % 8 ) bn++;
    actual_char_width = (font->widths ? font->widths[bt - font->start_char] : font->char_width);
+   ug_pixels_drawn += (UG_U32) actual_char_width * font->char_height;
+
+   /* Span output, when filling rectangles is accelerated and streaming the whole glyph box is
+    * not possible or would paint a transparent background */
+   if ( (font->font_type == FONT_TYPE_1BPP) && (gui->driver[DRIVER_FILL_FRAME].state & DRIVER_ENABLED) &&
+        ((bc == C_TRANSPARENT) || !(gui->driver[DRIVER_FILL_AREA].state & DRIVER_ENABLED)) )
+   {
+      _UG_PutCharSpans(bt, x, y, fc, bc, font, bn, actual_char_width);
+      return;
+   }
 
    /* Is hardware acceleration available? */
    if ( gui->driver[DRIVER_FILL_AREA].state & DRIVER_ENABLED )
@@ -0,0 +1,25 @@
+/*
+ * Bafang LCD 850C firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Host stand-in for the STM32 device header, only what the common code touches
+
+#ifndef STM32F10X_H_
+#define STM32F10X_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint8_t ui8_port; // 0 = A, 1 = B, 2 = C
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc;
+
+#define GPIOA (&host_gpioa)
+#define GPIOB (&host_gpiob)
+#define GPIOC (&host_gpioc)
+
+#endif /* STM32F10X_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Glue between the host main loop and the simulated hardware back-ends
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define HOST_MSEC_PER_TICK 20 // main_idle() period, as on the real displays
+
+typedef enum
+{
+  HOST_BUTTON_ONOFF = 1,
+  HOST_BUTTON_UP = 2,
+  HOST_BUTTON_DOWN = 4,
+  HOST_BUTTON_M = 8
+} host_button_t;
+
+// host_main.c
+uint32_t host_get_msecs(void);
+
+// host_buttons.c, script lines are "<tick> <onoff|up|down|m> <ticks held>", # starts a comment
+bool host_buttons_load(const char *p_path);
+void host_buttons_tick(uint32_t ui32_tick);
+bool host_button_pressed(host_button_t button);
+
+// host_flash.c, without a file the flash starts blank and is lost on exit
+void host_flash_set_file(const char *p_path);
+
+// host_fds.c, the nRF5 SDK FDS stand-in behind the SW102 eeprom_hw.c. Simulated time only passes
+// in sd_app_evt_wait() and host_fds_advance(), which run the event handlers of the flash operations
+// done by then, as the SoftDevice interrupt would.
+typedef struct
+{
+  uint32_t ui32_writes;        // records written, updates included
+  uint32_t ui32_gcs;
+  uint32_t ui32_words_written;
+  uint32_t ui32_page_erases;
+} host_fds_counters_t;
+
+void host_fds_reset(void);
+uint64_t host_fds_now_us(void);
+void host_fds_advance(uint32_t ui32_us);
+void host_fds_counters(host_fds_counters_t *p_counters);
+
+// host_uart.c, counts the packets the firmware sends to the motor
+uint32_t host_uart_tx_packets(void);
+
+// host_lcd_850c.c / host_lcd_sw102.c
+typedef struct
+{
+  uint32_t ui32_pixels;          // pixels that reached the panel
+  uint32_t ui32_window_commands; // 0x2a/0x2b on the 850C, page address on the SW102
+  uint32_t ui32_bus_cycles;      // WR strobes on the 850C, SPI bytes on the SW102
+  uint64_t ui64_bus_ns;          // estimated time the bus was busy
+} host_lcd_counters_t;
+
+void host_lcd_init(void);
+// write what is on the glass as a PPM (850C) or PBM (SW102)
+bool host_lcd_dump(const char *p_path);
+// latch the pixel and bus counts of the tick just drawn, print them when p_file is not NULL
+void host_lcd_tick_end(uint32_t ui32_tick, FILE *p_file);
+// running totals since host_lcd_init()
+void host_lcd_counters(host_lcd_counters_t *p_counters);
@@ -0,0 +1,29 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// The checks of the host test programs. A failed CHECK() is counted and the first 10 are printed,
+// main() then exits with 1 if host_test_failed().
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+static uint32_t ui32_failures;
+
+#define CHECK(condition, ...) \
+  do { if (!(condition)) { if (ui32_failures++ < 10) { printf("FAIL: " __VA_ARGS__); printf("\n"); } } } while (0)
+
+// Prints how many checks failed, if any
+static inline bool host_test_failed(void)
+{
+  if (!ui32_failures)
+    return false;
+
+  printf("%u failures\n", ui32_failures);
+  return true;
+}
@@ -0,0 +1,17 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define NRF_SUCCESS 0
+
+void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info);
+
+#define APP_ERROR_HANDLER(code) app_error_fault_handler((code), 0, 0)
+#define APP_ERROR_CHECK(code) \
+  do { uint32_t _err = (code); if (_err != NRF_SUCCESS) app_error_fault_handler(_err, 0, 0); } while (0)
@@ -0,0 +1,11 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+// the host "interrupts" (FDS events) only run from sd_app_evt_wait() and host_fds_advance()
+#define CRITICAL_REGION_ENTER() {
+#define CRITICAL_REGION_EXIT() }
@@ -0,0 +1,17 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Host stand-in for the nRF5 SDK boards.h
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nrf_gpio.h"
+#include "custom_board.h"
+
+#define SET_BIT(W,B)  ((W) |= (uint32_t)(1U << (B)))
+#define CLR_BIT(W, B) ((W) &= (~((uint32_t)1 << (B))))
@@ -0,0 +1,114 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+// The part of the nRF5 SDK 12 FDS API the SW102 uses, implemented by src/host_fds.c
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_error.h" // the SDK headers pull it in
+
+typedef uint32_t ret_code_t;
+
+enum
+{
+  FDS_SUCCESS = 0,
+  FDS_ERR_NOT_INITIALIZED = 0x8602,
+  FDS_ERR_INVALID_ARG = 0x8604,
+  FDS_ERR_NO_SPACE_IN_FLASH = 0x8607,
+  FDS_ERR_NO_SPACE_IN_QUEUES = 0x8608,
+  FDS_ERR_RECORD_TOO_LARGE = 0x8609,
+  FDS_ERR_NOT_FOUND = 0x860a,
+};
+
+typedef struct
+{
+  uint32_t record_id;
+  uint32_t const * p_record;
+  uint16_t gc_run_count;
+  bool record_is_open;
+} fds_record_desc_t;
+
+typedef struct
+{
+  uint32_t const * p_addr;
+  uint16_t page;
+} fds_find_token_t;
+
+typedef struct
+{
+  void const * p_header;
+  void const * p_data;
+} fds_flash_record_t;
+
+typedef struct
+{
+  void const * p_data;
+  uint16_t length_words;
+} fds_record_chunk_t;
+
+typedef struct
+{
+  uint16_t file_id;
+  uint16_t key;
+  struct
+  {
+    fds_record_chunk_t const * p_chunks;
+    uint16_t num_chunks;
+  } data;
+} fds_record_t;
+
+typedef enum
+{
+  FDS_EVT_INIT,
+  FDS_EVT_WRITE,
+  FDS_EVT_UPDATE,
+  FDS_EVT_DEL_RECORD,
+  FDS_EVT_DEL_FILE,
+  FDS_EVT_GC
+} fds_evt_id_t;
+
+typedef struct
+{
+  fds_evt_id_t id;
+  ret_code_t result;
+  union
+  {
+    struct
+    {
+      uint32_t record_id;
+      uint16_t file_id;
+      uint16_t record_key;
+      bool is_record_updated;
+    } write;
+  };
+} fds_evt_t;
+
+typedef struct
+{
+  uint16_t open_records;
+  uint16_t valid_records;
+  uint16_t dirty_records;
+  uint16_t words_reserved;
+  uint16_t words_used;
+  uint16_t largest_contig;
+  uint16_t freeable_words;
+} fds_stat_t;
+
+typedef void (*fds_cb_t)(fds_evt_t const * const p_evt);
+
+ret_code_t fds_register(fds_cb_t cb);
+ret_code_t fds_init(void);
+ret_code_t fds_record_write(fds_record_desc_t * const p_desc, fds_record_t const * const p_record);
+ret_code_t fds_record_update(fds_record_desc_t * const p_desc, fds_record_t const * const p_record);
+ret_code_t fds_record_delete(fds_record_desc_t * const p_desc);
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * const p_desc,
+    fds_find_token_t * const p_token);
+ret_code_t fds_record_open(fds_record_desc_t * const p_desc, fds_flash_record_t * const p_flash_record);
+ret_code_t fds_record_close(fds_record_desc_t * const p_desc);
+ret_code_t fds_gc(void);
+ret_code_t fds_stat(fds_stat_t * const p_stat);
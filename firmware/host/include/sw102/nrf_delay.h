@@ -0,0 +1,10 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+#define nrf_delay_us(us) ((void) (us))
+#define nrf_delay_ms(ms) ((void) (ms))
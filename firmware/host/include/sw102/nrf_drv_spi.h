@@ -0,0 +1,55 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Host stand-in for the nRF5 SDK SPI master driver, transfers go to the SH1107 model
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "app_error.h"
+
+typedef struct
+{
+  uint8_t drv_inst_idx;
+} nrf_drv_spi_t;
+
+typedef enum
+{
+  NRF_SPI_FREQ_4M = 4,
+  NRF_SPI_FREQ_8M = 8,
+} nrf_spi_frequency_t;
+
+typedef enum
+{
+  NRF_SPI_MODE_0 = 0,
+} nrf_spi_mode_t;
+
+typedef enum
+{
+  NRF_SPI_BIT_ORDER_MSB_FIRST = 0,
+} nrf_spi_bit_order_t;
+
+typedef struct
+{
+  uint8_t sck_pin;
+  uint8_t mosi_pin;
+  uint8_t miso_pin;
+  uint8_t ss_pin;
+  nrf_spi_frequency_t frequency;
+  nrf_spi_mode_t mode;
+  nrf_spi_bit_order_t bit_order;
+} nrf_drv_spi_config_t;
+
+#define NRF_DRV_SPI_INSTANCE(id) { .drv_inst_idx = (id) }
+#define NRF_DRV_SPI_DEFAULT_CONFIG { .frequency = NRF_SPI_FREQ_4M }
+
+typedef void (*nrf_drv_spi_evt_handler_t)(void *p_event);
+
+uint32_t nrf_drv_spi_init(nrf_drv_spi_t const * const p_instance, nrf_drv_spi_config_t const * p_config,
+    nrf_drv_spi_evt_handler_t handler);
+uint32_t nrf_drv_spi_transfer(nrf_drv_spi_t const * const p_instance, uint8_t const * p_tx_buffer,
+    uint8_t tx_buffer_length, uint8_t * p_rx_buffer, uint8_t rx_buffer_length);
@@ -0,0 +1,20 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum
+{
+  NRF_GPIO_PIN_NOPULL = 0,
+  NRF_GPIO_PIN_PULLDOWN = 1,
+  NRF_GPIO_PIN_PULLUP = 3,
+} nrf_gpio_pin_pull_t;
+
+// the SH1107 model needs to know the command/data line, everything else is ignored
+void nrf_gpio_pin_set(uint32_t pin_number);
+void nrf_gpio_pin_clear(uint32_t pin_number);
@@ -0,0 +1,12 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// src/host_fds.c: sleeps until the next FDS event and delivers it
+uint32_t sd_app_evt_wait(void);
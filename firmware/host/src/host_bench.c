@@ -0,0 +1,367 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Render cost benchmark. Drives screenShow() and screen_clock() (which ends in screenUpdate())
+ * through a fixed set of scenarios and reports, per scenario, what the frames cost: pixels
+ * sent to the panel, window/page address commands, uGUI fill calls, glyphs drawn, values
+ * formatted to strings (editables and fieldSetText()) and the estimated bus time (WR strobes on
+ * the 850C, SPI bytes on the SW102).
+ *
+ * The result is JSON on stdout. The worst frame of each scenario is checked against the
+ * thresholds below and the exit code is 1 if any of them is exceeded, so a regression in
+ * renderLayouts(), renderGraph() or _UG_PutChar() fails "make bench". carried_updates are the
+ * updates that went over the render budget and left fields for the next one.
+ *
+ * Then every transition between two screens of screens[] is shown once and reported with the
+ * pixels it cleared, against the whole screen clear that screens used to get.
+ *
+ * Nothing here reads the wall clock and the motor data is fixed, so runs are repeatable.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ugui.h"
+#include "screen.h"
+#include "mainscreen.h"
+#include "configscreen.h"
+#include "eeprom.h"
+#include "buttons.h"
+#include "state.h"
+#include "host.h"
+
+typedef struct
+{
+  uint32_t ui32_pixels;
+  uint32_t ui32_window_commands;
+  uint32_t ui32_fills;
+  uint32_t ui32_glyphs;
+  uint32_t ui32_formats;
+  uint32_t ui32_bus_cycles;
+  uint64_t ui64_bus_us;
+} bench_cost_t;
+
+typedef struct
+{
+  const char *p_name;
+  Screen *p_screen;
+  uint32_t ui32_warmup_ticks;            // ticks drawn before measuring
+  uint32_t ui32_ticks;                   // ticks measured
+  void (*tick)(uint32_t ui32_tick);      // called before every screen_clock(), may be NULL
+  bool tick_warmup;                      // call tick in the warm up ticks too
+  bench_cost_t max_frame;                // thresholds for the worst measured frame
+} bench_scenario_t;
+
+#ifdef SW102
+#define BENCH_TARGET "sw102"
+#define BENCH_BUS_CYCLES "spi_bytes"
+#else
+#define BENCH_TARGET "850c"
+#define BENCH_BUS_CYCLES "wr_strobes"
+#endif
+
+static uint32_t ui32_msecs;
+
+uint32_t host_get_msecs(void)
+{
+  return ui32_msecs;
+}
+
+static void bench_motor_data(void)
+{
+  l2_vars.ui16_wheel_speed_x10 = 256;
+  l2_vars.ui16_adc_battery_voltage = 500;
+  l2_vars.ui8_battery_current_x5 = 50;
+  l2_vars.ui16_pedal_power_x10 = 1200;
+  l2_vars.ui8_pedal_cadence = 80;
+  l2_vars.ui8_motor_temperature = 40;
+  l2_publish_telemetry();
+  copy_layer_2_layer_3_vars();
+}
+
+static void tick_speed_changing(uint32_t ui32_tick)
+{
+  // a new speed every tick, from 0.0 to 45.9 km/h, so the big digits and the decimal change
+  l2_vars.ui16_wheel_speed_x10 = (ui32_tick * 37) % 460;
+  l2_publish_telemetry();
+  l3_vars.ui16_wheel_speed_x10 = l2_vars.ui16_wheel_speed_x10;
+}
+
+static void tick_config_scrolling(uint32_t ui32_tick)
+{
+  // one step down the menu every other tick
+  if (ui32_tick % 2 == 0)
+    screenOnPress(DOWN_CLICK);
+}
+
+#ifndef SW102
+static void tick_graph(uint32_t ui32_tick)
+{
+  // the graph samples every GRAPH_INTERVAL_MS, give it a new value each time
+  if (ui32_tick % (GRAPH_INTERVAL_MS / UPDATE_INTERVAL_MS) == 0)
+  {
+    l2_vars.ui16_adc_battery_voltage = 430 + (ui32_tick * 13) % 90;
+    l2_vars.ui16_battery_voltage_filtered_x10 = l2_vars.ui16_adc_battery_voltage; // what the graph shows
+    l2_publish_telemetry();
+  }
+}
+
+// A full graph scrolling by a column on each update, drawn the old way then incrementally
+static void tick_graph_redraw(uint32_t ui32_tick)
+{
+  graphIncremental = false;
+  tick_graph(ui32_tick);
+}
+
+static void tick_graph_incremental(uint32_t ui32_tick)
+{
+  graphIncremental = true;
+  tick_graph(ui32_tick);
+}
+
+#define GRAPH_FILL_TICKS (GRAPH_MAX_POINTS * (GRAPH_INTERVAL_MS / UPDATE_INTERVAL_MS))
+#endif
+
+static void tick_screen_switch(uint32_t ui32_tick)
+{
+  screenShow((ui32_tick % 2) ? &configScreen : &mainScreen);
+}
+
+// Thresholds are the worst frame measured when the scenario was added, plus some headroom.
+// Nothing changes in main_steady, so it must not format or draw anything at all.
+// The SW102 has no graph field, so it has no graph scenarios. screen_switch comes back to a full
+// graph, left by the graph scenarios.
+static const bench_scenario_t scenarios[] =
+{
+#ifndef SW102
+  { "boot",            &bootScreen,   0,  50, NULL, false,
+      { .ui32_pixels = 400000, .ui32_window_commands = 2300, .ui32_fills = 1400, .ui32_formats = 25, .ui32_glyphs = 140, .ui32_bus_cycles = 410000, .ui64_bus_us = 42000 } },
+  { "main_steady",     &mainScreen,  10,  50, NULL, false,
+      { .ui32_pixels = 0, .ui32_window_commands = 0, .ui32_fills = 0, .ui32_formats = 0, .ui32_glyphs = 0, .ui32_bus_cycles = 0, .ui64_bus_us = 0 } },
+  { "speed_changing",  &mainScreen,  10,  50, tick_speed_changing, false,
+      { .ui32_pixels = 30000, .ui32_window_commands = 420, .ui32_fills = 260, .ui32_formats = 6, .ui32_glyphs = 16, .ui32_bus_cycles = 32000, .ui64_bus_us = 3300 } },
+  { "config_scroll",   &configScreen, 10,  40, tick_config_scrolling, false,
+      { .ui32_pixels = 200000, .ui32_window_commands = 1900, .ui32_fills = 1200, .ui32_formats = 15, .ui32_glyphs = 110, .ui32_bus_cycles = 210000, .ui64_bus_us = 22000 } },
+  { "graph_refresh",   &mainScreen,  10, 350, tick_graph, false,
+      { .ui32_pixels = 8000, .ui32_window_commands = 200, .ui32_fills = 120, .ui32_formats = 2, .ui32_glyphs = 20, .ui32_bus_cycles = 9100, .ui64_bus_us = 960 } },
+  { "graph_scroll_redraw", &mainScreen, GRAPH_FILL_TICKS, 300, tick_graph_redraw, true,
+      { .ui32_pixels = 42000, .ui32_window_commands = 1000, .ui32_fills = 110, .ui32_formats = 1, .ui32_glyphs = 20, .ui32_bus_cycles = 47000, .ui64_bus_us = 5000 } },
+  { "graph_scroll",    &mainScreen, GRAPH_FILL_TICKS, 300, tick_graph_incremental, true,
+      { .ui32_pixels = 20000, .ui32_window_commands = 760, .ui32_fills = 110, .ui32_formats = 1, .ui32_glyphs = 20, .ui32_bus_cycles = 24000, .ui64_bus_us = 2600 } },
+  { "screen_switch",   &mainScreen,  10,  20, tick_screen_switch, false,
+      { .ui32_pixels = 390000, .ui32_window_commands = 2600, .ui32_fills = 1300, .ui32_formats = 20, .ui32_glyphs = 150, .ui32_bus_cycles = 410000, .ui64_bus_us = 41000 } },
+#else
+  { "boot",            &bootScreen,   0,  50, NULL, false,
+      { .ui32_pixels = 15000, .ui32_window_commands = 29, .ui32_fills = 300, .ui32_formats = 20, .ui32_glyphs = 45, .ui32_bus_cycles = 1900, .ui64_bus_us = 3800 } },
+  { "main_steady",     &mainScreen,  10,  50, NULL, false,
+      { .ui32_pixels = 0, .ui32_window_commands = 0, .ui32_fills = 0, .ui32_formats = 0, .ui32_glyphs = 0, .ui32_bus_cycles = 0, .ui64_bus_us = 0 } },
+  { "speed_changing",  &mainScreen,  10,  50, tick_speed_changing, false,
+      { .ui32_pixels = 4600, .ui32_window_commands = 11, .ui32_fills = 180, .ui32_formats = 4, .ui32_glyphs = 19, .ui32_bus_cycles = 600, .ui64_bus_us = 1200 } },
+  { "config_scroll",   &configScreen, 10,  40, tick_config_scrolling, false,
+      { .ui32_pixels = 9000, .ui32_window_commands = 19, .ui32_fills = 230, .ui32_formats = 6, .ui32_glyphs = 44, .ui32_bus_cycles = 1200, .ui64_bus_us = 2400 } },
+  { "screen_switch",   &mainScreen,  10,  20, tick_screen_switch, false,
+      { .ui32_pixels = 14000, .ui32_window_commands = 27, .ui32_fills = 340, .ui32_formats = 14, .ui32_glyphs = 53, .ui32_bus_cycles = 1800, .ui64_bus_us = 3600 } },
+#endif
+};
+
+static void cost_now(bench_cost_t *p_cost)
+{
+  host_lcd_counters_t counters;
+
+  host_lcd_counters(&counters);
+  p_cost->ui32_pixels = counters.ui32_pixels;
+  p_cost->ui32_window_commands = counters.ui32_window_commands;
+  p_cost->ui32_fills = ug_draw_stats.fills;
+  p_cost->ui32_glyphs = ug_draw_stats.glyphs;
+  p_cost->ui32_formats = screenFormattedStrings;
+  p_cost->ui32_bus_cycles = counters.ui32_bus_cycles;
+  p_cost->ui64_bus_us = counters.ui64_bus_ns / 1000;
+}
+
+static void cost_sub(bench_cost_t *p_result, const bench_cost_t *p_a, const bench_cost_t *p_b)
+{
+  p_result->ui32_pixels = p_a->ui32_pixels - p_b->ui32_pixels;
+  p_result->ui32_window_commands = p_a->ui32_window_commands - p_b->ui32_window_commands;
+  p_result->ui32_fills = p_a->ui32_fills - p_b->ui32_fills;
+  p_result->ui32_glyphs = p_a->ui32_glyphs - p_b->ui32_glyphs;
+  p_result->ui32_formats = p_a->ui32_formats - p_b->ui32_formats;
+  p_result->ui32_bus_cycles = p_a->ui32_bus_cycles - p_b->ui32_bus_cycles;
+  p_result->ui64_bus_us = p_a->ui64_bus_us - p_b->ui64_bus_us;
+}
+
+#define COST_MAX(field) if (p_cost->field > p_max->field) p_max->field = p_cost->field
+
+static void cost_max(bench_cost_t *p_max, const bench_cost_t *p_cost)
+{
+  COST_MAX(ui32_pixels);
+  COST_MAX(ui32_window_commands);
+  COST_MAX(ui32_fills);
+  COST_MAX(ui32_glyphs);
+  COST_MAX(ui32_formats);
+  COST_MAX(ui32_bus_cycles);
+  COST_MAX(ui64_bus_us);
+}
+
+#define COST_OVER(field) (p_cost->field > p_limit->field)
+
+static bool cost_over(const bench_cost_t *p_cost, const bench_cost_t *p_limit)
+{
+  return COST_OVER(ui32_pixels) || COST_OVER(ui32_window_commands) || COST_OVER(ui32_fills) ||
+      COST_OVER(ui32_glyphs) || COST_OVER(ui32_formats) || COST_OVER(ui32_bus_cycles) || COST_OVER(ui64_bus_us);
+}
+
+static void print_cost(const char *p_name, const bench_cost_t *p_cost, uint32_t ui32_divider, const char *p_end)
+{
+  printf("      \"%s\": { \"pixels\": %u, \"window_commands\": %u, \"fill_calls\": %u, \"glyphs\": %u, "
+      "\"formatted_strings\": %u, \"" BENCH_BUS_CYCLES "\": %u, \"bus_us\": %llu }%s\n",
+      p_name,
+      p_cost->ui32_pixels / ui32_divider,
+      p_cost->ui32_window_commands / ui32_divider,
+      p_cost->ui32_fills / ui32_divider,
+      p_cost->ui32_glyphs / ui32_divider,
+      p_cost->ui32_formats / ui32_divider,
+      p_cost->ui32_bus_cycles / ui32_divider,
+      (unsigned long long) (p_cost->ui64_bus_us / ui32_divider),
+      p_end);
+}
+
+static bool run_scenario(const bench_scenario_t *p_scenario, bool last)
+{
+  bench_cost_t start, before, after, frame, total, max;
+  uint32_t ui32_tick = 0;
+  uint32_t ui32_carried;
+  bool pass;
+
+  memset(&max, 0, sizeof(max));
+
+  bench_motor_data();
+
+  // without warm up, the cost of showing the screen is part of the first frame
+  if (p_scenario->ui32_warmup_ticks)
+    screenShow(p_scenario->p_screen);
+
+  for (; ui32_tick < p_scenario->ui32_warmup_ticks; ui32_tick++)
+  {
+    ui32_msecs += HOST_MSEC_PER_TICK;
+    if (p_scenario->tick_warmup)
+      p_scenario->tick(ui32_tick);
+    screen_clock();
+  }
+
+  cost_now(&start);
+  after = start; // a scenario of no ticks costs nothing
+  ui32_carried = screenCarriedUpdates;
+
+  for (uint32_t i = 0; i < p_scenario->ui32_ticks; i++, ui32_tick++)
+  {
+    ui32_msecs += HOST_MSEC_PER_TICK;
+
+    cost_now(&before);
+    if (i == 0 && !p_scenario->ui32_warmup_ticks)
+      screenShow(p_scenario->p_screen);
+    if (p_scenario->tick)
+      p_scenario->tick(ui32_tick);
+    screen_clock();
+    cost_now(&after);
+
+    cost_sub(&frame, &after, &before);
+    cost_max(&max, &frame);
+  }
+
+  cost_sub(&total, &after, &start);
+  pass = !cost_over(&max, &p_scenario->max_frame);
+
+  printf("    {\n");
+  printf("      \"name\": \"%s\",\n", p_scenario->p_name);
+  printf("      \"frames\": %u,\n", p_scenario->ui32_ticks);
+  print_cost("total", &total, 1, ",");
+  print_cost("avg_frame", &total, p_scenario->ui32_ticks, ",");
+  print_cost("max_frame", &max, 1, ",");
+  print_cost("threshold", &p_scenario->max_frame, 1, ",");
+  printf("      \"carried_updates\": %u,\n", screenCarriedUpdates - ui32_carried);
+  printf("      \"pass\": %s\n", pass ? "true" : "false");
+  printf("    }%s\n", last ? "" : ",");
+
+  return pass;
+}
+
+static const char* screen_name(const Screen *p_screen)
+{
+  if (p_screen == &mainScreen)
+    return "main";
+  if (p_screen == &configScreen)
+    return "config";
+#ifdef SW102
+  if (p_screen == &infoScreen)
+    return "info";
+#endif
+  return "?";
+}
+
+static void run_transitions(void)
+{
+  const char *p_separator = "";
+
+  printf("  \"transitions\": [\n");
+
+  for (uint32_t i = 0; screens[i]; i++)
+  {
+    for (uint32_t j = 0; screens[j]; j++)
+    {
+      bench_cost_t before, after, frame;
+
+      if (i == j)
+        continue;
+
+      // the screen left has been drawn and settled
+      screenShow(screens[i]);
+      for (uint32_t ui32_tick = 0; ui32_tick < 10; ui32_tick++)
+      {
+        ui32_msecs += HOST_MSEC_PER_TICK;
+        screen_clock();
+      }
+
+      uint32_t ui32_cleared = screenClearedPixels;
+      cost_now(&before);
+      screenShow(screens[j]); // draws the new screen at once
+      cost_now(&after);
+      cost_sub(&frame, &after, &before);
+      ui32_cleared = screenClearedPixels - ui32_cleared;
+
+      printf("%s    { \"from\": \"%s\", \"to\": \"%s\", \"cleared_pixels\": %u, \"whole_screen_pixels\": %u, "
+          "\"frame_pixels\": %u, \"" BENCH_BUS_CYCLES "\": %u }",
+          p_separator, screen_name(screens[i]), screen_name(screens[j]), ui32_cleared,
+          SCREEN_WIDTH * SCREEN_HEIGHT, frame.ui32_pixels, frame.ui32_bus_cycles);
+      p_separator = ",\n";
+    }
+  }
+
+  printf("\n  ],\n");
+}
+
+int main(void)
+{
+  const uint32_t ui32_num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+  bool pass = true;
+
+  eeprom_init();
+  host_lcd_init();
+
+  printf("{\n");
+  printf("  \"target\": \"" BENCH_TARGET "\",\n");
+  printf("  \"msec_per_frame\": %u,\n", HOST_MSEC_PER_TICK);
+  printf("  \"scenarios\": [\n");
+
+  for (uint32_t i = 0; i < ui32_num_scenarios; i++)
+    pass &= run_scenario(&scenarios[i], i == ui32_num_scenarios - 1);
+
+  printf("  ],\n");
+  run_transitions();
+  printf("  \"pass\": %s\n", pass ? "true" : "false");
+  printf("}\n");
+
+  return pass ? 0 : 1;
+}
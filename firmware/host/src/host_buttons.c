@@ -0,0 +1,139 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Scripted buttons, seen by the common buttons.c through the GPIO (850C) or PollButton (SW102) stubs
+
+#include <stdio.h>
+#include <string.h>
+#include "host.h"
+
+#define MAX_SCRIPT_PRESSES 256
+
+typedef struct
+{
+  uint32_t ui32_tick;
+  uint32_t ui32_ticks_held;
+  host_button_t button;
+} host_press_t;
+
+static host_press_t presses[MAX_SCRIPT_PRESSES];
+static uint32_t ui32_num_presses;
+static uint8_t ui8_pressed;
+
+static bool parse_button(const char *p_name, host_button_t *p_button)
+{
+  if (!strcmp(p_name, "onoff") || !strcmp(p_name, "pwr"))
+    *p_button = HOST_BUTTON_ONOFF;
+  else if (!strcmp(p_name, "up"))
+    *p_button = HOST_BUTTON_UP;
+  else if (!strcmp(p_name, "down"))
+    *p_button = HOST_BUTTON_DOWN;
+  else if (!strcmp(p_name, "m"))
+    *p_button = HOST_BUTTON_M;
+  else
+    return false;
+
+  return true;
+}
+
+bool host_buttons_load(const char *p_path)
+{
+  FILE *p_file = fopen(p_path, "r");
+  char line[128];
+  uint32_t ui32_line = 0;
+
+  if (!p_file)
+  {
+    perror(p_path);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), p_file))
+  {
+    host_press_t press;
+    char name[16];
+
+    ui32_line++;
+    if (line[strspn(line, " \t\r\n")] == '#' || line[strspn(line, " \t\r\n")] == 0)
+      continue;
+
+    if (sscanf(line, "%u %15s %u", &press.ui32_tick, name, &press.ui32_ticks_held) != 3 ||
+        !parse_button(name, &press.button) ||
+        ui32_num_presses == MAX_SCRIPT_PRESSES)
+    {
+      fprintf(stderr, "%s:%u: bad button line\n", p_path, ui32_line);
+      fclose(p_file);
+      return false;
+    }
+
+    presses[ui32_num_presses++] = press;
+  }
+
+  fclose(p_file);
+  return true;
+}
+
+void host_buttons_tick(uint32_t ui32_tick)
+{
+  ui8_pressed = 0;
+
+  for (uint32_t i = 0; i < ui32_num_presses; i++)
+  {
+    if (ui32_tick >= presses[i].ui32_tick &&
+        ui32_tick < presses[i].ui32_tick + presses[i].ui32_ticks_held)
+      ui8_pressed |= presses[i].button;
+  }
+}
+
+bool host_button_pressed(host_button_t button)
+{
+  return (ui8_pressed & button) != 0;
+}
+
+#ifndef SW102
+#include "stm32f10x.h"
+#include "stm32f10x_gpio.h"
+#include "pins.h"
+
+GPIO_TypeDef host_gpioa = { 0 }, host_gpiob = { 1 }, host_gpioc = { 2 };
+
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+  bool pressed = false;
+
+  if (GPIOx == BUTTON_ONOFF__PORT && GPIO_Pin == BUTTON_ONOFF__PIN)
+    pressed = host_button_pressed(HOST_BUTTON_ONOFF);
+  else if (GPIOx == BUTTON_UP__PORT && GPIO_Pin == BUTTON_UP__PIN)
+    pressed = host_button_pressed(HOST_BUTTON_UP);
+  else if (GPIOx == BUTTON_DOWN__PORT && GPIO_Pin == BUTTON_DOWN__PIN)
+    pressed = host_button_pressed(HOST_BUTTON_DOWN);
+
+  // the buttons pull the pins low
+  return pressed ? 0 : 1;
+}
+#else
+#include "button.h"
+#include "main.h"
+
+Button buttonM = { BUTTON_ACTIVE_LOW, BUTTON_M__PIN };
+Button buttonDWN = { BUTTON_ACTIVE_LOW, BUTTON_DOWN__PIN };
+Button buttonUP = { BUTTON_ACTIVE_LOW, BUTTON_UP__PIN };
+Button buttonPWR = { BUTTON_ACTIVE_LOW, BUTTON_PWR__PIN };
+
+bool PollButton(Button* button)
+{
+  if (button == &buttonM)
+    return host_button_pressed(HOST_BUTTON_M);
+  if (button == &buttonDWN)
+    return host_button_pressed(HOST_BUTTON_DOWN);
+  if (button == &buttonUP)
+    return host_button_pressed(HOST_BUTTON_UP);
+  if (button == &buttonPWR)
+    return host_button_pressed(HOST_BUTTON_ONOFF);
+
+  return false;
+}
+#endif
@@ -0,0 +1,160 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Checks the CRC16 implementations of common/src/crc16.c against the bitwise crc16() the firmware
+ * used before, for every CRC state and every byte, then times them.
+ *
+ *   -n <bytes>   bytes to run through each implementation for the timing (default 10000000)
+ *
+ * Exits with 1 if an implementation doesn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include "crc16.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER
+#endif
+
+typedef uint16_t (*crc16_update_fn)(uint16_t ui16_crc, uint8_t ui8_data);
+
+static const struct
+{
+  const char *p_name;
+  crc16_update_fn update;
+} implementations[] =
+{
+  { "bitwise", crc16_update_bitwise },
+  { "nibble_table", crc16_update_nibble_table },
+  { "byte_table", crc16_update_byte_table },
+  { "crc16_update", crc16_update },
+};
+
+#define IMPLEMENTATIONS (sizeof(implementations) / sizeof(implementations[0]))
+
+// the crc16() of utils.c this replaced
+static void crc16_reference(uint8_t ui8_data, uint16_t *ui16_crc)
+{
+  unsigned int i;
+
+  *ui16_crc = *ui16_crc ^ (uint16_t) ui8_data;
+  for (i = 8; i > 0; i--)
+  {
+    if (*ui16_crc & 0x0001)
+      *ui16_crc = (*ui16_crc >> 1) ^ 0xA001;
+    else
+      *ui16_crc >>= 1;
+  }
+}
+
+static uint32_t equivalence(void)
+{
+  uint32_t ui32_failures = 0;
+
+  for (uint32_t ui32_crc = 0; ui32_crc <= 0xffff; ui32_crc++)
+  {
+    for (uint32_t ui32_byte = 0; ui32_byte <= 0xff; ui32_byte++)
+    {
+      uint16_t ui16_expected = ui32_crc;
+
+      crc16_reference(ui32_byte, &ui16_expected);
+
+      for (uint8_t i = 0; i < IMPLEMENTATIONS; i++)
+      {
+        uint16_t ui16_crc = implementations[i].update(ui32_crc, ui32_byte);
+
+        if (ui16_crc != ui16_expected && ui32_failures++ < 10)
+          printf("FAIL: %s(0x%04x, 0x%02x) is 0x%04x, expected 0x%04x\n",
+              implementations[i].p_name, ui32_crc, ui32_byte, ui16_crc, ui16_expected);
+      }
+    }
+  }
+
+  // and a whole buffer, the "123456789" check value of CRC-16/MODBUS
+  if (crc16_buffer(CRC16_INIT, (const uint8_t*) "123456789", 9) != 0x4b37)
+  {
+    printf("FAIL: crc16_buffer() check value\n");
+    ui32_failures++;
+  }
+
+  return ui32_failures;
+}
+
+static void timing(uint32_t ui32_bytes)
+{
+  static uint8_t data[4096];
+
+  for (uint32_t i = 0; i < sizeof(data); i++)
+    data[i] = (uint8_t) (i * 131 + 7);
+
+  for (uint8_t i = 0; i < IMPLEMENTATIONS; i++)
+  {
+    crc16_update_fn update = implementations[i].update;
+    volatile uint16_t ui16_sink;
+    uint16_t ui16_crc = CRC16_INIT;
+    struct timespec start, end;
+#ifdef HAVE_CYCLE_COUNTER
+    uint64_t ui64_cycles = __rdtsc();
+#endif
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t j = 0; j < ui32_bytes; j++)
+      ui16_crc = update(ui16_crc, data[j & (sizeof(data) - 1)]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef HAVE_CYCLE_COUNTER
+    ui64_cycles = __rdtsc() - ui64_cycles;
+#endif
+    ui16_sink = ui16_crc;
+    (void) ui16_sink;
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%-13s %6.2f ns/byte", implementations[i].p_name, ns / ui32_bytes);
+#ifdef HAVE_CYCLE_COUNTER
+    printf(" %6.2f TSC cycles/byte", (double) ui64_cycles / ui32_bytes);
+#endif
+    printf("\n");
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_bytes = 10000000;
+  uint32_t ui32_failures;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_bytes = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n bytes]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  ui32_failures = equivalence();
+  if (ui32_failures)
+  {
+    printf("%u failures\n", ui32_failures);
+    return 1;
+  }
+
+  printf("all implementations match for every CRC and byte\n");
+
+  if (ui32_bytes)
+    timing(ui32_bytes);
+
+  return 0;
+}
@@ -0,0 +1,473 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * FDS stand-in: records in the virtual pages of the SW102 sdk_config.h, one flash operation at a
+ * time from a queue, each taking the nRF51 flash time of the words it writes and the pages it
+ * erases. A record's data is read when its write is done, not when it is queued, as FDS does.
+ * Record deletes are done at once and have no event.
+ */
+
+#include <string.h>
+#include "fds.h"
+#include "nrf_soc.h"
+#include "host.h"
+
+#define VIRTUAL_PAGES     3   // FDS_VIRTUAL_PAGES, one is the GC swap page
+#define DATA_PAGES        (VIRTUAL_PAGES - 1)
+#define PAGE_WORDS        256 // FDS_VIRTUAL_PAGE_SIZE
+#define PAGE_TAG_WORDS    2
+#define HEADER_WORDS      3
+#define MAX_RECORD_WORDS  (PAGE_WORDS - PAGE_TAG_WORDS - HEADER_WORDS)
+#define MAX_RECORDS       64
+#define OP_QUEUE_SIZE     4   // FDS_OP_QUEUE_SIZE
+#define MAX_USERS         8
+
+// nRF51 product specification, approximate
+#define WRITE_WORD_US     45
+#define ERASE_PAGE_US     22300
+
+typedef struct
+{
+  bool used; // written, dirty or not, until a GC of its page
+  bool valid;
+  uint8_t ui8_page;
+  uint16_t ui16_file_id;
+  uint16_t ui16_key;
+  uint32_t ui32_record_id;
+  uint16_t ui16_words;
+  uint32_t ui32_data[MAX_RECORD_WORDS];
+} record_t;
+
+typedef enum
+{
+  OP_INIT,
+  OP_WRITE,
+  OP_UPDATE,
+  OP_GC
+} op_type_t;
+
+typedef struct
+{
+  op_type_t type;
+  bool started;
+  uint64_t ui64_done_us;
+  uint32_t ui32_record_id;
+  uint32_t ui32_old_record_id;
+  uint16_t ui16_file_id;
+  uint16_t ui16_key;
+  uint8_t ui8_page;
+  const uint32_t *p_data;
+  uint16_t ui16_words;
+} op_t;
+
+static record_t records[MAX_RECORDS];
+static uint16_t ui16_page_used[DATA_PAGES]; // words, with the ones reserved by queued writes
+static op_t ops[OP_QUEUE_SIZE]; // ops[0] is the one in progress
+static uint8_t ui8_ops;
+static fds_cb_t users[MAX_USERS];
+static uint8_t ui8_users;
+static uint64_t ui64_now_us;
+static uint64_t ui64_flash_free_us; // when the operation in progress is done
+static uint32_t ui32_next_record_id;
+static bool initialized;
+static host_fds_counters_t counters;
+
+void host_fds_reset(void)
+{
+  memset(records, 0, sizeof(records));
+  memset(ui16_page_used, 0, sizeof(ui16_page_used));
+  memset(&counters, 0, sizeof(counters));
+  ui8_ops = 0;
+  ui8_users = 0;
+  ui64_now_us = 0;
+  ui64_flash_free_us = 0;
+  ui32_next_record_id = 1;
+  initialized = false;
+}
+
+uint64_t host_fds_now_us(void)
+{
+  return ui64_now_us;
+}
+
+void host_fds_counters(host_fds_counters_t *p_counters)
+{
+  *p_counters = counters;
+}
+
+static record_t* find_record(uint32_t ui32_record_id)
+{
+  for (uint8_t i = 0; i < MAX_RECORDS; i++)
+  {
+    if (records[i].used && records[i].valid && records[i].ui32_record_id == ui32_record_id)
+      return &records[i];
+  }
+
+  return NULL;
+}
+
+static bool page_dirty(uint8_t ui8_page)
+{
+  for (uint8_t i = 0; i < MAX_RECORDS; i++)
+  {
+    if (records[i].used && !records[i].valid && records[i].ui8_page == ui8_page)
+      return true;
+  }
+
+  return false;
+}
+
+static uint16_t page_valid_words(uint8_t ui8_page)
+{
+  uint16_t ui16_words = 0;
+
+  for (uint8_t i = 0; i < MAX_RECORDS; i++)
+  {
+    if (records[i].used && records[i].valid && records[i].ui8_page == ui8_page)
+      ui16_words += HEADER_WORDS + records[i].ui16_words;
+  }
+
+  return ui16_words;
+}
+
+// flash time of an operation, from the state when it starts
+static uint32_t op_duration_us(const op_t *p_op)
+{
+  uint32_t ui32_us = 0;
+
+  switch (p_op->type)
+  {
+    case OP_INIT:
+      return 1000;
+
+    case OP_WRITE:
+      return (HEADER_WORDS + p_op->ui16_words) * WRITE_WORD_US;
+
+    case OP_UPDATE:
+      // and the old record header is marked dirty
+      return (HEADER_WORDS + p_op->ui16_words + 1) * WRITE_WORD_US;
+
+    case OP_GC:
+      // every page with dirty records: copy the valid ones to the swap page, erase the old page
+      for (uint8_t ui8_page = 0; ui8_page < DATA_PAGES; ui8_page++)
+      {
+        if (page_dirty(ui8_page))
+          ui32_us += (page_valid_words(ui8_page) + PAGE_TAG_WORDS) * WRITE_WORD_US + ERASE_PAGE_US;
+      }
+      return ui32_us;
+  }
+
+  return 0;
+}
+
+static void send_event(const fds_evt_t *p_evt)
+{
+  for (uint8_t i = 0; i < ui8_users; i++)
+    users[i](p_evt);
+}
+
+static void complete(const op_t *p_op)
+{
+  fds_evt_t evt;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.result = FDS_SUCCESS;
+
+  switch (p_op->type)
+  {
+    case OP_INIT:
+      initialized = true;
+      evt.id = FDS_EVT_INIT;
+      break;
+
+    case OP_WRITE:
+    case OP_UPDATE:
+      for (uint8_t i = 0; i < MAX_RECORDS; i++)
+      {
+        record_t *p_record = &records[i];
+
+        if (p_record->used)
+          continue;
+
+        p_record->used = true;
+        p_record->valid = true;
+        p_record->ui8_page = p_op->ui8_page;
+        p_record->ui16_file_id = p_op->ui16_file_id;
+        p_record->ui16_key = p_op->ui16_key;
+        p_record->ui32_record_id = p_op->ui32_record_id;
+        p_record->ui16_words = p_op->ui16_words;
+        memcpy(p_record->ui32_data, p_op->p_data, p_op->ui16_words * sizeof(uint32_t));
+        break;
+      }
+
+      if (p_op->type == OP_UPDATE)
+      {
+        record_t *p_old = find_record(p_op->ui32_old_record_id);
+
+        if (p_old)
+          p_old->valid = false;
+      }
+
+      counters.ui32_writes++;
+      counters.ui32_words_written += HEADER_WORDS + p_op->ui16_words;
+      evt.id = p_op->type == OP_WRITE ? FDS_EVT_WRITE : FDS_EVT_UPDATE;
+      evt.write.record_id = p_op->ui32_record_id;
+      evt.write.file_id = p_op->ui16_file_id;
+      evt.write.record_key = p_op->ui16_key;
+      evt.write.is_record_updated = p_op->type == OP_UPDATE;
+      break;
+
+    case OP_GC:
+      for (uint8_t ui8_page = 0; ui8_page < DATA_PAGES; ui8_page++)
+      {
+        if (!page_dirty(ui8_page))
+          continue;
+
+        uint16_t ui16_valid = page_valid_words(ui8_page);
+
+        for (uint8_t i = 0; i < MAX_RECORDS; i++)
+        {
+          if (records[i].used && !records[i].valid && records[i].ui8_page == ui8_page)
+          {
+            records[i].used = false;
+            ui16_page_used[ui8_page] -= HEADER_WORDS + records[i].ui16_words;
+          }
+        }
+
+        counters.ui32_words_written += ui16_valid + PAGE_TAG_WORDS;
+        counters.ui32_page_erases++;
+      }
+
+      counters.ui32_gcs++;
+      evt.id = FDS_EVT_GC;
+      break;
+  }
+
+  send_event(&evt);
+}
+
+// Run the operations done by ui64_until_us, their events see the time they were done at
+static void run_until(uint64_t ui64_until_us)
+{
+  while (ui8_ops)
+  {
+    op_t op;
+
+    if (!ops[0].started)
+    {
+      ops[0].started = true;
+      ops[0].ui64_done_us = (ui64_flash_free_us > ui64_now_us ? ui64_flash_free_us : ui64_now_us) +
+          op_duration_us(&ops[0]);
+    }
+
+    if (ops[0].ui64_done_us > ui64_until_us)
+      break;
+
+    op = ops[0];
+    memmove(&ops[0], &ops[1], (ui8_ops - 1) * sizeof(op_t));
+    ui8_ops--;
+
+    ui64_now_us = op.ui64_done_us;
+    ui64_flash_free_us = op.ui64_done_us;
+    complete(&op);
+  }
+
+  if (ui64_until_us > ui64_now_us)
+    ui64_now_us = ui64_until_us;
+}
+
+void host_fds_advance(uint32_t ui32_us)
+{
+  run_until(ui64_now_us + ui32_us);
+}
+
+uint32_t sd_app_evt_wait(void)
+{
+  if (ui8_ops)
+  {
+    // sleep until the operation in progress is done
+    run_until(ui64_now_us);
+    if (ui8_ops)
+      run_until(ops[0].ui64_done_us);
+  }
+  else
+    run_until(ui64_now_us + 1000); // or the next timer interrupt
+
+  return 0;
+}
+
+static op_t* enqueue(op_type_t type)
+{
+  op_t *p_op;
+
+  if (ui8_ops == OP_QUEUE_SIZE)
+    return NULL;
+
+  p_op = &ops[ui8_ops++];
+  memset(p_op, 0, sizeof(*p_op));
+  p_op->type = type;
+  return p_op;
+}
+
+ret_code_t fds_register(fds_cb_t cb)
+{
+  if (ui8_users == MAX_USERS)
+    return FDS_ERR_NO_SPACE_IN_QUEUES;
+
+  users[ui8_users++] = cb;
+  return FDS_SUCCESS;
+}
+
+ret_code_t fds_init(void)
+{
+  return enqueue(OP_INIT) ? FDS_SUCCESS : FDS_ERR_NO_SPACE_IN_QUEUES;
+}
+
+static ret_code_t enqueue_write(op_type_t type, fds_record_desc_t * const p_desc, fds_record_t const * const p_record)
+{
+  uint16_t ui16_words = p_record->data.p_chunks[0].length_words;
+  uint8_t ui8_page;
+  op_t *p_op;
+
+  if (!initialized)
+    return FDS_ERR_NOT_INITIALIZED;
+  if (p_record->data.num_chunks != 1)
+    return FDS_ERR_INVALID_ARG;
+  if (ui16_words > MAX_RECORD_WORDS)
+    return FDS_ERR_RECORD_TOO_LARGE;
+  if (ui8_ops == OP_QUEUE_SIZE)
+    return FDS_ERR_NO_SPACE_IN_QUEUES;
+
+  // the space is reserved when the write is queued
+  for (ui8_page = 0; ui8_page < DATA_PAGES; ui8_page++)
+  {
+    if (PAGE_WORDS - PAGE_TAG_WORDS - ui16_page_used[ui8_page] >= HEADER_WORDS + ui16_words)
+      break;
+  }
+
+  if (ui8_page == DATA_PAGES)
+    return FDS_ERR_NO_SPACE_IN_FLASH;
+
+  ui16_page_used[ui8_page] += HEADER_WORDS + ui16_words;
+
+  p_op = enqueue(type);
+  p_op->ui8_page = ui8_page;
+  p_op->ui16_file_id = p_record->file_id;
+  p_op->ui16_key = p_record->key;
+  p_op->p_data = p_record->data.p_chunks[0].p_data;
+  p_op->ui16_words = ui16_words;
+  p_op->ui32_old_record_id = p_desc->record_id;
+  p_op->ui32_record_id = ui32_next_record_id++;
+
+  // the descriptor is the new record's from now on
+  memset(p_desc, 0, sizeof(*p_desc));
+  p_desc->record_id = p_op->ui32_record_id;
+  return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_write(fds_record_desc_t * const p_desc, fds_record_t const * const p_record)
+{
+  return enqueue_write(OP_WRITE, p_desc, p_record);
+}
+
+ret_code_t fds_record_update(fds_record_desc_t * const p_desc, fds_record_t const * const p_record)
+{
+  return enqueue_write(OP_UPDATE, p_desc, p_record);
+}
+
+ret_code_t fds_record_delete(fds_record_desc_t * const p_desc)
+{
+  record_t *p_record = find_record(p_desc->record_id);
+
+  if (!p_record)
+    return FDS_ERR_NOT_FOUND;
+
+  p_record->valid = false;
+  return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t * const p_desc,
+    fds_find_token_t * const p_token)
+{
+  if (!initialized)
+    return FDS_ERR_NOT_INITIALIZED;
+
+  // the token is the index of the next record to look at
+  for (uint16_t i = p_token->page; i < MAX_RECORDS; i++)
+  {
+    if (records[i].used && records[i].valid && records[i].ui16_file_id == file_id && records[i].ui16_key == record_key)
+    {
+      memset(p_desc, 0, sizeof(*p_desc));
+      p_desc->record_id = records[i].ui32_record_id;
+      p_token->page = i + 1;
+      return FDS_SUCCESS;
+    }
+  }
+
+  p_token->page = MAX_RECORDS;
+  return FDS_ERR_NOT_FOUND;
+}
+
+ret_code_t fds_record_open(fds_record_desc_t * const p_desc, fds_flash_record_t * const p_flash_record)
+{
+  record_t *p_record = find_record(p_desc->record_id);
+
+  if (!p_record)
+    return FDS_ERR_NOT_FOUND;
+
+  p_flash_record->p_header = NULL;
+  p_flash_record->p_data = p_record->ui32_data;
+  p_desc->record_is_open = true;
+  return FDS_SUCCESS;
+}
+
+ret_code_t fds_record_close(fds_record_desc_t * const p_desc)
+{
+  p_desc->record_is_open = false;
+  return FDS_SUCCESS;
+}
+
+ret_code_t fds_gc(void)
+{
+  if (!initialized)
+    return FDS_ERR_NOT_INITIALIZED;
+
+  return enqueue(OP_GC) ? FDS_SUCCESS : FDS_ERR_NO_SPACE_IN_QUEUES;
+}
+
+ret_code_t fds_stat(fds_stat_t * const p_stat)
+{
+  memset(p_stat, 0, sizeof(*p_stat));
+
+  if (!initialized)
+    return FDS_ERR_NOT_INITIALIZED;
+
+  for (uint8_t i = 0; i < MAX_RECORDS; i++)
+  {
+    if (!records[i].used)
+      continue;
+
+    if (records[i].valid)
+      p_stat->valid_records++;
+    else
+    {
+      p_stat->dirty_records++;
+      p_stat->freeable_words += HEADER_WORDS + records[i].ui16_words;
+    }
+  }
+
+  for (uint8_t ui8_page = 0; ui8_page < DATA_PAGES; ui8_page++)
+  {
+    uint16_t ui16_free = PAGE_WORDS - PAGE_TAG_WORDS - ui16_page_used[ui8_page];
+
+    p_stat->words_used += ui16_page_used[ui8_page];
+    if (ui16_free > p_stat->largest_contig)
+      p_stat->largest_contig = ui16_free;
+  }
+
+  return FDS_SUCCESS;
+}
@@ -0,0 +1,259 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Saves settings through the SW102 save queue (SW102/src/sw102/eeprom_hw.c) on the FDS stand-in of
+ * host_fds.c, from a 20 ms main loop, and measures how long each save stalls the loop. The same
+ * saves then go through the flash_write_words() the queue replaced, which ran a GC and waited for
+ * it and for the write. The saves come in bursts, several in the same tick, as when leaving the
+ * configuration screens.
+ *
+ *   -n <saves>   saves in each run (default 300)
+ *
+ * After every tick the record in flash must be a whole save, not older than the one seen before,
+ * and after the power off flush it must be the last save. Exits with 1 on a failure or if a save
+ * through the queue stalls the loop for a tick or more.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include "eeprom_hw.h"
+#include "eeprom.h"
+#include "fds.h"
+#include "nrf_soc.h"
+#include "host.h"
+#include "host_test.h"
+
+#define WORDS (sizeof(eeprom_data_t) / sizeof(uint32_t))
+
+#define FILE_ID     0x1001 // of eeprom_hw.c
+#define REC_KEY     0x2002
+
+#define TICK_US     (HOST_MSEC_PER_TICK * 1000)
+
+bool useSoftDevice = true;
+
+void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info)
+{
+  printf("FAIL: APP_ERROR 0x%x\n", id);
+  exit(1);
+}
+
+typedef bool (*save_fn)(const void *value, uint16_t length_words);
+
+typedef struct
+{
+  uint32_t ui32_saves;
+  uint64_t ui64_stall_max_us;
+  uint64_t ui64_stall_total_us;
+  uint32_t ui32_ticks_missed;
+  uint64_t ui64_flush_us;
+  host_fds_counters_t counters;
+} run_result_t;
+
+// Save number ui32_save: the number, then words that can only come from that save
+static void fill_save(uint32_t *p_words, uint32_t ui32_save)
+{
+  p_words[0] = ui32_save;
+  for (uint32_t i = 1; i < WORDS; i++)
+    p_words[i] = ui32_save * 2654435761u + i;
+}
+
+// The save in flash, -1 if there is none and -2 if it isn't a whole save
+static int32_t save_in_flash(void)
+{
+  fds_record_desc_t desc;
+  fds_find_token_t token;
+  fds_flash_record_t flash_record;
+  uint32_t words[WORDS];
+
+  memset(&token, 0, sizeof(token));
+  if (fds_record_find(FILE_ID, REC_KEY, &desc, &token) != FDS_SUCCESS)
+    return -1;
+
+  fds_record_open(&desc, &flash_record);
+  memcpy(words, flash_record.p_data, sizeof(words));
+  fds_record_close(&desc);
+
+  fill_save(words, words[0]); // what it should be
+  return memcmp(words, flash_record.p_data, sizeof(words)) == 0 ? (int32_t) words[0] : -2;
+}
+
+static void run(const char *p_name, save_fn save, run_result_t *p_result, uint32_t ui32_saves)
+{
+  uint32_t words[WORDS];
+  uint32_t ui32_save = 0;
+  uint32_t ui32_next_tick = 1;
+  int32_t i32_seen = -1;
+
+  memset(p_result, 0, sizeof(*p_result));
+
+  for (uint32_t ui32_tick = 0; ui32_save < ui32_saves; ui32_tick++)
+  {
+    // the loop sleeps until the next tick, the FDS events come meanwhile
+    host_fds_advance(TICK_US);
+
+    while (ui32_tick == ui32_next_tick && ui32_save < ui32_saves)
+    {
+      uint64_t ui64_start = host_fds_now_us();
+
+      fill_save(words, ui32_save);
+      CHECK(save(words, WORDS), "%s: save %u", p_name, ui32_save);
+
+      uint64_t ui64_stall = host_fds_now_us() - ui64_start;
+      if (ui64_stall > p_result->ui64_stall_max_us)
+        p_result->ui64_stall_max_us = ui64_stall;
+      p_result->ui64_stall_total_us += ui64_stall;
+      p_result->ui32_ticks_missed += ui64_stall / TICK_US;
+
+      // eeprom.c keeps changing the data it saved
+      memset(words, 0x5a, sizeof(words));
+
+      // bursts of 4 saves: 3 in a tick, 1 in the next, then a pause
+      ui32_save++;
+      if (ui32_save % 4 == 3)
+        ui32_next_tick++;
+      else if (ui32_save % 4 == 0)
+        ui32_next_tick += 30 + (ui32_save * 37) % 200;
+    }
+
+    int32_t i32_flash = save_in_flash();
+    CHECK(i32_flash != -2, "%s: tick %u, the record in flash is not a whole save", p_name, ui32_tick);
+    CHECK(i32_flash >= i32_seen, "%s: tick %u, save %d in flash after save %d", p_name, ui32_tick, i32_flash, i32_seen);
+    i32_seen = i32_flash;
+  }
+
+  // power off
+  uint64_t ui64_start = host_fds_now_us();
+  CHECK(flash_flush(), "%s: flush", p_name);
+  p_result->ui64_flush_us = host_fds_now_us() - ui64_start;
+
+  CHECK(save_in_flash() == (int32_t) ui32_saves - 1, "%s: save %d in flash after the power off, expected %u",
+      p_name, save_in_flash(), ui32_saves - 1);
+
+  host_fds_counters(&p_result->counters);
+}
+
+static void print_result(const char *p_name, const run_result_t *p_result, uint32_t ui32_saves)
+{
+  printf("%-13s stall max %6.1f ms mean %6.2f ms, %3u ticks missed, power off wait %5.1f ms, "
+      "%u FDS writes, %u GCs, %u page erases\n",
+      p_name, p_result->ui64_stall_max_us / 1000.0, p_result->ui64_stall_total_us / 1000.0 / ui32_saves,
+      p_result->ui32_ticks_missed, p_result->ui64_flush_us / 1000.0, p_result->counters.ui32_writes,
+      p_result->counters.ui32_gcs, p_result->counters.ui32_page_erases);
+}
+
+// The flash_write_words() of eeprom_hw.c before the save queue
+static volatile bool gc_done, init_done, write_done;
+
+static void legacy_evt_handler(fds_evt_t const *const evt)
+{
+  switch (evt->id)
+  {
+    case FDS_EVT_INIT:
+      init_done = true;
+      break;
+    case FDS_EVT_GC:
+      gc_done = true;
+      break;
+    case FDS_EVT_UPDATE:
+    case FDS_EVT_WRITE:
+      write_done = true;
+      break;
+    default:
+      break;
+  }
+}
+
+static bool legacy_wait_gc(void)
+{
+  gc_done = false;
+  fds_gc();
+  for (volatile int count = 0; count < 1000 && !gc_done; count++)
+    sd_app_evt_wait();
+  return gc_done;
+}
+
+static bool legacy_flash_write_words(const void *value, uint16_t length_words)
+{
+  fds_record_t record;
+  fds_record_desc_t record_desc;
+  fds_record_chunk_t record_chunk;
+  fds_find_token_t ftok;
+
+  legacy_wait_gc();
+
+  memset(&record_desc, 0x00, sizeof(record_desc));
+  memset(&ftok, 0x00, sizeof(ftok));
+  bool has_old = fds_record_find(FILE_ID, REC_KEY, &record_desc, &ftok) == FDS_SUCCESS;
+
+  record_chunk.p_data = value;
+  record_chunk.length_words = length_words;
+  record.file_id = FILE_ID;
+  record.key = REC_KEY;
+  record.data.p_chunks = &record_chunk;
+  record.data.num_chunks = 1;
+
+  write_done = false;
+  if (has_old)
+    fds_record_update(&record_desc, &record);
+  else
+    fds_record_write(&record_desc, &record);
+
+  for (volatile int count = 0; count < 1000 && !write_done; count++)
+    sd_app_evt_wait();
+
+  return write_done;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_saves = 300;
+  run_result_t queue, legacy;
+  uint32_t words[WORDS];
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_saves = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n saves]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  // the old flash_write_words() waited for the flash itself, so the flush has nothing left to do
+  host_fds_reset();
+  fds_register(legacy_evt_handler);
+  fds_init();
+  while (!init_done)
+    sd_app_evt_wait();
+  run("wait for GC", legacy_flash_write_words, &legacy, ui32_saves);
+
+  host_fds_reset();
+  eeprom_hw_init();
+  CHECK(!flash_read_words(words, WORDS), "read of a blank flash");
+  run("save queue", flash_write_words, &queue, ui32_saves);
+
+  print_result("wait for GC", &legacy, ui32_saves);
+  print_result("save queue", &queue, ui32_saves);
+
+  CHECK(queue.ui64_stall_max_us < TICK_US, "a save through the queue stalled the main loop %.1f ms",
+      queue.ui64_stall_max_us / 1000.0);
+
+  if (host_test_failed())
+    return 1;
+
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,436 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Checks the division free math of common/src/fixmath.c against /: the divisions by constants for
+ * every 16 bit value and round the multiples above (-x for every 32 bit value, a minute or two),
+ * fixmath_mulhi_parts() against a 64 bit multiply, and the reciprocals for
+ * every divisor up to 65536 and samples of the bigger ones. Then the layer_2() filters of state.c
+ * as they were, with /, and as they are, on fixmath.c, run side by side on random motor packets
+ * and must agree bit for bit. Last, the divisions are timed both ways. The host has a divide
+ * instruction, so the timing says little about the Cortex-M0, where / is a call to __aeabi_uidiv.
+ *
+ *   -n <values>  values to divide for the timing (default 10000000)
+ *   -t <ticks>   100ms ticks of random packets for the layer_2() filters (default 1000000)
+ *   -x           the constants for every 32 bit value
+ *
+ * Exits with 1 if a result doesn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <time.h>
+#include "fixmath.h"
+#include "host_test.h"
+
+// xorshift, repeatable runs
+static uint32_t ui32_seed = 2463534242u;
+
+static uint32_t random32(void)
+{
+  ui32_seed ^= ui32_seed << 13;
+  ui32_seed ^= ui32_seed >> 17;
+  ui32_seed ^= ui32_seed << 5;
+  return ui32_seed;
+}
+
+typedef struct
+{
+  const char *p_name;
+  uint32_t (*div)(uint32_t);
+  uint32_t ui32_divisor;
+} constant_t;
+
+static const constant_t constants[] =
+{
+  { "fixmath_div10", fixmath_div10, 10 },
+  { "fixmath_div20", fixmath_div20, 20 },
+  { "fixmath_div25", fixmath_div25, 25 },
+  { "fixmath_div36", fixmath_div36, 36 },
+  { "fixmath_div50", fixmath_div50, 50 },
+  { "fixmath_div500", fixmath_div500, 500 },
+  { "fixmath_div1000", fixmath_div1000, 1000 },
+  { "fixmath_div100000", fixmath_div100000, 100000 },
+};
+
+#define CONSTANTS (sizeof(constants) / sizeof(constants[0]))
+
+static void check_constant(const constant_t *p_constant, uint32_t ui32_value)
+{
+  uint32_t ui32_q = p_constant->div(ui32_value);
+
+  if (ui32_q != ui32_value / p_constant->ui32_divisor)
+    CHECK(false, "%s(%u) is %u", p_constant->p_name, ui32_value, ui32_q);
+}
+
+static void check_constants(bool every)
+{
+  if (every)
+  {
+    uint32_t ui32_value = 0;
+    do
+    {
+      for (uint8_t i = 0; i < CONSTANTS; i++)
+        check_constant(&constants[i], ui32_value);
+    } while (++ui32_value);
+
+    printf("constants: every 32 bit value\n");
+    return;
+  }
+
+  for (uint32_t ui32_value = 0; ui32_value <= 0xffff; ui32_value++)
+    for (uint8_t i = 0; i < CONSTANTS; i++)
+      check_constant(&constants[i], ui32_value);
+
+  // where they go wrong first if they do: round the multiples, and at the top
+  for (uint8_t i = 0; i < CONSTANTS; i++)
+  {
+    uint32_t ui32_divisor = constants[i].ui32_divisor;
+    for (uint32_t j = 0; j < 1000000; j++)
+    {
+      uint32_t ui32_multiple = (random32() / ui32_divisor) * ui32_divisor;
+      check_constant(&constants[i], ui32_multiple);
+      check_constant(&constants[i], ui32_multiple - 1);
+      check_constant(&constants[i], ui32_multiple + ui32_divisor - 1);
+      check_constant(&constants[i], 0xffffffff - j);
+    }
+  }
+
+  printf("constants: every 16 bit value, 4000000 samples of the rest\n");
+}
+
+static void check_mulhi_parts(void)
+{
+  static const uint32_t edges[] = { 0, 1, 0xffff, 0x10000, 0x7fffffff, 0x80000000, 0xfffffffe, 0xffffffff };
+
+  for (uint8_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    for (uint8_t j = 0; j < sizeof(edges) / sizeof(edges[0]); j++)
+      CHECK(fixmath_mulhi_parts(edges[i], edges[j]) == (uint32_t) (((uint64_t) edges[i] * edges[j]) >> 32),
+          "fixmath_mulhi_parts(0x%x, 0x%x)", edges[i], edges[j]);
+
+  for (uint32_t i = 0; i < 100000000; i++)
+  {
+    uint32_t ui32_a = random32(), ui32_b = random32();
+    // half of them with the low halves all ones, for the carries
+    if (i & 1)
+    {
+      ui32_a |= 0xffff;
+      ui32_b |= 0xffff;
+    }
+
+    if (fixmath_mulhi_parts(ui32_a, ui32_b) != (uint32_t) (((uint64_t) ui32_a * ui32_b) >> 32))
+      CHECK(false, "fixmath_mulhi_parts(0x%x, 0x%x)", ui32_a, ui32_b);
+  }
+
+  printf("fixmath_mulhi_parts: 100000000 random pairs\n");
+}
+
+static void check_recip_values(uint32_t ui32_divisor)
+{
+  fixmath_recip_t recip = { 0 };
+  uint32_t values[8] = { 0, ui32_divisor - 1, ui32_divisor, 0xffffffff, 0xffffffff - ui32_divisor };
+
+  fixmath_recip_set(&recip, ui32_divisor);
+  for (uint8_t i = 5; i < 8; i++)
+  {
+    uint32_t ui32_multiple = (random32() / ui32_divisor) * ui32_divisor;
+    values[i] = i == 7 ? random32() : ui32_multiple - (i & 1);
+  }
+
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint32_t ui32_q = fixmath_recip_div(&recip, values[i]);
+    if (ui32_q != values[i] / ui32_divisor)
+      CHECK(false, "fixmath_recip_div(%u) by %u is %u", values[i], ui32_divisor, ui32_q);
+  }
+}
+
+static void check_recip(void)
+{
+  for (uint32_t ui32_divisor = 1; ui32_divisor <= 65536; ui32_divisor++)
+    check_recip_values(ui32_divisor);
+
+  for (uint8_t ui8_bit = 16; ui8_bit < 32; ui8_bit++)
+  {
+    check_recip_values((1u << ui8_bit) - 1);
+    check_recip_values(1u << ui8_bit);
+    check_recip_values((1u << ui8_bit) + 1);
+  }
+  check_recip_values(0xffffffff);
+
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    uint32_t ui32_divisor = random32() >> (random32() & 31);
+    if (ui32_divisor)
+      check_recip_values(ui32_divisor);
+  }
+
+  // a new divisor takes, the same one again changes nothing
+  fixmath_recip_t recip = { 0 };
+  fixmath_recip_set(&recip, 7);
+  fixmath_recip_set(&recip, 7);
+  CHECK(fixmath_recip_div(&recip, 700) == 100, "reciprocal of 7 set twice");
+  fixmath_recip_set(&recip, 1);
+  CHECK(fixmath_recip_div(&recip, 700) == 700, "reciprocal of 1 after 7");
+
+  printf("reciprocals: every divisor up to 65536 and 1000000 random ones\n");
+}
+
+// The layer_2() filters of state.c, with the l2_vars and l3_vars fields they use
+typedef struct
+{
+  // in, from the motor packets and the settings
+  uint16_t ui16_adc_battery_voltage;
+  uint8_t ui8_battery_current_x5;
+  uint16_t ui16_pedal_torque_x10;
+  uint16_t ui16_pedal_power_x10;
+  uint16_t ui16_battery_pack_resistance_x1000;
+  uint32_t ui32_wh_x10_100_percent;
+  // filter state and out
+  uint32_t ui32_battery_voltage_accumulated_x10000;
+  uint16_t ui16_battery_current_accumulated_x5;
+  uint32_t ui32_pedal_torque_accumulated;
+  uint32_t ui32_pedal_power_accumulated;
+  uint16_t ui16_battery_voltage_filtered_x10;
+  uint16_t ui16_battery_current_filtered_x5;
+  uint16_t ui16_battery_power_filtered_x50;
+  uint16_t ui16_battery_power_filtered;
+  uint16_t ui16_pedal_torque_filtered;
+  uint16_t ui16_pedal_power_filtered;
+  uint16_t ui16_battery_voltage_soc_x10;
+  uint32_t ui32_wh_sum_x5;
+  uint32_t ui32_wh_sum_counter;
+  uint32_t ui32_wh_x10;
+  uint32_t ui32_soc;
+  fixmath_recip_t wh_x10_100_percent;
+} filters_t;
+
+// of state.h
+#define ADC_BATTERY_VOLTAGE_PER_ADC_STEP_X10000 866
+#define BATTERY_VOLTAGE_FILTER_COEFFICIENT 3
+#define BATTERY_CURRENT_FILTER_COEFFICIENT 2
+#define PEDAL_TORQUE_FILTER_COEFFICIENT    2
+#define PEDAL_POWER_FILTER_COEFFICIENT     3
+
+// what was there, with /, then what is there
+static void filters_div(filters_t *p, uint32_t ui32_tick)
+{
+  p->ui32_battery_voltage_accumulated_x10000 -= p->ui32_battery_voltage_accumulated_x10000 >> BATTERY_VOLTAGE_FILTER_COEFFICIENT;
+  p->ui32_battery_voltage_accumulated_x10000 += (uint32_t) p->ui16_adc_battery_voltage * ADC_BATTERY_VOLTAGE_PER_ADC_STEP_X10000;
+  p->ui16_battery_voltage_filtered_x10 = ((uint32_t) (p->ui32_battery_voltage_accumulated_x10000 >> BATTERY_VOLTAGE_FILTER_COEFFICIENT)) / 1000;
+  p->ui16_battery_current_accumulated_x5 -= p->ui16_battery_current_accumulated_x5 >> BATTERY_CURRENT_FILTER_COEFFICIENT;
+  p->ui16_battery_current_accumulated_x5 += (uint16_t) p->ui8_battery_current_x5;
+  p->ui16_battery_current_filtered_x5 = p->ui16_battery_current_accumulated_x5 >> BATTERY_CURRENT_FILTER_COEFFICIENT;
+  p->ui16_battery_power_filtered_x50 = p->ui16_battery_current_filtered_x5 * p->ui16_battery_voltage_filtered_x10;
+  p->ui16_battery_power_filtered = p->ui16_battery_power_filtered_x50 / 50;
+  if (p->ui16_battery_power_filtered < 200) { p->ui16_battery_power_filtered /= 10; p->ui16_battery_power_filtered *= 10; }
+  else if (p->ui16_battery_power_filtered < 400) { p->ui16_battery_power_filtered /= 20; p->ui16_battery_power_filtered *= 20; }
+  else { p->ui16_battery_power_filtered /= 25; p->ui16_battery_power_filtered *= 25; }
+
+  p->ui32_pedal_torque_accumulated -= p->ui32_pedal_torque_accumulated >> PEDAL_TORQUE_FILTER_COEFFICIENT;
+  p->ui32_pedal_torque_accumulated += (uint32_t) p->ui16_pedal_torque_x10 / 10;
+  p->ui16_pedal_torque_filtered = p->ui32_pedal_torque_accumulated >> PEDAL_TORQUE_FILTER_COEFFICIENT;
+  p->ui32_pedal_power_accumulated -= p->ui32_pedal_power_accumulated >> PEDAL_POWER_FILTER_COEFFICIENT;
+  p->ui32_pedal_power_accumulated += (uint32_t) p->ui16_pedal_power_x10 / 10;
+  p->ui16_pedal_power_filtered = p->ui32_pedal_power_accumulated >> PEDAL_POWER_FILTER_COEFFICIENT;
+  if (p->ui16_pedal_torque_filtered > 200) { p->ui16_pedal_torque_filtered /= 20; p->ui16_pedal_torque_filtered *= 20; }
+  else if (p->ui16_pedal_torque_filtered > 100) { p->ui16_pedal_torque_filtered /= 10; p->ui16_pedal_torque_filtered *= 10; }
+  if (p->ui16_pedal_power_filtered > 500) { p->ui16_pedal_power_filtered /= 25; p->ui16_pedal_power_filtered *= 25; }
+  else if (p->ui16_pedal_power_filtered > 200) { p->ui16_pedal_power_filtered /= 20; p->ui16_pedal_power_filtered *= 20; }
+  else if (p->ui16_pedal_power_filtered > 10) { p->ui16_pedal_power_filtered /= 10; p->ui16_pedal_power_filtered *= 10; }
+
+  p->ui16_battery_voltage_soc_x10 = p->ui16_battery_voltage_filtered_x10
+      + (uint16_t) ((((uint32_t) p->ui16_battery_pack_resistance_x1000) * ((uint32_t) p->ui16_battery_current_filtered_x5)) / ((uint32_t) 500));
+
+  if (p->ui16_battery_power_filtered_x50 > 0)
+  {
+    p->ui32_wh_sum_x5 += p->ui16_battery_power_filtered_x50 / 10;
+    p->ui32_wh_sum_counter++;
+  }
+  if (ui32_tick % 10 == 0 && p->ui32_wh_sum_counter)
+    p->ui32_wh_x10 = ((p->ui32_wh_sum_counter / 36) * (p->ui32_wh_sum_x5 / p->ui32_wh_sum_counter)) / 500;
+
+  p->ui32_soc = p->ui32_wh_x10 * 100;
+  p->ui32_soc = p->ui32_wh_x10_100_percent > 0 ? p->ui32_soc / p->ui32_wh_x10_100_percent : 0;
+}
+
+static void filters_fixmath(filters_t *p, uint32_t ui32_tick)
+{
+  p->ui32_battery_voltage_accumulated_x10000 -= p->ui32_battery_voltage_accumulated_x10000 >> BATTERY_VOLTAGE_FILTER_COEFFICIENT;
+  p->ui32_battery_voltage_accumulated_x10000 += (uint32_t) p->ui16_adc_battery_voltage * ADC_BATTERY_VOLTAGE_PER_ADC_STEP_X10000;
+  p->ui16_battery_voltage_filtered_x10 = fixmath_div1000(p->ui32_battery_voltage_accumulated_x10000 >> BATTERY_VOLTAGE_FILTER_COEFFICIENT);
+  p->ui16_battery_current_accumulated_x5 -= p->ui16_battery_current_accumulated_x5 >> BATTERY_CURRENT_FILTER_COEFFICIENT;
+  p->ui16_battery_current_accumulated_x5 += (uint16_t) p->ui8_battery_current_x5;
+  p->ui16_battery_current_filtered_x5 = p->ui16_battery_current_accumulated_x5 >> BATTERY_CURRENT_FILTER_COEFFICIENT;
+  p->ui16_battery_power_filtered_x50 = p->ui16_battery_current_filtered_x5 * p->ui16_battery_voltage_filtered_x10;
+  p->ui16_battery_power_filtered = fixmath_div50(p->ui16_battery_power_filtered_x50);
+  if (p->ui16_battery_power_filtered < 200) p->ui16_battery_power_filtered = fixmath_div10(p->ui16_battery_power_filtered) * 10;
+  else if (p->ui16_battery_power_filtered < 400) p->ui16_battery_power_filtered = fixmath_div20(p->ui16_battery_power_filtered) * 20;
+  else p->ui16_battery_power_filtered = fixmath_div25(p->ui16_battery_power_filtered) * 25;
+
+  p->ui32_pedal_torque_accumulated -= p->ui32_pedal_torque_accumulated >> PEDAL_TORQUE_FILTER_COEFFICIENT;
+  p->ui32_pedal_torque_accumulated += fixmath_div10(p->ui16_pedal_torque_x10);
+  p->ui16_pedal_torque_filtered = p->ui32_pedal_torque_accumulated >> PEDAL_TORQUE_FILTER_COEFFICIENT;
+  p->ui32_pedal_power_accumulated -= p->ui32_pedal_power_accumulated >> PEDAL_POWER_FILTER_COEFFICIENT;
+  p->ui32_pedal_power_accumulated += fixmath_div10(p->ui16_pedal_power_x10);
+  p->ui16_pedal_power_filtered = p->ui32_pedal_power_accumulated >> PEDAL_POWER_FILTER_COEFFICIENT;
+  if (p->ui16_pedal_torque_filtered > 200) p->ui16_pedal_torque_filtered = fixmath_div20(p->ui16_pedal_torque_filtered) * 20;
+  else if (p->ui16_pedal_torque_filtered > 100) p->ui16_pedal_torque_filtered = fixmath_div10(p->ui16_pedal_torque_filtered) * 10;
+  if (p->ui16_pedal_power_filtered > 500) p->ui16_pedal_power_filtered = fixmath_div25(p->ui16_pedal_power_filtered) * 25;
+  else if (p->ui16_pedal_power_filtered > 200) p->ui16_pedal_power_filtered = fixmath_div20(p->ui16_pedal_power_filtered) * 20;
+  else if (p->ui16_pedal_power_filtered > 10) p->ui16_pedal_power_filtered = fixmath_div10(p->ui16_pedal_power_filtered) * 10;
+
+  p->ui16_battery_voltage_soc_x10 = p->ui16_battery_voltage_filtered_x10
+      + (uint16_t) fixmath_div500(((uint32_t) p->ui16_battery_pack_resistance_x1000) * ((uint32_t) p->ui16_battery_current_filtered_x5));
+
+  if (p->ui16_battery_power_filtered_x50 > 0)
+  {
+    p->ui32_wh_sum_x5 += fixmath_div10(p->ui16_battery_power_filtered_x50);
+    p->ui32_wh_sum_counter++;
+  }
+  if (ui32_tick % 10 == 0 && p->ui32_wh_sum_counter)
+    p->ui32_wh_x10 = fixmath_div500(fixmath_div36(p->ui32_wh_sum_counter) * (p->ui32_wh_sum_x5 / p->ui32_wh_sum_counter));
+
+  p->ui32_soc = p->ui32_wh_x10 * 100;
+  if (p->ui32_wh_x10_100_percent > 0)
+  {
+    fixmath_recip_set(&p->wh_x10_100_percent, p->ui32_wh_x10_100_percent);
+    p->ui32_soc = fixmath_recip_div(&p->wh_x10_100_percent, p->ui32_soc);
+  }
+  else
+    p->ui32_soc = 0;
+}
+
+#define SAME(field) (a.field == b.field)
+
+static void check_filters(uint32_t ui32_ticks)
+{
+  filters_t a = { 0 }, b = { 0 };
+
+  for (uint32_t ui32_tick = 0; ui32_tick < ui32_ticks; ui32_tick++)
+  {
+    // a new packet every tick, settings that change now and then, the full ranges of the fields
+    a.ui16_adc_battery_voltage = random32() & 0x3ff;
+    a.ui8_battery_current_x5 = random32();
+    a.ui16_pedal_torque_x10 = random32();
+    a.ui16_pedal_power_x10 = random32();
+    if (ui32_tick % 1000 == 0)
+    {
+      a.ui16_battery_pack_resistance_x1000 = random32();
+      a.ui32_wh_x10_100_percent = ui32_tick % 3000 ? random32() >> (random32() & 31) : 0;
+    }
+
+    b.ui16_adc_battery_voltage = a.ui16_adc_battery_voltage;
+    b.ui8_battery_current_x5 = a.ui8_battery_current_x5;
+    b.ui16_pedal_torque_x10 = a.ui16_pedal_torque_x10;
+    b.ui16_pedal_power_x10 = a.ui16_pedal_power_x10;
+    b.ui16_battery_pack_resistance_x1000 = a.ui16_battery_pack_resistance_x1000;
+    b.ui32_wh_x10_100_percent = a.ui32_wh_x10_100_percent;
+
+    filters_div(&a, ui32_tick);
+    filters_fixmath(&b, ui32_tick);
+
+    if (!(SAME(ui16_battery_voltage_filtered_x10) && SAME(ui16_battery_current_filtered_x5)
+        && SAME(ui16_battery_power_filtered_x50) && SAME(ui16_battery_power_filtered)
+        && SAME(ui16_pedal_torque_filtered) && SAME(ui16_pedal_power_filtered)
+        && SAME(ui16_battery_voltage_soc_x10) && SAME(ui32_wh_sum_x5) && SAME(ui32_wh_x10) && SAME(ui32_soc)))
+    {
+      CHECK(false, "the layer_2() filters differ at tick %u", ui32_tick);
+      a = b; // one failure per difference, not every tick after it
+    }
+  }
+
+  printf("layer_2() filters: %u ticks bit exact\n", ui32_ticks);
+}
+
+static double elapsed_ns(const struct timespec *p_start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - p_start->tv_sec) * 1e9 + (now.tv_nsec - p_start->tv_nsec);
+}
+
+// the divisor goes through a volatile so the compiler can't make / a multiply too
+static void timing(uint32_t ui32_values)
+{
+  volatile uint32_t ui32_divisor_1000 = 1000;
+  volatile uint32_t ui32_sink = 0;
+  uint32_t ui32_divisor = ui32_divisor_1000, ui32_sum = 0;
+  fixmath_recip_t recip = { 0 };
+  struct timespec start;
+  double div_ns, fixmath_ns, recip_ns;
+
+  fixmath_recip_set(&recip, ui32_divisor);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_values; i++)
+  {
+    ui32_sum += (i * 2654435761u) / ui32_divisor;
+    ui32_divisor = ui32_divisor_1000;
+  }
+  div_ns = elapsed_ns(&start) / ui32_values;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_values; i++)
+    ui32_sum += fixmath_div1000(i * 2654435761u);
+  fixmath_ns = elapsed_ns(&start) / ui32_values;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_values; i++)
+    ui32_sum += fixmath_recip_div(&recip, i * 2654435761u);
+  recip_ns = elapsed_ns(&start) / ui32_values;
+
+  ui32_sink += ui32_sum;
+  printf("/ 1000 on the host: / %.2f ns, fixmath_div1000 %.2f ns, fixmath_recip_div %.2f ns\n",
+      div_ns, fixmath_ns, recip_ns);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_values = 10000000;
+  uint32_t ui32_ticks = 1000000;
+  bool every = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:x")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_values = strtoul(optarg, NULL, 0);
+        break;
+
+      case 't':
+        ui32_ticks = strtoul(optarg, NULL, 0);
+        break;
+
+      case 'x':
+        every = true;
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n values] [-t ticks] [-x]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  check_mulhi_parts();
+  check_constants(every);
+  check_recip();
+  check_filters(ui32_ticks);
+
+  if (host_test_failed())
+    return 1;
+
+  if (ui32_values)
+    timing(ui32_values);
+
+  printf("all checks passed\n");
+  return 0;
+}
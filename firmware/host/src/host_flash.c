@@ -0,0 +1,76 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Fake flash behind eeprom_hw.h: a single record kept in RAM and optionally in a file
+
+#include <stdio.h>
+#include <string.h>
+#include "eeprom_hw.h"
+#include "host.h"
+
+#define FLASH_WORDS 256
+
+static uint32_t flash[FLASH_WORDS];
+static uint16_t ui16_flash_length_words; // 0 when blank
+static const char *p_flash_file;
+
+void host_flash_set_file(const char *p_path)
+{
+  p_flash_file = p_path;
+}
+
+void eeprom_hw_init(void)
+{
+  FILE *p_file;
+  size_t words;
+
+  ui16_flash_length_words = 0;
+
+  if (!p_flash_file || !(p_file = fopen(p_flash_file, "rb")))
+    return;
+
+  words = fread(flash, sizeof(uint32_t), FLASH_WORDS, p_file);
+  ui16_flash_length_words = words;
+  fclose(p_file);
+}
+
+bool flash_read_words(void *dest, uint16_t length_words)
+{
+  if (length_words == 0 || length_words != ui16_flash_length_words)
+    return false;
+
+  memcpy(dest, flash, length_words * sizeof(uint32_t));
+  return true;
+}
+
+bool flash_write_words(const void *value, uint16_t length_words)
+{
+  FILE *p_file;
+
+  if (length_words > FLASH_WORDS)
+    return false;
+
+  memcpy(flash, value, length_words * sizeof(uint32_t));
+  ui16_flash_length_words = length_words;
+
+  if (!p_flash_file)
+    return true;
+
+  if (!(p_file = fopen(p_flash_file, "wb")))
+  {
+    perror(p_flash_file);
+    return false;
+  }
+
+  fwrite(flash, sizeof(uint32_t), length_words, p_file);
+  fclose(p_file);
+  return true;
+}
+
+bool flash_flush(void)
+{
+  return true;
+}
@@ -0,0 +1,316 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Runs the 850C key/value store (850C/src/flash_kv.c) on a simulated pair of STM32F103 flash
+ * pages. The simulation only programs erased halfwords (or writes 0x0000), like the PGERR check of
+ * the real flash, and counts the erases and the bytes programmed.
+ *
+ *   -n <saves>   saves of the wear run, a few words changed in each, as at every power off (default 2000)
+ *   -c <saves>   saves of the power cut run (default 300): each save is cut after every possible
+ *                flash operation, then after a reboot the settings must be all the old or all the
+ *                new ones, and the store must keep working
+ *
+ * The wear run is compared with the format it replaced, which erased a page and programmed a
+ * halfword per byte on every save. Exits with 1 on a failure.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include "flash_kv.h"
+#include "eeprom.h"
+#include "host_test.h"
+
+#define WORDS (sizeof(eeprom_data_t) / sizeof(uint32_t))
+
+// STM32F103 datasheet: typical halfword program time and minimum page erase time
+#define PROGRAM_HALFWORD_US 52.5
+#define ERASE_PAGE_US       20000.0
+
+// what a save cost before flash_kv.c: an erase, the data, the key, the magic and the write id
+#define LEGACY_SAVE_HALFWORDS (sizeof(eeprom_data_t) + 3)
+
+static uint8_t flash[FLASH_KV_PAGES][FLASH_KV_PAGE_SIZE];
+static uint32_t ui32_erases[FLASH_KV_PAGES];
+static uint32_t ui32_programmed_halfwords;
+static uint32_t ui32_violations;
+static bool locked = true;
+
+static int32_t i32_power_cut = -1; // flash operations left until the power is lost, -1 for never
+static bool power_lost;
+
+// false if the power is lost before the operation completes
+static bool flash_operation(void)
+{
+  if (power_lost)
+    return false;
+
+  if (i32_power_cut >= 0 && i32_power_cut-- == 0)
+  {
+    power_lost = true;
+    return false;
+  }
+
+  return true;
+}
+
+const uint8_t* flash_kv_hw_page(uint8_t ui8_page)
+{
+  return flash[ui8_page];
+}
+
+void flash_kv_hw_unlock(void)
+{
+  locked = false;
+}
+
+void flash_kv_hw_lock(void)
+{
+  locked = true;
+}
+
+static bool program_halfword(uint8_t ui8_page, uint16_t ui16_offset, uint16_t ui16_data)
+{
+  uint16_t *p_halfword = (uint16_t*) &flash[ui8_page][ui16_offset];
+
+  if (locked || ui8_page >= FLASH_KV_PAGES || ui16_offset >= FLASH_KV_PAGE_SIZE || (ui16_offset & 1) ||
+      (*p_halfword != 0xffff && ui16_data != 0))
+  {
+    ui32_violations++;
+    return false;
+  }
+
+  if (!flash_operation())
+  {
+    // cut part way, some of the bits are programmed
+    *p_halfword &= ui16_data | 0xaaaa;
+    return false;
+  }
+
+  *p_halfword = ui16_data;
+  ui32_programmed_halfwords++;
+  return true;
+}
+
+bool flash_kv_hw_program_word(uint8_t ui8_page, uint16_t ui16_offset, uint32_t ui32_data)
+{
+  return program_halfword(ui8_page, ui16_offset, ui32_data) &&
+      program_halfword(ui8_page, ui16_offset + 2, ui32_data >> 16);
+}
+
+bool flash_kv_hw_erase(uint8_t ui8_page)
+{
+  if (locked || ui8_page >= FLASH_KV_PAGES)
+  {
+    ui32_violations++;
+    return false;
+  }
+
+  if (!flash_operation())
+  {
+    // cut part way, only some of the page is erased
+    memset(flash[ui8_page], 0xff, FLASH_KV_PAGE_SIZE / 2);
+    return false;
+  }
+
+  memset(flash[ui8_page], 0xff, FLASH_KV_PAGE_SIZE);
+  ui32_erases[ui8_page]++;
+  return true;
+}
+
+static void power_on(void)
+{
+  i32_power_cut = -1;
+  power_lost = false;
+  flash_kv_init(0);
+}
+
+static void reset_flash(void)
+{
+  memset(flash, 0xff, sizeof(flash));
+  memset(ui32_erases, 0, sizeof(ui32_erases));
+  ui32_programmed_halfwords = 0;
+  power_on();
+}
+
+// The next settings: the odometer and the energy counters change on every ride, a config
+// value from time to time
+static void next_settings(uint32_t *p_words, uint32_t ui32_save)
+{
+  p_words[WORDS - 1] += 1 + ui32_save % 7;
+  if (ui32_save % 3 == 0)
+    p_words[WORDS / 2] += 25;
+  if (ui32_save % 40 == 0)
+    p_words[(ui32_save / 40) % WORDS] ^= 0x00010000;
+  if (ui32_save % 97 == 0)
+    p_words[(ui32_save / 97 + 5) % WORDS] = 0xffffffff;
+}
+
+static bool read_equals(const uint32_t *p_words)
+{
+  uint32_t words[WORDS];
+
+  return flash_kv_read(words, WORDS) && memcmp(words, p_words, sizeof(words)) == 0;
+}
+
+static void basics(void)
+{
+  uint32_t words[WORDS], read[WORDS + 2];
+
+  reset_flash();
+  CHECK(!flash_kv_read(read, WORDS), "read of a blank flash");
+
+  for (uint32_t i = 0; i < WORDS; i++)
+    words[i] = i * 0x01010101;
+
+  CHECK(flash_kv_write(words, WORDS), "first save");
+  CHECK(read_equals(words), "read after the first save");
+  power_on();
+  CHECK(read_equals(words), "read after a reboot");
+
+  uint32_t ui32_programmed = ui32_programmed_halfwords;
+  CHECK(flash_kv_write(words, WORDS), "save without changes");
+  CHECK(ui32_programmed_halfwords == ui32_programmed, "a save without changes programmed %u halfwords",
+      ui32_programmed_halfwords - ui32_programmed);
+
+  // words that were never saved read as erased flash
+  CHECK(flash_kv_read(read, WORDS + 2) && read[WORDS] == 0xffffffff && read[WORDS + 1] == 0xffffffff,
+      "words after the saved ones");
+
+  CHECK(!flash_kv_write(words, FLASH_KV_KEYS + 1), "save of more words than keys");
+  CHECK(ui32_violations == 0, "%u flash violations", ui32_violations);
+}
+
+static void wear(uint32_t ui32_saves)
+{
+  uint32_t words[WORDS];
+
+  memset(words, 0, sizeof(words));
+  reset_flash();
+
+  for (uint32_t ui32_save = 0; ui32_save < ui32_saves; ui32_save++)
+  {
+    next_settings(words, ui32_save);
+    CHECK(flash_kv_write(words, WORDS), "save %u", ui32_save);
+
+    if (ui32_save % 11 == 0)
+      power_on();
+    CHECK(read_equals(words), "read after save %u", ui32_save);
+  }
+
+  CHECK(ui32_violations == 0, "%u flash violations", ui32_violations);
+
+  uint32_t ui32_erases_total = ui32_erases[0] + ui32_erases[1];
+  double kv_us = ui32_programmed_halfwords * PROGRAM_HALFWORD_US + ui32_erases_total * ERASE_PAGE_US;
+  double legacy_us = ui32_saves * (LEGACY_SAVE_HALFWORDS * PROGRAM_HALFWORD_US + ERASE_PAGE_US);
+
+  printf("wear: %u saves of %u words\n", ui32_saves, (unsigned) WORDS);
+  printf("  key/value store: %u + %u erases, %u bytes programmed, %.0f us of flash time per save\n",
+      ui32_erases[0], ui32_erases[1], ui32_programmed_halfwords * 2, kv_us / ui32_saves);
+  printf("  old format:      %u erases, %u bytes programmed, %.0f us of flash time per save\n",
+      ui32_saves, (unsigned) (ui32_saves * LEGACY_SAVE_HALFWORDS * 2), legacy_us / ui32_saves);
+  printf("  %.1fx fewer erases, %.1fx less flash time\n",
+      (double) ui32_saves / (ui32_erases_total ? ui32_erases_total : 1), legacy_us / kv_us);
+}
+
+static void power_cuts(uint32_t ui32_saves)
+{
+  static uint8_t image[FLASH_KV_PAGES][FLASH_KV_PAGE_SIZE];
+  uint32_t words[WORDS], next[WORDS], after[WORDS];
+  bool saved = false; // nothing to read before the first save
+  uint32_t ui32_cuts = 0, ui32_old = 0, ui32_new = 0;
+
+  memset(words, 0, sizeof(words));
+  reset_flash();
+
+  for (uint32_t ui32_save = 0; ui32_save < ui32_saves; ui32_save++)
+  {
+    memcpy(next, words, sizeof(next));
+    next_settings(next, ui32_save);
+    memcpy(image, flash, sizeof(image));
+
+    for (int32_t i32_cut = 0; ; i32_cut++)
+    {
+      memcpy(flash, image, sizeof(image));
+      power_on();
+      i32_power_cut = i32_cut;
+      bool ok = flash_kv_write(next, WORDS);
+      bool cut = power_lost;
+
+      if (!cut)
+      {
+        CHECK(ok, "save %u without a cut", ui32_save);
+        break;
+      }
+
+      ui32_cuts++;
+      CHECK(!ok, "save %u cut after %d operations reported success", ui32_save, i32_cut);
+
+      power_on();
+      if (read_equals(next))
+        ui32_new++;
+      else if (saved ? read_equals(words) : !flash_kv_read(after, WORDS))
+        ui32_old++;
+      else
+        CHECK(0, "save %u cut after %d operations: the settings are a mix", ui32_save, i32_cut);
+
+      // and the store keeps working
+      memcpy(after, next, sizeof(after));
+      after[0] ^= 0x5a5a5a5a;
+      CHECK(flash_kv_write(after, WORDS), "save after save %u was cut after %d operations", ui32_save, i32_cut);
+      power_on();
+      CHECK(read_equals(after), "read after save %u was cut after %d operations", ui32_save, i32_cut);
+    }
+
+    memcpy(flash, image, sizeof(image));
+    power_on();
+    CHECK(flash_kv_write(next, WORDS), "save %u", ui32_save);
+    memcpy(words, next, sizeof(words));
+    saved = true;
+  }
+
+  CHECK(ui32_violations == 0, "%u flash violations", ui32_violations);
+  printf("power cuts: %u saves cut at %u points, %u recovered the old settings, %u the new ones\n",
+      ui32_saves, ui32_cuts, ui32_old, ui32_new);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_saves = 2000;
+  uint32_t ui32_cut_saves = 300;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:c:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_saves = strtoul(optarg, NULL, 0);
+        break;
+
+      case 'c':
+        ui32_cut_saves = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n saves] [-c saves]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  basics();
+  if (ui32_saves)
+    wear(ui32_saves);
+  power_cuts(ui32_cut_saves);
+
+  if (host_test_failed())
+    return 1;
+
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,277 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Checks the number formatting of common/src/format.c against the snprintf() formats the screens
+ * used before, for every value of the 8 and 16 bit editables with every div_digits and
+ * hide_fraction, for the strings of mainscreen.c and fault.c, and for samples of the 32 bit
+ * values. The division by 10 under the digits is fixmath_div10(), host_fixmath_test.c checks it.
+ * Then the editable formatting is timed both ways.
+ *
+ *   -n <values>  values to format for the timing (default 10000000)
+ *   -r <values>  random 32 bit values to check for each div_digits and hide_fraction (default 1000000)
+ *
+ * Exits with 1 if a string doesn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include "format.h"
+#include "host_test.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER
+#endif
+
+#define MAX_FIELD_LEN 32 // of screen.h
+
+static uint32_t ui32_strings;
+
+#define CHECK_STRING(p_got, p_expected, ...) \
+  do { ui32_strings++; CHECK(strcmp(p_got, p_expected) == 0, "\"%s\", expected \"%s\": " __VA_ARGS__); } while (0)
+
+// getEditableString() of screen.c before format.c, the int32_t is a long on the ARM targets
+static void editable_snprintf(char *p_out, int32_t i32_num, uint8_t ui8_div_digits, bool hide_fraction)
+{
+  long num = i32_num;
+
+  if (ui8_div_digits == 0)
+    snprintf(p_out, MAX_FIELD_LEN, "%lu", (unsigned long) (uint32_t) num);
+  else
+  {
+    int div = 1;
+    for (uint8_t i = 0; i < ui8_div_digits; i++)
+      div *= 10;
+
+    if (hide_fraction)
+      snprintf(p_out, MAX_FIELD_LEN, "%ld", num / div);
+    else
+      snprintf(p_out, MAX_FIELD_LEN, "%ld.%0*lu", num / div, ui8_div_digits, (unsigned long) (uint32_t) (num % div));
+  }
+}
+
+// getEditableString() now
+static void editable_format(char *p_out, int32_t i32_num, uint8_t ui8_div_digits, bool hide_fraction)
+{
+  if (ui8_div_digits == 0)
+    format_uint(p_out, i32_num, 0, ' ');
+  else
+    format_fixed(p_out, i32_num, ui8_div_digits, hide_fraction ? 0 : ui8_div_digits);
+}
+
+static void check_editable(int32_t i32_num, uint8_t ui8_div_digits, bool hide_fraction)
+{
+  char expected[MAX_FIELD_LEN], got[MAX_FIELD_LEN];
+
+  // a negative fraction came out as "-1.4294967291", format_fixed() shows "-1.5"
+  if (i32_num < 0 && ui8_div_digits && !hide_fraction)
+  {
+    uint32_t ui32_magnitude = 0u - (uint32_t) i32_num;
+    uint32_t div = 1;
+    for (uint8_t i = 0; i < ui8_div_digits; i++)
+      div *= 10;
+
+    snprintf(expected, sizeof(expected), "-%lu.%0*lu", (unsigned long) (ui32_magnitude / div), ui8_div_digits,
+        (unsigned long) (ui32_magnitude % div));
+  }
+  else
+    editable_snprintf(expected, i32_num, ui8_div_digits, hide_fraction);
+
+  editable_format(got, i32_num, ui8_div_digits, hide_fraction);
+  CHECK_STRING(got, expected, "editable %d, div_digits %u, hide_fraction %u", i32_num, ui8_div_digits, hide_fraction);
+}
+
+static void check_editables(uint32_t ui32_random)
+{
+  for (uint8_t ui8_div_digits = 0; ui8_div_digits <= 3; ui8_div_digits++)
+  {
+    for (uint8_t hide_fraction = 0; hide_fraction <= 1; hide_fraction++)
+    {
+      // the sizes of getEditableNumber(): uint8_t, int16_t and the uint16_t values that go through it
+      for (int32_t i32_num = -32768; i32_num <= 65535; i32_num++)
+        check_editable(i32_num, ui8_div_digits, hide_fraction);
+
+      // the 32 bit values, the trip and the odometer
+      const int32_t edges[] = { INT32_MIN, INT32_MIN + 1, -1000000000, -999999999, 999999999, 1000000000, INT32_MAX };
+      for (uint8_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+        check_editable(edges[i], ui8_div_digits, hide_fraction);
+
+      uint32_t ui32_seed = 12345;
+      for (uint32_t i = 0; i < ui32_random; i++)
+      {
+        ui32_seed = ui32_seed * 1664525u + 1013904223u;
+        int32_t i32_num = ui32_seed >> (i % 32); // all the lengths
+        check_editable(i % 7 ? i32_num : -i32_num, ui8_div_digits, hide_fraction);
+      }
+    }
+  }
+
+  printf("editables: every 8 and 16 bit value, %u random 32 bit values, for every div_digits and hide_fraction\n", ui32_random);
+}
+
+// The fieldPrintf() strings of mainscreen.c and fault.c
+static void check_screen_strings(void)
+{
+  char expected[64], got[64];
+  char *p;
+
+  for (uint32_t ui32_value = 0; ui32_value <= 65535; ui32_value++)
+  {
+    // battery_soc()
+    snprintf(expected, sizeof(expected), "%3d%%", (int) ui32_value);
+    format_str(format_uint(got, ui32_value, 3, ' '), "%");
+    CHECK_STRING(got, expected, "soc %u", ui32_value);
+
+    snprintf(expected, sizeof(expected), "%u.%1uV", ui32_value / 10, ui32_value % 10);
+    format_str(format_fixed(got, ui32_value, 1, 1), "V");
+    CHECK_STRING(got, expected, "voltage %u", ui32_value);
+
+    // the boot screen
+    snprintf(expected, sizeof(expected), "Waiting TSDZ2 - (%u.%uV)", ui32_value / 10, ui32_value % 10);
+    format_str(format_fixed(format_str(got, "Waiting TSDZ2 - ("), ui32_value, 1, 1), "V)");
+    CHECK_STRING(got, expected, "boot voltage %u", ui32_value);
+  }
+
+  // time() and trip_time()
+  for (uint32_t ui32_hours = 0; ui32_hours <= 255; ui32_hours++)
+  {
+    for (uint32_t ui32_minutes = 0; ui32_minutes < 60; ui32_minutes++)
+    {
+      snprintf(expected, sizeof(expected), "%d:%02d", ui32_hours, ui32_minutes);
+      p = format_str(format_uint(got, ui32_hours, 0, ' '), ":");
+      format_uint(p, ui32_minutes, 2, '0');
+      CHECK_STRING(got, expected, "time %u:%u", ui32_hours, ui32_minutes);
+    }
+  }
+
+  // widths and signs of format_int()
+  for (int32_t i32_value = -1100; i32_value <= 1100; i32_value++)
+  {
+    for (uint8_t ui8_width = 0; ui8_width <= 8; ui8_width++)
+    {
+      snprintf(expected, sizeof(expected), "%*d", ui8_width, i32_value);
+      format_int(got, i32_value, ui8_width, ' ');
+      CHECK_STRING(got, expected, "%d width %u", i32_value, ui8_width);
+
+      snprintf(expected, sizeof(expected), "%0*d", ui8_width, i32_value);
+      format_int(got, i32_value, ui8_width, '0');
+      CHECK_STRING(got, expected, "%d zero width %u", i32_value, ui8_width);
+    }
+  }
+
+  // app_error_fault_handler()
+  uint32_t ui32_seed = 54321;
+  for (uint32_t i = 0; i < 1000000; i++)
+  {
+    ui32_seed = ui32_seed * 1664525u + 1013904223u;
+    uint32_t ui32_value = i < 16 ? i : ui32_seed >> (i % 32);
+
+    snprintf(expected, sizeof(expected), "0x%lx", (unsigned long) ui32_value);
+    format_hex(format_str(got, "0x"), ui32_value, 0);
+    CHECK_STRING(got, expected, "hex %u", ui32_value);
+
+    snprintf(expected, sizeof(expected), "0x%06lx", (unsigned long) ui32_value);
+    format_hex(format_str(got, "0x"), ui32_value, 6);
+    CHECK_STRING(got, expected, "hex 6 %u", ui32_value);
+
+    snprintf(expected, sizeof(expected), "%08lx", (unsigned long) ui32_value);
+    format_hex(got, ui32_value, 8);
+    CHECK_STRING(got, expected, "hex 8 %u", ui32_value);
+
+    snprintf(expected, sizeof(expected), "%lu", (unsigned long) ui32_value);
+    format_uint(got, ui32_value, 0, ' ');
+    CHECK_STRING(got, expected, "uint %u", ui32_value);
+  }
+  format_uint(got, UINT32_MAX, 0, ' ');
+  CHECK_STRING(got, "4294967295", "UINT32_MAX");
+  format_int(got, INT32_MIN, 0, ' ');
+  CHECK_STRING(got, "-2147483648", "INT32_MIN");
+  format_fixed(got, INT32_MIN, 9, 9);
+  CHECK_STRING(got, "-2.147483648", "INT32_MIN with 9 decimals");
+  format_fixed(got, 7, 9, 9);
+  CHECK_STRING(got, "0.000000007", "7 with 9 decimals");
+
+  printf("screen strings: soc, voltages, times, widths and the fault codes\n");
+}
+
+typedef void (*editable_fn)(char *p_out, int32_t i32_num, uint8_t ui8_div_digits, bool hide_fraction);
+
+// Values as the main screen shows them: speeds and voltages with a decimal, powers and temperatures without
+static void timing(const char *p_name, editable_fn format, uint32_t ui32_values)
+{
+  static const uint8_t div_digits[4] = { 1, 0, 1, 0 };
+  static const bool hide_fraction[4] = { true, false, false, false };
+  char out[MAX_FIELD_LEN];
+  volatile char sink = 0;
+  struct timespec start, end;
+#ifdef HAVE_CYCLE_COUNTER
+  uint64_t ui64_cycles = __rdtsc();
+#endif
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_values; i++)
+  {
+    format(out, (i * 40503u) & 0xfff, div_digits[i & 3], hide_fraction[i & 3]);
+    sink += out[0];
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef HAVE_CYCLE_COUNTER
+  ui64_cycles = __rdtsc() - ui64_cycles;
+#endif
+
+  double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+  printf("%-9s %6.2f ns/value", p_name, ns / ui32_values);
+#ifdef HAVE_CYCLE_COUNTER
+  printf(" %7.2f TSC cycles/value", (double) ui64_cycles / ui32_values);
+#endif
+  printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_values = 10000000;
+  uint32_t ui32_random = 1000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_values = strtoul(optarg, NULL, 0);
+        break;
+
+      case 'r':
+        ui32_random = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n values] [-r values]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  check_editables(ui32_random);
+  check_screen_strings();
+
+  if (host_test_failed())
+    return 1;
+
+  printf("%u strings match\n", ui32_strings);
+
+  if (ui32_values)
+  {
+    timing("snprintf", editable_snprintf, ui32_values);
+    timing("format.c", editable_format, ui32_values);
+  }
+
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,350 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Checks the motor packet framer of the 850C UART (common/src/packet_framer.c) with byte stream
+ * fixtures: packets back to back, garbage and false start bytes before a packet, a bad CRC, a
+ * packet cut off by an idle line, a late reader, a change of the packet length, and then a long
+ * random stream cut into random DMA chunks round the ring, where every whole packet must come out.
+ * Then a writer and a reader thread hammer the three buffers, as the UART interrupt and layer_2()
+ * do, and every packet the reader gets must be whole.
+ *
+ *   -n <packets>  packets in the random stream (default 1000000)
+ *   -t <packets>  packets for the two threads (default 10000000)
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "packet_framer.h"
+#include "motor_packet.h"
+#include "crc16.h"
+#include "host_test.h"
+
+#define RING_SIZE 64 // as usart1.c
+#define LENGTH (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE + UART_NUMBER_CRC_BYTES)
+#define LENGTH_V20 (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 + UART_NUMBER_CRC_BYTES)
+
+// The DMA side: bytes go round the ring and the framer is called as the interrupts would
+typedef struct
+{
+  uint8_t ring[RING_SIZE];
+  uint16_t ui16_head;
+  packet_framer_t framer;
+  uart_rx_stats_t stats;
+} line_t;
+
+static void line_init(line_t *p_line)
+{
+  memset(p_line, 0, sizeof(*p_line));
+  packet_framer_init(&p_line->framer, p_line->ring, RING_SIZE, MOTOR_PACKET_RX_START_BYTE, LENGTH, &p_line->stats);
+}
+
+// ui16_chunk bytes at a time, the half and full transfer interrupts in between, then idle
+static void line_send(line_t *p_line, const uint8_t *p_bytes, uint32_t ui32_count, uint16_t ui16_chunk, bool idle)
+{
+  while (ui32_count)
+  {
+    uint16_t ui16_bytes = ui32_count < ui16_chunk ? ui32_count : ui16_chunk;
+
+    for (uint16_t i = 0; i < ui16_bytes; i++)
+    {
+      p_line->ring[p_line->ui16_head] = *p_bytes++;
+      p_line->ui16_head = (p_line->ui16_head + 1) % RING_SIZE;
+
+      if (p_line->ui16_head % (RING_SIZE / 2) == 0)
+        packet_framer_process(&p_line->framer, p_line->ui16_head, false);
+    }
+
+    ui32_count -= ui16_bytes;
+    packet_framer_process(&p_line->framer, p_line->ui16_head, idle && !ui32_count);
+  }
+}
+
+// The newest packet, which must have the length the framer was set up for
+static const uint8_t* line_get(line_t *p_line)
+{
+  uint8_t ui8_length = 0;
+  const uint8_t *p_packet = packet_framer_get(&p_line->framer, &ui8_length);
+
+  CHECK(!p_packet || ui8_length == LENGTH, "packet of %u bytes", ui8_length);
+  return p_packet;
+}
+
+// Packet ui32_number, its data bytes worked out from the number so a mixed up packet shows
+static void make_packet(uint8_t *p_packet, uint32_t ui32_number)
+{
+  p_packet[0] = MOTOR_PACKET_RX_START_BYTE;
+  for (uint8_t i = 1; i <= UART_NUMBER_DATA_BYTES_TO_RECEIVE; i++)
+    p_packet[i] = (uint8_t) ((ui32_number >> (8 * (i % 4))) + i * 37);
+
+  uint16_t ui16_crc = crc16_buffer(CRC16_INIT, p_packet, LENGTH - UART_NUMBER_CRC_BYTES);
+  p_packet[LENGTH - 2] = ui16_crc & 0xff;
+  p_packet[LENGTH - 1] = ui16_crc >> 8;
+}
+
+static bool is_packet(const uint8_t *p_packet, uint32_t ui32_number)
+{
+  uint8_t expected[LENGTH];
+
+  make_packet(expected, ui32_number);
+  return p_packet && memcmp(p_packet, expected, LENGTH) == 0;
+}
+
+static void check_stats(const line_t *p_line, uint32_t ui32_packets, uint32_t ui32_crc, uint32_t ui32_framing,
+    uint32_t ui32_replaced, const char *p_what)
+{
+  const uart_rx_stats_t *p_stats = &p_line->stats;
+
+  CHECK(p_stats->ui32_packets == ui32_packets && p_stats->ui32_crc_errors == ui32_crc
+      && p_stats->ui32_framing_errors == ui32_framing && p_stats->ui32_replaced == ui32_replaced,
+      "%s: %u packets, %u CRC, %u framing, %u replaced, expected %u %u %u %u", p_what,
+      p_stats->ui32_packets, p_stats->ui32_crc_errors, p_stats->ui32_framing_errors, p_stats->ui32_replaced,
+      ui32_packets, ui32_crc, ui32_framing, ui32_replaced);
+}
+
+static void fixtures(void)
+{
+  static line_t line;
+  uint8_t packet[LENGTH];
+
+  // back to back, read as they come, in chunks of every size
+  line_init(&line);
+  for (uint32_t i = 0; i < 100; i++)
+  {
+    make_packet(packet, i);
+    line_send(&line, packet, LENGTH, 1 + i % LENGTH, true);
+    CHECK(is_packet(line_get(&line), i), "back to back packet %u", i);
+    CHECK(line_get(&line) == NULL, "packet %u read twice", i);
+  }
+  check_stats(&line, 100, 0, 0, 0, "back to back");
+
+  // garbage with false start bytes just before a packet, the false starts reach into it
+  line_init(&line);
+  static const uint8_t garbage[] = { 0x00, 0x43, 0x12, 0x43, 0x43, 0xff, 0x43 };
+  make_packet(packet, 1000);
+  line_send(&line, garbage, sizeof(garbage), sizeof(garbage), false);
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(is_packet(line_get(&line), 1000), "packet after garbage");
+  check_stats(&line, 1, 4, 1, 0, "garbage");
+
+  // a bad CRC, the next packet is good
+  line_init(&line);
+  make_packet(packet, 2000);
+  packet[10] ^= 0x01;
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(line_get(&line) == NULL, "packet with a bad CRC");
+  make_packet(packet, 2001);
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(is_packet(line_get(&line), 2001), "packet after a bad CRC");
+  check_stats(&line, 1, 1, 0, 0, "bad CRC");
+
+  // cut off by an idle line, the next packet comes right after the idle
+  line_init(&line);
+  make_packet(packet, 3000);
+  line_send(&line, packet, 10, 10, true);
+  make_packet(packet, 3001);
+  line_send(&line, packet, LENGTH, 7, true);
+  CHECK(is_packet(line_get(&line), 3001), "packet after a cut off one");
+  check_stats(&line, 1, 0, 1, 0, "cut off");
+
+  // cut off without an idle line, the CRC then fails and the next start byte is found
+  line_init(&line);
+  make_packet(packet, 4000);
+  line_send(&line, packet, 10, 10, false);
+  make_packet(packet, 4001);
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(is_packet(line_get(&line), 4001), "packet after a cut off one without idle");
+  CHECK(line.stats.ui32_packets == 1 && line.stats.ui32_crc_errors >= 1, "cut off without idle");
+
+  // a late reader gets the newest packet
+  line_init(&line);
+  for (uint32_t i = 0; i < 5; i++)
+  {
+    make_packet(packet, 5000 + i);
+    line_send(&line, packet, LENGTH, LENGTH, true);
+  }
+  CHECK(is_packet(line_get(&line), 5004), "newest packet for a late reader");
+  check_stats(&line, 5, 0, 0, 4, "late reader");
+
+  // a V20 motor after the stream version changed, the V19 packet then is one byte short
+  line_init(&line);
+  make_packet(packet, 6000);
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(is_packet(line_get(&line), 6000), "V19 packet before the length change");
+  packet_framer_set_length(&line.framer, LENGTH_V20);
+
+  uint8_t packet_v20[LENGTH_V20];
+  memcpy(packet_v20, packet, LENGTH - UART_NUMBER_CRC_BYTES);
+  packet_v20[LENGTH - UART_NUMBER_CRC_BYTES] = 0x5a;
+  uint16_t ui16_crc = crc16_buffer(CRC16_INIT, packet_v20, LENGTH_V20 - UART_NUMBER_CRC_BYTES);
+  packet_v20[LENGTH_V20 - 2] = ui16_crc & 0xff;
+  packet_v20[LENGTH_V20 - 1] = ui16_crc >> 8;
+
+  line_send(&line, packet, LENGTH, LENGTH, true);
+  CHECK(line_get(&line) == NULL, "V19 packet after the length change");
+  line_send(&line, packet_v20, LENGTH_V20, 5, true);
+  uint8_t ui8_length = 0;
+  const uint8_t *p_packet = packet_framer_get(&line.framer, &ui8_length);
+  CHECK(p_packet && ui8_length == LENGTH_V20 && memcmp(p_packet, packet_v20, LENGTH_V20) == 0,
+      "V20 packet after the length change, %u bytes", ui8_length);
+  check_stats(&line, 2, 0, 1, 0, "length change");
+
+  printf("fixtures: back to back, garbage, bad CRC, cut off packets, late reader, length change\n");
+}
+
+// Packets with noise in between, some damaged, in random chunks
+static void random_stream(uint32_t ui32_packets)
+{
+  static line_t line;
+  uint8_t bytes[LENGTH + 16];
+  uint32_t ui32_seed = 4711;
+  uint32_t ui32_whole = 0, ui32_received = 0;
+
+  line_init(&line);
+
+  for (uint32_t i = 0; i < ui32_packets; i++)
+  {
+    ui32_seed = ui32_seed * 1664525u + 1013904223u;
+    uint32_t ui32_random = ui32_seed;
+    uint8_t ui8_noise = (ui32_random >> 8) % 4 == 0 ? (ui32_random >> 12) % 16 : 0;
+    bool damaged = (ui32_random >> 16) % 16 == 0;
+    bool idle = (ui32_random >> 20) % 2;
+
+    // noise is biased towards start bytes
+    for (uint8_t j = 0; j < ui8_noise; j++)
+    {
+      ui32_seed = ui32_seed * 1664525u + 1013904223u;
+      bytes[j] = (ui32_seed >> 24) & 1 ? MOTOR_PACKET_RX_START_BYTE : ui32_seed >> 16;
+    }
+
+    make_packet(bytes + ui8_noise, i);
+    if (damaged)
+      bytes[ui8_noise + 1 + (ui32_random >> 24) % (LENGTH - 1)] ^= 0x10;
+    else
+      ui32_whole++;
+
+    line_send(&line, bytes, ui8_noise + LENGTH, 1 + (ui32_random >> 26), idle);
+
+    const uint8_t *p_packet = line_get(&line);
+    if (p_packet && is_packet(p_packet, i))
+    {
+      CHECK(!damaged, "random stream packet %u is damaged", i);
+      ui32_received++;
+    }
+  }
+
+  // A start byte in the noise has a 1 in 65536 chance of a good CRC, then the packet it runs into
+  // can be lost. Every other whole packet must come out.
+  uint32_t ui32_false = line.stats.ui32_packets - ui32_received;
+  CHECK(ui32_whole - ui32_received <= ui32_false && ui32_false <= ui32_packets / 10000,
+      "random stream: %u whole packets, %u received, %u false", ui32_whole, ui32_received, ui32_false);
+
+  printf("random stream: %u packets, %u whole, %u received, %u CRC errors, %u framing errors, %u false\n",
+      ui32_packets, ui32_whole, ui32_received, line.stats.ui32_crc_errors, line.stats.ui32_framing_errors, ui32_false);
+}
+
+static line_t thread_line;
+static uint32_t ui32_writer_packets;
+static volatile bool writer_done;
+
+static void* writer(void *p_arg)
+{
+  uint8_t packet[LENGTH];
+
+  (void) p_arg;
+
+  for (uint32_t i = 1; i <= ui32_writer_packets; i++)
+  {
+    make_packet(packet, i);
+    line_send(&thread_line, packet, LENGTH, LENGTH, true);
+  }
+
+  writer_done = true;
+  return NULL;
+}
+
+static void threads(uint32_t ui32_packets)
+{
+  pthread_t writer_thread;
+  uint32_t ui32_received = 0, ui32_torn = 0, ui32_last = 0;
+
+  line_init(&thread_line);
+  ui32_writer_packets = ui32_packets;
+
+  if (pthread_create(&writer_thread, NULL, writer, NULL))
+  {
+    perror("pthread_create");
+    exit(1);
+  }
+
+  while (!writer_done || thread_line.framer.ui8_ready & PACKET_FRAMER_FRESH)
+  {
+    const uint8_t *p_packet = line_get(&thread_line);
+    if (!p_packet)
+      continue;
+
+    // the number is in data bytes 1 to 4, the others must agree with it
+    uint32_t ui32_number = (uint8_t) (p_packet[4] - 4 * 37) | (uint32_t) (uint8_t) (p_packet[1] - 37) << 8
+        | (uint32_t) (uint8_t) (p_packet[2] - 2 * 37) << 16 | (uint32_t) (uint8_t) (p_packet[3] - 3 * 37) << 24;
+
+    if (!is_packet(p_packet, ui32_number) || ui32_number <= ui32_last)
+      ui32_torn++;
+
+    ui32_last = ui32_number;
+    ui32_received++;
+  }
+
+  pthread_join(writer_thread, NULL);
+
+  CHECK(ui32_torn == 0, "%u packets torn or out of order", ui32_torn);
+  CHECK(ui32_last == ui32_packets, "last packet %u of %u", ui32_last, ui32_packets);
+  CHECK(ui32_received + thread_line.stats.ui32_replaced == ui32_packets, "threads: %u received, %u replaced",
+      ui32_received, thread_line.stats.ui32_replaced);
+
+  printf("threads: %u packets, %u read, %u replaced, %u torn\n", ui32_packets, ui32_received,
+      thread_line.stats.ui32_replaced, ui32_torn);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_packets = 1000000;
+  uint32_t ui32_thread_packets = 10000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_packets = strtoul(optarg, NULL, 0);
+        break;
+
+      case 't':
+        ui32_thread_packets = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n packets] [-t packets]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  fixtures();
+  random_stream(ui32_packets);
+  if (ui32_thread_packets)
+    threads(ui32_thread_packets);
+
+  if (host_test_failed())
+    return 1;
+
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// RTC, power and fault handling of the displays, driven by the host tick clock
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "rtc.h"
+#include "eeprom.h"
+#include "fault.h"
+#include "state.h"
+#include "host.h"
+
+#define SECONDS_IN_DAY 86400
+
+uint32_t ui32_seconds_since_startup = 0;
+static uint32_t ui32_rtc_offset; // seconds of the day when the host started
+
+void rtc_init(void)
+{
+}
+
+void rtc_set_time(rtc_time_t *rtc_time)
+{
+  uint32_t ui32_time = ((uint32_t) rtc_time->ui8_hours * 3600) + ((uint32_t) rtc_time->ui8_minutes * 60);
+
+  ui32_rtc_offset = (ui32_time + SECONDS_IN_DAY - (ui32_seconds_since_startup % SECONDS_IN_DAY)) % SECONDS_IN_DAY;
+}
+
+rtc_time_t* rtc_get_time(void)
+{
+  static rtc_time_t rtc_time;
+  uint32_t ui32_temp = (ui32_seconds_since_startup + ui32_rtc_offset) % SECONDS_IN_DAY;
+
+  rtc_time.ui8_hours = ui32_temp / 3600;
+  rtc_time.ui8_minutes = (ui32_temp % 3600) / 60;
+
+  return &rtc_time;
+}
+
+rtc_time_t* rtc_get_time_since_startup(void)
+{
+  static rtc_time_t rtc_time;
+
+  rtc_time.ui8_hours = ui32_seconds_since_startup / 3600;
+  rtc_time.ui8_minutes = (ui32_seconds_since_startup % 3600) / 60;
+
+  return &rtc_time;
+}
+
+#ifdef SW102
+void system_power(bool state)
+{
+  (void) state;
+}
+
+uint32_t get_msecs()
+{
+  return host_get_msecs();
+}
+
+uint32_t get_seconds()
+{
+  return l3_vars.ui32_trip_timeSec;
+}
+#endif
+
+// layer_2_stats on the simulated clock, layer_2_task() runs right after the trigger
+uint32_t layer_2_clock(void)
+{
+  return host_get_msecs() * 1000;
+}
+
+uint32_t layer_2_clock_us_since(uint32_t ui32_stamp)
+{
+  return host_get_msecs() * 1000 - ui32_stamp;
+}
+
+// layer_2_task() runs in the main loop here, so the urgent packet goes right away
+void tx_urgent_pend(void)
+{
+  tx_urgent_task();
+}
+
+void lcd_power_off(uint8_t updateDistanceOdo)
+{
+  (void) updateDistanceOdo;
+
+  l3_vars.ui32_wh_x10_offset = l3_vars.ui32_wh_x10;
+  // save the variables on EEPROM
+  eeprom_write_variables();
+
+  printf("power off at %u ms\n", host_get_msecs());
+  exit(0);
+}
+
+void app_error_fault_handler(uint32_t id, uint32_t pc, uint32_t info)
+{
+  fprintf(stderr, "fault %u (pc 0x%08x, info 0x%08x) at %u ms\n", id, pc, info, host_get_msecs());
+  exit(2);
+}
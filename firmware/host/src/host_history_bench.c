@@ -0,0 +1,365 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Records a ride into the graph history (common/src/history.c) and checks every level against
+ * the min, max and average worked out from all the samples. Then checks the windowed max/min the
+ * graphs scale with against a scan of the points, times history_record() and prints the memory a
+ * series takes.
+ *
+ *   -n <seconds>  seconds of ride to record and check (default 40000, a bit over 11 hours)
+ *   -t <samples>  samples to time (default 10000000)
+ *
+ * Exits with 1 if a level or a window doesn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include "history.h"
+#include "host_test.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER
+#endif
+
+// the 850C records a series per graph value, and the levels 1 and 2 of the battery voltage and
+// level 1 of the motor temperature
+#define SERIES_850C 8
+#define RINGS_850C 3
+
+static uint16_t ui16_value;
+static uint16_t *p_ride;
+
+// A value that goes up and down and now and then jumps, as a power or a speed does
+static uint16_t ride_value(uint32_t ui32_second)
+{
+  uint32_t ui32_value = 300 + (ui32_second * 7) % 400 + ((ui32_second * 2654435761u) >> 24);
+
+  if (ui32_second % 97 < 5)
+    ui32_value = 0; // stopped
+  if (ui32_second % 1000 == 500)
+    ui32_value = 65535;
+
+  return ui32_value;
+}
+
+static void check_level(const history_series_t *p_series, uint8_t ui8_level, uint32_t ui32_seconds)
+{
+  uint32_t ui32_span = history_level_seconds(ui8_level);
+  uint32_t ui32_buckets = ui32_seconds / ui32_span;
+  uint32_t ui32_count = ui32_buckets < HISTORY_POINTS ? ui32_buckets : HISTORY_POINTS;
+
+  CHECK(history_count(p_series, ui8_level) == ui32_count, "level %u has %u points, expected %u",
+      ui8_level, history_count(p_series, ui8_level), ui32_count);
+  CHECK(history_added(p_series, ui8_level) == ui32_buckets, "level %u added %u points, expected %u",
+      ui8_level, history_added(p_series, ui8_level), ui32_buckets);
+
+  for (uint32_t i = 0; i < ui32_count; i++)
+  {
+    uint32_t ui32_first = (ui32_buckets - ui32_count + i) * ui32_span;
+    uint32_t ui32_sum = 0;
+    uint16_t ui16_min = UINT16_MAX, ui16_max = 0;
+
+    // an average of averages, as the history works it out
+    uint32_t ui32_sub_span = ui8_level ? history_level_seconds(ui8_level - 1) : 1;
+    for (uint32_t j = 0; j < ui32_span; j += ui32_sub_span)
+    {
+      uint32_t ui32_sub_sum = 0;
+
+      for (uint32_t k = 0; k < ui32_sub_span; k++)
+      {
+        uint16_t ui16_sample = p_ride[ui32_first + j + k];
+
+        ui32_sub_sum += ui16_sample;
+        if (ui16_sample < ui16_min)
+          ui16_min = ui16_sample;
+        if (ui16_sample > ui16_max)
+          ui16_max = ui16_sample;
+      }
+
+      // level 2 averages the level 1 averages, which are rounded down
+      ui32_sum += ui8_level == 2 ? ui32_sub_sum / ui32_sub_span : ui32_sub_sum;
+    }
+
+    uint16_t ui16_avg = ui8_level == 2 ? ui32_sum / (ui32_span / ui32_sub_span) : ui32_sum / ui32_span;
+    history_bucket_t point = history_point(p_series, ui8_level, i);
+
+    CHECK(point.ui16_min == ui16_min && point.ui16_max == ui16_max && point.ui16_avg == ui16_avg,
+        "level %u point %u is %u/%u/%u, expected %u/%u/%u", ui8_level, i,
+        point.ui16_min, point.ui16_max, point.ui16_avg, ui16_min, ui16_max, ui16_avg);
+  }
+}
+
+static void ride(uint32_t ui32_seconds)
+{
+  static history_bucket_t buckets[HISTORY_LEVELS - 1][HISTORY_POINTS];
+  static history_series_t series = HISTORY_SERIES_BUCKETS(&ui16_value, buckets);
+
+  p_ride = malloc(ui32_seconds * sizeof(uint16_t));
+
+  for (uint32_t ui32_second = 0; ui32_second < ui32_seconds; ui32_second++)
+  {
+    p_ride[ui32_second] = ui16_value = ride_value(ui32_second);
+    history_record(&series);
+
+    // while the rings fill, as they wrap and at the end
+    if (ui32_second % 1237 == 0 || ui32_second + 1 == ui32_seconds)
+    {
+      for (uint8_t ui8_level = 0; ui8_level < HISTORY_LEVELS; ui8_level++)
+        check_level(&series, ui8_level, ui32_second + 1);
+    }
+  }
+
+  printf("%u s recorded, levels checked against the samples\n", ui32_seconds);
+  free(p_ride);
+}
+
+static void wide_sources(void)
+{
+  static uint8_t ui8_source = 200;
+  static uint32_t ui32_source = 100000;
+  static history_series_t series_8 = HISTORY_SERIES(&ui8_source);
+  static history_series_t series_32 = HISTORY_SERIES(&ui32_source);
+
+  history_record(&series_8);
+  history_record(&series_32);
+  CHECK(history_point(&series_8, 0, 0).ui16_avg == 200, "8 bit source");
+  CHECK(history_point(&series_32, 0, 0).ui16_avg == UINT16_MAX, "32 bit source is not saturated");
+}
+
+// xorshift, repeatable runs
+static uint32_t random_next(uint32_t *p_seed)
+{
+  *p_seed ^= *p_seed << 13;
+  *p_seed ^= *p_seed >> 17;
+  *p_seed ^= *p_seed << 5;
+  return *p_seed;
+}
+
+// The max/min of a level by a scan of its points, as graphFindExtremes() did before the windows
+static void scan_extremes(const history_series_t *p_series, uint8_t ui8_level, int32_t i32_min_threshold,
+    int32_t *p_max, int32_t *p_min)
+{
+  *p_max = INT32_MIN;
+  *p_min = INT32_MAX;
+
+  for (uint32_t i = 0; i < history_count(p_series, ui8_level); i++)
+  {
+    history_bucket_t point = history_point(p_series, ui8_level, i);
+
+    if (point.ui16_max > *p_max)
+      *p_max = point.ui16_max;
+
+    int32_t i32_min = point.ui16_min;
+    if (i32_min < i32_min_threshold)
+      i32_min = point.ui16_avg;
+    if (i32_min < *p_min && i32_min >= i32_min_threshold)
+      *p_min = i32_min;
+  }
+}
+
+// The value of the window test at a second: long falls and rises, which fill the max and the min
+// queue, noise, stops, and values past 16 bits that the history saturates. The graph points used to
+// be 16 bits with a shift for the values that didn't fit, the history saturates them instead.
+static uint32_t window_value(uint32_t ui32_second, uint32_t *p_seed)
+{
+  uint32_t ui32_phase = ui32_second % 3000;
+
+  if (ui32_phase < 600)
+    return 150000 - ui32_phase * 200; // falls through 65535
+  if (ui32_phase < 1200)
+    return (ui32_phase - 600) * 3;
+  if (ui32_phase < 1800)
+    return random_next(p_seed) % 1000;
+  if (ui32_phase < 2400)
+    return ui32_phase % 50 < 20 ? 0 : 280 + random_next(p_seed) % 40; // stops, around a threshold
+
+  return random_next(p_seed) % 150000;
+}
+
+#define WINDOW_THRESHOLDS 4
+
+// A window for every level and threshold, updated after every sample or after gaps of up to two
+// rings, against a scan of the level after each update
+static void windows(uint32_t ui32_seconds)
+{
+  static uint32_t ui32_source;
+  static history_bucket_t buckets[HISTORY_LEVELS - 1][HISTORY_POINTS];
+  static history_series_t series = HISTORY_SERIES_BUCKETS(&ui32_source, buckets);
+  static history_series_t series_0 = HISTORY_SERIES(&ui32_source);
+  static const int32_t thresholds[WINDOW_THRESHOLDS] = { -1, 0, 300, 65535 };
+  static history_window_t window[HISTORY_LEVELS][WINDOW_THRESHOLDS];
+  uint32_t ui32_next_update[HISTORY_LEVELS][WINDOW_THRESHOLDS];
+  uint32_t ui32_seed = 2463534242u, ui32_updates = 0, ui32_saturated = 0;
+
+  for (uint8_t l = 0; l < HISTORY_LEVELS; l++)
+  {
+    for (uint8_t t = 0; t < WINDOW_THRESHOLDS; t++)
+    {
+      history_window_init(&window[l][t], l, thresholds[t]);
+      ui32_next_update[l][t] = 0;
+    }
+  }
+
+  for (uint32_t ui32_second = 0; ui32_second < ui32_seconds; ui32_second++)
+  {
+    ui32_source = window_value(ui32_second, &ui32_seed);
+    history_record(&series);
+
+    for (uint8_t l = 0; l < HISTORY_LEVELS; l++)
+    {
+      for (uint8_t t = 0; t < WINDOW_THRESHOLDS; t++)
+      {
+        if (ui32_second != ui32_next_update[l][t])
+          continue;
+
+        int32_t i32_max, i32_min;
+        history_window_update(&window[l][t], &series);
+        scan_extremes(&series, l, thresholds[t], &i32_max, &i32_min);
+
+        CHECK(history_window_max(&window[l][t], &series) == i32_max
+            && history_window_min(&window[l][t], &series) == i32_min,
+            "second %u level %u threshold %d: max/min %d/%d, the scan %d/%d", ui32_second, l, thresholds[t],
+            history_window_max(&window[l][t], &series), history_window_min(&window[l][t], &series), i32_max, i32_min);
+
+        if (i32_max == UINT16_MAX)
+          ui32_saturated++;
+        ui32_updates++;
+
+        // mostly every point or every few, as a graph on the screen, and now and then after a long time off it
+        uint32_t ui32_random = random_next(&ui32_seed);
+        uint32_t ui32_points = ui32_random % 64 ? 1 + (ui32_random >> 8) % 3 : 1 + (ui32_random >> 8) % (2 * HISTORY_POINTS);
+        ui32_next_update[l][t] = ui32_second + ui32_points * history_level_seconds(l);
+      }
+    }
+  }
+
+  CHECK(ui32_saturated, "no window saw a saturated value");
+
+  // a level the series doesn't have
+  history_window_t empty;
+  history_record(&series_0);
+  history_window_init(&empty, 1, -1);
+  history_window_update(&empty, &series_0);
+  CHECK(history_window_max(&empty, &series_0) == INT32_MIN && history_window_min(&empty, &series_0) == INT32_MAX,
+      "window of a level the series doesn't have");
+
+  printf("%u window updates checked against a scan, %u bytes per window\n", ui32_updates,
+      (uint32_t) sizeof(history_window_t));
+}
+
+// A series without bucket rings has level 0 only
+static void levels(void)
+{
+  static history_bucket_t buckets[1][HISTORY_POINTS];
+  static history_series_t series_0 = HISTORY_SERIES(&ui16_value);
+  static history_series_t series_1 = HISTORY_SERIES_BUCKETS(&ui16_value, buckets);
+
+  for (uint32_t i = 0; i < 1000; i++)
+  {
+    history_record(&series_0);
+    history_record(&series_1);
+  }
+
+  CHECK(history_count(&series_0, 0) == HISTORY_POINTS && history_count(&series_0, 1) == 0
+      && history_added(&series_0, 1) == 0, "level 1 of a series without buckets");
+  CHECK(history_count(&series_1, 1) == 100 && history_count(&series_1, 2) == 0
+      && history_added(&series_1, 2) == 0, "level 2 of a series with one ring of buckets");
+}
+
+static void timing(uint32_t ui32_samples)
+{
+  static history_bucket_t buckets[HISTORY_LEVELS - 1][HISTORY_POINTS];
+  static history_series_t series = HISTORY_SERIES_BUCKETS(&ui16_value, buckets);
+  struct timespec start, end;
+#ifdef HAVE_CYCLE_COUNTER
+  uint64_t ui64_cycles = __rdtsc();
+#endif
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_samples; i++)
+  {
+    ui16_value = i * 40503u;
+    history_record(&series);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+#ifdef HAVE_CYCLE_COUNTER
+  ui64_cycles = __rdtsc() - ui64_cycles;
+#endif
+
+  double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+  printf("history_record %6.2f ns/sample", ns / ui32_samples);
+#ifdef HAVE_CYCLE_COUNTER
+  printf(" %6.2f TSC cycles/sample", (double) ui64_cycles / ui32_samples);
+#endif
+  printf("\n");
+}
+
+static void footprint(void)
+{
+  // the two pointers come first and are 4 bytes on the ARM targets, the rest is aligned to 4 at most
+  uint32_t ui32_series = offsetof(history_series_t, ui8_partial_count) + sizeof(((history_series_t*) 0)->ui8_partial_count)
+      - 2 * (sizeof(void*) - 4);
+  ui32_series = (ui32_series + 3) & ~3u;
+  uint32_t ui32_ring = sizeof(history_bucket_t[HISTORY_POINTS]);
+  uint32_t ui32_850c = SERIES_850C * ui32_series + RINGS_850C * ui32_ring;
+
+  printf("series: %u bytes with level 0, %u more per level above\n", ui32_series, ui32_ring);
+  printf("the 850C: %u series and %u rings of buckets, %u bytes\n", SERIES_850C, RINGS_850C, ui32_850c);
+
+  for (uint8_t ui8_level = 0; ui8_level < HISTORY_LEVELS; ui8_level++)
+  {
+    uint32_t ui32_span = HISTORY_POINTS * history_level_seconds(ui8_level);
+
+    printf("  level %u: %3u s per point, %2u h %02u min\n", ui8_level, history_level_seconds(ui8_level),
+        ui32_span / 3600, ui32_span / 60 % 60);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_seconds = 40000;
+  uint32_t ui32_samples = 10000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:t:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_seconds = strtoul(optarg, NULL, 0);
+        break;
+
+      case 't':
+        ui32_samples = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n seconds] [-t samples]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  ride(ui32_seconds);
+  wide_sources();
+  levels();
+  windows(ui32_seconds);
+
+  if (host_test_failed())
+    return 1;
+
+  footprint();
+  if (ui32_samples)
+    timing(ui32_samples);
+
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * Bafang LCD 850C firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// 850C display: the real uGUI accelerators and burst engine, with the bus going to lcd_bus_model.c
+
+#include <stdio.h>
+#include "ugui.h"
+#include "ugui_bafang_850c.h"
+#include "lcd_burst.h"
+#include "lcd_bus_model.h"
+#include "state.h"
+#include "host.h"
+
+// Estimated WR cycle times: the burst loops strobe in about 12 CPU cycles at 128MHz (tWC is
+// 100ns min), commands go through lcd_write_command() and its wait_pulse() loop
+#define NS_PER_DATA_STROBE     100
+#define NS_PER_COMMAND_STROBE  250
+
+UG_GUI gui;
+
+static uint8_t ui8_backlight;
+
+void host_lcd_init(void)
+{
+  lcd_bus_model_reset();
+
+  // same as bafang_500C_lcd_init() once the controller is configured
+  UG_Init(&gui, lcd_pixel_set, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+  UG_DriverRegister(DRIVER_FILL_FRAME, (void*) HW_FillFrame);
+  UG_DriverRegister(DRIVER_DRAW_LINE, (void*) HW_DrawLine);
+  UG_DriverRegister(DRIVER_FILL_AREA, (void*) HW_FillArea);
+
+  // and lcd_init()
+  UG_FillScreen(C_BLACK);
+  set_lcd_backlight();
+}
+
+void lcd_set_backlight_intensity(uint8_t ui8_intensity)
+{
+  ui8_backlight = ui8_intensity;
+}
+
+bool host_lcd_dump(const char *p_path)
+{
+  FILE *p_file = fopen(p_path, "wb");
+
+  if (!p_file)
+  {
+    perror(p_path);
+    return false;
+  }
+
+  fprintf(p_file, "P6\n# backlight %u\n%u %u\n255\n", ui8_backlight, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+  for (UG_S16 y = 0; y < DISPLAY_HEIGHT; y++)
+  {
+    for (UG_S16 x = 0; x < DISPLAY_WIDTH; x++)
+    {
+      // RGB565 to RGB888
+      uint16_t ui16_pixel = lcd_bus_model_get_pixel(x, y);
+      uint8_t rgb[3] = {
+          ((ui16_pixel >> 11) & 0x1f) << 3,
+          ((ui16_pixel >> 5) & 0x3f) << 2,
+          (ui16_pixel & 0x1f) << 3 };
+
+      fwrite(rgb, 1, sizeof(rgb), p_file);
+    }
+  }
+
+  fclose(p_file);
+  return true;
+}
+
+void host_lcd_tick_end(uint32_t ui32_tick, FILE *p_file)
+{
+  static lcd_bus_model_counters_t last;
+  const lcd_bus_model_counters_t *p_counters = lcd_bus_model_counters();
+  const lcd_bus_stats_t *p_stats;
+
+  lcd_bus_stats_frame_end();
+  p_stats = lcd_bus_stats_last_frame();
+
+  if (p_file && p_stats->ui32_command_strobes + p_stats->ui32_data_strobes)
+  {
+    fprintf(p_file, "tick %u: pixels %u commands %u data %u bursts %u window_skips %u | model strobes %u pixels %u\n",
+        ui32_tick,
+        p_stats->ui32_pixels,
+        p_stats->ui32_command_strobes,
+        p_stats->ui32_data_strobes,
+        p_stats->ui32_bursts,
+        p_stats->ui32_window_skips,
+        p_counters->ui32_strobes - last.ui32_strobes,
+        p_counters->ui32_pixels - last.ui32_pixels);
+  }
+
+  last = *p_counters;
+}
+
+void host_lcd_counters(host_lcd_counters_t *p_counters)
+{
+  const lcd_bus_model_counters_t *p_model = lcd_bus_model_counters();
+
+  p_counters->ui32_pixels = p_model->ui32_pixels;
+  p_counters->ui32_window_commands = p_model->ui32_windows;
+  p_counters->ui32_bus_cycles = p_model->ui32_strobes;
+  p_counters->ui64_bus_ns = (uint64_t) (p_model->ui32_strobes - p_model->ui32_commands) * NS_PER_DATA_STROBE +
+      (uint64_t) p_model->ui32_commands * NS_PER_COMMAND_STROBE;
+}
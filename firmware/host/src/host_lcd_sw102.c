@@ -0,0 +1,180 @@
+/*
+ * Bafang LCD SW102 Bluetooth firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * SW102 display: the real lcd.c frameBuffer code with the SPI transfers going to a model of the
+ * SH1107 in page addressing mode. Only the page and column address commands are decoded, the
+ * other commands of the init sequence are skipped together with their parameter byte.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ugui.h"
+#include "lcd.h"
+#include "custom_board.h"
+#include "nrf_gpio.h"
+#include "nrf_drv_spi.h"
+#include "host.h"
+
+typedef struct
+{
+  bool is_data;         // state of the C/D pin
+  uint8_t ui8_page;
+  uint8_t ui8_column;
+  uint8_t ui8_command;  // last command byte
+  uint8_t ui8_skip;     // parameter bytes of the last command still to come
+  uint8_t ui8_contrast;
+  uint32_t ui32_bytes;  // SPI bytes, commands included
+  uint32_t ui32_data_bytes;
+  uint32_t ui32_page_commands;
+} sh1107_t;
+
+static sh1107_t sh1107;
+static uint8_t panel_ram[16][64];
+
+#define NS_PER_SPI_BYTE 2000 // 8 bits at 4MHz
+
+UG_GUI gui;
+
+void nrf_gpio_pin_set(uint32_t pin_number)
+{
+  if (pin_number == LCD_COMMAND_DATA__PIN)
+    sh1107.is_data = true;
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number)
+{
+  if (pin_number == LCD_COMMAND_DATA__PIN)
+    sh1107.is_data = false;
+}
+
+static void sh1107_command(uint8_t ui8_cmd)
+{
+  if (sh1107.ui8_skip)
+  {
+    sh1107.ui8_skip--;
+    if (sh1107.ui8_command == 0x81)
+      sh1107.ui8_contrast = ui8_cmd;
+    return;
+  }
+
+  sh1107.ui8_command = ui8_cmd;
+
+  if (ui8_cmd <= 0x0f) // lower column address
+    sh1107.ui8_column = (sh1107.ui8_column & 0xf0) | ui8_cmd;
+  else if (ui8_cmd <= 0x17) // higher column address
+    sh1107.ui8_column = (sh1107.ui8_column & 0x0f) | ((ui8_cmd & 0x07) << 4);
+  else if (ui8_cmd >= 0xb0 && ui8_cmd <= 0xbf) // page address
+  {
+    sh1107.ui8_page = ui8_cmd & 0x0f;
+    sh1107.ui32_page_commands++;
+  }
+  else if (ui8_cmd == 0x81)
+    sh1107.ui8_skip = 1; // contrast, kept for the dump header
+  else if (ui8_cmd == 0xa8 || ui8_cmd == 0xd3 || ui8_cmd == 0xd5 || ui8_cmd == 0xd9 ||
+      ui8_cmd == 0xdb || ui8_cmd == 0xdc || ui8_cmd == 0xad)
+    sh1107.ui8_skip = 1;
+}
+
+uint32_t nrf_drv_spi_init(nrf_drv_spi_t const * const p_instance, nrf_drv_spi_config_t const * p_config,
+    nrf_drv_spi_evt_handler_t handler)
+{
+  (void) p_instance;
+  (void) p_config;
+  (void) handler;
+  return NRF_SUCCESS;
+}
+
+uint32_t nrf_drv_spi_transfer(nrf_drv_spi_t const * const p_instance, uint8_t const * p_tx_buffer,
+    uint8_t tx_buffer_length, uint8_t * p_rx_buffer, uint8_t rx_buffer_length)
+{
+  (void) p_instance;
+  (void) p_rx_buffer;
+  (void) rx_buffer_length;
+
+  for (uint8_t i = 0; i < tx_buffer_length; i++)
+  {
+    uint8_t ui8_byte = p_tx_buffer[i];
+
+    sh1107.ui32_bytes++;
+
+    if (sh1107.is_data)
+    {
+      sh1107.ui32_data_bytes++;
+      if (sh1107.ui8_column < 64)
+        panel_ram[sh1107.ui8_page][sh1107.ui8_column++] = ui8_byte;
+    }
+    else
+      sh1107_command(ui8_byte);
+  }
+
+  return NRF_SUCCESS;
+}
+
+void host_lcd_init(void)
+{
+  memset(&sh1107, 0, sizeof(sh1107));
+  memset(panel_ram, 0xff, sizeof(panel_ram)); // garbage until the first refresh
+  lcd_init();
+}
+
+bool host_lcd_dump(const char *p_path)
+{
+  FILE *p_file = fopen(p_path, "wb");
+
+  if (!p_file)
+  {
+    perror(p_path);
+    return false;
+  }
+
+  fprintf(p_file, "P4\n# contrast %u\n64 128\n", sh1107.ui8_contrast);
+
+  for (uint8_t y = 0; y < 128; y++)
+  {
+    uint8_t row[8] = { 0 };
+
+    // PBM: 1 is black, the OLED lights the pixels that are set
+    for (uint8_t x = 0; x < 64; x++)
+    {
+      if (!(panel_ram[y / 8][x] & (1 << (y % 8))))
+        row[x / 8] |= 0x80 >> (x % 8);
+    }
+
+    fwrite(row, 1, sizeof(row), p_file);
+  }
+
+  fclose(p_file);
+  return true;
+}
+
+void host_lcd_tick_end(uint32_t ui32_tick, FILE *p_file)
+{
+  static sh1107_t last;
+  static lcd_flush_stats_t last_flush;
+  const lcd_flush_stats_t *p_flush = lcd_get_flush_stats();
+
+  if (p_file && sh1107.ui32_bytes != last.ui32_bytes)
+  {
+    fprintf(p_file, "tick %u: spi bytes %u data %u | pages %u\n",
+        ui32_tick,
+        sh1107.ui32_bytes - last.ui32_bytes,
+        sh1107.ui32_data_bytes - last.ui32_data_bytes,
+        p_flush->pages - last_flush.pages);
+  }
+
+  last = sh1107;
+  last_flush = *p_flush;
+}
+
+void host_lcd_counters(host_lcd_counters_t *p_counters)
+{
+  // every data byte is a column of 8 pixels
+  p_counters->ui32_pixels = sh1107.ui32_data_bytes * 8;
+  p_counters->ui32_window_commands = sh1107.ui32_page_commands;
+  p_counters->ui32_bus_cycles = sh1107.ui32_bytes;
+  p_counters->ui64_bus_ns = (uint64_t) sh1107.ui32_bytes * NS_PER_SPI_BYTE;
+}
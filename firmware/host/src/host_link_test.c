@@ -0,0 +1,426 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Loopback test of the motor link handshake (common/src/motor_link.c) on a pty pair. The display
+ * end runs motor_link.c, motor_packet.c and the packet framer on the master side, and sets its
+ * baud rate there with uart_set_baud(). A motor that knows the handshake runs on the slave side.
+ * Bytes sent at one baud rate and read at another come out as garbage, as on a real line, so the
+ * two ends only talk when they agree.
+ *
+ * Every 100ms window the display takes the newest packet, runs motor_link_update() and sends, then
+ * the motor answers every packet it got, twice when it sends every 50ms. The scenarios: a motor
+ * with 115200 and 50ms, one with 57600 only, one without the handshake, one that never switches,
+ * a noisy line that makes both ends fall back to 9600 and then switch again, and a TX still busy
+ * when the display should change its baud rate.
+ *
+ * Exits with 1 if a check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pty.h>
+#include <termios.h>
+#include "motor_link.h"
+#include "motor_packet.h"
+#include "packet_framer.h"
+#include "crc16.h"
+#include "host_test.h"
+
+#define RING_SIZE 64
+#define RX_LENGTH (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 + UART_NUMBER_CRC_BYTES)
+#define TX_LENGTH (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V20 + UART_NUMBER_CRC_BYTES)
+#define RX_LINK_OFFSET (1 + UART_NUMBER_DATA_BYTES_TO_RECEIVE_V20 - 1)
+#define TX_LINK_OFFSET (1 + UART_NUMBER_DATA_BYTES_TO_SEND_V20 - 1)
+
+// One end of the line: its pty fd and the framer of what it receives
+typedef struct
+{
+  int fd;
+  uint8_t ring[RING_SIZE];
+  uint16_t ui16_head;
+  packet_framer_t framer;
+  uart_rx_stats_t stats;
+  // the speed of each write still on the line, the pty only carries the bytes
+  speed_t sent_speed[16];
+  uint8_t sent_bytes[16];
+  uint8_t ui8_sent_head, ui8_sent_tail;
+} end_t;
+
+static end_t display, motor;
+static bool noisy; // the motor's packets get damaged on the way
+
+static speed_t speed_of(uint32_t ui32_baud)
+{
+  return ui32_baud == 115200 ? B115200 : ui32_baud == 57600 ? B57600 : B9600;
+}
+
+static void set_speed(int fd, uint32_t ui32_baud)
+{
+  struct termios tio;
+
+  tcgetattr(fd, &tio);
+  cfsetispeed(&tio, speed_of(ui32_baud));
+  cfsetospeed(&tio, speed_of(ui32_baud));
+  tcsetattr(fd, TCSANOW, &tio);
+}
+
+static speed_t get_speed(int fd)
+{
+  struct termios tio;
+
+  tcgetattr(fd, &tio);
+  return cfgetospeed(&tio);
+}
+
+// the display UART, for motor_link.c
+uint8_t uart_get_stream_version(void)
+{
+  return 20;
+}
+
+// write() returns once the bytes are in the pty, a scenario can make the next calls see it busy
+static uint8_t ui8_tx_busy_calls;
+
+bool uart_tx_busy(void)
+{
+  if (!ui8_tx_busy_calls)
+    return false;
+
+  ui8_tx_busy_calls--;
+  return true;
+}
+
+void uart_set_baud(uint32_t ui32_baud)
+{
+  set_speed(display.fd, ui32_baud);
+}
+
+static void end_init(end_t *p_end, int fd, uint8_t ui8_start_byte, uint8_t ui8_length)
+{
+  struct termios tio;
+
+  memset(p_end, 0, sizeof(*p_end));
+  p_end->fd = fd;
+
+  tcgetattr(fd, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(fd, TCSANOW, &tio);
+  set_speed(fd, 9600);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  packet_framer_init(&p_end->framer, p_end->ring, RING_SIZE, ui8_start_byte, ui8_length, &p_end->stats);
+}
+
+// What came in, garbage where it was sent at another speed than this end has now
+static void end_receive(end_t *p_end, end_t *p_other, bool damage)
+{
+  uint8_t bytes[256];
+  ssize_t count;
+
+  while ((count = read(p_end->fd, bytes, sizeof(bytes))) > 0)
+  {
+    for (ssize_t i = 0; i < count; i++)
+    {
+      uint8_t ui8_log = p_other->ui8_sent_tail;
+      bool garbage = p_other->sent_speed[ui8_log] != get_speed(p_end->fd);
+      if (--p_other->sent_bytes[ui8_log] == 0)
+        p_other->ui8_sent_tail = (ui8_log + 1) % 16;
+
+      uint8_t ui8_byte = bytes[i];
+      if (garbage)
+        ui8_byte = ui8_byte * 7 + 0x55;
+      else if (damage && i % 13 == 5)
+        ui8_byte ^= 0x20;
+
+      p_end->ring[p_end->ui16_head] = ui8_byte;
+      p_end->ui16_head = (p_end->ui16_head + 1) % RING_SIZE;
+      if (p_end->ui16_head % (RING_SIZE / 2) == 0)
+        packet_framer_process(&p_end->framer, p_end->ui16_head, false);
+    }
+  }
+
+  packet_framer_process(&p_end->framer, p_end->ui16_head, true);
+}
+
+static void send_bytes(end_t *p_end, const uint8_t *p_bytes, uint8_t ui8_count)
+{
+  p_end->sent_speed[p_end->ui8_sent_head] = get_speed(p_end->fd);
+  p_end->sent_bytes[p_end->ui8_sent_head] = ui8_count;
+  p_end->ui8_sent_head = (p_end->ui8_sent_head + 1) % 16;
+
+  CHECK(write(p_end->fd, p_bytes, ui8_count) == ui8_count, "write");
+}
+
+// The motor controller side of the handshake
+typedef struct
+{
+  uint8_t ui8_caps;      // 0 for a motor without the handshake
+  bool never_switches;   // answers offers, not switches
+  uint8_t ui8_link;      // what it sends in its byte 26
+  uint8_t ui8_choice;    // 0 at 9600
+  uint8_t ui8_bad_windows;
+  uint32_t ui32_packets; // status packets sent
+} fake_motor_t;
+
+static fake_motor_t fake;
+
+static void motor_send_status(void)
+{
+  uint8_t packet[RX_LENGTH];
+
+  packet[0] = MOTOR_PACKET_RX_START_BYTE;
+  for (uint8_t i = 1; i < RX_LINK_OFFSET; i++)
+    packet[i] = i;
+  packet[RX_LINK_OFFSET] = fake.ui8_link;
+
+  uint16_t ui16_crc = crc16_buffer(CRC16_INIT, packet, RX_LENGTH - UART_NUMBER_CRC_BYTES);
+  packet[RX_LENGTH - 2] = ui16_crc & 0xff;
+  packet[RX_LENGTH - 1] = ui16_crc >> 8;
+
+  send_bytes(&motor, packet, RX_LENGTH);
+  fake.ui32_packets++;
+}
+
+static void motor_window(void)
+{
+  end_receive(&motor, &display, false);
+
+  uint8_t ui8_length;
+  const uint8_t *p_packet = packet_framer_get(&motor.framer, &ui8_length);
+  if (!p_packet || ui8_length != TX_LENGTH)
+  {
+    // the motor's own fallback, as the display's
+    if (fake.ui8_choice && ++fake.ui8_bad_windows >= MOTOR_LINK_FALLBACK_WINDOWS)
+    {
+      fake.ui8_choice = fake.ui8_link = fake.ui8_bad_windows = 0;
+      set_speed(motor.fd, 9600);
+    }
+    return;
+  }
+
+  fake.ui8_bad_windows = 0;
+  uint8_t ui8_request = p_packet[TX_LINK_OFFSET];
+  uint8_t ui8_switch_to = 0;
+
+  if (!fake.ui8_caps)
+    fake.ui8_link = 0;
+  else if ((ui8_request & (MOTOR_LINK_OFFER | MOTOR_LINK_SWITCH)) == MOTOR_LINK_OFFER)
+    fake.ui8_link = MOTOR_LINK_OFFER | fake.ui8_caps;
+  else if ((ui8_request & MOTOR_LINK_SWITCH) && !fake.never_switches
+      && !(ui8_request & MOTOR_LINK_DATA_MASK & ~fake.ui8_caps))
+  {
+    fake.ui8_link = ui8_request;
+    if (fake.ui8_choice != (ui8_request & MOTOR_LINK_DATA_MASK))
+      ui8_switch_to = ui8_request & MOTOR_LINK_DATA_MASK;
+  }
+  else if (!ui8_request)
+    fake.ui8_link = 0;
+
+  // the answer goes at the old speed, then it switches
+  motor_send_status();
+  if (ui8_switch_to)
+  {
+    fake.ui8_choice = ui8_switch_to;
+    set_speed(motor.fd, motor_link_baud(ui8_switch_to));
+  }
+
+  if (fake.ui8_choice & MOTOR_LINK_RATE_50MS)
+    motor_send_status();
+}
+
+static l2_vars_t vars;
+static uint32_t ui32_good_windows;
+
+static void display_window(uint32_t ui32_window)
+{
+  const motor_packet_version_t *p_version = motor_packet_version(20);
+  uint8_t packet[TX_LENGTH];
+
+  end_receive(&display, &motor, noisy);
+
+  uint8_t ui8_length;
+  const uint8_t *p_packet = packet_framer_get(&display.framer, &ui8_length);
+  bool packet_ok = p_packet && motor_packet_decode(p_version, p_packet, ui8_length, &vars);
+  if (packet_ok)
+    ui32_good_windows++;
+
+  motor_link_update(&vars, packet_ok);
+
+  motor_packet_encode(p_version, ui32_window % (p_version->ui8_max_message_id + 1), &vars, packet);
+  send_bytes(&display, packet, TX_LENGTH);
+}
+
+static void run(uint32_t ui32_windows)
+{
+  for (uint32_t i = 0; i < ui32_windows; i++)
+  {
+    display_window(i);
+    motor_window();
+  }
+}
+
+static void start(uint8_t ui8_caps, bool never_switches)
+{
+  int master, slave;
+
+  if (display.fd)
+  {
+    close(display.fd);
+    close(motor.fd);
+  }
+
+  if (openpty(&master, &slave, NULL, NULL, NULL))
+  {
+    perror("openpty");
+    exit(1);
+  }
+
+  end_init(&display, master, MOTOR_PACKET_RX_START_BYTE, RX_LENGTH);
+  end_init(&motor, slave, MOTOR_PACKET_TX_START_BYTE, TX_LENGTH);
+
+  memset(&fake, 0, sizeof(fake));
+  fake.ui8_caps = ui8_caps;
+  fake.never_switches = never_switches;
+
+  memset(&vars, 0, sizeof(vars));
+  memset(&motor_link, 0, sizeof(motor_link));
+  motor_link.ui32_baud = 9600;
+  ui32_good_windows = 0;
+  noisy = false;
+  ui8_tx_busy_calls = 0;
+}
+
+static void check_link(motor_link_state_t state, uint32_t ui32_baud, speed_t speed, const char *p_what)
+{
+  CHECK(motor_link.state == state && motor_link.ui32_baud == ui32_baud, "%s: state %u at %u, expected %u at %u",
+      p_what, motor_link.state, motor_link.ui32_baud, state, ui32_baud);
+  CHECK(get_speed(display.fd) == speed && get_speed(motor.fd) == speed, "%s: the two ends are at different speeds",
+      p_what);
+}
+
+static void fast_motor(void)
+{
+  start(MOTOR_LINK_BAUD_57600 | MOTOR_LINK_BAUD_115200 | MOTOR_LINK_RATE_50MS, false);
+
+  // a good packet at 9600, the offer, the answer, the switch and its answer
+  run(5);
+  check_link(MOTOR_LINK_FAST, 115200, B115200, "115200 and 50ms");
+  CHECK(motor_link.ui8_choice == (MOTOR_LINK_BAUD_115200 | MOTOR_LINK_RATE_50MS), "choice 0x%02x", motor_link.ui8_choice);
+
+  uint32_t ui32_good = ui32_good_windows, ui32_sent = fake.ui32_packets;
+  run(100);
+  CHECK(ui32_good_windows - ui32_good == 100, "%u of 100 windows had a good packet at 115200",
+      ui32_good_windows - ui32_good);
+  CHECK(fake.ui32_packets - ui32_sent == 200, "%u packets in 100 windows at 50ms", fake.ui32_packets - ui32_sent);
+
+  // the line goes bad: the display falls back first, then the motor stops hearing it and follows
+  noisy = true;
+  run(MOTOR_LINK_FALLBACK_WINDOWS);
+  noisy = false;
+  CHECK(motor_link.ui32_fallbacks == 1, "%u fallbacks on a noisy line", motor_link.ui32_fallbacks);
+  run(MOTOR_LINK_FALLBACK_WINDOWS + 2);
+  check_link(MOTOR_LINK_SLOW, 9600, B9600, "after the fallback");
+
+  ui32_good = ui32_good_windows;
+  run(50);
+  CHECK(ui32_good_windows - ui32_good == 50, "%u of 50 windows had a good packet after the fallback",
+      ui32_good_windows - ui32_good);
+
+  // and it offers again after MOTOR_LINK_RETRY_WINDOWS
+  run(MOTOR_LINK_RETRY_WINDOWS);
+  check_link(MOTOR_LINK_FAST, 115200, B115200, "after the retry");
+  CHECK(motor_link.ui32_switches == 2, "%u switches", motor_link.ui32_switches);
+
+  printf("115200 and 50ms: switched in 5 windows, fell back on a noisy line, switched again after the retry\n");
+}
+
+static void medium_motor(void)
+{
+  start(MOTOR_LINK_BAUD_57600, false);
+  run(5);
+  check_link(MOTOR_LINK_FAST, 57600, B57600, "57600 only");
+  CHECK(motor_link.ui8_choice == MOTOR_LINK_BAUD_57600, "choice 0x%02x", motor_link.ui8_choice);
+
+  uint32_t ui32_sent = fake.ui32_packets;
+  run(20);
+  CHECK(fake.ui32_packets - ui32_sent == 20, "%u packets in 20 windows at 100ms", fake.ui32_packets - ui32_sent);
+
+  printf("57600 only: switched, one packet per 100ms\n");
+}
+
+static void old_motor(void)
+{
+  start(0, false);
+  run(MOTOR_LINK_RETRY_WINDOWS + 50);
+  check_link(MOTOR_LINK_SLOW, 9600, B9600, "no handshake");
+  // the first window comes before the motor's first packet
+  CHECK(ui32_good_windows == MOTOR_LINK_RETRY_WINDOWS + 49, "%u good windows without the handshake", ui32_good_windows);
+  CHECK(motor_link.ui32_switches == 0 && vars.ui8_link_request == 0, "offering to a motor without the handshake");
+
+  printf("no handshake: stays at 9600, every packet good\n");
+}
+
+static void stubborn_motor(void)
+{
+  start(MOTOR_LINK_BAUD_115200, true);
+  run(5 + MOTOR_LINK_WAIT_WINDOWS);
+  check_link(MOTOR_LINK_SLOW, 9600, B9600, "never switches");
+  CHECK(ui32_good_windows == 4 + MOTOR_LINK_WAIT_WINDOWS, "%u good windows with a motor that never switches",
+      ui32_good_windows);
+
+  printf("never switches: back to 9600 without losing a packet\n");
+}
+
+static void busy_tx(void)
+{
+  start(MOTOR_LINK_BAUD_57600, false);
+
+  // the motor's answer to the switch comes in the 5th window, the display TX is busy then and after
+  run(4);
+  ui8_tx_busy_calls = 2;
+  run(2);
+  CHECK(motor_link.state == MOTOR_LINK_SWITCHING && motor_link.ui32_baud == 9600, "switch with the TX busy");
+  CHECK(get_speed(motor.fd) == B57600, "the motor didn't switch");
+  run(1);
+  check_link(MOTOR_LINK_FAST, 57600, B57600, "once the TX is done");
+
+  uint32_t ui32_good = ui32_good_windows;
+  run(20);
+  CHECK(ui32_good_windows - ui32_good == 20, "%u of 20 windows had a good packet after a late switch",
+      ui32_good_windows - ui32_good);
+
+  // the fallback finds the TX busy too, and goes back to 9600 a window later
+  noisy = true;
+  run(MOTOR_LINK_FALLBACK_WINDOWS - 1);
+  ui8_tx_busy_calls = 1;
+  run(1);
+  CHECK(motor_link.state == MOTOR_LINK_SLOW && motor_link.ui32_baud == 57600, "fallback with the TX busy");
+  noisy = false;
+  run(MOTOR_LINK_FALLBACK_WINDOWS + 2);
+  check_link(MOTOR_LINK_SLOW, 9600, B9600, "after a late fallback");
+  CHECK(motor_link.ui32_baud_retries == 3, "%u baud rate retries", motor_link.ui32_baud_retries);
+
+  printf("TX busy: the switch and the fallback wait for the next window\n");
+}
+
+int main(void)
+{
+  fast_motor();
+  medium_motor();
+  old_motor();
+  stubborn_motor();
+  busy_tx();
+
+  if (host_test_failed())
+    return 1;
+
+  printf("all checks passed\n");
+  return 0;
+}
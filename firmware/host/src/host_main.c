@@ -0,0 +1,127 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Host main loop. It runs the same services as the display main loops on a simulated clock:
+ * main_idle() every 20ms tick, layer_2() every 100ms (triggered by TIM4 on the 850C, the app timer
+ * on the SW102) and the seconds counter every second, so runs are repeatable and faster than real time.
+ *
+ *   -n <ticks>    number of 20ms ticks to run (default 250)
+ *   -s <script>   button script, see host.h
+ *   -f <file>     back the fake flash with a file, so settings survive between runs
+ *   -o <dir>      dump the screen to <dir>/frame-NNNNN.ppm (850C) or .pbm (SW102)
+ *   -e <ticks>    dump every <ticks> ticks instead of only the last one
+ *   -q            don't print the per tick pixel and bus counts
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ugui.h"
+#include "screen.h"
+#include "mainscreen.h"
+#include "eeprom.h"
+#include "rtc.h"
+#include "state.h"
+#include "host.h"
+
+#ifdef SW102
+#define HOST_DUMP_EXTENSION "pbm"
+#else
+#define HOST_DUMP_EXTENSION "ppm"
+#endif
+
+static uint32_t ui32_msecs;
+
+uint32_t host_get_msecs(void)
+{
+  return ui32_msecs;
+}
+
+static void dump(const char *p_dir, uint32_t ui32_tick)
+{
+  char path[512];
+
+  snprintf(path, sizeof(path), "%s/frame-%05u." HOST_DUMP_EXTENSION, p_dir, ui32_tick);
+  host_lcd_dump(path);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_ticks = 250;
+  uint32_t ui32_dump_every = 0;
+  const char *p_dump_dir = NULL;
+  bool quiet = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:s:f:o:e:q")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_ticks = strtoul(optarg, NULL, 0);
+        break;
+
+      case 's':
+        if (!host_buttons_load(optarg))
+          return 1;
+        break;
+
+      case 'f':
+        host_flash_set_file(optarg);
+        break;
+
+      case 'o':
+        p_dump_dir = optarg;
+        break;
+
+      case 'e':
+        ui32_dump_every = strtoul(optarg, NULL, 0);
+        break;
+
+      case 'q':
+        quiet = true;
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n ticks] [-s script] [-f flash] [-o dir [-e ticks]] [-q]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  // the backlight level comes from the eeprom, so it goes first
+  eeprom_init();
+  host_lcd_init();
+
+  screenShow(&bootScreen);
+
+  for (uint32_t ui32_tick = 0; ui32_tick < ui32_ticks; ui32_tick++)
+  {
+    ui32_msecs = ui32_tick * HOST_MSEC_PER_TICK;
+
+    if (ui32_tick % (100 / HOST_MSEC_PER_TICK) == 0 && layer_2_trigger()) // every 100ms
+      layer_2_task();
+
+    if (ui32_tick && ui32_tick % (1000 / HOST_MSEC_PER_TICK) == 0)
+      ui32_seconds_since_startup++;
+
+    host_buttons_tick(ui32_tick);
+    main_idle();
+    host_lcd_tick_end(ui32_tick, quiet ? NULL : stdout);
+
+    if (p_dump_dir && ui32_dump_every && ui32_tick % ui32_dump_every == 0)
+      dump(p_dump_dir, ui32_tick);
+  }
+
+  if (p_dump_dir && ui32_ticks)
+    dump(p_dump_dir, ui32_ticks - 1);
+
+  printf("%u ticks, %u packets to the motor\n", ui32_ticks, host_uart_tx_packets());
+  printf("%u assist/lights/walk changes: %u packets sent for them, %u tries held back, max %u ms to the UART\n",
+      tx_urgent_stats.ui32_changes, tx_urgent_stats.ui32_sent, tx_urgent_stats.ui32_deferred,
+      tx_urgent_stats.ui32_latency_max_us / 1000);
+  return 0;
+}
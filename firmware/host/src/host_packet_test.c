@@ -0,0 +1,421 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Checks the motor packet codec (common/src/motor_packet.c) against packets captured from the
+ * hand written process_rx() and send_tx_package() it replaced, then times it. Also measures the
+ * worst case delay, in packets, from a setting change to the packet that takes it to the motor,
+ * with motor_packet_schedule() and with the plain message id rotation it replaced.
+ *
+ *   -n <packets>   packets to decode and encode for the timing (default 1000000)
+ *
+ * Exits with 1 if a packet doesn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "motor_packet.h"
+#include "crc16.h"
+#include "host_test.h"
+
+typedef struct
+{
+  const char *p_name;
+  uint16_t ui16_var;
+  uint8_t ui8_size;
+  uint32_t ui32_value;
+} expected_var_t;
+
+#define VAR(var, value) { #var, offsetof(l2_vars_t, var), sizeof(((l2_vars_t*) 0)->var), value }
+
+// V19 packet, data byte N is N * 37 + 11
+static const uint8_t rx_packet_v19[] =
+{
+  0x43, 0x30, 0x55, 0x7a, 0x9f, 0xc4, 0xe9, 0x0e, 0x33, 0x58, 0x7d, 0xa2, 0xc7, 0xec, 0x11, 0x36,
+  0x5b, 0x80, 0xa5, 0xca, 0xef, 0x14, 0x39, 0x5e, 0x83, 0xa8, 0x77, 0xcd
+};
+
+// what process_rx() got from it, byte 8 is the throttle or the motor temperature
+static const expected_var_t rx_vars[] =
+{
+  VAR(ui16_adc_battery_voltage, 304),
+  VAR(ui8_battery_current_x5, 122),
+  VAR(ui16_wheel_speed_x10, 50335),
+  VAR(ui8_braking, 1),
+  VAR(ui8_adc_throttle, 14),
+  VAR(ui8_adc_pedal_torque_sensor, 88),
+  VAR(ui8_pedal_torque_sensor, 125),
+  VAR(ui8_pedal_cadence, 162),
+  VAR(ui8_pedal_human_power, 199),
+  VAR(ui8_duty_cycle, 236),
+  VAR(ui16_motor_speed_erps, 13841),
+  VAR(ui8_foc_angle, 91),
+  VAR(ui8_error_states, 128),
+  VAR(ui8_temperature_current_limiting_value, 165),
+  VAR(ui32_wheel_speed_sensor_tick_counter, 1372106),
+  VAR(ui16_pedal_torque_x10, 24121),
+  VAR(ui16_pedal_power_x10, 43139),
+};
+
+static const expected_var_t rx_vars_throttle[] = { VAR(ui8_throttle, 51), VAR(ui8_motor_temperature, 0) };
+static const expected_var_t rx_vars_temperature[] = { VAR(ui8_throttle, 0), VAR(ui8_motor_temperature, 51) };
+
+#define TX_LENGTH_V19 (UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V19 + UART_NUMBER_CRC_BYTES)
+
+// What send_tx_package() sent for message ids 0 to 8 with the configuration of tx_setup():
+// assist level 3, walk assist on, and offroad with assist off.
+static const uint8_t tx_packets_v19[3][UART_MAX_NUMBER_MESSAGE_ID_V19 + 1][TX_LENGTH_V19] =
+{
+  {
+    { 0x59, 0x00, 0x0c, 0x01, 0x28, 0xa2, 0x01, 0xfb, 0x50 },
+    { 0x59, 0x01, 0x0c, 0x01, 0x28, 0x02, 0x08, 0x42, 0x87 },
+    { 0x59, 0x02, 0x0c, 0x01, 0x28, 0x19, 0x10, 0x48, 0x4e },
+    { 0x59, 0x03, 0x0c, 0x01, 0x28, 0x01, 0x03, 0x02, 0x52 },
+    { 0x59, 0x04, 0x0c, 0x01, 0x28, 0x34, 0x14, 0x54, 0xbb },
+    { 0x59, 0x05, 0x0c, 0x01, 0x28, 0x23, 0x01, 0x9b, 0x55 },
+    { 0x59, 0x06, 0x0c, 0x01, 0x28, 0x41, 0x55, 0xb3, 0xf9 },
+    { 0x59, 0x07, 0x0c, 0x01, 0x28, 0x32, 0x00, 0x57, 0x27 },
+    { 0x59, 0x08, 0x0c, 0x01, 0x28, 0x01, 0x01, 0x82, 0xe8 },
+  },
+  {
+    { 0x59, 0x00, 0x20, 0x03, 0x28, 0xa2, 0x01, 0x6b, 0x2e },
+    { 0x59, 0x01, 0x20, 0x03, 0x28, 0x02, 0x08, 0xd2, 0xf9 },
+    { 0x59, 0x02, 0x20, 0x03, 0x28, 0x19, 0x10, 0xd8, 0x30 },
+    { 0x59, 0x03, 0x20, 0x03, 0x28, 0x01, 0x03, 0x92, 0x2c },
+    { 0x59, 0x04, 0x20, 0x03, 0x28, 0x34, 0x14, 0xc4, 0xc5 },
+    { 0x59, 0x05, 0x20, 0x03, 0x28, 0x23, 0x01, 0x0b, 0x2b },
+    { 0x59, 0x06, 0x20, 0x03, 0x28, 0x41, 0x55, 0x23, 0x87 },
+    { 0x59, 0x07, 0x20, 0x03, 0x28, 0x32, 0x00, 0xc7, 0x59 },
+    { 0x59, 0x08, 0x20, 0x03, 0x28, 0x01, 0x01, 0x12, 0x96 },
+  },
+  {
+    { 0x59, 0x00, 0x00, 0x00, 0x28, 0xa2, 0x01, 0xea, 0xad },
+    { 0x59, 0x01, 0x00, 0x00, 0x28, 0x02, 0x08, 0x53, 0x7a },
+    { 0x59, 0x02, 0x00, 0x00, 0x28, 0x31, 0x10, 0x47, 0xb3 },
+    { 0x59, 0x03, 0x00, 0x00, 0x28, 0x01, 0x03, 0x13, 0xaf },
+    // send_tx_package() read the boost factor of assist level -1 here, now it is 0
+    { 0x59, 0x04, 0x00, 0x00, 0x28, 0x00, 0x14, 0x53, 0x86 },
+    { 0x59, 0x05, 0x00, 0x00, 0x28, 0x23, 0x01, 0x8a, 0xa8 },
+    { 0x59, 0x06, 0x00, 0x00, 0x28, 0x41, 0x55, 0xa2, 0x04 },
+    { 0x59, 0x07, 0x00, 0x00, 0x28, 0x32, 0x00, 0x46, 0xda },
+    { 0x59, 0x08, 0x00, 0x00, 0x28, 0x01, 0x01, 0x93, 0x15 },
+  },
+};
+
+static void check_vars(const l2_vars_t *p_vars, const expected_var_t *p_expected, uint8_t ui8_count)
+{
+  for (uint8_t i = 0; i < ui8_count; i++)
+  {
+    const uint8_t *p_var = (const uint8_t*) p_vars + p_expected[i].ui16_var;
+    uint32_t ui32_value = 0;
+
+    memcpy(&ui32_value, p_var, p_expected[i].ui8_size);
+    CHECK(ui32_value == p_expected[i].ui32_value, "%s is %u, expected %u", p_expected[i].p_name, ui32_value,
+        p_expected[i].ui32_value);
+  }
+}
+
+static void test_rx(void)
+{
+  const motor_packet_version_t *p_v19 = motor_packet_version(19);
+  const motor_packet_version_t *p_v20 = motor_packet_version(20);
+  uint8_t packet[sizeof(rx_packet_v19)];
+  l2_vars_t vars;
+
+  memset(&vars, 0, sizeof(vars));
+  CHECK(motor_packet_decode(p_v19, rx_packet_v19, sizeof(rx_packet_v19), &vars), "V19 packet not decoded");
+  check_vars(&vars, rx_vars, sizeof(rx_vars) / sizeof(rx_vars[0]));
+  check_vars(&vars, rx_vars_throttle, 2);
+
+  memset(&vars, 0, sizeof(vars));
+  vars.ui8_temperature_limit_feature_enabled = 1;
+  motor_packet_decode(p_v19, rx_packet_v19, sizeof(rx_packet_v19), &vars);
+  check_vars(&vars, rx_vars_temperature, 2);
+
+  // a V19 packet is one byte short for V20
+  CHECK(!motor_packet_decode(p_v20, rx_packet_v19, sizeof(rx_packet_v19), &vars), "V19 packet accepted as V20");
+
+  memcpy(packet, rx_packet_v19, sizeof(packet));
+  packet[0] = MOTOR_PACKET_TX_START_BYTE;
+  memset(&vars, 0, sizeof(vars));
+  CHECK(!motor_packet_decode(p_v19, packet, sizeof(packet), &vars) && !vars.ui16_adc_battery_voltage,
+      "packet with the wrong start byte accepted");
+
+  CHECK(!motor_packet_version(18), "unknown stream version accepted");
+}
+
+static void tx_setup(l2_vars_t *p_vars, uint8_t ui8_variant)
+{
+  memset(p_vars, 0, sizeof(*p_vars));
+
+  p_vars->ui8_assist_level = 3;
+  for (uint8_t i = 0; i < 10; i++)
+  {
+    p_vars->ui8_assist_level_factor[i] = 10 + i;
+    p_vars->ui8_walk_assist_level_factor[i] = 30 + i;
+    p_vars->ui8_startup_motor_power_boost_factor[i] = 50 + i;
+  }
+
+  p_vars->ui8_lights = 1;
+  p_vars->ui8_target_max_battery_power = 40;
+  p_vars->ui16_battery_low_voltage_cut_off_x10 = 418;
+  p_vars->ui16_wheel_perimeter = 2050;
+  p_vars->ui8_wheel_max_speed = 25;
+  p_vars->ui8_battery_max_current = 16;
+  p_vars->ui8_motor_type = 1;
+  p_vars->ui8_startup_motor_power_boost_always = 1;
+  p_vars->ui8_startup_motor_power_boost_limit_power = 1;
+  p_vars->ui8_startup_motor_power_boost_time = 20;
+  p_vars->ui8_startup_motor_power_boost_fade_time = 35;
+  p_vars->ui8_startup_motor_power_boost_feature_enabled = 1;
+  p_vars->ui8_motor_temperature_min_value_to_limit = 65;
+  p_vars->ui8_motor_temperature_max_value_to_limit = 85;
+  p_vars->ui8_ramp_up_amps_per_second_x10 = 50;
+  p_vars->ui8_temperature_limit_feature_enabled = 1;
+  p_vars->ui8_motor_assistance_startup_without_pedal_rotation = 1;
+
+  if (ui8_variant == 1)
+    p_vars->ui8_walk_assist = 1;
+  else if (ui8_variant == 2)
+  {
+    p_vars->ui8_assist_level = 0;
+    p_vars->ui8_offroad_mode = 1;
+    p_vars->ui8_lights = 0;
+  }
+}
+
+static void test_tx(void)
+{
+  const motor_packet_version_t *p_v19 = motor_packet_version(19);
+  const motor_packet_version_t *p_v20 = motor_packet_version(20);
+  uint8_t packet[UART_NUMBER_START_BYTES + UART_NUMBER_DATA_BYTES_TO_SEND_V20 + UART_NUMBER_CRC_BYTES];
+  l2_vars_t vars;
+
+  for (uint8_t ui8_variant = 0; ui8_variant < 3; ui8_variant++)
+  {
+    tx_setup(&vars, ui8_variant);
+
+    for (uint8_t ui8_id = 0; ui8_id <= p_v19->ui8_max_message_id; ui8_id++)
+    {
+      uint8_t ui8_length = motor_packet_encode(p_v19, ui8_id, &vars, packet);
+
+      if (ui8_length != TX_LENGTH_V19 || memcmp(packet, tx_packets_v19[ui8_variant][ui8_id], TX_LENGTH_V19))
+      {
+        printf("FAIL: V19 variant %u message %u:", ui8_variant, ui8_id);
+        for (uint8_t i = 0; i < ui8_length; i++)
+          printf(" %02x", packet[i]);
+        printf("\n");
+        ui32_failures++;
+      }
+    }
+  }
+
+  // V20: same fields, one more data byte and the CRC after it
+  tx_setup(&vars, 0);
+  memset(packet, 0xff, sizeof(packet));
+  CHECK(motor_packet_encode(p_v20, 2, &vars, packet) == sizeof(packet) &&
+      !memcmp(packet, tx_packets_v19[0][2], 1 + UART_NUMBER_DATA_BYTES_TO_SEND_V19) &&
+      packet[1 + UART_NUMBER_DATA_BYTES_TO_SEND_V19] == 0, "V20 packet");
+
+  uint16_t ui16_crc = crc16_buffer(CRC16_INIT, packet, UART_NUMBER_DATA_BYTES_TO_SEND_V20 + 1);
+  CHECK(packet[sizeof(packet) - 2] == (ui16_crc & 0xff) && packet[sizeof(packet) - 1] == (ui16_crc >> 8), "V20 CRC");
+}
+
+// The settings in the TX messages and the message that takes each
+typedef struct
+{
+  const char *p_name;
+  uint16_t ui16_var;
+  uint8_t ui8_message_id;
+} tx_setting_t;
+
+#define SETTING(var, message_id) { #var, offsetof(l2_vars_t, var), message_id }
+
+static const tx_setting_t tx_settings[] =
+{
+  SETTING(ui16_battery_low_voltage_cut_off_x10, 0),
+  SETTING(ui16_wheel_perimeter, 1),
+  SETTING(ui8_wheel_max_speed, 2),
+  SETTING(ui8_battery_max_current, 2),
+  SETTING(ui8_motor_type, 3),
+  SETTING(ui8_startup_motor_power_boost_always, 3),
+  SETTING(ui8_startup_motor_power_boost_limit_power, 3),
+  SETTING(ui8_startup_motor_power_boost_factor[2], 4), // assist level 3
+  SETTING(ui8_startup_motor_power_boost_time, 4),
+  SETTING(ui8_startup_motor_power_boost_fade_time, 5),
+  SETTING(ui8_startup_motor_power_boost_feature_enabled, 5),
+  SETTING(ui8_motor_temperature_min_value_to_limit, 6),
+  SETTING(ui8_motor_temperature_max_value_to_limit, 6),
+  SETTING(ui8_ramp_up_amps_per_second_x10, 7),
+  SETTING(ui8_temperature_limit_feature_enabled, 8),
+  SETTING(ui8_motor_assistance_startup_without_pedal_rotation, 8),
+};
+
+// packets until the change made after ui16_phase packets is sent, 0 if it isn't within 100
+static uint8_t schedule_delay(const motor_packet_version_t *p_version, const tx_setting_t *p_setting,
+    uint16_t ui16_phase, bool rotation)
+{
+  motor_packet_schedule_t schedule;
+  l2_vars_t vars;
+  uint8_t ui8_messages = p_version->ui8_max_message_id + 1;
+  uint16_t ui16_packet = 0;
+
+  memset(&schedule, 0, sizeof(schedule));
+  tx_setup(&vars, 0);
+
+  // past the first round, where every message is new and the refresh goes between them
+  for (; ui16_packet < 2 * ui8_messages + ui16_phase; ui16_packet++)
+    motor_packet_schedule(&schedule, p_version, &vars);
+
+  ((uint8_t*) &vars)[p_setting->ui16_var] ^= 1;
+
+  for (uint8_t ui8_delay = 1; ui8_delay <= 100; ui8_delay++, ui16_packet++)
+  {
+    uint8_t ui8_id = rotation ? ui16_packet % ui8_messages : motor_packet_schedule(&schedule, p_version, &vars);
+    if (ui8_id == p_setting->ui8_message_id)
+      return ui8_delay;
+  }
+
+  return 0;
+}
+
+static void test_schedule(void)
+{
+  static const uint8_t versions[] = { 19, 20 };
+
+  for (uint8_t v = 0; v < sizeof(versions); v++)
+  {
+    const motor_packet_version_t *p_version = motor_packet_version(versions[v]);
+    uint16_t ui16_cycle = (p_version->ui8_max_message_id + 1) * (MOTOR_PACKET_DIRTY_BURST + 1);
+
+    printf("V%u worst case packets from a change to the motor: schedule / rotation\n", versions[v]);
+
+    for (uint8_t i = 0; i < sizeof(tx_settings) / sizeof(tx_settings[0]); i++)
+    {
+      const tx_setting_t *p_setting = &tx_settings[i];
+      uint8_t ui8_worst = 0, ui8_worst_rotation = 0;
+
+      if (p_setting->ui8_message_id > p_version->ui8_max_message_id)
+        continue; // not in this version
+
+      for (uint16_t ui16_phase = 0; ui16_phase < 2 * ui16_cycle; ui16_phase++)
+      {
+        uint8_t ui8_delay = schedule_delay(p_version, p_setting, ui16_phase, false);
+        uint8_t ui8_delay_rotation = schedule_delay(p_version, p_setting, ui16_phase, true);
+
+        if (!ui8_delay || ui8_delay > ui8_worst)
+          ui8_worst = ui8_delay ? ui8_delay : 255;
+        if (ui8_delay_rotation > ui8_worst_rotation)
+          ui8_worst_rotation = ui8_delay_rotation;
+      }
+
+      printf("  %-52s %3u / %u\n", p_setting->p_name, ui8_worst, ui8_worst_rotation);
+      CHECK(ui8_worst == 1, "V%u %s takes %u packets", versions[v], p_setting->p_name, ui8_worst);
+    }
+
+    // a setting that changes every packet still leaves room for the refresh of the others
+    motor_packet_schedule_t schedule;
+    l2_vars_t vars;
+    uint16_t last_sent[MOTOR_PACKET_MAX_MESSAGES] = { 0 };
+    uint16_t ui16_max_gap = 0, ui16_max_gap_changing = 0;
+
+    memset(&schedule, 0, sizeof(schedule));
+    tx_setup(&vars, 0);
+    for (uint16_t ui16_packet = 1; ui16_packet <= 1000; ui16_packet++)
+    {
+      vars.ui16_wheel_perimeter++;
+      uint8_t ui8_id = motor_packet_schedule(&schedule, p_version, &vars);
+      uint16_t ui16_gap = ui16_packet - last_sent[ui8_id];
+
+      if (ui16_packet <= ui16_cycle)
+        ; // the first round
+      else if (ui8_id == 1 && ui16_gap > ui16_max_gap_changing)
+        ui16_max_gap_changing = ui16_gap;
+      else if (ui8_id != 1 && ui16_gap > ui16_max_gap)
+        ui16_max_gap = ui16_gap;
+      last_sent[ui8_id] = ui16_packet;
+    }
+
+    printf("  a setting changing every packet: sent every %u packets at most, the others every %u (cycle %u)\n",
+        ui16_max_gap_changing, ui16_max_gap, ui16_cycle);
+    CHECK(ui16_max_gap_changing <= 2 && ui16_max_gap <= ui16_cycle, "the refresh with a setting changing every packet");
+  }
+}
+
+static double elapsed_ns(const struct timespec *p_start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - p_start->tv_sec) * 1e9 + (now.tv_nsec - p_start->tv_nsec);
+}
+
+static void timing(uint32_t ui32_packets)
+{
+  const motor_packet_version_t *p_v19 = motor_packet_version(19);
+  uint8_t packet[TX_LENGTH_V19];
+  volatile uint32_t ui32_sink = 0;
+  struct timespec start;
+  l2_vars_t vars;
+  double decode_ns, encode_ns;
+
+  memset(&vars, 0, sizeof(vars));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_packets; i++)
+  {
+    motor_packet_decode(p_v19, rx_packet_v19, sizeof(rx_packet_v19), &vars);
+    ui32_sink += vars.ui16_wheel_speed_x10;
+  }
+  decode_ns = elapsed_ns(&start) / ui32_packets;
+
+  tx_setup(&vars, 0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t i = 0; i < ui32_packets; i++)
+  {
+    motor_packet_encode(p_v19, i % (UART_MAX_NUMBER_MESSAGE_ID_V19 + 1), &vars, packet);
+    ui32_sink += packet[5];
+  }
+  encode_ns = elapsed_ns(&start) / ui32_packets;
+
+  printf("%u packets: decode %.1f ns, encode %.1f ns (CRC included) per packet\n", ui32_packets, decode_ns, encode_ns);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_packets = 1000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_packets = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n packets]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  test_rx();
+  test_tx();
+  test_schedule();
+
+  if (host_test_failed())
+    return 1;
+
+  printf("captured packets match\n");
+
+  if (ui32_packets)
+    timing(ui32_packets);
+
+  return 0;
+}
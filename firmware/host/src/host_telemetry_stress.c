@@ -0,0 +1,104 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+/*
+ * Stress test of the layer 2 to layer 3 telemetry snapshot (common/src/telemetry.c).
+ *
+ * A writer thread plays layer_2() and publishes frames as fast as it can, every byte of frame N
+ * set to N. A reader thread plays the main loop and takes snapshots as fast as it can. A snapshot
+ * with bytes from two frames is a torn read. On the displays the writer is an interrupt, so it
+ * never runs at the same time as the reader, but a second core makes every race far more likely.
+ *
+ *   -n <frames>   frames to publish (default 100000000)
+ *
+ * Exits with 1 if a torn snapshot was seen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "telemetry.h"
+
+static uint32_t ui32_frames = 100000000;
+static volatile bool writer_done;
+
+static void* writer(void *p_arg)
+{
+  (void) p_arg;
+
+  for (uint32_t ui32_frame = 1; ui32_frame <= ui32_frames; ui32_frame++)
+  {
+    memset(telemetry_back_buffer(), (uint8_t) ui32_frame, sizeof(l2_telemetry_t));
+    telemetry_publish();
+  }
+
+  writer_done = true;
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t ui32_snapshots = 0;
+  uint32_t ui32_retries = 0;
+  uint32_t ui32_torn = 0;
+  uint32_t ui32_new_frames = 0;
+  uint8_t ui8_last = 0;
+  pthread_t writer_thread;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'n':
+        ui32_frames = strtoul(optarg, NULL, 0);
+        break;
+
+      default:
+        fprintf(stderr, "usage: %s [-n frames]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (pthread_create(&writer_thread, NULL, writer, NULL))
+  {
+    perror("pthread_create");
+    return 1;
+  }
+
+  while (!writer_done)
+  {
+    l2_telemetry_t snapshot;
+    const uint8_t *p_byte = (const uint8_t*) &snapshot;
+
+    ui32_retries += telemetry_snapshot(&snapshot);
+    ui32_snapshots++;
+
+    for (uint32_t i = 1; i < sizeof(snapshot); i++)
+    {
+      if (p_byte[i] != p_byte[0])
+      {
+        ui32_torn++;
+        break;
+      }
+    }
+
+    if (p_byte[0] != ui8_last)
+    {
+      ui8_last = p_byte[0];
+      ui32_new_frames++;
+    }
+  }
+
+  pthread_join(writer_thread, NULL);
+
+  printf("%u frames published, %u snapshots (%u saw a new frame), %u retries, %u torn\n",
+      ui32_frames, ui32_snapshots, ui32_new_frames, ui32_retries, ui32_torn);
+
+  return ui32_torn ? 1 : 0;
+}
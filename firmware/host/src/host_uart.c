@@ -0,0 +1,73 @@
+/*
+ * Bafang LCD firmware - host build
+ *
+ * Released under the GPL License, Version 3
+ */
+
+// Fake motor UART. Nothing is ever received, so the common code runs its simulated motor
+// (battery voltage is reported below 14V), and transmitted packets are only counted.
+
+#include <stddef.h>
+#include "uart.h"
+#include "adc.h"
+#include "host.h"
+
+static uint8_t ui8_tx_buffer[UART_NUMBER_DATA_BYTES_TO_SEND_V20 + UART_NUMBER_START_BYTES + UART_NUMBER_CRC_BYTES + 1];
+static uint32_t ui32_tx_packets;
+static uint8_t ui8_stream_version = 19; // as the targets, layer_2() sets the one of the setting
+uart_rx_stats_t uart_rx_stats;
+
+void uart_init(void)
+{
+}
+
+uint8_t uart_get_stream_version(void)
+{
+  return ui8_stream_version;
+}
+
+void uart_set_stream_version(uint8_t version)
+{
+  ui8_stream_version = version;
+}
+
+const uint8_t* uart_get_rx_buffer_rdy(uint8_t *p_length)
+{
+  (void) p_length;
+  return NULL;
+}
+
+uint8_t* uart_get_tx_buffer(void)
+{
+  return ui8_tx_buffer;
+}
+
+void uart_send_tx_buffer(uint8_t *tx_buffer)
+{
+  (void) tx_buffer;
+  ui32_tx_packets++;
+}
+
+bool uart_tx_busy(void)
+{
+  return false;
+}
+
+void uart_set_baud(uint32_t ui32_baud)
+{
+  (void) ui32_baud;
+}
+
+uint32_t host_uart_tx_packets(void)
+{
+  return ui32_tx_packets;
+}
+
+void battery_voltage_init(void)
+{
+}
+
+uint16_t battery_voltage_10x_get()
+{
+  return 120; // a bench supply, the firmware switches to its simulated motor
+}